@@ -0,0 +1,113 @@
+#include "assets.h"
+
+#include <sys/stat.h>
+
+#ifdef ASSETS_VERIFY
+#define ASSET_PAK_FLAGS				PAK_FLAG_VERIFY
+#else
+#define ASSET_PAK_FLAGS				0
+#endif
+
+static pak					asset_pak;
+static bool					has_pak;
+static char					*asset_pak_path;
+static char					*asset_root;
+
+void assets_init(char *pack_path, char *loose_root)
+{
+	has_pak = pak_open(&asset_pak, pack_path, ASSET_PAK_FLAGS);
+	asset_pak_path = pack_path;
+	asset_root = loose_root;
+
+	if (has_pak)
+		dbg_log("opened asset pack successfully");
+	else
+		dbg_warn("no asset pack found, loading loose files");
+}
+
+void assets_clean(void)
+{
+	if (has_pak)
+		pak_close(&asset_pak);
+
+	has_pak = false;
+}
+
+bool asset_try_load(asset *a, char *name)
+{
+	const pak_entry				*entry;
+	char					path[ASSET_PATH_MAX];
+
+	if (has_pak && (entry = pak_find(&asset_pak, name)) != NULL) {
+		if (!pak_read(&asset_pak, entry, &a->blob)) {
+			dbg_warn("asset failed its pack checksum");
+
+			return false;
+		}
+
+		a->data = a->blob.data;
+		a->len = a->blob.len;
+		a->from_pack = true;
+
+		return true;
+	}
+
+	snprintf(path, sizeof(path), "%s/%s", asset_root, name);
+
+	if (!fv_try_open(&a->fv, path, FV_HINT_SEQUENTIAL))
+		return false;
+
+	a->data = a->fv.data;
+	a->len = a->fv.len;
+	a->from_pack = false;
+
+	return true;
+}
+
+void asset_load(asset *a, char *name)
+{
+	if (!asset_try_load(a, name))
+		dbg_error("could not load asset");
+}
+
+void asset_release(asset *a)
+{
+	if (a->from_pack)
+		pak_blob_release(&a->blob);
+	else
+		fv_close(&a->fv);
+
+	a->data = NULL;
+	a->len = 0;
+}
+
+bool asset_locate(asset_loc *loc, char *name)
+{
+	const pak_entry				*entry;
+	struct stat				st;
+
+	memset(loc, '\0', sizeof(asset_loc));
+
+	if (has_pak && (entry = pak_find(&asset_pak, name)) != NULL) {
+		snprintf(loc->path, sizeof(loc->path), "%s", asset_pak_path);
+
+		loc->offset = entry->offset;
+		loc->stored_len = entry->stored_len;
+		loc->raw_len = entry->raw_len;
+		loc->checksum = entry->checksum;
+		loc->lz4 = (entry->flags & PAK_ENTRY_LZ4) != 0;
+		loc->verify = (asset_pak.flags & PAK_FLAG_VERIFY) != 0;
+
+		return true;
+	}
+
+	snprintf(loc->path, sizeof(loc->path), "%s/%s", asset_root, name);
+
+	if (stat(loc->path, &st) != 0 || !S_ISREG(st.st_mode))
+		return false;
+
+	loc->stored_len = st.st_size;
+	loc->raw_len = st.st_size;
+
+	return true;
+}
@@ -0,0 +1,46 @@
+#ifndef ASSETS_H_INCLUDED
+#define ASSETS_H_INCLUDED
+
+#include "../util/debug.h"
+#include "../util/util.h"
+#include "../util/pack.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <stdbool.h>
+
+#define ASSET_PATH_MAX				1024
+
+typedef struct {
+	const uint8_t *data;
+	size_t len;
+	bool from_pack;
+	pak_blob blob;
+	file_view fv;
+} asset;
+
+/* where an asset's bytes live on disk, for readers that do their own i/o */
+typedef struct {
+	char path[ASSET_PATH_MAX];
+	uint64_t offset;
+	uint64_t stored_len;
+	uint64_t raw_len;
+	uint32_t checksum;
+	bool lz4;
+	bool verify;
+} asset_loc;
+
+void assets_init(char *pack_path, char *loose_root);
+
+void assets_clean(void);
+
+bool asset_try_load(asset *a, char *name);
+
+void asset_load(asset *a, char *name);
+
+void asset_release(asset *a);
+
+bool asset_locate(asset_loc *loc, char *name);
+
+#endif
@@ -0,0 +1,481 @@
+#include "cull.h"
+
+#include <math.h>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define CULL_X86
+#endif
+
+/*
+ * kernels process objects [first, cnt) so the simd ones can hand their tail to the scalar
+ * ones; every isa evaluates the same expressions in the same order without fma, so all
+ * three produce bit-identical streams and visible lists
+ */
+typedef struct {
+	void (*mul)(const float *a, float *const *m, uint32_t first, uint32_t cnt);
+	void (*aabbs)(float *const *m, float *const *local, float *const *world, uint32_t first, uint32_t cnt);
+	uint32_t (*spheres)(const frustum *f, float *const *world, uint32_t *visible, uint32_t first, uint32_t cnt);
+} cull_kernels;
+
+static void mul_scalar(const float *a, float *const *m, uint32_t first, uint32_t cnt)
+{
+	float					b[16];
+
+	for (uint32_t i = first; i < cnt; i++) {
+		for (uint32_t k = 0; k < 16; k++)
+			b[k] = m[k][i];
+
+		for (uint32_t col = 0; col < 4; col++) {
+			for (uint32_t row = 0; row < 4; row++) {
+				m[col * 4 + row][i] = a[row] * b[col * 4] + a[4 + row] * b[col * 4 + 1] +
+					a[8 + row] * b[col * 4 + 2] + a[12 + row] * b[col * 4 + 3];
+			}
+		}
+	}
+}
+
+/* arvo's method: the center goes through the matrix, the extents through its absolute value */
+static void aabbs_scalar(float *const *m, float *const *local, float *const *world, uint32_t first, uint32_t cnt)
+{
+	float					cx, cy, cz, ex, ey, ez;
+
+	for (uint32_t i = first; i < cnt; i++) {
+		cx = local[0][i];
+		cy = local[1][i];
+		cz = local[2][i];
+		ex = local[3][i];
+		ey = local[4][i];
+		ez = local[5][i];
+
+		for (uint32_t r = 0; r < 3; r++) {
+			world[r][i] = m[r][i] * cx + m[4 + r][i] * cy + m[8 + r][i] * cz + m[12 + r][i];
+			world[3 + r][i] = fabsf(m[r][i]) * ex + fabsf(m[4 + r][i]) * ey + fabsf(m[8 + r][i]) * ez;
+		}
+
+		world[6][i] = sqrtf(world[3][i] * world[3][i] + world[4][i] * world[4][i] + world[5][i] * world[5][i]);
+	}
+}
+
+static uint32_t spheres_scalar(const frustum *f, float *const *world, uint32_t *visible, uint32_t first, uint32_t cnt)
+{
+	const float				*pl;
+	uint32_t				n;
+	bool					inside;
+
+	n = 0;
+
+	for (uint32_t i = first; i < cnt; i++) {
+		inside = true;
+
+		for (uint32_t p = 0; p < 6 && inside; p++) {
+			pl = f->planes[p];
+
+			if (pl[0] * world[0][i] + pl[1] * world[1][i] + pl[2] * world[2][i] + pl[3] < -world[6][i])
+				inside = false;
+		}
+
+		if (inside)
+			visible[n++] = i;
+	}
+
+	return n;
+}
+
+#ifdef CULL_X86
+__attribute__((target("sse2")))
+static void mul_sse2(const float *a, float *const *m, uint32_t first, uint32_t cnt)
+{
+	__m128					b[16], r;
+	uint32_t				i;
+
+	for (i = first; i + 4 <= cnt; i += 4) {
+		for (uint32_t k = 0; k < 16; k++)
+			b[k] = _mm_loadu_ps(m[k] + i);
+
+		for (uint32_t col = 0; col < 4; col++) {
+			for (uint32_t row = 0; row < 4; row++) {
+				r = _mm_mul_ps(_mm_set1_ps(a[row]), b[col * 4]);
+				r = _mm_add_ps(r, _mm_mul_ps(_mm_set1_ps(a[4 + row]), b[col * 4 + 1]));
+				r = _mm_add_ps(r, _mm_mul_ps(_mm_set1_ps(a[8 + row]), b[col * 4 + 2]));
+				r = _mm_add_ps(r, _mm_mul_ps(_mm_set1_ps(a[12 + row]), b[col * 4 + 3]));
+
+				_mm_storeu_ps(m[col * 4 + row] + i, r);
+			}
+		}
+	}
+
+	mul_scalar(a, m, i, cnt);
+}
+
+__attribute__((target("sse2")))
+static void aabbs_sse2(float *const *m, float *const *local, float *const *world, uint32_t first, uint32_t cnt)
+{
+	__m128					c[3], e[3], abs_mask, wc, we, r2;
+	uint32_t				i;
+
+	abs_mask = _mm_castsi128_ps(_mm_set1_epi32(0x7fffffff));
+
+	for (i = first; i + 4 <= cnt; i += 4) {
+		for (uint32_t k = 0; k < 3; k++) {
+			c[k] = _mm_loadu_ps(local[k] + i);
+			e[k] = _mm_loadu_ps(local[3 + k] + i);
+		}
+
+		r2 = _mm_setzero_ps();
+
+		for (uint32_t r = 0; r < 3; r++) {
+			wc = _mm_mul_ps(_mm_loadu_ps(m[r] + i), c[0]);
+			wc = _mm_add_ps(wc, _mm_mul_ps(_mm_loadu_ps(m[4 + r] + i), c[1]));
+			wc = _mm_add_ps(wc, _mm_mul_ps(_mm_loadu_ps(m[8 + r] + i), c[2]));
+			wc = _mm_add_ps(wc, _mm_loadu_ps(m[12 + r] + i));
+
+			we = _mm_mul_ps(_mm_and_ps(_mm_loadu_ps(m[r] + i), abs_mask), e[0]);
+			we = _mm_add_ps(we, _mm_mul_ps(_mm_and_ps(_mm_loadu_ps(m[4 + r] + i), abs_mask), e[1]));
+			we = _mm_add_ps(we, _mm_mul_ps(_mm_and_ps(_mm_loadu_ps(m[8 + r] + i), abs_mask), e[2]));
+
+			_mm_storeu_ps(world[r] + i, wc);
+			_mm_storeu_ps(world[3 + r] + i, we);
+
+			r2 = _mm_add_ps(r2, _mm_mul_ps(we, we));
+		}
+
+		_mm_storeu_ps(world[6] + i, _mm_sqrt_ps(r2));
+	}
+
+	aabbs_scalar(m, local, world, i, cnt);
+}
+
+__attribute__((target("sse2")))
+static uint32_t spheres_sse2(const frustum *f, float *const *world, uint32_t *visible, uint32_t first, uint32_t cnt)
+{
+	__m128					x, y, z, neg_r, d, out;
+	const float				*pl;
+	uint32_t				i, n, mask;
+
+	n = 0;
+
+	for (i = first; i + 4 <= cnt; i += 4) {
+		x = _mm_loadu_ps(world[0] + i);
+		y = _mm_loadu_ps(world[1] + i);
+		z = _mm_loadu_ps(world[2] + i);
+		neg_r = _mm_sub_ps(_mm_setzero_ps(), _mm_loadu_ps(world[6] + i));
+		out = _mm_setzero_ps();
+
+		for (uint32_t p = 0; p < 6; p++) {
+			pl = f->planes[p];
+
+			d = _mm_mul_ps(_mm_set1_ps(pl[0]), x);
+			d = _mm_add_ps(d, _mm_mul_ps(_mm_set1_ps(pl[1]), y));
+			d = _mm_add_ps(d, _mm_mul_ps(_mm_set1_ps(pl[2]), z));
+			d = _mm_add_ps(d, _mm_set1_ps(pl[3]));
+
+			out = _mm_or_ps(out, _mm_cmplt_ps(d, neg_r));
+		}
+
+		mask = ~(uint32_t)_mm_movemask_ps(out) & 0xf;
+
+		while (mask != 0) {
+			visible[n++] = i + __builtin_ctz(mask);
+			mask &= mask - 1;
+		}
+	}
+
+	return n + spheres_scalar(f, world, visible + n, i, cnt);
+}
+
+__attribute__((target("avx2")))
+static void mul_avx2(const float *a, float *const *m, uint32_t first, uint32_t cnt)
+{
+	__m256					b[16], r;
+	uint32_t				i;
+
+	for (i = first; i + 8 <= cnt; i += 8) {
+		for (uint32_t k = 0; k < 16; k++)
+			b[k] = _mm256_loadu_ps(m[k] + i);
+
+		for (uint32_t col = 0; col < 4; col++) {
+			for (uint32_t row = 0; row < 4; row++) {
+				r = _mm256_mul_ps(_mm256_set1_ps(a[row]), b[col * 4]);
+				r = _mm256_add_ps(r, _mm256_mul_ps(_mm256_set1_ps(a[4 + row]), b[col * 4 + 1]));
+				r = _mm256_add_ps(r, _mm256_mul_ps(_mm256_set1_ps(a[8 + row]), b[col * 4 + 2]));
+				r = _mm256_add_ps(r, _mm256_mul_ps(_mm256_set1_ps(a[12 + row]), b[col * 4 + 3]));
+
+				_mm256_storeu_ps(m[col * 4 + row] + i, r);
+			}
+		}
+	}
+
+	mul_scalar(a, m, i, cnt);
+}
+
+__attribute__((target("avx2")))
+static void aabbs_avx2(float *const *m, float *const *local, float *const *world, uint32_t first, uint32_t cnt)
+{
+	__m256					c[3], e[3], abs_mask, wc, we, r2;
+	uint32_t				i;
+
+	abs_mask = _mm256_castsi256_ps(_mm256_set1_epi32(0x7fffffff));
+
+	for (i = first; i + 8 <= cnt; i += 8) {
+		for (uint32_t k = 0; k < 3; k++) {
+			c[k] = _mm256_loadu_ps(local[k] + i);
+			e[k] = _mm256_loadu_ps(local[3 + k] + i);
+		}
+
+		r2 = _mm256_setzero_ps();
+
+		for (uint32_t r = 0; r < 3; r++) {
+			wc = _mm256_mul_ps(_mm256_loadu_ps(m[r] + i), c[0]);
+			wc = _mm256_add_ps(wc, _mm256_mul_ps(_mm256_loadu_ps(m[4 + r] + i), c[1]));
+			wc = _mm256_add_ps(wc, _mm256_mul_ps(_mm256_loadu_ps(m[8 + r] + i), c[2]));
+			wc = _mm256_add_ps(wc, _mm256_loadu_ps(m[12 + r] + i));
+
+			we = _mm256_mul_ps(_mm256_and_ps(_mm256_loadu_ps(m[r] + i), abs_mask), e[0]);
+			we = _mm256_add_ps(we, _mm256_mul_ps(_mm256_and_ps(_mm256_loadu_ps(m[4 + r] + i), abs_mask), e[1]));
+			we = _mm256_add_ps(we, _mm256_mul_ps(_mm256_and_ps(_mm256_loadu_ps(m[8 + r] + i), abs_mask), e[2]));
+
+			_mm256_storeu_ps(world[r] + i, wc);
+			_mm256_storeu_ps(world[3 + r] + i, we);
+
+			r2 = _mm256_add_ps(r2, _mm256_mul_ps(we, we));
+		}
+
+		_mm256_storeu_ps(world[6] + i, _mm256_sqrt_ps(r2));
+	}
+
+	aabbs_scalar(m, local, world, i, cnt);
+}
+
+__attribute__((target("avx2")))
+static uint32_t spheres_avx2(const frustum *f, float *const *world, uint32_t *visible, uint32_t first, uint32_t cnt)
+{
+	__m256					x, y, z, neg_r, d, out;
+	const float				*pl;
+	uint32_t				i, n, mask;
+
+	n = 0;
+
+	for (i = first; i + 8 <= cnt; i += 8) {
+		x = _mm256_loadu_ps(world[0] + i);
+		y = _mm256_loadu_ps(world[1] + i);
+		z = _mm256_loadu_ps(world[2] + i);
+		neg_r = _mm256_sub_ps(_mm256_setzero_ps(), _mm256_loadu_ps(world[6] + i));
+		out = _mm256_setzero_ps();
+
+		for (uint32_t p = 0; p < 6; p++) {
+			pl = f->planes[p];
+
+			d = _mm256_mul_ps(_mm256_set1_ps(pl[0]), x);
+			d = _mm256_add_ps(d, _mm256_mul_ps(_mm256_set1_ps(pl[1]), y));
+			d = _mm256_add_ps(d, _mm256_mul_ps(_mm256_set1_ps(pl[2]), z));
+			d = _mm256_add_ps(d, _mm256_set1_ps(pl[3]));
+
+			out = _mm256_or_ps(out, _mm256_cmp_ps(d, neg_r, _CMP_LT_OQ));
+		}
+
+		mask = ~(uint32_t)_mm256_movemask_ps(out) & 0xff;
+
+		while (mask != 0) {
+			visible[n++] = i + __builtin_ctz(mask);
+			mask &= mask - 1;
+		}
+	}
+
+	return n + spheres_scalar(f, world, visible + n, i, cnt);
+}
+#endif
+
+static const cull_kernels kernels[CULL_ISA_CNT] = {
+	[CULL_ISA_SCALAR] = { mul_scalar, aabbs_scalar, spheres_scalar },
+#ifdef CULL_X86
+	[CULL_ISA_SSE2] = { mul_sse2, aabbs_sse2, spheres_sse2 },
+	[CULL_ISA_AVX2] = { mul_avx2, aabbs_avx2, spheres_avx2 },
+#endif
+};
+
+static cull_isa					cur_isa;
+
+bool cull_isa_supported(cull_isa isa)
+{
+	if (isa >= CULL_ISA_CNT || kernels[isa].mul == NULL)
+		return false;
+
+#ifdef CULL_X86
+	__builtin_cpu_init();
+
+	if (isa == CULL_ISA_SSE2)
+		return __builtin_cpu_supports("sse2");
+
+	if (isa == CULL_ISA_AVX2)
+		return __builtin_cpu_supports("avx2");
+#endif
+
+	return true;
+}
+
+/* picks the widest isa the cpu runs, the scalar kernels are used until this is called */
+cull_isa cull_init(void)
+{
+	cur_isa = CULL_ISA_SCALAR;
+
+	for (int isa = CULL_ISA_CNT - 1; isa > CULL_ISA_SCALAR; isa--) {
+		if (cull_isa_supported(isa)) {
+			cur_isa = isa;
+			break;
+		}
+	}
+
+	dbg_log("selected %s cull kernels successfully", cull_isa_name(cur_isa));
+
+	return cur_isa;
+}
+
+bool cull_select_isa(cull_isa isa)
+{
+	if (!cull_isa_supported(isa))
+		return false;
+
+	cur_isa = isa;
+
+	return true;
+}
+
+cull_isa cull_get_isa(void)
+{
+	return cur_isa;
+}
+
+const char *cull_isa_name(cull_isa isa)
+{
+	switch (isa) {
+	case CULL_ISA_SCALAR:
+		return "scalar";
+	case CULL_ISA_SSE2:
+		return "sse2";
+	case CULL_ISA_AVX2:
+		return "avx2";
+	default:
+		return "unknown";
+	}
+}
+
+void cull_set_init(cull_set *set)
+{
+	for (uint32_t i = 0; i < CULL_MODEL_STREAMS; i++)
+		cull_f32_list_init(&set->model[i]);
+
+	for (uint32_t i = 0; i < CULL_LOCAL_STREAMS; i++)
+		cull_f32_list_init(&set->local[i]);
+
+	for (uint32_t i = 0; i < CULL_WORLD_STREAMS; i++)
+		cull_f32_list_init(&set->world[i]);
+
+	cull_u32_list_init(&set->visible);
+
+	set->cnt = 0;
+}
+
+void cull_set_clean(cull_set *set)
+{
+	for (uint32_t i = 0; i < CULL_MODEL_STREAMS; i++)
+		cull_f32_list_clean(&set->model[i]);
+
+	for (uint32_t i = 0; i < CULL_LOCAL_STREAMS; i++)
+		cull_f32_list_clean(&set->local[i]);
+
+	for (uint32_t i = 0; i < CULL_WORLD_STREAMS; i++)
+		cull_f32_list_clean(&set->world[i]);
+
+	cull_u32_list_clean(&set->visible);
+
+	set->cnt = 0;
+}
+
+void cull_set_clear(cull_set *set)
+{
+	for (uint32_t i = 0; i < CULL_MODEL_STREAMS; i++)
+		cull_f32_list_clear(&set->model[i]);
+
+	for (uint32_t i = 0; i < CULL_LOCAL_STREAMS; i++)
+		cull_f32_list_clear(&set->local[i]);
+
+	for (uint32_t i = 0; i < CULL_WORLD_STREAMS; i++)
+		cull_f32_list_clear(&set->world[i]);
+
+	cull_u32_list_clear(&set->visible);
+
+	set->cnt = 0;
+}
+
+/* aabb is a center and half extents in model space, as in mesh.aabb */
+uint32_t cull_set_add(cull_set *set, const mat4 *model, const float *aabb)
+{
+	for (uint32_t i = 0; i < CULL_MODEL_STREAMS; i++)
+		cull_f32_list_push(&set->model[i], model->m[i]);
+
+	for (uint32_t i = 0; i < CULL_LOCAL_STREAMS; i++)
+		cull_f32_list_push(&set->local[i], aabb[i]);
+
+	return set->cnt++;
+}
+
+void cull_set_model(const cull_set *set, uint32_t ind, mat4 *model)
+{
+	for (uint32_t i = 0; i < CULL_MODEL_STREAMS; i++)
+		model->m[i] = set->model[i].elems[ind];
+}
+
+static inline void get_streams(cull_f32_list *lists, uint32_t cnt, float **streams)
+{
+	for (uint32_t i = 0; i < cnt; i++)
+		streams[i] = lists[i].elems;
+}
+
+/* every model becomes a * model, e.g. to move a whole set under a parent transform */
+void cull_mul(cull_set *set, const mat4 *a)
+{
+	float					*m[CULL_MODEL_STREAMS];
+
+	get_streams(set->model, CULL_MODEL_STREAMS, m);
+
+	kernels[cur_isa].mul(a->m, m, 0, set->cnt);
+}
+
+void cull_transform_aabbs(cull_set *set)
+{
+	float					*m[CULL_MODEL_STREAMS], *local[CULL_LOCAL_STREAMS];
+	float					*world[CULL_WORLD_STREAMS];
+
+	for (uint32_t i = 0; i < CULL_WORLD_STREAMS; i++) {
+		cull_f32_list_reserve(&set->world[i], set->cnt);
+		set->world[i].size = set->cnt;
+	}
+
+	get_streams(set->model, CULL_MODEL_STREAMS, m);
+	get_streams(set->local, CULL_LOCAL_STREAMS, local);
+	get_streams(set->world, CULL_WORLD_STREAMS, world);
+
+	kernels[cur_isa].aabbs(m, local, world, 0, set->cnt);
+}
+
+/* tests the world bounding spheres from the last cull_transform_aabbs, visible is rewritten in index order */
+uint32_t cull_test_spheres(cull_set *set, const frustum *f)
+{
+	float					*world[CULL_WORLD_STREAMS];
+
+	cull_u32_list_reserve(&set->visible, set->cnt);
+
+	get_streams(set->world, CULL_WORLD_STREAMS, world);
+
+	set->visible.size = kernels[cur_isa].spheres(f, world, set->visible.elems, 0, set->cnt);
+
+	return set->visible.size;
+}
+
+uint32_t cull_run(cull_set *set, const frustum *f)
+{
+	cull_transform_aabbs(set);
+
+	return cull_test_spheres(set, f);
+}
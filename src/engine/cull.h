@@ -0,0 +1,70 @@
+#ifndef CULL_H_INCLUDED
+#define CULL_H_INCLUDED
+
+#include "../util/debug.h"
+#include "../util/util.h"
+#include "../util/dynarr.h"
+#include "../util/vmath.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <stdbool.h>
+
+#define CULL_MODEL_STREAMS			16
+#define CULL_LOCAL_STREAMS			6
+#define CULL_WORLD_STREAMS			7
+
+typedef enum {
+	CULL_ISA_SCALAR,
+	CULL_ISA_SSE2,
+	CULL_ISA_AVX2,
+	CULL_ISA_CNT,
+} cull_isa;
+
+DYNARR_DEFINE(cull_f32_list, float)
+
+DYNARR_DEFINE(cull_u32_list, uint32_t)
+
+/*
+ * structure of arrays, one stream per scalar so the kernels load 4 or 8 objects per instruction;
+ * model is column-major like mat4, local is aabb center and half extents, world is the transformed
+ * aabb followed by the radius of its bounding sphere, visible the indices that passed the last cull
+ */
+typedef struct {
+	cull_f32_list model[CULL_MODEL_STREAMS];
+	cull_f32_list local[CULL_LOCAL_STREAMS];
+	cull_f32_list world[CULL_WORLD_STREAMS];
+	cull_u32_list visible;
+	uint32_t cnt;
+} cull_set;
+
+cull_isa cull_init(void);
+
+bool cull_isa_supported(cull_isa isa);
+
+bool cull_select_isa(cull_isa isa);
+
+cull_isa cull_get_isa(void);
+
+const char *cull_isa_name(cull_isa isa);
+
+void cull_set_init(cull_set *set);
+
+void cull_set_clean(cull_set *set);
+
+void cull_set_clear(cull_set *set);
+
+uint32_t cull_set_add(cull_set *set, const mat4 *model, const float *aabb);
+
+void cull_set_model(const cull_set *set, uint32_t ind, mat4 *model);
+
+void cull_mul(cull_set *set, const mat4 *a);
+
+void cull_transform_aabbs(cull_set *set);
+
+uint32_t cull_test_spheres(cull_set *set, const frustum *f);
+
+uint32_t cull_run(cull_set *set, const frustum *f);
+
+#endif
@@ -0,0 +1,541 @@
+#include "ecs.h"
+
+static inline uint32_t align_col(uint32_t off)
+{
+	return (off + ECS_COLUMN_ALIGN - 1) & ~(uint32_t)(ECS_COLUMN_ALIGN - 1);
+}
+
+static inline uint8_t *column(ecs_chunk *chunk, const ecs_archetype *arch, uint32_t comp)
+{
+	return (uint8_t *)chunk + arch->offsets[comp];
+}
+
+static inline ecs_entity *entity_column(ecs_chunk *chunk, const ecs_archetype *arch)
+{
+	return (ecs_entity *)((uint8_t *)chunk + arch->ent_offset);
+}
+
+static inline uint32_t layout_size(ecs_world *w, ecs_archetype *arch, uint32_t cap)
+{
+	uint32_t				off;
+
+	off = align_col(sizeof(ecs_chunk));
+	arch->ent_offset = off;
+	off = align_col(off + cap * sizeof(ecs_entity));
+
+	for (uint32_t i = 0; i < arch->comp_cnt; i++) {
+		arch->offsets[arch->comps[i]] = off;
+		off = align_col(off + cap * w->comp_sizes[arch->comps[i]]);
+	}
+
+	return off;
+}
+
+/* columns are packed back to back, so the capacity is whatever fits once each is aligned */
+static inline ecs_archetype *create_arch(ecs_world *w, ecs_mask mask)
+{
+	ecs_archetype				*arch;
+	uint32_t				row_size;
+
+	arch = mem_alloc(sizeof(ecs_archetype));
+
+	if (arch == NULL)
+		dbg_error("failed to allocate archetype");
+
+	memset(arch, '\0', sizeof(*arch));
+
+	arch->mask = mask;
+	arch->index = w->archs.size;
+	row_size = sizeof(ecs_entity);
+
+	for (uint32_t comp = 0; comp < w->comp_cnt; comp++) {
+		if (mask & ECS_BIT(comp)) {
+			arch->comps[arch->comp_cnt++] = comp;
+			row_size += w->comp_sizes[comp];
+		}
+	}
+
+	arch->chunk_cap = (ECS_CHUNK_SIZE - sizeof(ecs_chunk)) / row_size;
+
+	while (arch->chunk_cap > 0 && layout_size(w, arch, arch->chunk_cap) > ECS_CHUNK_SIZE)
+		arch->chunk_cap--;
+
+	if (arch->chunk_cap == 0)
+		dbg_error("component set does not fit in a chunk");
+
+	ecs_chunk_list_init(&arch->chunks);
+	ecs_archetype_list_push(&w->archs, arch);
+
+	return arch;
+}
+
+static inline ecs_archetype *find_arch(ecs_world *w, ecs_mask mask)
+{
+	for (uint32_t i = 0; i < w->archs.size; i++) {
+		if (w->archs.elems[i]->mask == mask)
+			return w->archs.elems[i];
+	}
+
+	if (w->comp_cnt < ECS_MAX_COMPONENTS && mask >> w->comp_cnt != 0)
+		dbg_error("entity uses an unregistered component");
+
+	return create_arch(w, mask);
+}
+
+static inline ecs_chunk *acquire_chunk(ecs_world *w, ecs_archetype *arch)
+{
+	ecs_chunk				*chunk;
+
+	if (w->free_chunks.size > 0)
+		chunk = ecs_chunk_list_pop(&w->free_chunks);
+	else
+		chunk = mem_alloc(ECS_CHUNK_SIZE);
+
+	if (chunk == NULL)
+		dbg_error("failed to allocate ecs chunk");
+
+	chunk->arch = arch;
+	chunk->cnt = 0;
+
+	ecs_chunk_list_push(&arch->chunks, chunk);
+
+	return chunk;
+}
+
+/* appends a zeroed row and points the entity's record at it */
+static inline void push_row(ecs_world *w, ecs_archetype *arch, ecs_entity e)
+{
+	ecs_chunk				*chunk;
+	ecs_record				*rec;
+	uint32_t				size;
+
+	if (arch->chunks.size == 0 || arch->chunks.elems[arch->chunks.size - 1]->cnt == arch->chunk_cap)
+		chunk = acquire_chunk(w, arch);
+	else
+		chunk = arch->chunks.elems[arch->chunks.size - 1];
+
+	for (uint32_t i = 0; i < arch->comp_cnt; i++) {
+		size = w->comp_sizes[arch->comps[i]];
+
+		memset(column(chunk, arch, arch->comps[i]) + chunk->cnt * size, '\0', size);
+	}
+
+	entity_column(chunk, arch)[chunk->cnt] = e;
+
+	rec = &w->records.elems[(uint32_t)e];
+	rec->arch = arch->index;
+	rec->chunk = arch->chunks.size - 1;
+	rec->row = chunk->cnt;
+
+	chunk->cnt++;
+	arch->cnt++;
+}
+
+/* fills the hole with the archetype's last row so chunks stay dense */
+static inline void remove_row(ecs_world *w, ecs_archetype *arch, uint32_t chunk_ind, uint32_t row)
+{
+	ecs_chunk				*chunk, *last;
+	ecs_entity				moved;
+	ecs_record				*rec;
+	uint32_t				last_row, size;
+
+	chunk = arch->chunks.elems[chunk_ind];
+	last = arch->chunks.elems[arch->chunks.size - 1];
+	last_row = last->cnt - 1;
+
+	if (chunk != last || row != last_row) {
+		for (uint32_t i = 0; i < arch->comp_cnt; i++) {
+			size = w->comp_sizes[arch->comps[i]];
+
+			memcpy(column(chunk, arch, arch->comps[i]) + row * size,
+				column(last, arch, arch->comps[i]) + last_row * size, size);
+		}
+
+		moved = entity_column(last, arch)[last_row];
+		entity_column(chunk, arch)[row] = moved;
+
+		rec = &w->records.elems[(uint32_t)moved];
+		rec->chunk = chunk_ind;
+		rec->row = row;
+	}
+
+	last->cnt--;
+	arch->cnt--;
+
+	if (last->cnt == 0)
+		ecs_chunk_list_push(&w->free_chunks, ecs_chunk_list_pop(&arch->chunks));
+}
+
+static inline ecs_record *lookup(ecs_world *w, ecs_entity e)
+{
+	ecs_record				*rec;
+
+	if ((uint32_t)e >= w->records.size)
+		return NULL;
+
+	rec = &w->records.elems[(uint32_t)e];
+
+	return rec->gen == (uint32_t)(e >> 32) ? rec : NULL;
+}
+
+/* reserves an id without touching any chunk, so it is safe while iterating */
+static inline ecs_entity reserve(ecs_world *w)
+{
+	ecs_record				*rec;
+	uint32_t				ind;
+
+	if (w->free_records.size > 0) {
+		ind = ecs_u32_list_pop(&w->free_records);
+	} else {
+		ind = w->records.size;
+		rec = ecs_record_list_push_n(&w->records, NULL, 1);
+		rec->gen = 1;
+	}
+
+	rec = &w->records.elems[ind];
+	rec->arch = ECS_PENDING;
+
+	return (ecs_entity)rec->gen << 32 | ind;
+}
+
+static inline void move_entity(ecs_world *w, ecs_entity e, ecs_record *rec, ecs_mask mask)
+{
+	ecs_archetype				*src, *dst;
+	ecs_chunk				*src_chunk, *dst_chunk;
+	uint32_t				src_chunk_ind, src_row, comp, size;
+
+	src = w->archs.elems[rec->arch];
+	dst = find_arch(w, mask);
+	src_chunk_ind = rec->chunk;
+	src_row = rec->row;
+	src_chunk = src->chunks.elems[src_chunk_ind];
+
+	push_row(w, dst, e);
+
+	dst_chunk = dst->chunks.elems[rec->chunk];
+
+	for (uint32_t i = 0; i < dst->comp_cnt; i++) {
+		comp = dst->comps[i];
+		size = w->comp_sizes[comp];
+
+		if (src->mask & ECS_BIT(comp))
+			memcpy(column(dst_chunk, dst, comp) + rec->row * size, column(src_chunk, src, comp) + src_row * size,
+				size);
+	}
+
+	remove_row(w, src, src_chunk_ind, src_row);
+}
+
+void ecs_init(ecs_world *w)
+{
+	memset(w, '\0', sizeof(*w));
+
+	ecs_archetype_list_init(&w->archs);
+	ecs_record_list_init(&w->records);
+	ecs_u32_list_init(&w->free_records);
+	ecs_chunk_list_init(&w->free_chunks);
+}
+
+void ecs_clean(ecs_world *w)
+{
+	ecs_archetype				*arch;
+
+	for (uint32_t i = 0; i < w->archs.size; i++) {
+		arch = w->archs.elems[i];
+
+		for (uint32_t j = 0; j < arch->chunks.size; j++)
+			mem_free(arch->chunks.elems[j]);
+
+		ecs_chunk_list_clean(&arch->chunks);
+		mem_free(arch);
+	}
+
+	for (uint32_t i = 0; i < w->free_chunks.size; i++)
+		mem_free(w->free_chunks.elems[i]);
+
+	ecs_archetype_list_clean(&w->archs);
+	ecs_record_list_clean(&w->records);
+	ecs_u32_list_clean(&w->free_records);
+	ecs_chunk_list_clean(&w->free_chunks);
+}
+
+uint32_t ecs_register(ecs_world *w, uint32_t size)
+{
+	if (w->comp_cnt == ECS_MAX_COMPONENTS)
+		dbg_error("too many ecs components");
+
+	w->comp_sizes[w->comp_cnt] = size;
+
+	return w->comp_cnt++;
+}
+
+ecs_entity ecs_create(ecs_world *w, ecs_mask mask)
+{
+	ecs_entity				e;
+
+	e = reserve(w);
+
+	push_row(w, find_arch(w, mask), e);
+
+	w->alive++;
+
+	return e;
+}
+
+/* stale handles are ignored, the generation bump makes every copy of e stale */
+void ecs_destroy(ecs_world *w, ecs_entity e)
+{
+	ecs_record				*rec;
+
+	rec = lookup(w, e);
+
+	if (rec == NULL)
+		return;
+
+	if (rec->arch != ECS_PENDING) {
+		remove_row(w, w->archs.elems[rec->arch], rec->chunk, rec->row);
+		w->alive--;
+	}
+
+	rec->gen = rec->gen == UINT32_MAX ? 1 : rec->gen + 1;
+	rec->arch = ECS_PENDING;
+
+	ecs_u32_list_push(&w->free_records, (uint32_t)e);
+}
+
+bool ecs_alive(ecs_world *w, ecs_entity e)
+{
+	ecs_record				*rec;
+
+	rec = lookup(w, e);
+
+	return rec != NULL && rec->arch != ECS_PENDING;
+}
+
+void *ecs_get(ecs_world *w, ecs_entity e, uint32_t comp)
+{
+	ecs_record				*rec;
+	ecs_archetype				*arch;
+
+	rec = lookup(w, e);
+
+	if (rec == NULL || rec->arch == ECS_PENDING)
+		return NULL;
+
+	arch = w->archs.elems[rec->arch];
+
+	if (!(arch->mask & ECS_BIT(comp)))
+		return NULL;
+
+	return column(arch->chunks.elems[rec->chunk], arch, comp) + rec->row * w->comp_sizes[comp];
+}
+
+void ecs_add(ecs_world *w, ecs_entity e, uint32_t comp)
+{
+	ecs_record				*rec;
+	ecs_mask				mask;
+
+	rec = lookup(w, e);
+
+	if (rec == NULL || rec->arch == ECS_PENDING)
+		return;
+
+	mask = w->archs.elems[rec->arch]->mask;
+
+	if (!(mask & ECS_BIT(comp)))
+		move_entity(w, e, rec, mask | ECS_BIT(comp));
+}
+
+void ecs_remove(ecs_world *w, ecs_entity e, uint32_t comp)
+{
+	ecs_record				*rec;
+	ecs_mask				mask;
+
+	rec = lookup(w, e);
+
+	if (rec == NULL || rec->arch == ECS_PENDING)
+		return;
+
+	mask = w->archs.elems[rec->arch]->mask;
+
+	if (mask & ECS_BIT(comp))
+		move_entity(w, e, rec, mask & ~ECS_BIT(comp));
+}
+
+void ecs_query_init(ecs_query *q, ecs_mask all, ecs_mask none)
+{
+	q->all = all;
+	q->none = none;
+	q->seen = 0;
+
+	ecs_u32_list_init(&q->archs);
+}
+
+void ecs_query_clean(ecs_query *q)
+{
+	ecs_u32_list_clean(&q->archs);
+}
+
+void ecs_iter_init(ecs_iter *it, ecs_world *w, ecs_query *q)
+{
+	ecs_mask				mask;
+
+	/* archetypes are never removed, so only the ones created since the last iteration need matching */
+	for (; q->seen < w->archs.size; q->seen++) {
+		mask = w->archs.elems[q->seen]->mask;
+
+		if ((mask & q->all) == q->all && (mask & q->none) == 0)
+			ecs_u32_list_push(&q->archs, q->seen);
+	}
+
+	it->w = w;
+	it->q = q;
+	it->arch_ind = 0;
+	it->chunk_ind = 0;
+	it->arch = NULL;
+	it->chunk = NULL;
+	it->cnt = 0;
+}
+
+/* steps to the next chunk; the columns of that chunk hold it->cnt contiguous rows */
+bool ecs_iter_next(ecs_iter *it)
+{
+	ecs_archetype				*arch;
+
+	while (it->arch_ind < it->q->archs.size) {
+		arch = it->w->archs.elems[it->q->archs.elems[it->arch_ind]];
+
+		if (it->chunk_ind < arch->chunks.size) {
+			it->arch = arch;
+			it->chunk = arch->chunks.elems[it->chunk_ind++];
+			it->cnt = it->chunk->cnt;
+
+			return true;
+		}
+
+		it->arch_ind++;
+		it->chunk_ind = 0;
+	}
+
+	return false;
+}
+
+void *ecs_iter_column(ecs_iter *it, uint32_t comp)
+{
+	if (!(it->arch->mask & ECS_BIT(comp)))
+		return NULL;
+
+	return column(it->chunk, it->arch, comp);
+}
+
+ecs_entity *ecs_iter_entities(ecs_iter *it)
+{
+	return entity_column(it->chunk, it->arch);
+}
+
+void ecs_cmd_init(ecs_cmd_buf *cb)
+{
+	ecs_cmd_list_init(&cb->cmds);
+	ecs_u8_list_init(&cb->data);
+}
+
+void ecs_cmd_clean(ecs_cmd_buf *cb)
+{
+	ecs_cmd_list_clean(&cb->cmds);
+	ecs_u8_list_clean(&cb->data);
+}
+
+static inline void push_cmd(ecs_cmd_buf *cb, ecs_cmd_type type, ecs_entity e, uint32_t comp, const void *data,
+	uint32_t len)
+{
+	ecs_cmd					*cmd;
+
+	cmd = ecs_cmd_list_push_n(&cb->cmds, NULL, 1);
+	cmd->type = type;
+	cmd->comp = comp;
+	cmd->e = e;
+	cmd->mask = 0;
+	cmd->data_offset = cb->data.size;
+	cmd->data_len = data != NULL ? len : 0;
+
+	if (data != NULL)
+		ecs_u8_list_push_n(&cb->data, data, len);
+}
+
+/* the returned entity is valid immediately but has no storage until the flush */
+ecs_entity ecs_cmd_create(ecs_cmd_buf *cb, ecs_world *w, ecs_mask mask)
+{
+	ecs_entity				e;
+
+	e = reserve(w);
+
+	push_cmd(cb, ECS_CMD_CREATE, e, 0, NULL, 0);
+
+	cb->cmds.elems[cb->cmds.size - 1].mask = mask;
+
+	return e;
+}
+
+void ecs_cmd_destroy(ecs_cmd_buf *cb, ecs_entity e)
+{
+	push_cmd(cb, ECS_CMD_DESTROY, e, 0, NULL, 0);
+}
+
+void ecs_cmd_add(ecs_cmd_buf *cb, ecs_entity e, uint32_t comp, const void *data, uint32_t len)
+{
+	push_cmd(cb, ECS_CMD_ADD, e, comp, data, len);
+}
+
+void ecs_cmd_remove(ecs_cmd_buf *cb, ecs_entity e, uint32_t comp)
+{
+	push_cmd(cb, ECS_CMD_REMOVE, e, comp, NULL, 0);
+}
+
+void ecs_cmd_set(ecs_cmd_buf *cb, ecs_entity e, uint32_t comp, const void *data, uint32_t len)
+{
+	push_cmd(cb, ECS_CMD_SET, e, comp, data, len);
+}
+
+/* commands apply in record order, those aimed at entities destroyed in the meantime are dropped */
+void ecs_cmd_flush(ecs_cmd_buf *cb, ecs_world *w)
+{
+	ecs_cmd					*cmd;
+	ecs_record				*rec;
+	void					*dest;
+
+	for (uint32_t i = 0; i < cb->cmds.size; i++) {
+		cmd = &cb->cmds.elems[i];
+
+		switch (cmd->type) {
+		case ECS_CMD_CREATE:
+			rec = lookup(w, cmd->e);
+
+			if (rec != NULL && rec->arch == ECS_PENDING) {
+				push_row(w, find_arch(w, cmd->mask), cmd->e);
+				w->alive++;
+			}
+
+			break;
+		case ECS_CMD_DESTROY:
+			ecs_destroy(w, cmd->e);
+			break;
+		case ECS_CMD_ADD:
+		case ECS_CMD_SET:
+			if (cmd->type == ECS_CMD_ADD)
+				ecs_add(w, cmd->e, cmd->comp);
+
+			dest = ecs_get(w, cmd->e, cmd->comp);
+
+			if (dest != NULL && cmd->data_len > 0)
+				memcpy(dest, cb->data.elems + cmd->data_offset, clamp_uint(cmd->data_len, 0, w->comp_sizes[cmd->comp]));
+
+			break;
+		case ECS_CMD_REMOVE:
+			ecs_remove(w, cmd->e, cmd->comp);
+			break;
+		}
+	}
+
+	ecs_cmd_list_clear(&cb->cmds);
+	ecs_u8_list_clear(&cb->data);
+}
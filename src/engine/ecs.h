@@ -0,0 +1,167 @@
+#ifndef ECS_H_INCLUDED
+#define ECS_H_INCLUDED
+
+#include "../util/debug.h"
+#include "../util/util.h"
+#include "../util/dynarr.h"
+#include "../util/arena.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <stdbool.h>
+
+#define ECS_CHUNK_SIZE				(64 * 1024)
+#define ECS_MAX_COMPONENTS			64
+#define ECS_COLUMN_ALIGN			16
+#define ECS_PENDING				UINT32_MAX
+#define ECS_NULL				((ecs_entity)0)
+
+#define ECS_BIT(comp)				((ecs_mask)1 << (comp))
+
+/* generation in the high 32 bits, record index in the low; generations start at 1 so 0 is never alive */
+typedef uint64_t ecs_entity;
+
+typedef uint64_t ecs_mask;
+
+typedef struct ecs_archetype ecs_archetype;
+
+/*
+ * a 64 kb block: this header, then the entity column, then one column per component at arch offsets;
+ * each queried column restarts the hardware prefetcher, so longer column runs stream closer to raw arrays
+ */
+typedef struct {
+	ecs_archetype *arch;
+	uint32_t cnt;
+} ecs_chunk;
+
+DYNARR_DEFINE(ecs_chunk_list, ecs_chunk *)
+
+DYNARR_DEFINE(ecs_u32_list, uint32_t)
+
+DYNARR_DEFINE(ecs_u8_list, uint8_t)
+
+/* only the last chunk is partly full, removal swaps the archetype's last row into the hole */
+struct ecs_archetype {
+	ecs_mask mask;
+	uint32_t index;
+	uint32_t comp_cnt;
+	uint8_t comps[ECS_MAX_COMPONENTS];
+	uint32_t offsets[ECS_MAX_COMPONENTS];
+	uint32_t ent_offset;
+	uint32_t chunk_cap;
+	uint32_t cnt;
+	ecs_chunk_list chunks;
+};
+
+DYNARR_DEFINE(ecs_archetype_list, ecs_archetype *)
+
+typedef struct {
+	uint32_t gen;
+	uint32_t arch;
+	uint32_t chunk;
+	uint32_t row;
+} ecs_record;
+
+DYNARR_DEFINE(ecs_record_list, ecs_record)
+
+typedef struct {
+	uint32_t comp_sizes[ECS_MAX_COMPONENTS];
+	uint32_t comp_cnt;
+	ecs_archetype_list archs;
+	ecs_record_list records;
+	ecs_u32_list free_records;
+	ecs_chunk_list free_chunks;
+	uint32_t alive;
+} ecs_world;
+
+/* matching archetypes are cached and only new ones are checked on the next iteration */
+typedef struct {
+	ecs_mask all;
+	ecs_mask none;
+	ecs_u32_list archs;
+	uint32_t seen;
+} ecs_query;
+
+typedef struct {
+	ecs_world *w;
+	ecs_query *q;
+	uint32_t arch_ind;
+	uint32_t chunk_ind;
+	ecs_archetype *arch;
+	ecs_chunk *chunk;
+	uint32_t cnt;
+} ecs_iter;
+
+typedef enum {
+	ECS_CMD_CREATE,
+	ECS_CMD_DESTROY,
+	ECS_CMD_ADD,
+	ECS_CMD_REMOVE,
+	ECS_CMD_SET,
+} ecs_cmd_type;
+
+typedef struct {
+	ecs_cmd_type type;
+	uint32_t comp;
+	ecs_entity e;
+	ecs_mask mask;
+	uint32_t data_offset;
+	uint32_t data_len;
+} ecs_cmd;
+
+DYNARR_DEFINE(ecs_cmd_list, ecs_cmd)
+
+/* structural changes recorded while iterating and applied in order by ecs_cmd_flush */
+typedef struct {
+	ecs_cmd_list cmds;
+	ecs_u8_list data;
+} ecs_cmd_buf;
+
+void ecs_init(ecs_world *w);
+
+void ecs_clean(ecs_world *w);
+
+uint32_t ecs_register(ecs_world *w, uint32_t size);
+
+ecs_entity ecs_create(ecs_world *w, ecs_mask mask);
+
+void ecs_destroy(ecs_world *w, ecs_entity e);
+
+bool ecs_alive(ecs_world *w, ecs_entity e);
+
+void *ecs_get(ecs_world *w, ecs_entity e, uint32_t comp);
+
+void ecs_add(ecs_world *w, ecs_entity e, uint32_t comp);
+
+void ecs_remove(ecs_world *w, ecs_entity e, uint32_t comp);
+
+void ecs_query_init(ecs_query *q, ecs_mask all, ecs_mask none);
+
+void ecs_query_clean(ecs_query *q);
+
+void ecs_iter_init(ecs_iter *it, ecs_world *w, ecs_query *q);
+
+bool ecs_iter_next(ecs_iter *it);
+
+void *ecs_iter_column(ecs_iter *it, uint32_t comp);
+
+ecs_entity *ecs_iter_entities(ecs_iter *it);
+
+void ecs_cmd_init(ecs_cmd_buf *cb);
+
+void ecs_cmd_clean(ecs_cmd_buf *cb);
+
+ecs_entity ecs_cmd_create(ecs_cmd_buf *cb, ecs_world *w, ecs_mask mask);
+
+void ecs_cmd_destroy(ecs_cmd_buf *cb, ecs_entity e);
+
+void ecs_cmd_add(ecs_cmd_buf *cb, ecs_entity e, uint32_t comp, const void *data, uint32_t len);
+
+void ecs_cmd_remove(ecs_cmd_buf *cb, ecs_entity e, uint32_t comp);
+
+void ecs_cmd_set(ecs_cmd_buf *cb, ecs_entity e, uint32_t comp, const void *data, uint32_t len);
+
+void ecs_cmd_flush(ecs_cmd_buf *cb, ecs_world *w);
+
+#endif
@@ -1 +1,145 @@
-#include "game.h"
\ No newline at end of file
+#include "game.h"
+
+static ecs_world				world;
+static ecs_query				move_query;
+static ecs_query				draw_query;
+static uint32_t					comp_pos;
+static uint32_t					comp_vel;
+static uint32_t					comp_scale;
+static game_move_list				move_chunks;
+static job_system				*job_pool;
+
+static inline float spawn_coord(uint32_t i, uint32_t salt)
+{
+	uint32_t				h;
+
+	h = (i + 1) * 0x9e3779b9u ^ salt;
+	h ^= h >> 16;
+	h *= 0x85ebca6bu;
+	h ^= h >> 13;
+
+	return (float)(h >> 8) / (float)(1 << 23) - 1.0f;
+}
+
+static inline void bounce(float *p, float *v)
+{
+	if (*p > GAME_BOUNDS) {
+		*p = GAME_BOUNDS;
+		*v = -*v;
+	} else if (*p < -GAME_BOUNDS) {
+		*p = -GAME_BOUNDS;
+		*v = -*v;
+	}
+}
+
+static void move_range(void *arg, uint32_t begin, uint32_t end, uint32_t worker)
+{
+	game_move_chunk				*chunk;
+	float					dt;
+
+	PROF_ZONE("move_range");
+
+	(void)worker;
+
+	dt = *(float *)arg;
+
+	for (uint32_t c = begin; c < end; c++) {
+		chunk = &move_chunks.elems[c];
+
+		for (uint32_t i = 0; i < chunk->cnt; i++) {
+			chunk->pos[i].x += chunk->vel[i].x * dt;
+			chunk->pos[i].y += chunk->vel[i].y * dt;
+			chunk->pos[i].z += chunk->vel[i].z * dt;
+
+			bounce(&chunk->pos[i].x, &chunk->vel[i].x);
+			bounce(&chunk->pos[i].y, &chunk->vel[i].y);
+		}
+	}
+}
+
+/* one static scene object at the origin, then entity_cnt small ones bouncing around inside it */
+void game_init(uint32_t entity_cnt, job_system *jobs)
+{
+	ecs_entity				e;
+	vec3					*pos, *vel;
+	float					*scale;
+
+	job_pool = jobs;
+
+	ecs_init(&world);
+
+	comp_pos = ecs_register(&world, sizeof(vec3));
+	comp_vel = ecs_register(&world, sizeof(vec3));
+	comp_scale = ecs_register(&world, sizeof(float));
+
+	e = ecs_create(&world, ECS_BIT(comp_pos) | ECS_BIT(comp_scale));
+	*(float *)ecs_get(&world, e, comp_scale) = 1.0f;
+
+	for (uint32_t i = 0; i < entity_cnt; i++) {
+		e = ecs_create(&world, ECS_BIT(comp_pos) | ECS_BIT(comp_vel) | ECS_BIT(comp_scale));
+
+		pos = ecs_get(&world, e, comp_pos);
+		vel = ecs_get(&world, e, comp_vel);
+		scale = ecs_get(&world, e, comp_scale);
+
+		pos->x = spawn_coord(i, 0x1u) * GAME_BOUNDS;
+		pos->y = spawn_coord(i, 0x2u) * GAME_BOUNDS;
+		pos->z = 0.0f;
+		vel->x = spawn_coord(i, 0x3u) * 0.5f;
+		vel->y = spawn_coord(i, 0x4u) * 0.5f;
+		vel->z = 0.0f;
+		*scale = GAME_ENTITY_SCALE;
+	}
+
+	game_move_list_init(&move_chunks);
+
+	ecs_query_init(&move_query, ECS_BIT(comp_pos) | ECS_BIT(comp_vel), 0);
+	ecs_query_init(&draw_query, ECS_BIT(comp_pos) | ECS_BIT(comp_scale), 0);
+
+	dbg_log("created %u game entities successfully", world.alive);
+}
+
+void game_update(float dt)
+{
+	ecs_iter				it;
+	vec3					*pos;
+	float					*scale;
+	mat4					model;
+
+	PROF_ZONE("game_update");
+
+	game_move_list_clear(&move_chunks);
+	ecs_iter_init(&it, &world, &move_query);
+
+	while (ecs_iter_next(&it)) {
+		game_move_list_push(&move_chunks, (game_move_chunk){
+			ecs_iter_column(&it, comp_pos),
+			ecs_iter_column(&it, comp_vel),
+			it.cnt
+		});
+	}
+
+	/* chunks never share rows, so workers can move them without any locking */
+	job_parallel_for(job_pool, 0, move_chunks.size, GAME_MOVE_GRAIN, move_range, &dt);
+
+	ecs_iter_init(&it, &world, &draw_query);
+
+	while (ecs_iter_next(&it)) {
+		pos = ecs_iter_column(&it, comp_pos);
+		scale = ecs_iter_column(&it, comp_scale);
+
+		for (uint32_t i = 0; i < it.cnt; i++) {
+			mat4_translate_scale(&model, pos[i].x, pos[i].y, pos[i].z, scale[i]);
+			vk_draw_instance(&model);
+		}
+	}
+}
+
+void game_clean(void)
+{
+	ecs_query_clean(&draw_query);
+	ecs_query_clean(&move_query);
+	ecs_clean(&world);
+
+	game_move_list_clean(&move_chunks);
+}
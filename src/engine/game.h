@@ -2,8 +2,29 @@
 #define GAME_H_INCLUDED
 
 #include "graphics/vulkan.h"
+#include "ecs.h"
+#include "../util/job.h"
 
 #include <stdio.h>
 #include <stdlib.h>
 
-#endif
\ No newline at end of file
+#define GAME_BOUNDS				1.0f
+#define GAME_ENTITY_SCALE			0.02f
+#define GAME_MOVE_GRAIN				4
+
+/* one chunk's worth of a system's columns, gathered so chunks can be split across workers */
+typedef struct {
+	vec3 *pos;
+	vec3 *vel;
+	uint32_t cnt;
+} game_move_chunk;
+
+DYNARR_DEFINE(game_move_list, game_move_chunk)
+
+void game_init(uint32_t entity_cnt, job_system *jobs);
+
+void game_update(float dt);
+
+void game_clean(void);
+
+#endif
@@ -0,0 +1,491 @@
+#include "batch.h"
+
+static inline void create_cull_sets(draw_batcher *b)
+{
+	VkDescriptorSetLayoutBinding		bindings[BATCH_CULL_BINDING_CNT];
+	VkDescriptorSetLayoutCreateInfo		layout_info;
+	VkDescriptorPoolSize			pool_size;
+	VkDescriptorPoolCreateInfo		pool_info;
+	VkDescriptorSetLayout			set_layouts[BATCH_MAX_FRAMES];
+	VkDescriptorSetAllocateInfo		set_info;
+	VkDescriptorSet				sets[BATCH_MAX_FRAMES];
+	VkDescriptorBufferInfo			buf_infos[BATCH_CULL_BINDING_CNT];
+	VkWriteDescriptorSet			writes[BATCH_CULL_BINDING_CNT];
+	batch_frame				*frame;
+
+	/* instances, bounds, culled, indirect, in the binding order of cull.comp */
+	for (uint32_t i = 0; i < BATCH_CULL_BINDING_CNT; i++) {
+		memset(&bindings[i], '\0', sizeof(bindings[i]));
+
+		bindings[i].binding = i;
+		bindings[i].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+		bindings[i].descriptorCount = 1;
+		bindings[i].stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+	}
+
+	memset(&layout_info, '\0', sizeof(layout_info));
+
+	layout_info.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
+	layout_info.bindingCount = BATCH_CULL_BINDING_CNT;
+	layout_info.pBindings = bindings;
+
+	if (vkCreateDescriptorSetLayout(b->dev, &layout_info, NULL, &b->cull_set_layout) != VK_SUCCESS)
+		dbg_error("failed to create cull descriptor set layout");
+
+	pool_size.type = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+	pool_size.descriptorCount = BATCH_CULL_BINDING_CNT * b->frame_cnt;
+
+	memset(&pool_info, '\0', sizeof(pool_info));
+
+	pool_info.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
+	pool_info.maxSets = b->frame_cnt;
+	pool_info.poolSizeCount = 1;
+	pool_info.pPoolSizes = &pool_size;
+
+	if (vkCreateDescriptorPool(b->dev, &pool_info, NULL, &b->cull_pool) != VK_SUCCESS)
+		dbg_error("failed to create cull descriptor pool");
+
+	for (uint32_t i = 0; i < b->frame_cnt; i++)
+		set_layouts[i] = b->cull_set_layout;
+
+	memset(&set_info, '\0', sizeof(set_info));
+
+	set_info.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
+	set_info.descriptorPool = b->cull_pool;
+	set_info.descriptorSetCount = b->frame_cnt;
+	set_info.pSetLayouts = set_layouts;
+
+	if (vkAllocateDescriptorSets(b->dev, &set_info, sets) != VK_SUCCESS)
+		dbg_error("failed to allocate cull descriptor sets");
+
+	for (uint32_t i = 0; i < b->frame_cnt; i++) {
+		frame = &b->frames[i];
+		frame->cull_set = sets[i];
+
+		buf_infos[0].buffer = frame->instances;
+		buf_infos[1].buffer = frame->bounds;
+		buf_infos[2].buffer = frame->culled;
+		buf_infos[3].buffer = frame->indirect;
+
+		for (uint32_t j = 0; j < BATCH_CULL_BINDING_CNT; j++) {
+			buf_infos[j].offset = 0;
+			buf_infos[j].range = VK_WHOLE_SIZE;
+
+			memset(&writes[j], '\0', sizeof(writes[j]));
+
+			writes[j].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+			writes[j].dstSet = frame->cull_set;
+			writes[j].dstBinding = j;
+			writes[j].descriptorCount = 1;
+			writes[j].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+			writes[j].pBufferInfo = &buf_infos[j];
+		}
+
+		vkUpdateDescriptorSets(b->dev, BATCH_CULL_BINDING_CNT, writes, 0, NULL);
+	}
+}
+
+void batch_init(draw_batcher *b, gpu_allocator *ga, VkDevice dev, uint32_t frame_cnt, uint32_t max_instances,
+	bool first_instance)
+{
+	VkBufferCreateInfo			buf_info;
+	VkMemoryPropertyFlags			host_flags;
+	batch_frame				*frame;
+
+	memset(b, '\0', sizeof(*b));
+
+	b->dev = dev;
+	b->ga = ga;
+	b->frame_cnt = frame_cnt;
+	b->max_instances = max_instances;
+	b->first_instance = first_instance;
+
+	memset(&buf_info, '\0', sizeof(buf_info));
+
+	buf_info.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
+	buf_info.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+
+	host_flags = VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT;
+
+	/* host written every frame, so device local only when the bar makes it visible */
+	for (uint32_t i = 0; i < frame_cnt; i++) {
+		frame = &b->frames[i];
+
+		buf_info.size = (VkDeviceSize)max_instances * sizeof(mat4);
+		buf_info.usage = VK_BUFFER_USAGE_VERTEX_BUFFER_BIT | VK_BUFFER_USAGE_STORAGE_BUFFER_BIT;
+
+		ga_create_buffer(ga, &buf_info, host_flags, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, &frame->instances,
+			&frame->instance_alloc);
+
+		/* only ever touched by the cull shader and the vertex fetch */
+		ga_create_buffer(ga, &buf_info, 0, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, &frame->culled, &frame->culled_alloc);
+
+		buf_info.size = BATCH_MAX_GROUPS * sizeof(VkDrawIndexedIndirectCommand);
+		buf_info.usage = VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT | VK_BUFFER_USAGE_STORAGE_BUFFER_BIT;
+
+		ga_create_buffer(ga, &buf_info, host_flags, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, &frame->indirect,
+			&frame->indirect_alloc);
+
+		buf_info.size = BATCH_MAX_GROUPS * 4 * sizeof(float);
+		buf_info.usage = VK_BUFFER_USAGE_STORAGE_BUFFER_BIT;
+
+		ga_create_buffer(ga, &buf_info, host_flags, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, &frame->bounds,
+			&frame->bounds_alloc);
+	}
+
+	create_cull_sets(b);
+
+	batch_group_list_init(&b->groups);
+	batch_item_list_init(&b->items);
+	batch_u32_list_init(&b->cursor);
+	batch_u32_list_init(&b->order);
+
+	dbg_log("created draw batcher for %u instances successfully", max_instances);
+}
+
+void batch_clean(draw_batcher *b)
+{
+	batch_frame				*frame;
+
+	for (uint32_t i = 0; i < b->frame_cnt; i++) {
+		frame = &b->frames[i];
+
+		vkDestroyBuffer(b->dev, frame->instances, NULL);
+		vkDestroyBuffer(b->dev, frame->indirect, NULL);
+		vkDestroyBuffer(b->dev, frame->bounds, NULL);
+		vkDestroyBuffer(b->dev, frame->culled, NULL);
+
+		ga_free(b->ga, &frame->instance_alloc);
+		ga_free(b->ga, &frame->indirect_alloc);
+		ga_free(b->ga, &frame->bounds_alloc);
+		ga_free(b->ga, &frame->culled_alloc);
+	}
+
+	vkDestroyDescriptorPool(b->dev, b->cull_pool, NULL);
+	vkDestroyDescriptorSetLayout(b->dev, b->cull_set_layout, NULL);
+
+	batch_group_list_clean(&b->groups);
+	batch_item_list_clean(&b->items);
+	batch_u32_list_clean(&b->cursor);
+	batch_u32_list_clean(&b->order);
+}
+
+/* the mesh stream on binding 0, then a model matrix per instance as four vec4 columns at locations 3-6 */
+uint32_t batch_vertex_input(const mesh_layout *layout, VkVertexInputBindingDescription *bindings,
+	VkVertexInputAttributeDescription *attribs)
+{
+	bindings[0] = layout->binding;
+
+	bindings[1].binding = BATCH_INSTANCE_BINDING;
+	bindings[1].stride = sizeof(mat4);
+	bindings[1].inputRate = VK_VERTEX_INPUT_RATE_INSTANCE;
+
+	memcpy(attribs, layout->attribs, sizeof(layout->attribs));
+
+	for (uint32_t i = 0; i < BATCH_ATTRIB_CNT; i++) {
+		attribs[MESH_ATTRIB_CNT + i].location = MESH_ATTRIB_CNT + i;
+		attribs[MESH_ATTRIB_CNT + i].binding = BATCH_INSTANCE_BINDING;
+		attribs[MESH_ATTRIB_CNT + i].format = VK_FORMAT_R32G32B32A32_SFLOAT;
+		attribs[MESH_ATTRIB_CNT + i].offset = i * 4 * sizeof(float);
+	}
+
+	return MESH_ATTRIB_CNT + BATCH_ATTRIB_CNT;
+}
+
+static inline uint32_t find_group(draw_batcher *b, const mesh *m, uint32_t material)
+{
+	batch_group				group, *last;
+
+	last = b->groups.size > 0 ? &b->groups.elems[b->last_group] : NULL;
+
+	/* runs of the same mesh are the common case, so check the previous group first */
+	if (last != NULL && last->m == m && last->material == material)
+		return b->last_group;
+
+	for (uint32_t i = 0; i < b->groups.size; i++) {
+		if (b->groups.elems[i].m == m && b->groups.elems[i].material == material) {
+			b->last_group = i;
+			return i;
+		}
+	}
+
+	if (b->groups.size == BATCH_MAX_GROUPS)
+		return UINT32_MAX;
+
+	group.m = m;
+	group.material = material;
+	group.cnt = 0;
+	group.first = 0;
+
+	batch_group_list_push(&b->groups, group);
+
+	b->last_group = b->groups.size - 1;
+
+	return b->last_group;
+}
+
+void batch_add(draw_batcher *b, const mesh *m, uint32_t material, const mat4 *model)
+{
+	batch_item				*item;
+	uint32_t				group;
+
+	group = find_group(b, m, material);
+
+	if (group == UINT32_MAX || b->items.size == b->max_instances) {
+		if (!b->overflowed)
+			dbg_warn("draw batcher is full, dropping instances");
+
+		b->overflowed = true;
+
+		return;
+	}
+
+	item = batch_item_list_push_n(&b->items, NULL, 1);
+	item->group = group;
+	item->model = *model;
+
+	b->groups.elems[group].cnt++;
+}
+
+static int group_cmp(const void *a, const void *b)
+{
+	const batch_group			*ga, *gb;
+
+	ga = a;
+	gb = b;
+
+	if (ga->material != gb->material)
+		return ga->material < gb->material ? -1 : 1;
+
+	return (ga->m > gb->m) - (ga->m < gb->m);
+}
+
+/*
+ * counting sort of the queued instances into contiguous per-group ranges of the mapped stream;
+ * cpu culling drops instances here, gpu culling leaves every instance count at zero for cull.comp
+ */
+void batch_build(draw_batcher *b, uint32_t frame, const mat4 *view_proj)
+{
+	batch_frame				*bf;
+	batch_group				*group;
+	batch_item				*item;
+	mat4					*dest;
+	VkDrawIndexedIndirectCommand		*cmds;
+	float					*bounds, sphere[4];
+	uint32_t				*cursor, *order, first, g;
+
+	bf = &b->frames[frame];
+	dest = (mat4 *)bf->instance_alloc.map;
+	cmds = (VkDrawIndexedIndirectCommand *)bf->indirect_alloc.map;
+	bounds = (float *)bf->bounds_alloc.map;
+
+	if (b->cull != BATCH_CULL_NONE)
+		frustum_from_mat4(&b->view, view_proj);
+
+	/* grow-only scratch, so building a steady scene makes no heap calls */
+	batch_u32_list_reserve(&b->cursor, b->groups.size + 1);
+	batch_u32_list_reserve(&b->order, b->groups.size + 1);
+
+	cursor = b->cursor.elems;
+	order = b->order.elems;
+
+	for (uint32_t i = 0; i < b->groups.size; i++)
+		b->groups.elems[i].first = i;
+
+	/* groups are ordered by material so pipeline binds happen once per material */
+	qsort(b->groups.elems, b->groups.size, sizeof(batch_group), group_cmp);
+
+	first = 0;
+
+	for (uint32_t i = 0; i < b->groups.size; i++) {
+		group = &b->groups.elems[i];
+
+		order[group->first] = i;
+		group->first = first;
+		cursor[i] = first;
+		first += group->cnt;
+
+		memcpy(&bounds[i * 4], group->m->bounds, sizeof(group->m->bounds));
+
+		cmds[i].indexCount = group->m->idx_cnt;
+		cmds[i].instanceCount = b->cull == BATCH_CULL_GPU ? 0 : group->cnt;
+		cmds[i].firstIndex = 0;
+		cmds[i].vertexOffset = 0;
+		cmds[i].firstInstance = b->first_instance ? group->first : 0;
+	}
+
+	if (b->cull == BATCH_CULL_CPU) {
+		for (uint32_t i = 0; i < b->items.size; i++) {
+			item = &b->items.elems[i];
+			g = order[item->group];
+
+			sphere_transform(sphere, &item->model, b->groups.elems[g].m->bounds);
+
+			if (frustum_test_sphere(&b->view, sphere))
+				dest[cursor[g]++] = item->model;
+		}
+
+		for (uint32_t i = 0; i < b->groups.size; i++) {
+			group = &b->groups.elems[i];
+
+			b->stats.culled += group->cnt - (cursor[i] - group->first);
+			group->cnt = cursor[i] - group->first;
+			cmds[i].instanceCount = group->cnt;
+		}
+	} else {
+		for (uint32_t i = 0; i < b->items.size; i++)
+			dest[cursor[order[b->items.elems[i].group]]++] = b->items.elems[i].model;
+	}
+}
+
+/* one thread per instance, survivors are appended to their group's range of culled with an atomic count */
+void batch_record_cull(draw_batcher *b, VkCommandBuffer cmd_buf, uint32_t frame, VkPipeline pipeline,
+	VkPipelineLayout layout)
+{
+	batch_cull_params			params;
+	VkMemoryBarrier				barrier;
+
+	if (b->cull != BATCH_CULL_GPU || b->direct || b->items.size == 0)
+		return;
+
+	/* cull.comp finds each instance's group by firstInstance, so it needs the feature */
+	if (!b->first_instance)
+		dbg_error("gpu culling needs drawIndirectFirstInstance");
+
+	memcpy(params.planes, b->view.planes, sizeof(params.planes));
+
+	params.instance_cnt = b->items.size;
+	params.group_cnt = b->groups.size;
+
+	vkCmdBindPipeline(cmd_buf, VK_PIPELINE_BIND_POINT_COMPUTE, pipeline);
+	vkCmdBindDescriptorSets(cmd_buf, VK_PIPELINE_BIND_POINT_COMPUTE, layout, 0, 1, &b->frames[frame].cull_set, 0, NULL);
+	vkCmdPushConstants(cmd_buf, layout, VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof(params), &params);
+	vkCmdDispatch(cmd_buf, (params.instance_cnt + BATCH_CULL_GROUP_SIZE - 1) / BATCH_CULL_GROUP_SIZE, 1, 1);
+
+	memset(&barrier, '\0', sizeof(barrier));
+
+	barrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+	barrier.srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT;
+	barrier.dstAccessMask = VK_ACCESS_INDIRECT_COMMAND_READ_BIT | VK_ACCESS_VERTEX_ATTRIBUTE_READ_BIT;
+
+	vkCmdPipelineBarrier(cmd_buf, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+		VK_PIPELINE_STAGE_DRAW_INDIRECT_BIT | VK_PIPELINE_STAGE_VERTEX_INPUT_BIT, 0, 1, &barrier, 0, NULL, 0, NULL);
+}
+
+/* last group whose instance range starts at or before slot */
+static inline uint32_t group_at_slot(const draw_batcher *b, uint32_t slot)
+{
+	uint32_t				lo, hi, mid;
+
+	lo = 0;
+	hi = b->groups.size;
+
+	while (hi - lo > 1) {
+		mid = (lo + hi) / 2;
+
+		if (b->groups.elems[mid].first <= slot)
+			lo = mid;
+		else
+			hi = mid;
+	}
+
+	return lo;
+}
+
+/* per-object draws are counted per instance slot, indirect draws per group */
+uint32_t batch_draw_cnt(const draw_batcher *b)
+{
+	return b->direct ? b->items.size : b->groups.size;
+}
+
+/*
+ * records draws [begin, end) with all the state they need, so disjoint ranges can go to
+ * separate secondary command buffers on separate threads; stats are updated atomically
+ */
+void batch_record_range(draw_batcher *b, VkCommandBuffer cmd_buf, uint32_t frame, const VkPipeline *pipelines,
+	VkPipelineLayout layout, const mat4 *view_proj, uint32_t begin, uint32_t end)
+{
+	batch_frame				*bf;
+	batch_group				*group;
+	VkDeviceSize				offsets[2];
+	VkBuffer				bufs[2];
+	uint32_t				material, lo, hi;
+	uint64_t				draw_calls, instances;
+
+	if (begin >= end || b->groups.size == 0)
+		return;
+
+	bf = &b->frames[frame];
+	material = UINT32_MAX;
+	draw_calls = 0;
+	instances = 0;
+
+	offsets[0] = 0;
+	offsets[1] = 0;
+	bufs[1] = b->cull == BATCH_CULL_GPU && !b->direct ? bf->culled : bf->instances;
+
+	for (uint32_t i = b->direct ? group_at_slot(b, begin) : begin; i < b->groups.size; i++) {
+		group = &b->groups.elems[i];
+
+		if (b->direct) {
+			if (group->first >= end)
+				break;
+
+			/* cpu culling can leave slots past a group's count unused */
+			lo = group->first > begin ? group->first : begin;
+			hi = group->first + group->cnt < end ? group->first + group->cnt : end;
+
+			if (lo >= hi)
+				continue;
+		} else if (i >= end) {
+			break;
+		}
+
+		if (group->material != material) {
+			material = group->material;
+
+			vkCmdBindPipeline(cmd_buf, VK_PIPELINE_BIND_POINT_GRAPHICS, pipelines[material]);
+			vkCmdPushConstants(cmd_buf, layout, VK_SHADER_STAGE_VERTEX_BIT, 0, sizeof(mat4), view_proj);
+		}
+
+		bufs[0] = group->m->vbuf;
+		offsets[1] = b->direct || b->first_instance ? 0 : (VkDeviceSize)group->first * sizeof(mat4);
+
+		vkCmdBindVertexBuffers(cmd_buf, 0, 2, bufs, offsets);
+		vkCmdBindIndexBuffer(cmd_buf, group->m->ibuf, 0, group->m->idx_type);
+
+		/* the per-object path exists as a baseline for the instancing bench */
+		if (b->direct) {
+			for (uint32_t j = lo; j < hi; j++)
+				vkCmdDrawIndexed(cmd_buf, group->m->idx_cnt, 1, 0, 0, j);
+
+			draw_calls += hi - lo;
+			instances += hi - lo;
+		} else {
+			vkCmdDrawIndexedIndirect(cmd_buf, bf->indirect, i * sizeof(VkDrawIndexedIndirectCommand), 1,
+				sizeof(VkDrawIndexedIndirectCommand));
+
+			draw_calls++;
+			instances += group->cnt;
+		}
+	}
+
+	__atomic_fetch_add(&b->stats.draw_calls, draw_calls, __ATOMIC_RELAXED);
+	__atomic_fetch_add(&b->stats.instances, instances, __ATOMIC_RELAXED);
+}
+
+void batch_record(draw_batcher *b, VkCommandBuffer cmd_buf, uint32_t frame, const VkPipeline *pipelines,
+	VkPipelineLayout layout, const mat4 *view_proj)
+{
+	batch_record_range(b, cmd_buf, frame, pipelines, layout, view_proj, 0, batch_draw_cnt(b));
+	batch_reset(b);
+}
+
+void batch_reset(draw_batcher *b)
+{
+	batch_group_list_clear(&b->groups);
+	batch_item_list_clear(&b->items);
+
+	b->last_group = 0;
+	b->overflowed = false;
+}
@@ -0,0 +1,130 @@
+#ifndef BATCH_H_INCLUDED
+#define BATCH_H_INCLUDED
+
+#include "../../util/debug.h"
+#include "../../util/util.h"
+#include "../../util/dynarr.h"
+#include "../../util/vmath.h"
+#include "gpu_alloc.h"
+#include "mesh.h"
+
+#include <vulkan/vulkan.h>
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <stdbool.h>
+
+#define BATCH_MAX_FRAMES			4
+#define BATCH_MAX_GROUPS			1024
+#define BATCH_ATTRIB_CNT			4
+#define BATCH_INSTANCE_BINDING			1
+#define BATCH_CULL_GROUP_SIZE			64
+#define BATCH_CULL_BINDING_CNT			4
+
+typedef enum {
+	BATCH_CULL_NONE,
+	BATCH_CULL_CPU,
+	BATCH_CULL_GPU,
+} batch_cull_mode;
+
+typedef struct {
+	const mesh *m;
+	uint32_t material;
+	uint32_t cnt;
+	uint32_t first;
+} batch_group;
+
+typedef struct {
+	uint32_t group;
+	mat4 model;
+} batch_item;
+
+DYNARR_DEFINE(batch_group_list, batch_group)
+
+DYNARR_DEFINE(batch_item_list, batch_item)
+
+DYNARR_DEFINE(batch_u32_list, uint32_t)
+
+/* matches the push constant block of cull.comp */
+typedef struct {
+	float planes[6][4];
+	uint32_t instance_cnt;
+	uint32_t group_cnt;
+} batch_cull_params;
+
+/*
+ * per frame in flight, written by the cpu after that frame's fence and read by the gpu;
+ * with gpu culling the survivors of instances are compacted into culled, which is drawn instead
+ */
+typedef struct {
+	VkBuffer instances;
+	ga_allocation instance_alloc;
+	VkBuffer indirect;
+	ga_allocation indirect_alloc;
+	VkBuffer bounds;
+	ga_allocation bounds_alloc;
+	VkBuffer culled;
+	ga_allocation culled_alloc;
+	VkDescriptorSet cull_set;
+} batch_frame;
+
+typedef struct {
+	uint64_t draw_calls;
+	uint64_t instances;
+	uint64_t culled;
+} batch_stats;
+
+/*
+ * instances are queued with a mesh and a material (an index into the pipeline array given
+ * to batch_record), grouped on build, and drawn with one indirect command per group;
+ * without drawIndirectFirstInstance every command starts at instance 0 and the group's
+ * range is reached by offsetting the instance binding instead
+ */
+typedef struct {
+	VkDevice dev;
+	gpu_allocator *ga;
+	batch_frame frames[BATCH_MAX_FRAMES];
+	uint32_t frame_cnt;
+	uint32_t max_instances;
+	VkDescriptorSetLayout cull_set_layout;
+	VkDescriptorPool cull_pool;
+	batch_group_list groups;
+	batch_item_list items;
+	batch_u32_list cursor;
+	batch_u32_list order;
+	uint32_t last_group;
+	bool overflowed;
+	bool direct;
+	bool first_instance;
+	batch_cull_mode cull;
+	frustum view;
+	batch_stats stats;
+} draw_batcher;
+
+void batch_init(draw_batcher *b, gpu_allocator *ga, VkDevice dev, uint32_t frame_cnt, uint32_t max_instances,
+	bool first_instance);
+
+void batch_clean(draw_batcher *b);
+
+uint32_t batch_vertex_input(const mesh_layout *layout, VkVertexInputBindingDescription *bindings,
+	VkVertexInputAttributeDescription *attribs);
+
+void batch_add(draw_batcher *b, const mesh *m, uint32_t material, const mat4 *model);
+
+void batch_build(draw_batcher *b, uint32_t frame, const mat4 *view_proj);
+
+void batch_record_cull(draw_batcher *b, VkCommandBuffer cmd_buf, uint32_t frame, VkPipeline pipeline,
+	VkPipelineLayout layout);
+
+uint32_t batch_draw_cnt(const draw_batcher *b);
+
+void batch_record_range(draw_batcher *b, VkCommandBuffer cmd_buf, uint32_t frame, const VkPipeline *pipelines,
+	VkPipelineLayout layout, const mat4 *view_proj, uint32_t begin, uint32_t end);
+
+void batch_record(draw_batcher *b, VkCommandBuffer cmd_buf, uint32_t frame, const VkPipeline *pipelines,
+	VkPipelineLayout layout, const mat4 *view_proj);
+
+void batch_reset(draw_batcher *b);
+
+#endif
@@ -0,0 +1,572 @@
+#include "gpu_alloc.h"
+#include "../../util/arena.h"
+
+#define GA_NO_NODE				UINT32_MAX
+#define GA_DEFRAG_MAX_OCCUPANCY			0.5f
+
+static inline VkDeviceSize ga_align_up(VkDeviceSize val, VkDeviceSize align)
+{
+	return (val + align - 1) / align * align;
+}
+
+static inline uint32_t ga_log2(VkDeviceSize val)
+{
+	return 63 - __builtin_clzll(val);
+}
+
+static inline uint32_t ga_order_for(VkDeviceSize size, VkDeviceSize align)
+{
+	VkDeviceSize				need;
+
+	need = size > align ? size : align;
+
+	if (need <= GA_MIN_ALLOC)
+		return 0;
+
+	return ga_log2(need - 1) + 1 - ga_log2(GA_MIN_ALLOC);
+}
+
+static inline uint8_t ga_max(uint8_t a, uint8_t b)
+{
+	return a > b ? a : b;
+}
+
+/* tree[node] holds 1 + the largest free order in the node's subtree, or 0 when nothing is free */
+static inline void ga_tree_fixup(ga_block *block, uint32_t node, uint32_t order)
+{
+	uint32_t				l, r;
+
+	while (node > 0) {
+		node = (node - 1) / 2;
+		order++;
+
+		l = node * 2 + 1;
+		r = node * 2 + 2;
+
+		if (block->tree[l] == order && block->tree[r] == order)
+			block->tree[node] = order + 1;
+		else
+			block->tree[node] = ga_max(block->tree[l], block->tree[r]);
+	}
+}
+
+static inline uint32_t ga_block_alloc(ga_block *block, uint32_t order, VkDeviceSize *offset)
+{
+	uint32_t				node, cur_order, depth;
+
+	if (block->dedicated || block->tree[0] < order + 1)
+		return GA_NO_NODE;
+
+	node = 0;
+
+	for (cur_order = block->levels; cur_order > order; cur_order--)
+		node = block->tree[node * 2 + 1] >= order + 1 ? node * 2 + 1 : node * 2 + 2;
+
+	block->tree[node] = 0;
+
+	ga_tree_fixup(block, node, order);
+
+	depth = block->levels - order;
+	*offset = (VkDeviceSize)(node + 1 - (1u << depth)) * (GA_MIN_ALLOC << order);
+
+	block->used += GA_MIN_ALLOC << order;
+	block->alloc_cnt++;
+
+	return node;
+}
+
+static inline void ga_block_free(ga_block *block, uint32_t node)
+{
+	uint32_t				order;
+
+	order = block->levels - ga_log2(node + 1);
+
+	block->tree[node] = order + 1;
+
+	ga_tree_fixup(block, node, order);
+
+	block->used -= GA_MIN_ALLOC << order;
+	block->alloc_cnt--;
+}
+
+static inline ga_block *ga_new_block(gpu_allocator *ga, VkDeviceSize size, uint32_t type, ga_kind kind, bool dedicated)
+{
+	ga_block				*block;
+	VkMemoryAllocateInfo			alloc_info;
+	uint32_t				node_cnt, depth;
+
+	block = mem_alloc(sizeof(ga_block));
+
+	if (block == NULL)
+		dbg_error("failed to allocate gpu block descriptor");
+
+	memset(&alloc_info, '\0', sizeof(alloc_info));
+
+	alloc_info.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
+	alloc_info.allocationSize = size;
+	alloc_info.memoryTypeIndex = type;
+
+	if (vkAllocateMemory(ga->dev, &alloc_info, NULL, &block->mem) != VK_SUCCESS)
+		dbg_error("failed to allocate gpu memory block");
+
+	block->map = NULL;
+
+	if (ga->mem_props.memoryTypes[type].propertyFlags & VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT) {
+		if (vkMapMemory(ga->dev, block->mem, 0, VK_WHOLE_SIZE, 0, (void **)&block->map) != VK_SUCCESS)
+			dbg_error("failed to map gpu memory block");
+	}
+
+	block->type = type;
+	block->kind = kind;
+	block->size = size;
+	block->used = 0;
+	block->alloc_cnt = 0;
+	block->dedicated = dedicated;
+	block->tree = NULL;
+	block->levels = 0;
+
+	if (!dedicated) {
+		block->levels = ga_log2(size / GA_MIN_ALLOC);
+		node_cnt = (2u << block->levels) - 1;
+		block->tree = mem_alloc(node_cnt);
+
+		if (block->tree == NULL)
+			dbg_error("failed to allocate gpu block tree");
+
+		for (depth = 0; depth <= block->levels; depth++)
+			memset(block->tree + (1u << depth) - 1, block->levels - depth + 1, 1u << depth);
+	}
+
+	ga_block_list_push(&ga->blocks, block);
+
+	return block;
+}
+
+static inline void ga_destroy_block(gpu_allocator *ga, uint32_t ind)
+{
+	ga_block				*block;
+
+	block = ga->blocks.elems[ind];
+
+	if (block->map != NULL)
+		vkUnmapMemory(ga->dev, block->mem);
+
+	vkFreeMemory(ga->dev, block->mem, NULL);
+
+	mem_free(block->tree);
+	mem_free(block);
+
+	ga->blocks.elems[ind] = ga->blocks.elems[ga->blocks.size - 1];
+	ga->blocks.size--;
+}
+
+static inline void ga_fill_alloc(ga_allocation *alloc, ga_block *block, uint32_t node, VkDeviceSize offset, VkDeviceSize size)
+{
+	alloc->block = block;
+	alloc->mem = block->mem;
+	alloc->offset = offset;
+	alloc->size = size;
+	alloc->node = node;
+	alloc->map = block->map != NULL ? block->map + offset : NULL;
+}
+
+void ga_init(gpu_allocator *ga, VkPhysicalDevice phys_dev, VkDevice dev)
+{
+	ga->dev = dev;
+	ga->total_alloc_calls = 0;
+	ga->total_alloc_ns = 0;
+
+	vkGetPhysicalDeviceMemoryProperties(phys_dev, &ga->mem_props);
+
+	ga_block_list_init(&ga->blocks);
+
+	pthread_mutex_init(&ga->lock, NULL);
+
+	dbg_log("initialized gpu allocator successfully");
+}
+
+void ga_clean(gpu_allocator *ga)
+{
+	while (ga->blocks.size > 0)
+		ga_destroy_block(ga, ga->blocks.size - 1);
+
+	ga_block_list_clean(&ga->blocks);
+
+	pthread_mutex_destroy(&ga->lock);
+}
+
+uint32_t ga_find_mem_type(gpu_allocator *ga, uint32_t type_bits, VkMemoryPropertyFlags required, VkMemoryPropertyFlags preferred)
+{
+	uint32_t				fallback;
+	VkMemoryPropertyFlags			flags;
+
+	fallback = UINT32_MAX;
+
+	for (uint32_t i = 0; i < ga->mem_props.memoryTypeCount; i++) {
+		flags = ga->mem_props.memoryTypes[i].propertyFlags;
+
+		if (!(type_bits & (1u << i)) || (flags & required) != required)
+			continue;
+
+		if ((flags & preferred) == preferred)
+			return i;
+
+		if (fallback == UINT32_MAX)
+			fallback = i;
+	}
+
+	if (fallback == UINT32_MAX)
+		dbg_error("failed to find a suitable memory type");
+
+	return fallback;
+}
+
+void ga_alloc(gpu_allocator *ga, const VkMemoryRequirements *reqs, uint32_t type, ga_kind kind, ga_allocation *alloc)
+{
+	uint64_t				start_ns;
+	uint32_t				order, node;
+	VkDeviceSize				offset;
+	ga_block				*block;
+
+	start_ns = time_now_ns();
+	order = ga_order_for(reqs->size, reqs->alignment);
+
+	pthread_mutex_lock(&ga->lock);
+
+	if ((GA_MIN_ALLOC << order) > GA_BLOCK_SIZE / 2) {
+		block = ga_new_block(ga, reqs->size, type, kind, true);
+		block->used = reqs->size;
+		block->alloc_cnt = 1;
+
+		ga_fill_alloc(alloc, block, GA_NO_NODE, 0, reqs->size);
+	} else {
+		node = GA_NO_NODE;
+
+		for (uint32_t i = 0; i < ga->blocks.size && node == GA_NO_NODE; i++) {
+			block = ga->blocks.elems[i];
+
+			if (block->type == type && block->kind == kind)
+				node = ga_block_alloc(block, order, &offset);
+		}
+
+		if (node == GA_NO_NODE) {
+			block = ga_new_block(ga, GA_BLOCK_SIZE, type, kind, false);
+			node = ga_block_alloc(block, order, &offset);
+		}
+
+		ga_fill_alloc(alloc, block, node, offset, reqs->size);
+	}
+
+	ga->total_alloc_calls++;
+	ga->total_alloc_ns += time_now_ns() - start_ns;
+
+	pthread_mutex_unlock(&ga->lock);
+}
+
+void ga_free(gpu_allocator *ga, ga_allocation *alloc)
+{
+	if (alloc->block == NULL)
+		return;
+
+	pthread_mutex_lock(&ga->lock);
+
+	if (alloc->block->dedicated) {
+		for (uint32_t i = 0; i < ga->blocks.size; i++) {
+			if (ga->blocks.elems[i] == alloc->block) {
+				ga_destroy_block(ga, i);
+				break;
+			}
+		}
+	} else {
+		ga_block_free(alloc->block, alloc->node);
+	}
+
+	pthread_mutex_unlock(&ga->lock);
+
+	alloc->block = NULL;
+	alloc->mem = VK_NULL_HANDLE;
+	alloc->map = NULL;
+}
+
+void ga_create_buffer(gpu_allocator *ga, const VkBufferCreateInfo *buf_info, VkMemoryPropertyFlags required,
+	VkMemoryPropertyFlags preferred, VkBuffer *buf, ga_allocation *alloc)
+{
+	VkMemoryRequirements			mem_reqs;
+
+	if (vkCreateBuffer(ga->dev, buf_info, NULL, buf) != VK_SUCCESS)
+		dbg_error("failed to create buffer");
+
+	vkGetBufferMemoryRequirements(ga->dev, *buf, &mem_reqs);
+
+	ga_alloc(ga, &mem_reqs, ga_find_mem_type(ga, mem_reqs.memoryTypeBits, required, preferred), GA_KIND_LINEAR, alloc);
+
+	if (vkBindBufferMemory(ga->dev, *buf, alloc->mem, alloc->offset) != VK_SUCCESS)
+		dbg_error("failed to bind buffer memory");
+}
+
+void ga_create_image(gpu_allocator *ga, const VkImageCreateInfo *img_info, VkMemoryPropertyFlags required,
+	VkMemoryPropertyFlags preferred, VkImage *img, ga_allocation *alloc)
+{
+	VkMemoryRequirements			mem_reqs;
+	ga_kind					kind;
+
+	if (vkCreateImage(ga->dev, img_info, NULL, img) != VK_SUCCESS)
+		dbg_error("failed to create image");
+
+	vkGetImageMemoryRequirements(ga->dev, *img, &mem_reqs);
+
+	kind = img_info->tiling == VK_IMAGE_TILING_OPTIMAL ? GA_KIND_OPTIMAL : GA_KIND_LINEAR;
+
+	ga_alloc(ga, &mem_reqs, ga_find_mem_type(ga, mem_reqs.memoryTypeBits, required, preferred), kind, alloc);
+
+	if (vkBindImageMemory(ga->dev, *img, alloc->mem, alloc->offset) != VK_SUCCESS)
+		dbg_error("failed to bind image memory");
+}
+
+void ga_trim(gpu_allocator *ga)
+{
+	pthread_mutex_lock(&ga->lock);
+
+	for (uint32_t i = ga->blocks.size; i > 0; i--) {
+		if (ga->blocks.elems[i - 1]->alloc_cnt == 0)
+			ga_destroy_block(ga, i - 1);
+	}
+
+	pthread_mutex_unlock(&ga->lock);
+}
+
+/*
+ * the allocator does not own resources, so defragmentation is a hook: allocations in
+ * sparse blocks are re-placed into denser ones and move_fn must copy the contents and
+ * rebind (usually recreate) the resource before the old range is freed
+ */
+uint32_t ga_defrag(gpu_allocator *ga, ga_allocation **allocs, uint32_t alloc_cnt, ga_move_fn move_fn, void *user)
+{
+	ga_allocation				*old_alloc, new_alloc;
+	ga_block				*src, *dst;
+	uint32_t				moved, order, node;
+	VkDeviceSize				offset;
+
+	moved = 0;
+
+	for (uint32_t i = 0; i < alloc_cnt; i++) {
+		old_alloc = allocs[i];
+		src = old_alloc->block;
+
+		if (src == NULL || src->dedicated || (float)src->used / src->size >= GA_DEFRAG_MAX_OCCUPANCY)
+			continue;
+
+		order = src->levels - ga_log2(old_alloc->node + 1);
+		node = GA_NO_NODE;
+		dst = NULL;
+
+		pthread_mutex_lock(&ga->lock);
+
+		for (uint32_t j = 0; j < ga->blocks.size && node == GA_NO_NODE; j++) {
+			dst = ga->blocks.elems[j];
+
+			if (dst != src && dst->type == src->type && dst->kind == src->kind && dst->used > src->used)
+				node = ga_block_alloc(dst, order, &offset);
+		}
+
+		pthread_mutex_unlock(&ga->lock);
+
+		if (node == GA_NO_NODE)
+			continue;
+
+		ga_fill_alloc(&new_alloc, dst, node, offset, old_alloc->size);
+
+		move_fn(old_alloc, &new_alloc, user);
+
+		ga_free(ga, old_alloc);
+
+		*old_alloc = new_alloc;
+		moved++;
+	}
+
+	ga_trim(ga);
+
+	return moved;
+}
+
+void ga_get_stats(gpu_allocator *ga, ga_stats *stats)
+{
+	ga_block				*block;
+	uint64_t				free_bytes, largest_free, block_largest;
+
+	memset(stats, '\0', sizeof(*stats));
+
+	free_bytes = 0;
+	largest_free = 0;
+
+	pthread_mutex_lock(&ga->lock);
+
+	for (uint32_t i = 0; i < ga->blocks.size; i++) {
+		block = ga->blocks.elems[i];
+
+		stats->block_cnt++;
+		stats->block_bytes += block->size;
+		stats->used_bytes += block->used;
+		stats->alloc_cnt += block->alloc_cnt;
+
+		if (block->dedicated) {
+			stats->dedicated_cnt++;
+			continue;
+		}
+
+		free_bytes += block->size - block->used;
+		block_largest = block->tree[0] > 0 ? GA_MIN_ALLOC << (block->tree[0] - 1) : 0;
+
+		if (block_largest > largest_free)
+			largest_free = block_largest;
+	}
+
+	stats->total_alloc_calls = ga->total_alloc_calls;
+	stats->total_alloc_ns = ga->total_alloc_ns;
+	stats->fragmentation = free_bytes > 0 ? 1.0f - (float)largest_free / free_bytes : 0.0f;
+
+	pthread_mutex_unlock(&ga->lock);
+}
+
+static inline void ga_region_init(gpu_allocator *ga, ga_allocation *alloc, VkDeviceSize size, uint32_t type)
+{
+	VkMemoryRequirements			reqs;
+
+	memset(&reqs, '\0', sizeof(reqs));
+
+	reqs.size = size;
+	reqs.alignment = GA_MIN_ALLOC;
+	reqs.memoryTypeBits = 1u << type;
+
+	ga_alloc(ga, &reqs, type, GA_KIND_LINEAR, alloc);
+}
+
+void ga_linear_init(gpu_allocator *ga, ga_linear *lin, VkDeviceSize size, uint32_t type)
+{
+	ga_region_init(ga, &lin->alloc, size, type);
+
+	lin->used = 0;
+}
+
+void ga_linear_clean(gpu_allocator *ga, ga_linear *lin)
+{
+	ga_free(ga, &lin->alloc);
+}
+
+bool ga_linear_alloc(ga_linear *lin, VkDeviceSize size, VkDeviceSize align, VkDeviceSize *offset)
+{
+	VkDeviceSize				start;
+
+	start = ga_align_up(lin->alloc.offset + lin->used, align) - lin->alloc.offset;
+
+	if (start + size > lin->alloc.size)
+		return false;
+
+	*offset = start;
+	lin->used = start + size;
+
+	return true;
+}
+
+void ga_linear_reset(ga_linear *lin)
+{
+	lin->used = 0;
+}
+
+void ga_ring_init(gpu_allocator *ga, ga_ring *ring, VkDeviceSize size, uint32_t type)
+{
+	ga_region_init(ga, &ring->alloc, size, type);
+
+	ring->head = 0;
+	ring->tail = 0;
+	ring->used = 0;
+	ring->total = 0;
+	ring->mark_first = 0;
+	ring->mark_cnt = 0;
+}
+
+void ga_ring_clean(gpu_allocator *ga, ga_ring *ring)
+{
+	ga_free(ga, &ring->alloc);
+}
+
+/* offsets are relative to the ring's allocation; alignment is against the underlying memory */
+bool ga_ring_alloc(ga_ring *ring, VkDeviceSize size, VkDeviceSize align, VkDeviceSize *offset)
+{
+	VkDeviceSize				cap, base, start, consumed;
+
+	cap = ring->alloc.size;
+	base = ring->alloc.offset;
+
+	if (ring->used == 0) {
+		ring->head = 0;
+		ring->tail = 0;
+	}
+
+	if (ring->used == cap || size > cap)
+		return false;
+
+	start = ga_align_up(base + ring->head, align) - base;
+
+	if (ring->head >= ring->tail) {
+		if (start + size <= cap) {
+			consumed = start + size - ring->head;
+		} else {
+			start = ga_align_up(base, align) - base;
+
+			if (start + size > ring->tail && ring->used > 0)
+				return false;
+
+			if (start + size > cap)
+				return false;
+
+			consumed = cap - ring->head + start + size;
+		}
+	} else {
+		if (start + size > ring->tail)
+			return false;
+
+		consumed = start + size - ring->head;
+	}
+
+	ring->head = (start + size) % cap;
+	ring->used += consumed;
+	ring->total += consumed;
+
+	*offset = start;
+
+	return true;
+}
+
+void ga_ring_mark(ga_ring *ring, uint64_t tag)
+{
+	uint32_t				ind;
+
+	if (ring->mark_cnt == GA_RING_MAX_MARKS) {
+		ind = (ring->mark_first + ring->mark_cnt - 1) % GA_RING_MAX_MARKS;
+	} else {
+		ind = (ring->mark_first + ring->mark_cnt) % GA_RING_MAX_MARKS;
+		ring->mark_cnt++;
+	}
+
+	ring->mark_tags[ind] = tag;
+	ring->mark_heads[ind] = ring->head;
+	ring->mark_totals[ind] = ring->total;
+}
+
+void ga_ring_release(ga_ring *ring, uint64_t completed_tag)
+{
+	uint32_t				ind;
+
+	while (ring->mark_cnt > 0) {
+		ind = ring->mark_first;
+
+		if (ring->mark_tags[ind] > completed_tag)
+			break;
+
+		ring->tail = ring->mark_heads[ind];
+		ring->used = ring->total - ring->mark_totals[ind];
+		ring->mark_first = (ring->mark_first + 1) % GA_RING_MAX_MARKS;
+		ring->mark_cnt--;
+	}
+}
@@ -0,0 +1,135 @@
+#ifndef GPU_ALLOC_H_INCLUDED
+#define GPU_ALLOC_H_INCLUDED
+
+#include "../../util/debug.h"
+#include "../../util/util.h"
+#include "../../util/dynarr.h"
+
+#include <vulkan/vulkan.h>
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <pthread.h>
+
+#define GA_BLOCK_SIZE				(64ull * 1024 * 1024)
+#define GA_MIN_ALLOC				256ull
+#define GA_RING_MAX_MARKS			16
+
+/*
+ * buffers and linear images never share a block with optimal images, so
+ * neighbouring suballocations can never violate bufferImageGranularity
+ */
+typedef enum {
+	GA_KIND_LINEAR,
+	GA_KIND_OPTIMAL,
+	GA_KIND_CNT,
+} ga_kind;
+
+typedef struct {
+	VkDeviceMemory mem;
+	uint8_t *map;
+	uint32_t type;
+	ga_kind kind;
+	uint8_t *tree;
+	uint32_t levels;
+	VkDeviceSize size;
+	VkDeviceSize used;
+	uint32_t alloc_cnt;
+	bool dedicated;
+} ga_block;
+
+typedef struct {
+	ga_block *block;
+	VkDeviceMemory mem;
+	VkDeviceSize offset;
+	VkDeviceSize size;
+	uint8_t *map;
+	uint32_t node;
+} ga_allocation;
+
+typedef struct {
+	uint64_t block_cnt;
+	uint64_t dedicated_cnt;
+	uint64_t block_bytes;
+	uint64_t used_bytes;
+	uint64_t alloc_cnt;
+	uint64_t total_alloc_calls;
+	uint64_t total_alloc_ns;
+	float fragmentation;
+} ga_stats;
+
+DYNARR_DEFINE(ga_block_list, ga_block *)
+
+typedef struct {
+	VkDevice dev;
+	VkPhysicalDeviceMemoryProperties mem_props;
+	ga_block_list blocks;
+	pthread_mutex_t lock;
+	uint64_t total_alloc_calls;
+	uint64_t total_alloc_ns;
+} gpu_allocator;
+
+typedef struct {
+	ga_allocation alloc;
+	VkDeviceSize used;
+} ga_linear;
+
+/* marks close a section of the ring under a tag (frame number, timeline value) so it can be released once the gpu passes it */
+typedef struct {
+	ga_allocation alloc;
+	VkDeviceSize head;
+	VkDeviceSize tail;
+	VkDeviceSize used;
+	VkDeviceSize total;
+	uint64_t mark_tags[GA_RING_MAX_MARKS];
+	VkDeviceSize mark_heads[GA_RING_MAX_MARKS];
+	VkDeviceSize mark_totals[GA_RING_MAX_MARKS];
+	uint32_t mark_first;
+	uint32_t mark_cnt;
+} ga_ring;
+
+typedef void (*ga_move_fn)(ga_allocation *old_alloc, const ga_allocation *new_alloc, void *user);
+
+void ga_init(gpu_allocator *ga, VkPhysicalDevice phys_dev, VkDevice dev);
+
+void ga_clean(gpu_allocator *ga);
+
+uint32_t ga_find_mem_type(gpu_allocator *ga, uint32_t type_bits, VkMemoryPropertyFlags required, VkMemoryPropertyFlags preferred);
+
+void ga_alloc(gpu_allocator *ga, const VkMemoryRequirements *reqs, uint32_t type, ga_kind kind, ga_allocation *alloc);
+
+void ga_free(gpu_allocator *ga, ga_allocation *alloc);
+
+void ga_create_buffer(gpu_allocator *ga, const VkBufferCreateInfo *buf_info, VkMemoryPropertyFlags required,
+	VkMemoryPropertyFlags preferred, VkBuffer *buf, ga_allocation *alloc);
+
+void ga_create_image(gpu_allocator *ga, const VkImageCreateInfo *img_info, VkMemoryPropertyFlags required,
+	VkMemoryPropertyFlags preferred, VkImage *img, ga_allocation *alloc);
+
+void ga_trim(gpu_allocator *ga);
+
+uint32_t ga_defrag(gpu_allocator *ga, ga_allocation **allocs, uint32_t alloc_cnt, ga_move_fn move_fn, void *user);
+
+void ga_get_stats(gpu_allocator *ga, ga_stats *stats);
+
+void ga_linear_init(gpu_allocator *ga, ga_linear *lin, VkDeviceSize size, uint32_t type);
+
+void ga_linear_clean(gpu_allocator *ga, ga_linear *lin);
+
+bool ga_linear_alloc(ga_linear *lin, VkDeviceSize size, VkDeviceSize align, VkDeviceSize *offset);
+
+void ga_linear_reset(ga_linear *lin);
+
+void ga_ring_init(gpu_allocator *ga, ga_ring *ring, VkDeviceSize size, uint32_t type);
+
+void ga_ring_clean(gpu_allocator *ga, ga_ring *ring);
+
+bool ga_ring_alloc(ga_ring *ring, VkDeviceSize size, VkDeviceSize align, VkDeviceSize *offset);
+
+void ga_ring_mark(ga_ring *ring, uint64_t tag);
+
+void ga_ring_release(ga_ring *ring, uint64_t completed_tag);
+
+#endif
@@ -0,0 +1,355 @@
+#include "gpu_prof.h"
+
+#include <string.h>
+
+static inline uint32_t find_site(gpu_profiler *gp, const char *name)
+{
+	uint32_t				ind;
+
+	pthread_mutex_lock(&gp->lock);
+
+	for (ind = 0; ind < gp->site_cnt; ind++) {
+		if (gp->sites[ind].name == name || strcmp(gp->sites[ind].name, name) == 0)
+			break;
+	}
+
+	if (ind == gp->site_cnt) {
+		if (gp->site_cnt == GPU_PROF_MAX_SITES) {
+			ind = GPU_PROF_NONE;
+		} else {
+			memset(&gp->sites[ind], '\0', sizeof(gpu_prof_site));
+
+			gp->sites[ind].name = name;
+			gp->sites[ind].site = prof_intern_site(name, "gpu", 0);
+			gp->site_cnt++;
+		}
+	}
+
+	pthread_mutex_unlock(&gp->lock);
+
+	return ind;
+}
+
+/* one timestamp bracketed by two cpu reads; the midpoint is off by at most half a submit round trip */
+static inline void calibrate(gpu_profiler *gp, VkQueue queue, uint32_t queue_fam)
+{
+	VkCommandPoolCreateInfo			pool_info;
+	VkCommandBufferAllocateInfo		cb_info;
+	VkCommandBufferBeginInfo		begin_info;
+	VkFenceCreateInfo			fence_info;
+	VkSubmitInfo				submit_info;
+	VkCommandPool				cmd_pool;
+	VkCommandBuffer				cmd_buf;
+	VkFence					fence;
+	VkQueryPool				pool;
+	uint64_t				ts, t0, t1;
+
+	pool = gp->frames[0].ts_pool;
+
+	memset(&pool_info, '\0', sizeof(pool_info));
+
+	pool_info.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
+	pool_info.flags = VK_COMMAND_POOL_CREATE_TRANSIENT_BIT;
+	pool_info.queueFamilyIndex = queue_fam;
+
+	if (vkCreateCommandPool(gp->dev, &pool_info, NULL, &cmd_pool) != VK_SUCCESS)
+		dbg_error("failed to create gpu profiler command pool");
+
+	memset(&cb_info, '\0', sizeof(cb_info));
+
+	cb_info.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+	cb_info.commandPool = cmd_pool;
+	cb_info.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+	cb_info.commandBufferCount = 1;
+
+	if (vkAllocateCommandBuffers(gp->dev, &cb_info, &cmd_buf) != VK_SUCCESS)
+		dbg_error("failed to allocate gpu profiler command buffer");
+
+	memset(&begin_info, '\0', sizeof(begin_info));
+
+	begin_info.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+	begin_info.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+
+	vkBeginCommandBuffer(cmd_buf, &begin_info);
+	vkCmdResetQueryPool(cmd_buf, pool, 0, 1);
+	vkCmdWriteTimestamp(cmd_buf, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, pool, 0);
+
+	if (vkEndCommandBuffer(cmd_buf) != VK_SUCCESS)
+		dbg_error("failed to record gpu profiler calibration");
+
+	memset(&fence_info, '\0', sizeof(fence_info));
+
+	fence_info.sType = VK_STRUCTURE_TYPE_FENCE_CREATE_INFO;
+
+	if (vkCreateFence(gp->dev, &fence_info, NULL, &fence) != VK_SUCCESS)
+		dbg_error("failed to create gpu profiler fence");
+
+	memset(&submit_info, '\0', sizeof(submit_info));
+
+	submit_info.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+	submit_info.commandBufferCount = 1;
+	submit_info.pCommandBuffers = &cmd_buf;
+
+	t0 = time_now_ns();
+
+	if (vkQueueSubmit(queue, 1, &submit_info, fence) != VK_SUCCESS)
+		dbg_error("failed to submit gpu profiler calibration");
+
+	vkWaitForFences(gp->dev, 1, &fence, VK_TRUE, UINT64_MAX);
+
+	t1 = time_now_ns();
+
+	if (vkGetQueryPoolResults(gp->dev, pool, 0, 1, sizeof(ts), &ts, sizeof(uint64_t),
+		VK_QUERY_RESULT_64_BIT | VK_QUERY_RESULT_WAIT_BIT) != VK_SUCCESS)
+		dbg_error("failed to read gpu profiler calibration");
+
+	gp->offset_ns = (int64_t)(t0 + (t1 - t0) / 2) - (int64_t)((ts & gp->ts_mask) * gp->ns_per_tick);
+
+	vkDestroyFence(gp->dev, fence, NULL);
+	vkDestroyCommandPool(gp->dev, cmd_pool, NULL);
+}
+
+static inline void create_pools(gpu_profiler *gp, gpu_prof_frame *f)
+{
+	VkQueryPoolCreateInfo			pool_info;
+
+	memset(&pool_info, '\0', sizeof(pool_info));
+
+	pool_info.sType = VK_STRUCTURE_TYPE_QUERY_POOL_CREATE_INFO;
+	pool_info.queryType = VK_QUERY_TYPE_TIMESTAMP;
+	pool_info.queryCount = GPU_PROF_MAX_ZONES * 2;
+
+	if (vkCreateQueryPool(gp->dev, &pool_info, NULL, &f->ts_pool) != VK_SUCCESS)
+		dbg_error("failed to create timestamp query pool");
+
+	if (!gp->stats)
+		return;
+
+	pool_info.queryType = VK_QUERY_TYPE_PIPELINE_STATISTICS;
+	pool_info.queryCount = GPU_PROF_MAX_STATS_ZONES;
+	pool_info.pipelineStatistics = GPU_PROF_STAT_FLAGS;
+
+	if (vkCreateQueryPool(gp->dev, &pool_info, NULL, &f->stats_pool) != VK_SUCCESS)
+		dbg_error("failed to create pipeline statistics query pool");
+}
+
+/* stats is ignored unless the device was created with pipelineStatisticsQuery */
+void gpu_prof_init(gpu_profiler *gp, VkDevice dev, const VkPhysicalDeviceProperties *props, uint32_t ts_bits,
+	VkQueue queue, uint32_t queue_fam, uint32_t frame_cnt, bool stats)
+{
+	memset(gp, '\0', sizeof(*gp));
+
+	gp->dev = dev;
+	gp->frame_cnt = clamp_uint(frame_cnt, 1, GPU_PROF_MAX_FRAMES);
+	gp->ns_per_tick = props->limits.timestampPeriod;
+	gp->ts_mask = ts_bits >= 64 ? UINT64_MAX : (1ull << ts_bits) - 1;
+	gp->stats = stats;
+
+	pthread_mutex_init(&gp->lock, NULL);
+
+	if (ts_bits == 0) {
+		dbg_warn("graphics queue has no timestamp support, gpu profiling is disabled");
+
+		return;
+	}
+
+	for (uint32_t i = 0; i < gp->frame_cnt; i++)
+		create_pools(gp, &gp->frames[i]);
+
+	calibrate(gp, queue, queue_fam);
+
+	gp->timeline = prof_add_timeline("gpu");
+	gp->enabled = true;
+
+	dbg_log("initialized gpu profiler with %.2f ns ticks successfully", gp->ns_per_tick);
+}
+
+/* only called once the frame's fence has signalled, so results are read without waiting */
+static inline void resolve(gpu_profiler *gp, gpu_prof_frame *f)
+{
+	uint64_t				ts[GPU_PROF_MAX_ZONES * 2];
+	uint64_t				stats[GPU_PROF_MAX_STATS_ZONES * GPU_PROF_STAT_CNT];
+	uint32_t				zone_cnt, stats_cnt;
+	gpu_prof_zone				*z;
+	gpu_prof_site				*site;
+	uint64_t				begin, ticks, ns;
+	int64_t					cpu_ns;
+
+	if (!f->pending)
+		return;
+
+	f->pending = false;
+	zone_cnt = f->zone_cnt < GPU_PROF_MAX_ZONES ? f->zone_cnt : GPU_PROF_MAX_ZONES;
+	stats_cnt = f->stats_cnt < GPU_PROF_MAX_STATS_ZONES ? f->stats_cnt : GPU_PROF_MAX_STATS_ZONES;
+
+	if (zone_cnt > 0 && vkGetQueryPoolResults(gp->dev, f->ts_pool, 0, zone_cnt * 2, sizeof(ts), ts,
+		sizeof(uint64_t), VK_QUERY_RESULT_64_BIT) != VK_SUCCESS) {
+		gp->lost_frames++;
+
+		return;
+	}
+
+	if (stats_cnt > 0 && vkGetQueryPoolResults(gp->dev, f->stats_pool, 0, stats_cnt, sizeof(stats), stats,
+		GPU_PROF_STAT_CNT * sizeof(uint64_t), VK_QUERY_RESULT_64_BIT) != VK_SUCCESS)
+		stats_cnt = 0;
+
+	for (uint32_t i = 0; i < zone_cnt; i++) {
+		z = &f->zones[i];
+		site = &gp->sites[z->site];
+
+		begin = ts[i * 2] & gp->ts_mask;
+		ticks = ((ts[i * 2 + 1] & gp->ts_mask) - begin) & gp->ts_mask;
+		ns = ticks * gp->ns_per_tick;
+
+		site->calls++;
+		site->total_ns += ns;
+
+		if (ns > site->max_ns)
+			site->max_ns = ns;
+
+		cpu_ns = gp->offset_ns + (int64_t)(begin * gp->ns_per_tick);
+
+		prof_record_on(gp->timeline, site->site, prof_ns_to_ticks(cpu_ns), prof_ns_to_ticks(cpu_ns + ns));
+
+		if (z->stats == GPU_PROF_NONE || z->stats >= stats_cnt)
+			continue;
+
+		site->stats_calls++;
+
+		for (uint32_t j = 0; j < GPU_PROF_STAT_CNT; j++)
+			site->stats[j] += stats[z->stats * GPU_PROF_STAT_CNT + j];
+	}
+
+	gp->resolved_frames++;
+}
+
+/* must be recorded outside a render pass, before any zone of the frame */
+void gpu_prof_frame_begin(gpu_profiler *gp, VkCommandBuffer cmd_buf, uint32_t frame)
+{
+	gpu_prof_frame				*f;
+
+	if (!gp->enabled)
+		return;
+
+	f = &gp->frames[frame];
+
+	resolve(gp, f);
+
+	vkCmdResetQueryPool(cmd_buf, f->ts_pool, 0, GPU_PROF_MAX_ZONES * 2);
+
+	if (gp->stats)
+		vkCmdResetQueryPool(cmd_buf, f->stats_pool, 0, GPU_PROF_MAX_STATS_ZONES);
+
+	f->zone_cnt = 0;
+	f->stats_cnt = 0;
+	f->pending = true;
+}
+
+/*
+ * safe to call from several recording threads at once. a stats zone must begin and end
+ * in the same command buffer and, without inheritedQueries, must not span secondaries
+ */
+uint32_t gpu_prof_begin(gpu_profiler *gp, VkCommandBuffer cmd_buf, uint32_t frame, const char *name, bool stats)
+{
+	gpu_prof_frame				*f;
+	gpu_prof_zone				*z;
+	uint32_t				ind, site;
+
+	if (!gp->enabled)
+		return GPU_PROF_NONE;
+
+	f = &gp->frames[frame];
+	site = find_site(gp, name);
+	ind = site != GPU_PROF_NONE ? __atomic_fetch_add(&f->zone_cnt, 1, __ATOMIC_RELAXED) : GPU_PROF_NONE;
+
+	if (ind >= GPU_PROF_MAX_ZONES) {
+		__atomic_fetch_add(&gp->dropped_zones, 1, __ATOMIC_RELAXED);
+
+		return GPU_PROF_NONE;
+	}
+
+	z = &f->zones[ind];
+	z->site = site;
+	z->stats = GPU_PROF_NONE;
+
+	vkCmdWriteTimestamp(cmd_buf, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, f->ts_pool, ind * 2);
+
+	if (stats && gp->stats) {
+		z->stats = __atomic_fetch_add(&f->stats_cnt, 1, __ATOMIC_RELAXED);
+
+		if (z->stats < GPU_PROF_MAX_STATS_ZONES)
+			vkCmdBeginQuery(cmd_buf, f->stats_pool, z->stats, 0);
+		else
+			z->stats = GPU_PROF_NONE;
+	}
+
+	return ind;
+}
+
+void gpu_prof_end(gpu_profiler *gp, VkCommandBuffer cmd_buf, uint32_t frame, uint32_t zone)
+{
+	gpu_prof_frame				*f;
+
+	if (zone == GPU_PROF_NONE)
+		return;
+
+	f = &gp->frames[frame];
+
+	if (f->zones[zone].stats != GPU_PROF_NONE)
+		vkCmdEndQuery(cmd_buf, f->stats_pool, f->zones[zone].stats);
+
+	vkCmdWriteTimestamp(cmd_buf, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, f->ts_pool, zone * 2 + 1);
+}
+
+static inline void print_summary(gpu_profiler *gp)
+{
+	gpu_prof_site				*site;
+	double					frames, calls;
+
+	if (gp->resolved_frames == 0)
+		return;
+
+	frames = gp->resolved_frames;
+
+	dbg_info("gpu profile over %lu frames, %lu frames lost, %lu zones dropped", (unsigned long)gp->resolved_frames,
+		(unsigned long)gp->lost_frames, (unsigned long)gp->dropped_zones);
+
+	for (uint32_t i = 0; i < gp->site_cnt; i++) {
+		site = &gp->sites[i];
+
+		dbg_info("  %-24s %8.3f ms/frame %8.1f calls/frame  max %.3f ms", site->name,
+			site->total_ns / 1e6 / frames, site->calls / frames, site->max_ns / 1e6);
+
+		if (site->stats_calls == 0)
+			continue;
+
+		calls = site->stats_calls;
+
+		dbg_info("  %-24s %.0f prims in, %.0f vs, %.0f prims clipped, %.0f fs, %.0f cs per call", "",
+			site->stats[0] / calls, site->stats[1] / calls, site->stats[2] / calls, site->stats[3] / calls,
+			site->stats[4] / calls);
+	}
+}
+
+/* the device must be idle; picks up the frames still in flight, then prints the run's totals */
+void gpu_prof_clean(gpu_profiler *gp)
+{
+	if (gp->enabled) {
+		for (uint32_t i = 0; i < gp->frame_cnt; i++)
+			resolve(gp, &gp->frames[i]);
+
+		print_summary(gp);
+	}
+
+	for (uint32_t i = 0; i < gp->frame_cnt; i++) {
+		if (gp->frames[i].ts_pool != VK_NULL_HANDLE)
+			vkDestroyQueryPool(gp->dev, gp->frames[i].ts_pool, NULL);
+
+		if (gp->frames[i].stats_pool != VK_NULL_HANDLE)
+			vkDestroyQueryPool(gp->dev, gp->frames[i].stats_pool, NULL);
+	}
+
+	pthread_mutex_destroy(&gp->lock);
+
+	dbg_log("cleaned gpu profiler successfully");
+}
@@ -0,0 +1,89 @@
+#ifndef GPU_PROF_H_INCLUDED
+#define GPU_PROF_H_INCLUDED
+
+#include "../../util/debug.h"
+#include "../../util/util.h"
+#include "../../util/prof.h"
+
+#include <vulkan/vulkan.h>
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <pthread.h>
+
+#define GPU_PROF_MAX_FRAMES			4
+#define GPU_PROF_MAX_ZONES			128
+#define GPU_PROF_MAX_STATS_ZONES		16
+#define GPU_PROF_MAX_SITES			64
+#define GPU_PROF_STAT_CNT			5
+#define GPU_PROF_NONE				UINT32_MAX
+#define GPU_PROF_STAT_FLAGS			(VK_QUERY_PIPELINE_STATISTIC_INPUT_ASSEMBLY_PRIMITIVES_BIT | \
+						VK_QUERY_PIPELINE_STATISTIC_VERTEX_SHADER_INVOCATIONS_BIT | \
+						VK_QUERY_PIPELINE_STATISTIC_CLIPPING_PRIMITIVES_BIT | \
+						VK_QUERY_PIPELINE_STATISTIC_FRAGMENT_SHADER_INVOCATIONS_BIT | \
+						VK_QUERY_PIPELINE_STATISTIC_COMPUTE_SHADER_INVOCATIONS_BIT)
+
+/* one per distinct zone name, totals cover the whole run */
+typedef struct {
+	const char *name;
+	const prof_site *site;
+	uint64_t calls;
+	uint64_t total_ns;
+	uint64_t max_ns;
+	uint64_t stats_calls;
+	uint64_t stats[GPU_PROF_STAT_CNT];
+} gpu_prof_site;
+
+typedef struct {
+	uint32_t site;
+	uint32_t stats;
+} gpu_prof_zone;
+
+/* zone z owns timestamps 2z and 2z + 1; zones are claimed atomically so secondaries can record in parallel */
+typedef struct {
+	VkQueryPool ts_pool;
+	VkQueryPool stats_pool;
+	gpu_prof_zone zones[GPU_PROF_MAX_ZONES];
+	uint32_t zone_cnt;
+	uint32_t stats_cnt;
+	bool pending;
+} gpu_prof_frame;
+
+/*
+ * timestamps are written into a query pool per frame in flight and read back the next
+ * time that frame slot comes around, after its fence has already been waited on, so
+ * resolving never stalls. resolved zones land on a "gpu" timeline in prof, shifted onto
+ * the cpu clock by an offset measured once at init
+ */
+typedef struct {
+	VkDevice dev;
+	gpu_prof_frame frames[GPU_PROF_MAX_FRAMES];
+	uint32_t frame_cnt;
+	gpu_prof_site sites[GPU_PROF_MAX_SITES];
+	uint32_t site_cnt;
+	pthread_mutex_t lock;
+	prof_thread *timeline;
+	double ns_per_tick;
+	uint64_t ts_mask;
+	int64_t offset_ns;
+	uint64_t resolved_frames;
+	uint64_t lost_frames;
+	uint64_t dropped_zones;
+	bool enabled;
+	bool stats;
+} gpu_profiler;
+
+void gpu_prof_init(gpu_profiler *gp, VkDevice dev, const VkPhysicalDeviceProperties *props, uint32_t ts_bits,
+	VkQueue queue, uint32_t queue_fam, uint32_t frame_cnt, bool stats);
+
+void gpu_prof_clean(gpu_profiler *gp);
+
+void gpu_prof_frame_begin(gpu_profiler *gp, VkCommandBuffer cmd_buf, uint32_t frame);
+
+uint32_t gpu_prof_begin(gpu_profiler *gp, VkCommandBuffer cmd_buf, uint32_t frame, const char *name, bool stats);
+
+void gpu_prof_end(gpu_profiler *gp, VkCommandBuffer cmd_buf, uint32_t frame, uint32_t zone);
+
+#endif
@@ -0,0 +1,735 @@
+#include "mesh.h"
+
+#include <math.h>
+
+#define MESH_OBJ_LINE_MAX			512
+#define MESH_OBJ_MAX_POLY			64
+#define MESH_CORNER_EMPTY			UINT64_MAX
+
+typedef struct {
+	float v[3];
+} mesh_vec3;
+
+DYNARR_DEFINE(mesh_vec3_list, mesh_vec3)
+
+/* maps an obj position/normal index pair to the vertex it was expanded into */
+typedef struct {
+	uint64_t *keys;
+	uint32_t *vals;
+	uint32_t cap;
+	uint32_t cnt;
+} corner_map;
+
+static inline uint16_t f32_to_f16(float f)
+{
+	uint32_t				bits, mant, half, shift;
+	int32_t					exp;
+	uint16_t				sign;
+
+	memcpy(&bits, &f, sizeof(bits));
+
+	sign = (bits >> 16) & 0x8000;
+	exp = (int32_t)((bits >> 23) & 0xff) - 127 + 15;
+	mant = bits & 0x7fffff;
+
+	if ((bits & 0x7fffffff) >= 0x7f800000)
+		return sign | 0x7c00 | (mant != 0 ? 0x200 : 0);
+
+	if (exp >= 31)
+		return sign | 0x7c00;
+
+	if (exp <= 0) {
+		if (exp < -10)
+			return sign;
+
+		mant |= 0x800000;
+		shift = 14 - exp;
+		half = mant >> shift;
+
+		if (((mant >> (shift - 1)) & 1) && ((mant & ((1u << (shift - 1)) - 1)) || (half & 1)))
+			half++;
+
+		return sign | half;
+	}
+
+	/* round to nearest even, a carry into the exponent is still correct */
+	half = ((uint32_t)exp << 10) | (mant >> 13);
+
+	if ((mant & 0x1fff) > 0x1000 || ((mant & 0x1fff) == 0x1000 && (half & 1)))
+		half++;
+
+	return sign | half;
+}
+
+static inline void oct_encode(const float *n, float *out)
+{
+	float					l1, x, y;
+
+	l1 = fabsf(n[0]) + fabsf(n[1]) + fabsf(n[2]);
+
+	if (l1 == 0.0f) {
+		out[0] = 0.0f;
+		out[1] = 0.0f;
+		return;
+	}
+
+	x = n[0] / l1;
+	y = n[1] / l1;
+
+	if (n[2] < 0.0f) {
+		out[0] = (1.0f - fabsf(y)) * (x >= 0.0f ? 1.0f : -1.0f);
+		out[1] = (1.0f - fabsf(x)) * (y >= 0.0f ? 1.0f : -1.0f);
+	} else {
+		out[0] = x;
+		out[1] = y;
+	}
+}
+
+static inline int16_t to_snorm16(float f)
+{
+	f = f < -1.0f ? -1.0f : (f > 1.0f ? 1.0f : f);
+
+	return (int16_t)lrintf(f * 32767.0f);
+}
+
+static inline uint8_t to_unorm8(float f)
+{
+	f = f < 0.0f ? 0.0f : (f > 1.0f ? 1.0f : f);
+
+	return (uint8_t)lrintf(f * 255.0f);
+}
+
+static inline void set_attrib(mesh_layout *layout, uint32_t loc, VkFormat format, uint32_t size)
+{
+	layout->attribs[loc].location = loc;
+	layout->attribs[loc].binding = 0;
+	layout->attribs[loc].format = format;
+	layout->attribs[loc].offset = layout->stride;
+
+	layout->stride += size;
+}
+
+void mesh_layout_init(mesh_layout *layout, uint32_t quant)
+{
+	memset(layout, '\0', sizeof(*layout));
+
+	layout->quant = quant;
+
+	if (quant & MESH_QUANT_POS)
+		set_attrib(layout, 0, VK_FORMAT_R16G16B16A16_SFLOAT, 4 * sizeof(uint16_t));
+	else
+		set_attrib(layout, 0, VK_FORMAT_R32G32B32_SFLOAT, 3 * sizeof(float));
+
+	if (quant & MESH_QUANT_NORMAL)
+		set_attrib(layout, 1, VK_FORMAT_R16G16_SNORM, 2 * sizeof(int16_t));
+	else
+		set_attrib(layout, 1, VK_FORMAT_R32G32_SFLOAT, 2 * sizeof(float));
+
+	if (quant & MESH_QUANT_COLOR)
+		set_attrib(layout, 2, VK_FORMAT_R8G8B8A8_UNORM, 4 * sizeof(uint8_t));
+	else
+		set_attrib(layout, 2, VK_FORMAT_R32G32B32A32_SFLOAT, 4 * sizeof(float));
+
+	layout->binding.binding = 0;
+	layout->binding.stride = layout->stride;
+	layout->binding.inputRate = VK_VERTEX_INPUT_RATE_VERTEX;
+}
+
+void mesh_encode(const mesh_layout *layout, const mesh_vertex *verts, uint32_t vert_cnt, uint8_t *dest)
+{
+	const mesh_vertex			*v;
+	uint8_t					*out;
+	uint16_t				pos16[4];
+	int16_t					normal16[2];
+	uint8_t					color8[4];
+	float					oct[2];
+
+	for (uint32_t i = 0; i < vert_cnt; i++) {
+		v = &verts[i];
+		out = dest + (size_t)i * layout->stride;
+
+		if (layout->quant & MESH_QUANT_POS) {
+			for (uint32_t j = 0; j < 3; j++)
+				pos16[j] = f32_to_f16(v->pos[j]);
+
+			pos16[3] = f32_to_f16(1.0f);
+
+			memcpy(out + layout->attribs[0].offset, pos16, sizeof(pos16));
+		} else {
+			memcpy(out + layout->attribs[0].offset, v->pos, sizeof(v->pos));
+		}
+
+		oct_encode(v->normal, oct);
+
+		if (layout->quant & MESH_QUANT_NORMAL) {
+			normal16[0] = to_snorm16(oct[0]);
+			normal16[1] = to_snorm16(oct[1]);
+
+			memcpy(out + layout->attribs[1].offset, normal16, sizeof(normal16));
+		} else {
+			memcpy(out + layout->attribs[1].offset, oct, sizeof(oct));
+		}
+
+		if (layout->quant & MESH_QUANT_COLOR) {
+			for (uint32_t j = 0; j < 4; j++)
+				color8[j] = to_unorm8(v->color[j]);
+
+			memcpy(out + layout->attribs[2].offset, color8, sizeof(color8));
+		} else {
+			memcpy(out + layout->attribs[2].offset, v->color, sizeof(v->color));
+		}
+	}
+}
+
+void mesh_data_init(mesh_data *md)
+{
+	mesh_vertex_list_init(&md->verts);
+	mesh_index_list_init(&md->inds);
+}
+
+void mesh_data_clean(mesh_data *md)
+{
+	mesh_vertex_list_clean(&md->verts);
+	mesh_index_list_clean(&md->inds);
+}
+
+static inline void corner_map_init(corner_map *cm, uint32_t cap)
+{
+	cm->cap = cap;
+	cm->cnt = 0;
+	cm->keys = mem_alloc(cap * sizeof(uint64_t));
+	cm->vals = mem_alloc(cap * sizeof(uint32_t));
+
+	if (cm->keys == NULL || cm->vals == NULL)
+		dbg_error("failed to allocate obj corner map");
+
+	memset(cm->keys, 0xff, cap * sizeof(uint64_t));
+}
+
+static inline void corner_map_clean(corner_map *cm)
+{
+	mem_free(cm->keys);
+	mem_free(cm->vals);
+}
+
+static inline uint32_t *corner_map_slot(corner_map *cm, uint64_t key, bool *found)
+{
+	uint32_t				ind;
+
+	ind = (uint32_t)(key * 0x9e3779b97f4a7c15ull >> 32) & (cm->cap - 1);
+
+	while (cm->keys[ind] != MESH_CORNER_EMPTY && cm->keys[ind] != key)
+		ind = (ind + 1) & (cm->cap - 1);
+
+	*found = cm->keys[ind] == key;
+	cm->keys[ind] = key;
+
+	return &cm->vals[ind];
+}
+
+static inline void corner_map_grow(corner_map *cm)
+{
+	corner_map				old;
+	uint32_t				*slot;
+	bool					found;
+
+	old = *cm;
+
+	corner_map_init(cm, old.cap * 2);
+
+	for (uint32_t i = 0; i < old.cap; i++) {
+		if (old.keys[i] == MESH_CORNER_EMPTY)
+			continue;
+
+		slot = corner_map_slot(cm, old.keys[i], &found);
+		*slot = old.vals[i];
+		cm->cnt++;
+	}
+
+	corner_map_clean(&old);
+}
+
+static inline long resolve_obj_ind(long ind, uint32_t cnt)
+{
+	return ind < 0 ? (long)cnt + ind : ind - 1;
+}
+
+static inline bool parse_obj_corner(char *tok, const mesh_vec3_list *positions, const mesh_vec3_list *normals,
+	long *pos_ind, long *normal_ind)
+{
+	char					*end;
+
+	*pos_ind = resolve_obj_ind(strtol(tok, &end, 10), positions->size);
+	*normal_ind = -1;
+
+	if (end == tok || *pos_ind < 0 || *pos_ind >= (long)positions->size)
+		return false;
+
+	if (*end == '/') {
+		end = strchr(end + 1, '/');
+
+		if (end != NULL && end[1] != '\0') {
+			*normal_ind = resolve_obj_ind(strtol(end + 1, NULL, 10), normals->size);
+
+			if (*normal_ind < 0 || *normal_ind >= (long)normals->size)
+				return false;
+		}
+	}
+
+	return true;
+}
+
+/* objs without normals get smooth area-weighted ones */
+static inline void gen_normals(mesh_data *md)
+{
+	mesh_vertex				*a, *b, *c;
+	float					e0[3], e1[3], n[3], len;
+
+	for (uint32_t i = 0; i < md->verts.size; i++)
+		memset(md->verts.elems[i].normal, '\0', sizeof(md->verts.elems[i].normal));
+
+	for (uint32_t i = 0; i + 2 < md->inds.size; i += 3) {
+		a = &md->verts.elems[md->inds.elems[i]];
+		b = &md->verts.elems[md->inds.elems[i + 1]];
+		c = &md->verts.elems[md->inds.elems[i + 2]];
+
+		for (uint32_t j = 0; j < 3; j++) {
+			e0[j] = b->pos[j] - a->pos[j];
+			e1[j] = c->pos[j] - a->pos[j];
+		}
+
+		n[0] = e0[1] * e1[2] - e0[2] * e1[1];
+		n[1] = e0[2] * e1[0] - e0[0] * e1[2];
+		n[2] = e0[0] * e1[1] - e0[1] * e1[0];
+
+		for (uint32_t j = 0; j < 3; j++) {
+			a->normal[j] += n[j];
+			b->normal[j] += n[j];
+			c->normal[j] += n[j];
+		}
+	}
+
+	for (uint32_t i = 0; i < md->verts.size; i++) {
+		a = &md->verts.elems[i];
+		len = sqrtf(a->normal[0] * a->normal[0] + a->normal[1] * a->normal[1] + a->normal[2] * a->normal[2]);
+
+		if (len > 0.0f) {
+			for (uint32_t j = 0; j < 3; j++)
+				a->normal[j] /= len;
+		}
+	}
+}
+
+static inline void parse_obj_face(mesh_data *md, char *rest, const mesh_vec3_list *positions,
+	const mesh_vec3_list *normals, const mesh_vec3_list *colors, corner_map *cm)
+{
+	uint32_t				poly[MESH_OBJ_MAX_POLY];
+	uint32_t				poly_cnt, *slot;
+	long					pos_ind, normal_ind;
+	mesh_vertex				vert;
+	char					*tok, *save;
+	bool					found;
+
+	poly_cnt = 0;
+
+	tok = strtok_r(rest, " \t\r", &save);
+
+	while (tok != NULL && poly_cnt < MESH_OBJ_MAX_POLY) {
+		if (!parse_obj_corner(tok, positions, normals, &pos_ind, &normal_ind)) {
+			dbg_warn("skipping obj face with a bad index");
+			return;
+		}
+
+		if (cm->cnt * 2 >= cm->cap)
+			corner_map_grow(cm);
+
+		slot = corner_map_slot(cm, ((uint64_t)pos_ind << 32) | (uint32_t)(normal_ind + 1), &found);
+
+		if (!found) {
+			memcpy(vert.pos, positions->elems[pos_ind].v, sizeof(vert.pos));
+			memcpy(vert.color, colors->elems[pos_ind].v, sizeof(colors->elems[pos_ind].v));
+			vert.color[3] = 1.0f;
+
+			if (normal_ind >= 0)
+				memcpy(vert.normal, normals->elems[normal_ind].v, sizeof(vert.normal));
+			else
+				memset(vert.normal, '\0', sizeof(vert.normal));
+
+			*slot = md->verts.size;
+			cm->cnt++;
+
+			mesh_vertex_list_push(&md->verts, vert);
+		}
+
+		poly[poly_cnt++] = *slot;
+
+		tok = strtok_r(NULL, " \t\r", &save);
+	}
+
+	/* polygons are fanned around their first corner */
+	for (uint32_t i = 1; i + 1 < poly_cnt; i++) {
+		mesh_index_list_push(&md->inds, poly[0]);
+		mesh_index_list_push(&md->inds, poly[i]);
+		mesh_index_list_push(&md->inds, poly[i + 1]);
+	}
+}
+
+void mesh_data_load_obj(mesh_data *md, char *name)
+{
+	asset					a;
+	mesh_vec3_list				positions, normals, colors;
+	mesh_vec3				vec, color;
+	corner_map				cm;
+	char					line[MESH_OBJ_LINE_MAX];
+	size_t					pos, len;
+	const char				*nl;
+	int					n;
+
+	asset_load(&a, name);
+
+	mesh_vec3_list_init(&positions);
+	mesh_vec3_list_init(&normals);
+	mesh_vec3_list_init(&colors);
+
+	corner_map_init(&cm, 1024);
+
+	for (pos = 0; pos < a.len; pos += len + 1) {
+		nl = memchr(a.data + pos, '\n', a.len - pos);
+		len = nl != NULL ? (size_t)(nl - (const char *)a.data) - pos : a.len - pos;
+
+		if (len >= sizeof(line)) {
+			dbg_warn("skipping overlong obj line");
+			continue;
+		}
+
+		memcpy(line, a.data + pos, len);
+		line[len] = '\0';
+
+		if (strncmp(line, "v ", 2) == 0) {
+			color.v[0] = color.v[1] = color.v[2] = 1.0f;
+
+			n = sscanf(line + 2, "%f %f %f %f %f %f", &vec.v[0], &vec.v[1], &vec.v[2],
+				&color.v[0], &color.v[1], &color.v[2]);
+
+			if (n < 3)
+				dbg_warn("malformed obj position in %s", name);
+
+			mesh_vec3_list_push(&positions, vec);
+			mesh_vec3_list_push(&colors, color);
+		} else if (strncmp(line, "vn ", 3) == 0) {
+			if (sscanf(line + 3, "%f %f %f", &vec.v[0], &vec.v[1], &vec.v[2]) < 3)
+				dbg_warn("malformed obj normal in %s", name);
+
+			mesh_vec3_list_push(&normals, vec);
+		} else if (strncmp(line, "f ", 2) == 0) {
+			parse_obj_face(md, line + 2, &positions, &normals, &colors, &cm);
+		}
+	}
+
+	if (normals.size == 0)
+		gen_normals(md);
+
+	corner_map_clean(&cm);
+
+	mesh_vec3_list_clean(&positions);
+	mesh_vec3_list_clean(&normals);
+	mesh_vec3_list_clean(&colors);
+
+	asset_release(&a);
+
+	dbg_log("loaded mesh %s successfully", name);
+}
+
+void mesh_data_gen_grid(mesh_data *md, uint32_t cells)
+{
+	mesh_vertex				vert;
+	uint32_t				row, a, b, c, d;
+	float					u, v;
+
+	mesh_vertex_list_reserve(&md->verts, (cells + 1) * (cells + 1));
+	mesh_index_list_reserve(&md->inds, cells * cells * 6);
+
+	for (uint32_t y = 0; y <= cells; y++) {
+		for (uint32_t x = 0; x <= cells; x++) {
+			u = (float)x / cells;
+			v = (float)y / cells;
+
+			vert.pos[0] = u * 1.8f - 0.9f;
+			vert.pos[1] = v * 1.8f - 0.9f;
+			vert.pos[2] = 0.5f;
+			vert.normal[0] = 0.0f;
+			vert.normal[1] = 0.0f;
+			vert.normal[2] = -1.0f;
+			vert.color[0] = u;
+			vert.color[1] = v;
+			vert.color[2] = 1.0f - u;
+			vert.color[3] = 1.0f;
+
+			mesh_vertex_list_push(&md->verts, vert);
+		}
+	}
+
+	row = cells + 1;
+
+	/* clockwise in framebuffer space to match the pipeline's front face */
+	for (uint32_t y = 0; y < cells; y++) {
+		for (uint32_t x = 0; x < cells; x++) {
+			a = y * row + x;
+			b = a + 1;
+			c = a + row + 1;
+			d = a + row;
+
+			mesh_index_list_push(&md->inds, a);
+			mesh_index_list_push(&md->inds, b);
+			mesh_index_list_push(&md->inds, c);
+			mesh_index_list_push(&md->inds, a);
+			mesh_index_list_push(&md->inds, c);
+			mesh_index_list_push(&md->inds, d);
+		}
+	}
+}
+
+/* reorders in place; vertices stay mesh_vertex so the result encodes into any layout */
+void mesh_data_optimize(mesh_data *md)
+{
+	mopt_cache_stats			before, after;
+
+	if (md->inds.size == 0)
+		return;
+
+	mopt_get_cache_stats(md->inds.elems, md->inds.size, md->verts.size, MOPT_CACHE_SIZE, &before);
+
+	md->verts.size = mopt_dedup(md->verts.elems, sizeof(mesh_vertex), md->verts.size, md->inds.elems, md->inds.size);
+
+	mopt_tipsify(md->inds.elems, md->inds.size, md->verts.size, MOPT_CACHE_SIZE);
+	mopt_overdraw(md->inds.elems, md->inds.size, md->verts.elems[0].pos, sizeof(mesh_vertex), MOPT_CACHE_SIZE);
+
+	md->verts.size = mopt_fetch(md->verts.elems, sizeof(mesh_vertex), md->verts.size, md->inds.elems, md->inds.size);
+
+	mopt_get_cache_stats(md->inds.elems, md->inds.size, md->verts.size, MOPT_CACHE_SIZE, &after);
+
+	dbg_log("optimized mesh successfully, acmr %.3f -> %.3f", before.acmr, after.acmr);
+}
+
+static inline void create_mesh_buffer(gpu_allocator *ga, uploader *up, VkDeviceSize size, VkBufferUsageFlags usage,
+	VkBuffer *buf, ga_allocation *alloc)
+{
+	VkBufferCreateInfo			buf_info;
+	uint32_t				fams[2];
+
+	memset(&buf_info, '\0', sizeof(buf_info));
+
+	buf_info.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
+	buf_info.size = size;
+	buf_info.usage = usage | VK_BUFFER_USAGE_TRANSFER_DST_BIT;
+	buf_info.queueFamilyIndexCount = upload_queue_fams(up, fams);
+	buf_info.pQueueFamilyIndices = fams;
+	buf_info.sharingMode = buf_info.queueFamilyIndexCount > 1 ? VK_SHARING_MODE_CONCURRENT : VK_SHARING_MODE_EXCLUSIVE;
+
+	ga_create_buffer(ga, &buf_info, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, 0, buf, alloc);
+}
+
+/* aabb as center and half extents, and a sphere around its center, loose but cheap and stable for culling */
+static inline void compute_bounds(float *bounds, float *aabb, const mesh_data *md)
+{
+	float					lo[3], hi[3], d, dist, max_dist;
+	const float				*pos;
+
+	for (uint32_t i = 0; i < 3; i++) {
+		lo[i] = md->verts.elems[0].pos[i];
+		hi[i] = md->verts.elems[0].pos[i];
+	}
+
+	for (uint32_t i = 1; i < md->verts.size; i++) {
+		pos = md->verts.elems[i].pos;
+
+		for (uint32_t j = 0; j < 3; j++) {
+			lo[j] = fminf(lo[j], pos[j]);
+			hi[j] = fmaxf(hi[j], pos[j]);
+		}
+	}
+
+	for (uint32_t i = 0; i < 3; i++) {
+		bounds[i] = (lo[i] + hi[i]) * 0.5f;
+		aabb[i] = bounds[i];
+		aabb[3 + i] = (hi[i] - lo[i]) * 0.5f;
+	}
+
+	max_dist = 0.0f;
+
+	for (uint32_t i = 0; i < md->verts.size; i++) {
+		pos = md->verts.elems[i].pos;
+		dist = 0.0f;
+
+		for (uint32_t j = 0; j < 3; j++) {
+			d = pos[j] - bounds[j];
+			dist += d * d;
+		}
+
+		max_dist = fmaxf(max_dist, dist);
+	}
+
+	bounds[3] = sqrtf(max_dist);
+}
+
+/* one mem_alloc block for the caller to mem_free; strides are multiples of 4, so the indices stay aligned */
+uint8_t *mesh_bake(const mesh_data *md, uint32_t quant, uint64_t *len)
+{
+	mesh_blob_header			hdr;
+	mesh_layout				layout;
+	uint8_t					*blob;
+	uint16_t				*inds16;
+	uint64_t				vsize, isize;
+
+	if (md->verts.size == 0 || md->inds.size == 0)
+		dbg_error("cannot bake an empty mesh");
+
+	mesh_layout_init(&layout, quant);
+
+	memset(&hdr, '\0', sizeof(hdr));
+
+	hdr.magic = MESH_BLOB_MAGIC;
+	hdr.version = MESH_BLOB_VERSION;
+	hdr.quant = quant;
+	hdr.vert_cnt = md->verts.size;
+	hdr.idx_cnt = md->inds.size;
+	hdr.idx_size = hdr.vert_cnt <= MESH_MAX_INDEX16 ? sizeof(uint16_t) : sizeof(uint32_t);
+
+	compute_bounds(hdr.bounds, hdr.aabb, md);
+
+	vsize = (uint64_t)hdr.vert_cnt * layout.stride;
+	isize = (uint64_t)hdr.idx_cnt * hdr.idx_size;
+	*len = sizeof(hdr) + vsize + isize;
+
+	blob = mem_alloc(*len);
+
+	if (blob == NULL)
+		dbg_error("failed to allocate mesh blob");
+
+	memcpy(blob, &hdr, sizeof(hdr));
+	mesh_encode(&layout, md->verts.elems, hdr.vert_cnt, blob + sizeof(hdr));
+
+	if (hdr.idx_size == sizeof(uint16_t)) {
+		inds16 = (uint16_t *)(blob + sizeof(hdr) + vsize);
+
+		for (uint32_t i = 0; i < hdr.idx_cnt; i++)
+			inds16[i] = (uint16_t)md->inds.elems[i];
+	} else {
+		memcpy(blob + sizeof(hdr) + vsize, md->inds.elems, isize);
+	}
+
+	return blob;
+}
+
+/* sizes the mesh from a blob header and creates its buffers empty, false for a header this build cannot read */
+bool mesh_create_empty(mesh *m, gpu_allocator *ga, uploader *up, const mesh_blob_header *hdr)
+{
+	VkDeviceSize				vsize, isize;
+
+	if (hdr->magic != MESH_BLOB_MAGIC || hdr->version != MESH_BLOB_VERSION || (hdr->quant & ~MESH_QUANT_ALL) != 0 ||
+		hdr->vert_cnt == 0 || hdr->idx_cnt == 0 ||
+		hdr->idx_size != (hdr->vert_cnt <= MESH_MAX_INDEX16 ? sizeof(uint16_t) : sizeof(uint32_t)))
+		return false;
+
+	memset(m, '\0', sizeof(*m));
+
+	mesh_layout_init(&m->layout, hdr->quant);
+
+	m->vert_cnt = hdr->vert_cnt;
+	m->idx_cnt = hdr->idx_cnt;
+	m->idx_type = hdr->idx_size == sizeof(uint16_t) ? VK_INDEX_TYPE_UINT16 : VK_INDEX_TYPE_UINT32;
+
+	memcpy(m->bounds, hdr->bounds, sizeof(m->bounds));
+	memcpy(m->aabb, hdr->aabb, sizeof(m->aabb));
+
+	vsize = (VkDeviceSize)m->vert_cnt * m->layout.stride;
+	isize = (VkDeviceSize)m->idx_cnt * hdr->idx_size;
+
+	create_mesh_buffer(ga, up, vsize, VK_BUFFER_USAGE_VERTEX_BUFFER_BIT, &m->vbuf, &m->valloc);
+	create_mesh_buffer(ga, up, isize, VK_BUFFER_USAGE_INDEX_BUFFER_BIT, &m->ibuf, &m->ialloc);
+
+	dbg_log("created mesh with %u vertices (%u bytes each) and %u %u-bit indices successfully", m->vert_cnt,
+		m->layout.stride, m->idx_cnt, m->idx_type == VK_INDEX_TYPE_UINT16 ? 16 : 32);
+
+	return true;
+}
+
+/* the blob's length past its header */
+uint64_t mesh_payload_size(const mesh *m)
+{
+	return (uint64_t)m->vert_cnt * m->layout.stride +
+		(uint64_t)m->idx_cnt * (m->idx_type == VK_INDEX_TYPE_UINT16 ? sizeof(uint16_t) : sizeof(uint32_t));
+}
+
+/*
+ * stages a span of the blob past its header into the vertex and index buffers without waiting,
+ * returning how many leading bytes went in; bytes past the payload are taken and dropped
+ */
+uint64_t mesh_upload_span(mesh *m, uploader *up, const uint8_t *data, uint64_t offset, uint64_t len)
+{
+	uint64_t				vsize, end, done, n;
+
+	vsize = (uint64_t)m->vert_cnt * m->layout.stride;
+	end = mesh_payload_size(m);
+	done = 0;
+
+	if (offset < vsize) {
+		n = len < vsize - offset ? len : vsize - offset;
+		done = upload_try_buffer(up, m->vbuf, offset, data, n);
+
+		if (done < n)
+			return done;
+	}
+
+	if (done < len && offset + done < end) {
+		n = len - done < end - (offset + done) ? len - done : end - (offset + done);
+		n = upload_try_buffer(up, m->ibuf, offset + done - vsize, data + done, n);
+		done += n;
+
+		if (offset + done < end)
+			return done;
+	}
+
+	return len;
+}
+
+void mesh_create(mesh *m, gpu_allocator *ga, uploader *up, const mesh_data *md, uint32_t quant)
+{
+	uint8_t					*blob, *payload;
+	uint64_t				len;
+	VkDeviceSize				vsize;
+
+	blob = mesh_bake(md, quant, &len);
+
+	if (!mesh_create_empty(m, ga, up, (const mesh_blob_header *)blob))
+		dbg_error("failed to read back a baked mesh");
+
+	payload = blob + sizeof(mesh_blob_header);
+	vsize = (VkDeviceSize)m->vert_cnt * m->layout.stride;
+
+	upload_buffer(up, m->vbuf, 0, payload, vsize);
+	upload_buffer(up, m->ibuf, 0, payload + vsize, len - sizeof(mesh_blob_header) - vsize);
+
+	mem_free(blob);
+}
+
+void mesh_destroy(mesh *m, gpu_allocator *ga)
+{
+	vkDestroyBuffer(ga->dev, m->vbuf, NULL);
+	vkDestroyBuffer(ga->dev, m->ibuf, NULL);
+
+	ga_free(ga, &m->valloc);
+	ga_free(ga, &m->ialloc);
+}
+
+void mesh_draw(const mesh *m, VkCommandBuffer cmd_buf, uint32_t instance_cnt)
+{
+	VkDeviceSize				offset;
+
+	offset = 0;
+
+	vkCmdBindVertexBuffers(cmd_buf, 0, 1, &m->vbuf, &offset);
+	vkCmdBindIndexBuffer(cmd_buf, m->ibuf, 0, m->idx_type);
+
+	vkCmdDrawIndexed(cmd_buf, m->idx_cnt, instance_cnt, 0, 0, 0);
+}
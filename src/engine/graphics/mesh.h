@@ -0,0 +1,108 @@
+#ifndef MESH_H_INCLUDED
+#define MESH_H_INCLUDED
+
+#include "../../util/debug.h"
+#include "../../util/util.h"
+#include "../../util/dynarr.h"
+#include "../assets.h"
+#include "../mesh_opt.h"
+#include "gpu_alloc.h"
+#include "upload.h"
+
+#include <vulkan/vulkan.h>
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <stdbool.h>
+
+#define MESH_QUANT_POS				(1u << 0)
+#define MESH_QUANT_NORMAL			(1u << 1)
+#define MESH_QUANT_COLOR			(1u << 2)
+#define MESH_QUANT_ALL				(MESH_QUANT_POS | MESH_QUANT_NORMAL | MESH_QUANT_COLOR)
+#define MESH_ATTRIB_CNT				3
+#define MESH_MAX_INDEX16			UINT16_MAX
+#define MESH_BLOB_MAGIC				0x4853454du
+#define MESH_BLOB_VERSION			1
+
+/* the uncompressed form every loader and generator produces, encoded on upload */
+typedef struct {
+	float pos[3];
+	float normal[3];
+	float color[4];
+} mesh_vertex;
+
+DYNARR_DEFINE(mesh_vertex_list, mesh_vertex)
+
+DYNARR_DEFINE(mesh_index_list, uint32_t)
+
+typedef struct {
+	mesh_vertex_list verts;
+	mesh_index_list inds;
+} mesh_data;
+
+/*
+ * one interleaved binding: position, octahedral normal, color; quantized it is
+ * half4 + snorm16x2 + unorm8x4 = 16 bytes, otherwise float3 + float2 + float4 = 36
+ */
+typedef struct {
+	uint32_t quant;
+	uint32_t stride;
+	VkVertexInputBindingDescription binding;
+	VkVertexInputAttributeDescription attribs[MESH_ATTRIB_CNT];
+} mesh_layout;
+
+/* a baked mesh is this header, the encoded vertices, then the indices at their final width */
+typedef struct {
+	uint32_t magic;
+	uint32_t version;
+	uint32_t quant;
+	uint32_t vert_cnt;
+	uint32_t idx_cnt;
+	uint32_t idx_size;
+	float bounds[4];
+	float aabb[6];
+} mesh_blob_header;
+
+typedef struct {
+	VkBuffer vbuf;
+	ga_allocation valloc;
+	VkBuffer ibuf;
+	ga_allocation ialloc;
+	uint32_t vert_cnt;
+	uint32_t idx_cnt;
+	VkIndexType idx_type;
+	mesh_layout layout;
+	float bounds[4];
+	float aabb[6];
+} mesh;
+
+void mesh_layout_init(mesh_layout *layout, uint32_t quant);
+
+void mesh_encode(const mesh_layout *layout, const mesh_vertex *verts, uint32_t vert_cnt, uint8_t *dest);
+
+void mesh_data_init(mesh_data *md);
+
+void mesh_data_clean(mesh_data *md);
+
+void mesh_data_load_obj(mesh_data *md, char *name);
+
+void mesh_data_gen_grid(mesh_data *md, uint32_t cells);
+
+void mesh_data_optimize(mesh_data *md);
+
+uint8_t *mesh_bake(const mesh_data *md, uint32_t quant, uint64_t *len);
+
+bool mesh_create_empty(mesh *m, gpu_allocator *ga, uploader *up, const mesh_blob_header *hdr);
+
+uint64_t mesh_payload_size(const mesh *m);
+
+uint64_t mesh_upload_span(mesh *m, uploader *up, const uint8_t *data, uint64_t offset, uint64_t len);
+
+void mesh_create(mesh *m, gpu_allocator *ga, uploader *up, const mesh_data *md, uint32_t quant);
+
+void mesh_destroy(mesh *m, gpu_allocator *ga);
+
+void mesh_draw(const mesh *m, VkCommandBuffer cmd_buf, uint32_t instance_cnt);
+
+#endif
@@ -0,0 +1,261 @@
+#include "pipeline.h"
+#include "../../util/arena.h"
+#include "../../util/dynarr.h"
+
+static void psvc_build_task(void *arg, uint32_t worker)
+{
+	pipeline_future				*fut;
+	uint64_t				start_ns;
+
+	fut = arg;
+	start_ns = time_now_ns();
+
+	fut->result = pipeline_build(fut->svc->dev, fut->svc->thread_caches[worker], &fut->desc, &fut->pipeline);
+	fut->build_ns = time_now_ns() - start_ns;
+
+	tpool_signal(&fut->svc->pool, &fut->done);
+}
+
+VkResult pipeline_build(VkDevice dev, VkPipelineCache cache, const pipeline_desc *desc, VkPipeline *pipeline)
+{
+	VkPipelineShaderStageCreateInfo		vert_stage_info, frag_stage_info, shader_stage_infos[2];
+	VkPipelineVertexInputStateCreateInfo	vert_input_info;
+	VkPipelineInputAssemblyStateCreateInfo	ia_info;
+	VkPipelineViewportStateCreateInfo	viewport_info;
+	VkPipelineRasterizationStateCreateInfo	rast_info;
+	VkPipelineMultisampleStateCreateInfo	ms_info;
+	VkPipelineColorBlendAttachmentState	cba_info;
+	VkPipelineColorBlendStateCreateInfo	blend_info;
+	VkPipelineDynamicStateCreateInfo	ds_info;
+	VkDynamicState				dynam_states[3];
+	VkGraphicsPipelineCreateInfo		pipeline_info;
+
+	memset(&vert_stage_info, '\0', sizeof(vert_stage_info));
+
+	vert_stage_info.sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
+	vert_stage_info.stage = VK_SHADER_STAGE_VERTEX_BIT;
+	vert_stage_info.module = desc->vert;
+	vert_stage_info.pName = "main";
+
+	memset(&frag_stage_info, '\0', sizeof(frag_stage_info));
+
+	frag_stage_info.sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
+	frag_stage_info.stage = VK_SHADER_STAGE_FRAGMENT_BIT;
+	frag_stage_info.module = desc->frag;
+	frag_stage_info.pName = "main";
+
+	shader_stage_infos[0] = vert_stage_info;
+	shader_stage_infos[1] = frag_stage_info;
+
+	memset(&vert_input_info, '\0', sizeof(vert_input_info));
+
+	vert_input_info.sType = VK_STRUCTURE_TYPE_PIPELINE_VERTEX_INPUT_STATE_CREATE_INFO;
+	vert_input_info.vertexBindingDescriptionCount = desc->binding_cnt;
+	vert_input_info.pVertexBindingDescriptions = desc->bindings;
+	vert_input_info.vertexAttributeDescriptionCount = desc->attrib_cnt;
+	vert_input_info.pVertexAttributeDescriptions = desc->attribs;
+
+	memset(&ia_info, '\0', sizeof(ia_info));
+
+	ia_info.sType = VK_STRUCTURE_TYPE_PIPELINE_INPUT_ASSEMBLY_STATE_CREATE_INFO;
+	ia_info.topology = desc->topology;
+	ia_info.primitiveRestartEnable = VK_FALSE;
+
+	memset(&viewport_info, '\0', sizeof(viewport_info));
+
+	/* both are set per command buffer, so a resize never has to rebuild the pipeline */
+	viewport_info.sType = VK_STRUCTURE_TYPE_PIPELINE_VIEWPORT_STATE_CREATE_INFO;
+	viewport_info.viewportCount = 1;
+	viewport_info.pViewports = NULL;
+	viewport_info.scissorCount = 1;
+	viewport_info.pScissors = NULL;
+
+	memset(&rast_info, '\0', sizeof(rast_info));
+
+	rast_info.sType = VK_STRUCTURE_TYPE_PIPELINE_RASTERIZATION_STATE_CREATE_INFO;
+	rast_info.depthClampEnable = VK_FALSE;
+	rast_info.rasterizerDiscardEnable = VK_FALSE;
+	rast_info.polygonMode = VK_POLYGON_MODE_FILL;
+	rast_info.lineWidth = 1.0f;
+	rast_info.cullMode = desc->cull_mode;
+	rast_info.frontFace = desc->front_face;
+	rast_info.depthBiasEnable = VK_FALSE;
+	rast_info.depthBiasConstantFactor = 0.0f;
+	rast_info.depthBiasClamp = 0.0f;
+	rast_info.depthBiasSlopeFactor = 0.0f;
+
+	memset(&ms_info, '\0', sizeof(ms_info));
+
+	ms_info.sType = VK_STRUCTURE_TYPE_PIPELINE_MULTISAMPLE_STATE_CREATE_INFO;
+	ms_info.sampleShadingEnable = VK_FALSE;
+	ms_info.rasterizationSamples = VK_SAMPLE_COUNT_1_BIT;
+	ms_info.minSampleShading = 1.0f;
+	ms_info.pSampleMask = NULL;
+	ms_info.alphaToCoverageEnable = VK_FALSE;
+	ms_info.alphaToOneEnable = VK_FALSE;
+
+	memset(&cba_info, '\0', sizeof(cba_info));
+
+	cba_info.colorWriteMask =
+		VK_COLOR_COMPONENT_R_BIT |
+		VK_COLOR_COMPONENT_G_BIT |
+		VK_COLOR_COMPONENT_B_BIT |
+		VK_COLOR_COMPONENT_A_BIT;
+
+	cba_info.blendEnable = VK_FALSE;
+	cba_info.srcColorBlendFactor = VK_BLEND_FACTOR_ONE;
+	cba_info.dstColorBlendFactor = VK_BLEND_FACTOR_ZERO;
+	cba_info.colorBlendOp = VK_BLEND_OP_ADD;
+	cba_info.srcAlphaBlendFactor = VK_BLEND_FACTOR_ONE;
+	cba_info.dstAlphaBlendFactor = VK_BLEND_FACTOR_ZERO;
+	cba_info.alphaBlendOp = VK_BLEND_OP_ADD;
+
+	memset(&blend_info, '\0', sizeof(blend_info));
+
+	blend_info.sType = VK_STRUCTURE_TYPE_PIPELINE_COLOR_BLEND_STATE_CREATE_INFO;
+	blend_info.logicOpEnable = VK_FALSE;
+	blend_info.logicOp = VK_LOGIC_OP_COPY;
+	blend_info.attachmentCount = 1;
+	blend_info.pAttachments = &cba_info;
+	blend_info.blendConstants[0] = 0.0f;
+	blend_info.blendConstants[1] = 0.0f;
+	blend_info.blendConstants[2] = 0.0f;
+	blend_info.blendConstants[3] = 0.0f;
+
+	dynam_states[0] = VK_DYNAMIC_STATE_VIEWPORT;
+	dynam_states[1] = VK_DYNAMIC_STATE_SCISSOR;
+	dynam_states[2] = VK_DYNAMIC_STATE_LINE_WIDTH;
+
+	memset(&ds_info, '\0', sizeof(ds_info));
+
+	ds_info.sType = VK_STRUCTURE_TYPE_PIPELINE_DYNAMIC_STATE_CREATE_INFO;
+	ds_info.dynamicStateCount = ARRAY_SIZE(dynam_states);
+	ds_info.pDynamicStates = dynam_states;
+
+	memset(&pipeline_info, '\0', sizeof(pipeline_info));
+
+	pipeline_info.sType = VK_STRUCTURE_TYPE_GRAPHICS_PIPELINE_CREATE_INFO;
+	pipeline_info.stageCount = ARRAY_SIZE(shader_stage_infos);
+	pipeline_info.pStages = shader_stage_infos;
+	pipeline_info.pVertexInputState = &vert_input_info;
+	pipeline_info.pInputAssemblyState = &ia_info;
+	pipeline_info.pViewportState = &viewport_info;
+	pipeline_info.pRasterizationState = &rast_info;
+	pipeline_info.pMultisampleState = &ms_info;
+	pipeline_info.pDepthStencilState = NULL;
+	pipeline_info.pColorBlendState = &blend_info;
+	pipeline_info.pDynamicState = &ds_info;
+	pipeline_info.layout = desc->layout;
+	pipeline_info.renderPass = desc->render_pass;
+	pipeline_info.subpass = 0;
+	pipeline_info.basePipelineHandle = VK_NULL_HANDLE;
+	pipeline_info.basePipelineIndex = -1;
+
+	return vkCreateGraphicsPipelines(dev, cache, 1, &pipeline_info, NULL, pipeline);
+}
+
+VkResult pipeline_build_compute(VkDevice dev, VkPipelineCache cache, VkShaderModule comp, VkPipelineLayout layout,
+	VkPipeline *pipeline)
+{
+	VkComputePipelineCreateInfo		pipeline_info;
+
+	memset(&pipeline_info, '\0', sizeof(pipeline_info));
+
+	pipeline_info.sType = VK_STRUCTURE_TYPE_COMPUTE_PIPELINE_CREATE_INFO;
+	pipeline_info.stage.sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
+	pipeline_info.stage.stage = VK_SHADER_STAGE_COMPUTE_BIT;
+	pipeline_info.stage.module = comp;
+	pipeline_info.stage.pName = "main";
+	pipeline_info.layout = layout;
+	pipeline_info.basePipelineHandle = VK_NULL_HANDLE;
+	pipeline_info.basePipelineIndex = -1;
+
+	return vkCreateComputePipelines(dev, cache, 1, &pipeline_info, NULL, pipeline);
+}
+
+/* each worker compiles into its own cache seeded from dest_cache, so workers never contend on one cache lock */
+void psvc_init(pipeline_service *svc, VkDevice dev, VkPipelineCache dest_cache, uint32_t thread_cnt)
+{
+	VkPipelineCacheCreateInfo		cache_info;
+	size_t					seed_len;
+	void					*seed;
+
+	svc->dev = dev;
+	svc->dest_cache = dest_cache;
+
+	seed = NULL;
+	seed_len = 0;
+
+	if (vkGetPipelineCacheData(dev, dest_cache, &seed_len, NULL) == VK_SUCCESS && seed_len > 0) {
+		seed = mem_alloc(seed_len);
+
+		if (seed == NULL || vkGetPipelineCacheData(dev, dest_cache, &seed_len, seed) != VK_SUCCESS)
+			seed_len = 0;
+	}
+
+	tpool_init(&svc->pool, thread_cnt);
+
+	memset(&cache_info, '\0', sizeof(cache_info));
+
+	cache_info.sType = VK_STRUCTURE_TYPE_PIPELINE_CACHE_CREATE_INFO;
+	cache_info.initialDataSize = seed_len;
+	cache_info.pInitialData = seed_len > 0 ? seed : NULL;
+
+	for (uint32_t i = 0; i < svc->pool.thread_cnt; i++) {
+		if (vkCreatePipelineCache(dev, &cache_info, NULL, &svc->thread_caches[i]) != VK_SUCCESS)
+			dbg_error("failed to create worker pipeline cache");
+	}
+
+	mem_free(seed);
+
+	dbg_log("started pipeline service with %u threads", svc->pool.thread_cnt);
+}
+
+void psvc_clean(pipeline_service *svc)
+{
+	uint32_t				thread_cnt;
+
+	thread_cnt = svc->pool.thread_cnt;
+
+	tpool_clean(&svc->pool);
+
+	for (uint32_t i = 0; i < thread_cnt; i++)
+		vkDestroyPipelineCache(svc->dev, svc->thread_caches[i], NULL);
+}
+
+void psvc_submit(pipeline_service *svc, const pipeline_desc *descs, uint32_t cnt, pipeline_future *futs)
+{
+	for (uint32_t i = 0; i < cnt; i++) {
+		futs[i].svc = svc;
+		futs[i].desc = descs[i];
+		futs[i].pipeline = VK_NULL_HANDLE;
+		futs[i].result = VK_NOT_READY;
+		futs[i].build_ns = 0;
+		futs[i].done = 0;
+
+		tpool_submit(&svc->pool, psvc_build_task, &futs[i]);
+	}
+}
+
+void psvc_finish(pipeline_service *svc)
+{
+	tpool_wait_idle(&svc->pool);
+
+	if (vkMergePipelineCaches(svc->dev, svc->dest_cache, svc->pool.thread_cnt, svc->thread_caches) != VK_SUCCESS)
+		dbg_warn("failed to merge worker pipeline caches");
+}
+
+bool pfut_ready(pipeline_future *fut)
+{
+	return __atomic_load_n(&fut->done, __ATOMIC_ACQUIRE) != 0;
+}
+
+VkPipeline pfut_wait(pipeline_future *fut)
+{
+	tpool_wait_flag(&fut->svc->pool, &fut->done);
+
+	if (fut->result != VK_SUCCESS)
+		dbg_error("failed to create pipeline");
+
+	return fut->pipeline;
+}
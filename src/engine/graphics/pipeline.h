@@ -0,0 +1,66 @@
+#ifndef PIPELINE_H_INCLUDED
+#define PIPELINE_H_INCLUDED
+
+#include "../../util/debug.h"
+#include "../../util/util.h"
+#include "../../util/tpool.h"
+
+#include <vulkan/vulkan.h>
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+
+/* everything a desc points to must stay alive until its future completes */
+typedef struct {
+	VkShaderModule vert;
+	VkShaderModule frag;
+	VkPipelineLayout layout;
+	VkRenderPass render_pass;
+	const VkVertexInputBindingDescription *bindings;
+	uint32_t binding_cnt;
+	const VkVertexInputAttributeDescription *attribs;
+	uint32_t attrib_cnt;
+	VkPrimitiveTopology topology;
+	VkCullModeFlags cull_mode;
+	VkFrontFace front_face;
+} pipeline_desc;
+
+typedef struct pipeline_service pipeline_service;
+
+typedef struct {
+	pipeline_service *svc;
+	pipeline_desc desc;
+	VkPipeline pipeline;
+	VkResult result;
+	uint64_t build_ns;
+	uint32_t done;
+} pipeline_future;
+
+struct pipeline_service {
+	VkDevice dev;
+	VkPipelineCache dest_cache;
+	VkPipelineCache thread_caches[TPOOL_MAX_THREADS];
+	tpool pool;
+};
+
+VkResult pipeline_build(VkDevice dev, VkPipelineCache cache, const pipeline_desc *desc, VkPipeline *pipeline);
+
+VkResult pipeline_build_compute(VkDevice dev, VkPipelineCache cache, VkShaderModule comp, VkPipelineLayout layout,
+	VkPipeline *pipeline);
+
+void psvc_init(pipeline_service *svc, VkDevice dev, VkPipelineCache dest_cache, uint32_t thread_cnt);
+
+void psvc_clean(pipeline_service *svc);
+
+void psvc_submit(pipeline_service *svc, const pipeline_desc *descs, uint32_t cnt, pipeline_future *futs);
+
+void psvc_finish(pipeline_service *svc);
+
+bool pfut_ready(pipeline_future *fut);
+
+VkPipeline pfut_wait(pipeline_future *fut);
+
+#endif
@@ -0,0 +1,127 @@
+#include "pipeline_cache.h"
+#include "../../util/arena.h"
+
+#include <fcntl.h>
+#include <unistd.h>
+
+#define PCACHE_HEADER_SIZE			(4 * sizeof(uint32_t) + VK_UUID_SIZE)
+#define PCACHE_PATH_MAX				1024
+
+/* a cache from another driver or device is rejected by some drivers and silently misused by others */
+static inline bool pcache_header_valid(const uint8_t *data, size_t len, const VkPhysicalDeviceProperties *dev_props)
+{
+	uint32_t				header[4];
+
+	if (len < PCACHE_HEADER_SIZE)
+		return false;
+
+	memcpy(header, data, sizeof(header));
+
+	return header[0] >= PCACHE_HEADER_SIZE &&
+		header[1] == VK_PIPELINE_CACHE_HEADER_VERSION_ONE &&
+		header[2] == dev_props->vendorID &&
+		header[3] == dev_props->deviceID &&
+		memcmp(data + sizeof(header), dev_props->pipelineCacheUUID, VK_UUID_SIZE) == 0;
+}
+
+VkPipelineCache pcache_load(VkDevice dev, const VkPhysicalDeviceProperties *dev_props, char *filepath, bool *warm)
+{
+	file_view				fv;
+	bool					have_file;
+	VkPipelineCacheCreateInfo		cache_info;
+	VkPipelineCache				cache;
+
+	have_file = fv_try_open(&fv, filepath, FV_HINT_SEQUENTIAL);
+
+	memset(&cache_info, '\0', sizeof(cache_info));
+
+	cache_info.sType = VK_STRUCTURE_TYPE_PIPELINE_CACHE_CREATE_INFO;
+
+	*warm = false;
+
+	if (have_file) {
+		if (fv.len <= PCACHE_MAX_SIZE && pcache_header_valid(fv.data, fv.len, dev_props)) {
+			cache_info.initialDataSize = fv.len;
+			cache_info.pInitialData = fv.data;
+
+			*warm = true;
+		} else {
+			dbg_warn("discarding stale or oversized pipeline cache");
+		}
+	}
+
+	if (vkCreatePipelineCache(dev, &cache_info, NULL, &cache) != VK_SUCCESS) {
+		if (!*warm)
+			dbg_error("failed to create pipeline cache");
+
+		dbg_warn("driver rejected pipeline cache, starting cold");
+
+		cache_info.initialDataSize = 0;
+		cache_info.pInitialData = NULL;
+
+		*warm = false;
+
+		if (vkCreatePipelineCache(dev, &cache_info, NULL, &cache) != VK_SUCCESS)
+			dbg_error("failed to create pipeline cache");
+	}
+
+	if (have_file)
+		fv_close(&fv);
+
+	dbg_log("created %s pipeline cache successfully", *warm ? "warm" : "cold");
+
+	return cache;
+}
+
+/* written to a temp file and renamed so a crash mid-write never leaves a torn cache behind */
+void pcache_save(VkDevice dev, VkPipelineCache cache, char *filepath)
+{
+	size_t					len;
+	uint8_t					*data;
+	char					tmp_path[PCACHE_PATH_MAX];
+	int					fd;
+	bool					ok;
+
+	if (vkGetPipelineCacheData(dev, cache, &len, NULL) != VK_SUCCESS || len == 0)
+		return;
+
+	if (len > PCACHE_MAX_SIZE) {
+		dbg_warn("pipeline cache exceeds size cap, not saving");
+
+		return;
+	}
+
+	data = mem_alloc(len);
+
+	if (data == NULL)
+		dbg_error("failed to allocate pipeline cache buffer");
+
+	if (vkGetPipelineCacheData(dev, cache, &len, data) != VK_SUCCESS) {
+		mem_free(data);
+
+		return;
+	}
+
+	snprintf(tmp_path, sizeof(tmp_path), "%s.tmp", filepath);
+
+	fd = open(tmp_path, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+
+	if (fd < 0) {
+		dbg_warn("could not write pipeline cache");
+		mem_free(data);
+
+		return;
+	}
+
+	ok = write(fd, data, len) == (ssize_t)len && fsync(fd) == 0;
+	ok = close(fd) == 0 && ok;
+
+	if (!ok || rename(tmp_path, filepath) != 0) {
+		dbg_warn("could not write pipeline cache");
+		unlink(tmp_path);
+	} else {
+		dbg_log("saved pipeline cache successfully");
+	}
+
+	mem_free(data);
+}
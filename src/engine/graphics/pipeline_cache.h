@@ -0,0 +1,20 @@
+#ifndef PIPELINE_CACHE_H_INCLUDED
+#define PIPELINE_CACHE_H_INCLUDED
+
+#include "../../util/debug.h"
+#include "../../util/util.h"
+
+#include <vulkan/vulkan.h>
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <stdbool.h>
+
+#define PCACHE_MAX_SIZE				(64 * 1024 * 1024)
+
+VkPipelineCache pcache_load(VkDevice dev, const VkPhysicalDeviceProperties *dev_props, char *filepath, bool *warm);
+
+void pcache_save(VkDevice dev, VkPipelineCache cache, char *filepath);
+
+#endif
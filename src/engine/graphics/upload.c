@@ -0,0 +1,471 @@
+#include "upload.h"
+
+#define UPLOAD_BENCH_DST_SIZE			(64ull * 1024 * 1024)
+#define UPLOAD_BENCH_BYTES			(256ull * 1024 * 1024)
+
+static inline void upload_reclaim(uploader *up)
+{
+	upload_batch				*batch;
+
+	for (uint32_t i = 0; i < UPLOAD_MAX_BATCHES; i++) {
+		batch = &up->batches[i];
+
+		if (!batch->in_flight || vkGetFenceStatus(up->dev, batch->fence) != VK_SUCCESS)
+			continue;
+
+		batch->in_flight = false;
+
+		if (batch->tag > up->completed_tag)
+			up->completed_tag = batch->tag;
+	}
+
+	ga_ring_release(&up->ring, up->completed_tag);
+}
+
+/* a stall is only counted when the fence had not signalled yet and the cpu really blocks */
+static inline void upload_wait_batch(uploader *up, upload_batch *batch)
+{
+	if (!batch->in_flight)
+		return;
+
+	if (vkGetFenceStatus(up->dev, batch->fence) != VK_SUCCESS) {
+		vkWaitForFences(up->dev, 1, &batch->fence, VK_TRUE, UINT64_MAX);
+
+		up->stats.stall_cnt++;
+	}
+
+	upload_reclaim(up);
+}
+
+/* batches retire in submission order, so the lowest tag in flight frees the oldest ring space */
+static inline upload_batch *upload_oldest_batch(uploader *up)
+{
+	upload_batch				*oldest;
+
+	oldest = NULL;
+
+	for (uint32_t i = 0; i < UPLOAD_MAX_BATCHES; i++) {
+		if (up->batches[i].in_flight && (oldest == NULL || up->batches[i].tag < oldest->tag))
+			oldest = &up->batches[i];
+	}
+
+	return oldest;
+}
+
+/* copies data into the ring if the batches already retired left room for it, never waits */
+static inline bool upload_try_stage(uploader *up, const void *data, VkDeviceSize size, VkDeviceSize *offset)
+{
+	if (!ga_ring_alloc(&up->ring, size, UPLOAD_COPY_ALIGN, offset)) {
+		upload_reclaim(up);
+
+		if (!ga_ring_alloc(&up->ring, size, UPLOAD_COPY_ALIGN, offset))
+			return false;
+	}
+
+	memcpy(up->ring.alloc.map + *offset, data, size);
+
+	return true;
+}
+
+/* copies data into the ring, flushing and stalling on the oldest batch when it is full */
+static inline VkDeviceSize upload_stage(uploader *up, const void *data, VkDeviceSize size)
+{
+	upload_batch				*batch;
+	VkDeviceSize				offset;
+
+	if (size > up->ring.alloc.size)
+		dbg_error("upload of %lu bytes does not fit the staging ring", (unsigned long)size);
+
+	while (!upload_try_stage(up, data, size, &offset)) {
+		upload_flush(up, NULL);
+
+		batch = upload_oldest_batch(up);
+
+		if (batch == NULL)
+			dbg_error("staging ring is idle but cannot fit %lu bytes", (unsigned long)size);
+
+		upload_wait_batch(up, batch);
+	}
+
+	return offset;
+}
+
+static inline void push_buf_copy(uploader *up, VkBuffer dst, VkDeviceSize dst_offset, VkDeviceSize src_offset,
+	VkDeviceSize size)
+{
+	upload_buf_copy				copy, *prev;
+
+	copy.dst = dst;
+	copy.region.srcOffset = src_offset;
+	copy.region.dstOffset = dst_offset;
+	copy.region.size = size;
+
+	prev = up->buf_copies.size > 0 ? &up->buf_copies.elems[up->buf_copies.size - 1] : NULL;
+
+	/* adjacent uploads into the same buffer collapse into one region */
+	if (prev != NULL && prev->dst == dst && prev->region.srcOffset + prev->region.size == src_offset &&
+		prev->region.dstOffset + prev->region.size == dst_offset)
+		prev->region.size += size;
+	else
+		upload_buf_copy_list_push(&up->buf_copies, copy);
+
+	up->stats.upload_cnt++;
+	up->stats.upload_bytes += size;
+}
+
+void upload_init(uploader *up, gpu_allocator *ga, VkDevice dev, VkQueue queue, uint32_t queue_fam, uint32_t gfx_fam)
+{
+	VkBufferCreateInfo			buf_info;
+	VkMemoryRequirements			mem_reqs;
+	VkCommandPoolCreateInfo			pool_info;
+	VkCommandBufferAllocateInfo		cb_info;
+	VkFenceCreateInfo			fence_info;
+	VkSemaphoreCreateInfo			sem_info;
+	upload_batch				*batch;
+
+	memset(up, '\0', sizeof(*up));
+
+	up->dev = dev;
+	up->ga = ga;
+	up->queue = queue;
+	up->queue_fam = queue_fam;
+	up->gfx_fam = gfx_fam;
+
+	memset(&buf_info, '\0', sizeof(buf_info));
+
+	buf_info.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
+	buf_info.size = UPLOAD_RING_SIZE;
+	buf_info.usage = VK_BUFFER_USAGE_TRANSFER_SRC_BIT;
+	buf_info.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+
+	if (vkCreateBuffer(dev, &buf_info, NULL, &up->ring_buf) != VK_SUCCESS)
+		dbg_error("failed to create staging ring buffer");
+
+	vkGetBufferMemoryRequirements(dev, up->ring_buf, &mem_reqs);
+
+	ga_ring_init(ga, &up->ring, mem_reqs.size, ga_find_mem_type(ga, mem_reqs.memoryTypeBits,
+		VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, 0));
+
+	if (vkBindBufferMemory(dev, up->ring_buf, up->ring.alloc.mem, up->ring.alloc.offset) != VK_SUCCESS)
+		dbg_error("failed to bind staging ring memory");
+
+	memset(&pool_info, '\0', sizeof(pool_info));
+
+	pool_info.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
+	pool_info.flags = VK_COMMAND_POOL_CREATE_TRANSIENT_BIT;
+	pool_info.queueFamilyIndex = queue_fam;
+
+	memset(&cb_info, '\0', sizeof(cb_info));
+
+	cb_info.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+	cb_info.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+	cb_info.commandBufferCount = 1;
+
+	memset(&fence_info, '\0', sizeof(fence_info));
+
+	fence_info.sType = VK_STRUCTURE_TYPE_FENCE_CREATE_INFO;
+
+	memset(&sem_info, '\0', sizeof(sem_info));
+
+	sem_info.sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO;
+
+	for (uint32_t i = 0; i < UPLOAD_MAX_BATCHES; i++) {
+		batch = &up->batches[i];
+
+		if (vkCreateCommandPool(dev, &pool_info, NULL, &batch->cmd_pool) != VK_SUCCESS)
+			dbg_error("failed to create upload command pool");
+
+		cb_info.commandPool = batch->cmd_pool;
+
+		if (vkAllocateCommandBuffers(dev, &cb_info, &batch->cmd_buf) != VK_SUCCESS)
+			dbg_error("failed to allocate upload command buffer");
+
+		if (vkCreateFence(dev, &fence_info, NULL, &batch->fence) != VK_SUCCESS)
+			dbg_error("failed to create upload fence");
+
+		if (vkCreateSemaphore(dev, &sem_info, NULL, &batch->done) != VK_SUCCESS)
+			dbg_error("failed to create upload semaphore");
+	}
+
+	upload_buf_copy_list_init(&up->buf_copies);
+	upload_img_copy_list_init(&up->img_copies);
+	upload_region_list_init(&up->regions);
+	upload_barrier_list_init(&up->barriers);
+
+	dbg_log("created %s uploader successfully", queue_fam == gfx_fam ? "graphics queue" : "transfer queue");
+}
+
+void upload_clean(uploader *up)
+{
+	upload_wait(up);
+
+	for (uint32_t i = 0; i < UPLOAD_MAX_BATCHES; i++) {
+		vkDestroySemaphore(up->dev, up->batches[i].done, NULL);
+		vkDestroyFence(up->dev, up->batches[i].fence, NULL);
+		vkDestroyCommandPool(up->dev, up->batches[i].cmd_pool, NULL);
+	}
+
+	upload_buf_copy_list_clean(&up->buf_copies);
+	upload_img_copy_list_clean(&up->img_copies);
+	upload_region_list_clean(&up->regions);
+	upload_barrier_list_clean(&up->barriers);
+
+	vkDestroyBuffer(up->dev, up->ring_buf, NULL);
+	ga_ring_clean(up->ga, &up->ring);
+}
+
+uint32_t upload_queue_fams(const uploader *up, uint32_t *fams)
+{
+	fams[0] = up->gfx_fam;
+	fams[1] = up->queue_fam;
+
+	return up->queue_fam == up->gfx_fam ? 1 : 2;
+}
+
+void upload_buffer(uploader *up, VkBuffer dst, VkDeviceSize dst_offset, const void *data, VkDeviceSize size)
+{
+	VkDeviceSize				chunk;
+
+	while (size > 0) {
+		chunk = size < UPLOAD_MAX_CHUNK ? size : UPLOAD_MAX_CHUNK;
+
+		push_buf_copy(up, dst, dst_offset, upload_stage(up, data, chunk), chunk);
+
+		data = (const uint8_t *)data + chunk;
+		dst_offset += chunk;
+		size -= chunk;
+	}
+}
+
+/*
+ * upload_buffer for the render thread: it stages what the retired batches have room for and
+ * returns how many leading bytes that was, instead of waiting on the gpu for the rest
+ */
+VkDeviceSize upload_try_buffer(uploader *up, VkBuffer dst, VkDeviceSize dst_offset, const void *data, VkDeviceSize size)
+{
+	VkDeviceSize				src_offset, chunk, done;
+
+	for (done = 0; done < size; done += chunk) {
+		chunk = size - done < UPLOAD_MAX_CHUNK ? size - done : UPLOAD_MAX_CHUNK;
+
+		if (!upload_try_stage(up, (const uint8_t *)data + done, chunk, &src_offset)) {
+			up->stats.defer_cnt++;
+			break;
+		}
+
+		push_buf_copy(up, dst, dst_offset + done, src_offset, chunk);
+	}
+
+	return done;
+}
+
+void upload_image(uploader *up, VkImage dst, VkExtent3D extent, uint32_t mip_level, const void *data, VkDeviceSize size,
+	VkImageLayout final_layout)
+{
+	upload_img_copy				copy;
+
+	memset(&copy, '\0', sizeof(copy));
+
+	copy.dst = dst;
+	copy.final_layout = final_layout;
+	copy.region.bufferOffset = upload_stage(up, data, size);
+	copy.region.imageSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+	copy.region.imageSubresource.mipLevel = mip_level;
+	copy.region.imageSubresource.layerCount = 1;
+	copy.region.imageExtent = extent;
+
+	upload_img_copy_list_push(&up->img_copies, copy);
+
+	up->stats.upload_cnt++;
+	up->stats.upload_bytes += size;
+}
+
+/* the scratch lists only ever grow, so a steady stream of flushes makes no heap calls */
+static inline void record_img_barriers(uploader *up, VkCommandBuffer cmd_buf, bool pre)
+{
+	VkImageMemoryBarrier			*barriers;
+	upload_img_copy				*copy;
+
+	upload_barrier_list_reserve(&up->barriers, up->img_copies.size);
+
+	barriers = up->barriers.elems;
+
+	memset(barriers, '\0', up->img_copies.size * sizeof(VkImageMemoryBarrier));
+
+	for (uint32_t i = 0; i < up->img_copies.size; i++) {
+		copy = &up->img_copies.elems[i];
+
+		barriers[i].sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+		barriers[i].srcAccessMask = pre ? 0 : VK_ACCESS_TRANSFER_WRITE_BIT;
+		barriers[i].dstAccessMask = pre ? VK_ACCESS_TRANSFER_WRITE_BIT : 0;
+		barriers[i].oldLayout = pre ? VK_IMAGE_LAYOUT_UNDEFINED : VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+		barriers[i].newLayout = pre ? VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL : copy->final_layout;
+		barriers[i].srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+		barriers[i].dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+		barriers[i].image = copy->dst;
+		barriers[i].subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+		barriers[i].subresourceRange.baseMipLevel = copy->region.imageSubresource.mipLevel;
+		barriers[i].subresourceRange.levelCount = 1;
+		barriers[i].subresourceRange.layerCount = 1;
+	}
+
+	vkCmdPipelineBarrier(cmd_buf, pre ? VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT : VK_PIPELINE_STAGE_TRANSFER_BIT,
+		pre ? VK_PIPELINE_STAGE_TRANSFER_BIT : VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, 0, 0, NULL, 0, NULL,
+		up->img_copies.size, barriers);
+}
+
+static inline void record_copies(uploader *up, VkCommandBuffer cmd_buf)
+{
+	VkBufferCopy				*regions;
+	uint32_t				run;
+
+	if (up->img_copies.size > 0)
+		record_img_barriers(up, cmd_buf, true);
+
+	upload_region_list_reserve(&up->regions, up->buf_copies.size);
+
+	regions = up->regions.elems;
+
+	/* one vkCmdCopyBuffer per run of copies into the same destination */
+	for (uint32_t i = 0; i < up->buf_copies.size; i += run) {
+		for (run = 0; i + run < up->buf_copies.size && up->buf_copies.elems[i + run].dst == up->buf_copies.elems[i].dst; run++)
+			regions[run] = up->buf_copies.elems[i + run].region;
+
+		vkCmdCopyBuffer(cmd_buf, up->ring_buf, up->buf_copies.elems[i].dst, run, regions);
+	}
+
+	for (uint32_t i = 0; i < up->img_copies.size; i++)
+		vkCmdCopyBufferToImage(cmd_buf, up->ring_buf, up->img_copies.elems[i].dst,
+			VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, 1, &up->img_copies.elems[i].region);
+
+	if (up->img_copies.size > 0)
+		record_img_barriers(up, cmd_buf, false);
+}
+
+/*
+ * submits everything staged since the last flush; when signal is given it receives a
+ * semaphore the consuming submit must wait on with UPLOAD_WAIT_STAGES, which is only
+ * reused once its batch slot comes around again
+ */
+bool upload_flush(uploader *up, VkSemaphore *signal)
+{
+	upload_batch				*batch;
+	VkCommandBufferBeginInfo		begin_info;
+	VkSubmitInfo				submit_info;
+
+	PROF_ZONE("upload_flush");
+
+	if (up->buf_copies.size == 0 && up->img_copies.size == 0)
+		return false;
+
+	batch = &up->batches[up->cur_batch];
+
+	upload_wait_batch(up, batch);
+
+	vkResetFences(up->dev, 1, &batch->fence);
+	vkResetCommandPool(up->dev, batch->cmd_pool, 0);
+
+	memset(&begin_info, '\0', sizeof(begin_info));
+
+	begin_info.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+	begin_info.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+
+	if (vkBeginCommandBuffer(batch->cmd_buf, &begin_info) != VK_SUCCESS)
+		dbg_error("failed to begin upload command buffer");
+
+	record_copies(up, batch->cmd_buf);
+
+	if (vkEndCommandBuffer(batch->cmd_buf) != VK_SUCCESS)
+		dbg_error("failed to record upload command buffer");
+
+	memset(&submit_info, '\0', sizeof(submit_info));
+
+	submit_info.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+	submit_info.commandBufferCount = 1;
+	submit_info.pCommandBuffers = &batch->cmd_buf;
+
+	if (signal != NULL) {
+		submit_info.signalSemaphoreCount = 1;
+		submit_info.pSignalSemaphores = &batch->done;
+		*signal = batch->done;
+	}
+
+	if (vkQueueSubmit(up->queue, 1, &submit_info, batch->fence) != VK_SUCCESS)
+		dbg_error("failed to submit uploads");
+
+	batch->tag = ++up->next_tag;
+	batch->in_flight = true;
+
+	ga_ring_mark(&up->ring, batch->tag);
+
+	upload_buf_copy_list_clear(&up->buf_copies);
+	upload_img_copy_list_clear(&up->img_copies);
+
+	up->cur_batch = (up->cur_batch + 1) % UPLOAD_MAX_BATCHES;
+	up->stats.batch_cnt++;
+
+	return true;
+}
+
+void upload_wait(uploader *up)
+{
+	for (uint32_t i = 0; i < UPLOAD_MAX_BATCHES; i++) {
+		if (up->batches[i].in_flight)
+			vkWaitForFences(up->dev, 1, &up->batches[i].fence, VK_TRUE, UINT64_MAX);
+	}
+
+	upload_reclaim(up);
+}
+
+void upload_bench(uploader *up)
+{
+	VkBufferCreateInfo			buf_info;
+	VkBuffer				dst;
+	ga_allocation				dst_alloc;
+	uint8_t					*payload;
+	uint64_t				start_ns, elapsed_ns, iters;
+	double					secs;
+
+	memset(&buf_info, '\0', sizeof(buf_info));
+
+	buf_info.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
+	buf_info.size = UPLOAD_BENCH_DST_SIZE;
+	buf_info.usage = VK_BUFFER_USAGE_TRANSFER_DST_BIT;
+	buf_info.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+
+	ga_create_buffer(up->ga, &buf_info, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, 0, &dst, &dst_alloc);
+
+	payload = malloc(UPLOAD_BENCH_DST_SIZE);
+
+	if (payload == NULL)
+		dbg_error("failed to allocate upload bench payload");
+
+	memset(payload, 0xab, UPLOAD_BENCH_DST_SIZE);
+
+	for (VkDeviceSize size = 4 * 1024; size <= UPLOAD_BENCH_DST_SIZE; size *= 4) {
+		iters = UPLOAD_BENCH_BYTES / size;
+		start_ns = time_now_ns();
+
+		for (uint64_t i = 0; i < iters; i++) {
+			upload_buffer(up, dst, i * size % UPLOAD_BENCH_DST_SIZE, payload, size);
+
+			/* flush roughly once per megabyte, as a frame's worth of small uploads would */
+			if ((i + 1) * size % (1024 * 1024) == 0 || size >= 1024 * 1024)
+				upload_flush(up, NULL);
+		}
+
+		upload_flush(up, NULL);
+		upload_wait(up);
+
+		elapsed_ns = time_now_ns() - start_ns;
+		secs = elapsed_ns / 1e9;
+
+		dbg_info("upload %8lu KB: %9.1f MB/s, %10.0f uploads/s", (unsigned long)(size / 1024),
+			iters * size / (1024.0 * 1024.0) / secs, iters / secs);
+	}
+
+	free(payload);
+
+	vkDestroyBuffer(up->dev, dst, NULL);
+	ga_free(up->ga, &dst_alloc);
+}
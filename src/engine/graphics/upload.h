@@ -0,0 +1,104 @@
+#ifndef UPLOAD_H_INCLUDED
+#define UPLOAD_H_INCLUDED
+
+#include "../../util/debug.h"
+#include "../../util/util.h"
+#include "../../util/dynarr.h"
+#include "../../util/prof.h"
+#include "gpu_alloc.h"
+
+#include <vulkan/vulkan.h>
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <stdbool.h>
+
+#define UPLOAD_RING_SIZE			(32ull * 1024 * 1024)
+#define UPLOAD_MAX_CHUNK			(UPLOAD_RING_SIZE / 4)
+#define UPLOAD_MAX_BATCHES			4
+#define UPLOAD_COPY_ALIGN			16
+#define UPLOAD_WAIT_STAGES			(VK_PIPELINE_STAGE_DRAW_INDIRECT_BIT | VK_PIPELINE_STAGE_VERTEX_INPUT_BIT | \
+						VK_PIPELINE_STAGE_VERTEX_SHADER_BIT | VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT | \
+						VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT)
+
+typedef struct {
+	VkBuffer dst;
+	VkBufferCopy region;
+} upload_buf_copy;
+
+typedef struct {
+	VkImage dst;
+	VkBufferImageCopy region;
+	VkImageLayout final_layout;
+} upload_img_copy;
+
+DYNARR_DEFINE(upload_buf_copy_list, upload_buf_copy)
+
+DYNARR_DEFINE(upload_img_copy_list, upload_img_copy)
+
+DYNARR_DEFINE(upload_region_list, VkBufferCopy)
+
+DYNARR_DEFINE(upload_barrier_list, VkImageMemoryBarrier)
+
+typedef struct {
+	VkCommandPool cmd_pool;
+	VkCommandBuffer cmd_buf;
+	VkFence fence;
+	VkSemaphore done;
+	uint64_t tag;
+	bool in_flight;
+} upload_batch;
+
+typedef struct {
+	uint64_t upload_cnt;
+	uint64_t upload_bytes;
+	uint64_t batch_cnt;
+	uint64_t stall_cnt;
+	uint64_t defer_cnt;
+} upload_stats;
+
+/*
+ * uploads are staged in a persistently mapped ring and copied in one batch per flush;
+ * with a dedicated transfer family, destinations must be created with the families
+ * from upload_queue_fams and VK_SHARING_MODE_CONCURRENT so no ownership transfer is needed
+ */
+typedef struct {
+	VkDevice dev;
+	gpu_allocator *ga;
+	VkQueue queue;
+	uint32_t queue_fam;
+	uint32_t gfx_fam;
+	VkBuffer ring_buf;
+	ga_ring ring;
+	upload_batch batches[UPLOAD_MAX_BATCHES];
+	uint32_t cur_batch;
+	uint64_t next_tag;
+	uint64_t completed_tag;
+	upload_buf_copy_list buf_copies;
+	upload_img_copy_list img_copies;
+	upload_region_list regions;
+	upload_barrier_list barriers;
+	upload_stats stats;
+} uploader;
+
+void upload_init(uploader *up, gpu_allocator *ga, VkDevice dev, VkQueue queue, uint32_t queue_fam, uint32_t gfx_fam);
+
+void upload_clean(uploader *up);
+
+uint32_t upload_queue_fams(const uploader *up, uint32_t *fams);
+
+void upload_buffer(uploader *up, VkBuffer dst, VkDeviceSize dst_offset, const void *data, VkDeviceSize size);
+
+VkDeviceSize upload_try_buffer(uploader *up, VkBuffer dst, VkDeviceSize dst_offset, const void *data, VkDeviceSize size);
+
+void upload_image(uploader *up, VkImage dst, VkExtent3D extent, uint32_t mip_level, const void *data, VkDeviceSize size,
+	VkImageLayout final_layout);
+
+bool upload_flush(uploader *up, VkSemaphore *signal);
+
+void upload_wait(uploader *up);
+
+void upload_bench(uploader *up);
+
+#endif
@@ -1,11 +1,21 @@
 #include "vulkan.h"
 
+#include <sched.h>
+
+#define VK_ARENA_BLOCK_SIZE			(64 * 1024)
+#define VK_PIPELINE_CACHE_PATH			"build/pipeline.cache"
+#define VK_SCENE_MESH				"meshes/scene.obj"
+#define VK_SCENE_BLOB				"meshes/scene.mesh"
+#define VK_MESH_QUANT				MESH_QUANT_ALL
+#define VK_BENCH_GRID_CELLS			708
+#define VK_BENCH_CULL_SPAN			2.0f
+
 typedef struct {
-	int					gfx, present;
+	int					gfx, present, transfer;
 } queue_fam_inds;
 
 typedef struct {
-	VkQueue					gfx, present;
+	VkQueue					gfx, present, transfer;
 	float					priority;
 } vulkan_queues;
 
@@ -25,18 +35,49 @@ typedef struct {
 typedef struct {
 	VkImage					*imgs;
 	VkImageView				*img_views;
+	VkFramebuffer				*framebufs;
+	VkSemaphore				*render_done;
+	VkFence					*fences;
 	uint32_t				img_cnt;
 } swap_chain_imgs;
 
+/* one pool per recorder slot, so each secondary is recorded on a single thread at a time */
+typedef struct {
+	VkCommandPool				cmd_pool;
+	VkCommandBuffer				cmd_buf;
+	VkCommandPool				rec_pools[VK_MAX_RECORDERS];
+	VkCommandBuffer				rec_bufs[VK_MAX_RECORDERS];
+	VkSemaphore				img_avail;
+	VkFence					in_flight;
+} frame_data;
+
 typedef struct {
-	VkShaderModule				vert, frag;
+	VkFramebuffer				framebuf;
+	uint32_t				frame;
+	uint32_t				draw_cnt;
+	uint32_t				split;
+} record_ctx;
+
+typedef struct {
+	VkShaderModule				vert, frag, cull;
 } shader_modules;
 
+typedef struct {
+	ga_allocation				*img_allocs;
+	VkBuffer				staging;
+	ga_allocation				staging_alloc;
+	void					*staging_map;
+	VkCommandPool				cmd_pool;
+	uint32_t				last_img;
+} offscreen_target;
+
 GLFWwindow					*wnd;
 
 static VkInstance				inst;
 static VkSurfaceKHR				surface;
 static VkPhysicalDevice				phys_dev;
+static VkPhysicalDeviceProperties		dev_props;
+static uint32_t					gfx_ts_bits;
 static VkDevice					dev;
 static queue_fam_inds				qf_inds;
 static vulkan_queues				queues;
@@ -47,6 +88,39 @@ static swap_chain_imgs				sc_imgs;
 static shader_modules				shader_mods;
 static VkRenderPass				render_pass;
 static VkPipelineLayout				pipeline_layout;
+static VkPipelineCache				pipeline_cache;
+static VkPipeline				pipeline;
+static VkPipelineLayout				cull_pipeline_layout;
+static VkPipeline				cull_pipeline;
+static pipeline_desc				pipeline_dsc;
+static pipeline_service				pipeline_svc;
+static pipeline_future				pipeline_fut;
+static arena					vk_arena;
+static frame_data				frames[VK_MAX_FRAMES_IN_FLIGHT];
+static uint32_t					frame_cnt, cur_frame;
+static job_system				*job_pool;
+static uint32_t					recorder_cnt, recorders;
+static vk_frame_stats				frame_stats;
+static bool					headless;
+static bool					sc_resized, resize_pending;
+static uint64_t					resize_start_ns;
+static offscreen_target				offscreen;
+static gpu_allocator				gpu_alloc;
+static uploader					gpu_upload;
+static gpu_profiler				gpu_prof;
+static bool					gpu_stats;
+static bool					first_instance;
+static vk_present_pref				present_pref;
+static mesh					scene_mesh;
+static mesh_blob_header				scene_hdr;
+static streamer					*stream_sys;
+static stream_handle				scene_req;
+static uint64_t					scene_streamed;
+static bool					scene_pending, scene_ready, scene_bad;
+static draw_batcher				batcher;
+static mat4					view_proj;
+static VkVertexInputBindingDescription		vert_bindings[2];
+static VkVertexInputAttributeDescription	vert_attribs[MESH_ATTRIB_CNT + BATCH_ATTRIB_CNT];
 
 const char *req_exts[] = {
 	VK_KHR_SWAPCHAIN_EXTENSION_NAME,
@@ -61,7 +135,7 @@ static inline void query_swap_chain_details(void)
 	if (sc_dets.format_cnt == 0)
 		dbg_error("failed to find surface formats");
 
-	sc_dets.formats = malloc(sc_dets.format_cnt * sizeof(VkSurfaceFormatKHR));
+	sc_dets.formats = ARENA_PUSH(&vk_arena, VkSurfaceFormatKHR, sc_dets.format_cnt);
 
 	vkGetPhysicalDeviceSurfaceFormatsKHR(phys_dev, surface, &sc_dets.format_cnt, sc_dets.formats);
 
@@ -70,16 +144,32 @@ static inline void query_swap_chain_details(void)
 	if (sc_dets.present_mode_cnt == 0)
 		dbg_error("failed to find present modes");
 
-	sc_dets.present_modes = malloc(sc_dets.format_cnt * sizeof(VkPresentModeKHR));
+	sc_dets.present_modes = ARENA_PUSH(&vk_arena, VkPresentModeKHR, sc_dets.present_mode_cnt);
 
 	vkGetPhysicalDeviceSurfacePresentModesKHR(phys_dev, surface, &sc_dets.present_mode_cnt, sc_dets.present_modes);
 
 	dbg_log("queried swap chain details successfully");
 }
 
+/* higher is preferred, fifo is always supported so it is the floor */
+static inline uint32_t present_rank(VkPresentModeKHR mode)
+{
+	switch (present_pref) {
+	case VK_PRESENT_PREF_LOW_LATENCY:
+		if (mode == VK_PRESENT_MODE_IMMEDIATE_KHR)
+			return 2;
+
+		return mode == VK_PRESENT_MODE_MAILBOX_KHR;
+	case VK_PRESENT_PREF_MAILBOX:
+		return mode == VK_PRESENT_MODE_MAILBOX_KHR;
+	default:
+		return 0;
+	}
+}
+
 static inline void select_swap_chain_settings(void)
 {
-	uint32_t				width, height;
+	int					width, height;
 
 	sc_settings.format = sc_dets.formats[0];
 
@@ -92,8 +182,8 @@ static inline void select_swap_chain_settings(void)
 	sc_settings.present_mode = VK_PRESENT_MODE_FIFO_KHR;
 
 	for (uint32_t i = 0; i < sc_dets.present_mode_cnt; i++) {
-		if (sc_dets.present_modes[i] == VK_PRESENT_MODE_MAILBOX_KHR)
-			sc_settings.present_mode = VK_PRESENT_MODE_MAILBOX_KHR;
+		if (present_rank(sc_dets.present_modes[i]) > present_rank(sc_settings.present_mode))
+			sc_settings.present_mode = sc_dets.present_modes[i];
 	}
 	
 	if (sc_dets.capabilities.currentExtent.width != UINT32_MAX)
@@ -102,8 +192,10 @@ static inline void select_swap_chain_settings(void)
 		glfwGetFramebufferSize(wnd, &width, &height);
 		
 		sc_settings.extent = (VkExtent2D){
-			clamp_uint(width, sc_dets.capabilities.minImageExtent.width, sc_dets.capabilities.maxImageExtent.width),
-			clamp_uint(height, sc_dets.capabilities.minImageExtent.height, sc_dets.capabilities.maxImageExtent.height)
+			clamp_uint((uint32_t)width, sc_dets.capabilities.minImageExtent.width,
+				sc_dets.capabilities.maxImageExtent.width),
+			clamp_uint((uint32_t)height, sc_dets.capabilities.minImageExtent.height,
+				sc_dets.capabilities.maxImageExtent.height)
 		};
 	}
 
@@ -112,30 +204,51 @@ static inline void select_swap_chain_settings(void)
 
 static inline bool qf_inds_complete(queue_fam_inds *qf_inds)
 {
-	return qf_inds->gfx != -1 && qf_inds->present != -1;
+	return qf_inds->gfx != -1 && (headless || qf_inds->present != -1);
 }
 
-static inline void define_queue_infos(VkDeviceQueueCreateInfo *queue_infos, float *priority)
+static inline uint32_t define_queue_infos(VkDeviceQueueCreateInfo *queue_infos, float *priority)
 {
-	queue_infos[0].sType = VK_STRUCTURE_TYPE_DEVICE_QUEUE_CREATE_INFO;
-	queue_infos[0].queueFamilyIndex = qf_inds.gfx;
-	queue_infos[0].queueCount = 1;
-	queue_infos[0].pQueuePriorities = priority;
+	int					fams[3];
+	uint32_t				info_cnt;
+	bool					dup;
+
+	fams[0] = qf_inds.gfx;
+	fams[1] = qf_inds.present;
+	fams[2] = qf_inds.transfer;
+
+	info_cnt = 0;
+
+	for (uint32_t i = 0; i < ARRAY_SIZE(fams); i++) {
+		dup = false;
 
-	queue_infos[1].sType = VK_STRUCTURE_TYPE_DEVICE_QUEUE_CREATE_INFO;
-	queue_infos[1].queueFamilyIndex = qf_inds.present;
-	queue_infos[1].queueCount = 1;
-	queue_infos[1].pQueuePriorities = priority;
+		for (uint32_t j = 0; j < info_cnt; j++)
+			dup |= (int)queue_infos[j].queueFamilyIndex == fams[i];
+
+		if (dup)
+			continue;
+
+		queue_infos[info_cnt].sType = VK_STRUCTURE_TYPE_DEVICE_QUEUE_CREATE_INFO;
+		queue_infos[info_cnt].queueFamilyIndex = fams[i];
+		queue_infos[info_cnt].queueCount = 1;
+		queue_infos[info_cnt].pQueuePriorities = priority;
+
+		info_cnt++;
+	}
+
+	return info_cnt;
 }
 
 static inline bool phys_dev_ext_support(VkPhysicalDevice phys_dev)
 {
 	uint32_t				ext_cnt, supported_ext_cnt;
 	VkExtensionProperties			*avl_exts;
+	arena_mark				mark;
 	
 	vkEnumerateDeviceExtensionProperties(phys_dev, NULL, &ext_cnt, NULL);
-		
-	avl_exts = malloc(ext_cnt * sizeof(VkExtensionProperties));
+
+	mark = arena_get_mark(&vk_arena);
+	avl_exts = ARENA_PUSH(&vk_arena, VkExtensionProperties, ext_cnt);
 	
 	vkEnumerateDeviceExtensionProperties(phys_dev, NULL, &ext_cnt, avl_exts);
 
@@ -148,7 +261,7 @@ static inline bool phys_dev_ext_support(VkPhysicalDevice phys_dev)
 		}
 	}
 
-	free(avl_exts);
+	arena_reset_to(&vk_arena, mark);
 
 	return supported_ext_cnt == ARRAY_SIZE(req_exts);
 }
@@ -160,16 +273,10 @@ static inline uint32_t phys_dev_rate(VkPhysicalDevice phys_dev)
 	VkPhysicalDeviceProperties phys_dev_props;
 	vkGetPhysicalDeviceProperties(phys_dev, &phys_dev_props);
 
-	VkPhysicalDeviceFeatures phys_dev_feats;
-	vkGetPhysicalDeviceFeatures(phys_dev, &phys_dev_feats);
-
-	if (!phys_dev_ext_support(phys_dev))
+	if (!headless && !phys_dev_ext_support(phys_dev))
 		return 0;
 
-	if (!phys_dev_feats.geometryShader)
-		return 0;
-
-	score = 0;
+	score = 1;
 
 	if (phys_dev_props.deviceType == VK_PHYSICAL_DEVICE_TYPE_DISCRETE_GPU)
 		score += 1000;
@@ -179,14 +286,29 @@ static inline uint32_t phys_dev_rate(VkPhysicalDevice phys_dev)
 	return score;
 }
 
+/* resizes are only noted here, the swap chain is rebuilt after the next present */
+static void framebuf_resized(GLFWwindow *window, int width, int height)
+{
+	(void)window;
+	(void)width;
+	(void)height;
+
+	if (resize_start_ns == 0)
+		resize_start_ns = time_now_ns();
+
+	sc_resized = true;
+}
+
 static inline void init_glfw(uint32_t wnd_width, uint32_t wnd_height)
 {
 	glfwInit();
 	
 	glfwWindowHint(GLFW_CLIENT_API, GLFW_NO_API);
-	glfwWindowHint(GLFW_RESIZABLE, GLFW_FALSE);
+	glfwWindowHint(GLFW_RESIZABLE, GLFW_TRUE);
 
 	wnd = glfwCreateWindow(wnd_width, wnd_height, "come up with a name later", NULL, NULL);
+
+	glfwSetFramebufferSizeCallback(wnd, framebuf_resized);
 }
 
 static inline void create_inst(void)
@@ -205,7 +327,11 @@ static inline void create_inst(void)
 	app_info.engineVersion = VK_MAKE_VERSION(1, 0, 0);
 	app_info.apiVersion = VK_API_VERSION_1_0;
 	
-	glfw_exts = (char **)glfwGetRequiredInstanceExtensions(&glfw_ext_cnt);
+	glfw_ext_cnt = 0;
+	glfw_exts = NULL;
+
+	if (!headless)
+		glfw_exts = (char **)glfwGetRequiredInstanceExtensions(&glfw_ext_cnt);
 
 	memset(&inst_info, '\0', sizeof(inst_info));
 
@@ -233,10 +359,12 @@ static inline void pick_phys_dev(void)
 {
 	uint32_t				phys_dev_cnt, cur_best_score;
 	VkPhysicalDevice			*phys_devs;
+	arena_mark				mark;
 
 	vkEnumeratePhysicalDevices(inst, &phys_dev_cnt, NULL);
 
-	phys_devs = malloc(phys_dev_cnt * sizeof(VkPhysicalDevice));
+	mark = arena_get_mark(&vk_arena);
+	phys_devs = ARENA_PUSH(&vk_arena, VkPhysicalDevice, phys_dev_cnt);
 
 	vkEnumeratePhysicalDevices(inst, &phys_dev_cnt, phys_devs);
 
@@ -249,11 +377,13 @@ static inline void pick_phys_dev(void)
 		}
 	}
 
-	free(phys_devs);
+	arena_reset_to(&vk_arena, mark);
 
 	if (cur_best_score == 0)
 		dbg_error("no suitable physical devices found");
 
+	vkGetPhysicalDeviceProperties(phys_dev, &dev_props);
+
 	dbg_log("picked a physical device successfully");
 }
 
@@ -262,61 +392,97 @@ static inline void find_queue_fams(void)
 	uint32_t				queue_fam_cnt;
 	VkQueueFamilyProperties			*queue_fams;
 	VkBool32				present_support;
+	arena_mark				mark;
 
 	qf_inds.gfx = -1;
 	qf_inds.present = -1;
+	qf_inds.transfer = -1;
 
 	queue_fam_cnt = 0;
 
 	vkGetPhysicalDeviceQueueFamilyProperties(phys_dev, &queue_fam_cnt, NULL);
 	
-	queue_fams = malloc(queue_fam_cnt * sizeof(VkQueueFamilyProperties));
+	mark = arena_get_mark(&vk_arena);
+	queue_fams = ARENA_PUSH(&vk_arena, VkQueueFamilyProperties, queue_fam_cnt);
 
 	vkGetPhysicalDeviceQueueFamilyProperties(phys_dev, &queue_fam_cnt, queue_fams);
 
 	for (uint32_t i = 0; i < queue_fam_cnt; i++) {
-		if (queue_fams[i].queueFlags & VK_QUEUE_GRAPHICS_BIT)
+		if (qf_inds.gfx == -1 && (queue_fams[i].queueFlags & VK_QUEUE_GRAPHICS_BIT)) {
 			qf_inds.gfx = i;
+			gfx_ts_bits = queue_fams[i].timestampValidBits;
+		}
+
+		/* a transfer-only family is usually backed by the copy engines */
+		if (qf_inds.transfer == -1 && (queue_fams[i].queueFlags & VK_QUEUE_TRANSFER_BIT) &&
+			!(queue_fams[i].queueFlags & (VK_QUEUE_GRAPHICS_BIT | VK_QUEUE_COMPUTE_BIT)))
+			qf_inds.transfer = i;
 
 		present_support = false;
 
-		vkGetPhysicalDeviceSurfaceSupportKHR(phys_dev, i, surface, &present_support);
+		if (!headless && qf_inds.present == -1)
+			vkGetPhysicalDeviceSurfaceSupportKHR(phys_dev, i, surface, &present_support);
 
 		if (present_support)
 			qf_inds.present = i;
 
-		if (qf_inds_complete(&qf_inds))
+		if (qf_inds_complete(&qf_inds) && qf_inds.transfer != -1)
 			break;
 	}
 
-	free(queue_fams);
+	arena_reset_to(&vk_arena, mark);
 
 	if (!qf_inds_complete(&qf_inds))
 		dbg_error("failed to find queue families");
 
+	if (headless)
+		qf_inds.present = qf_inds.gfx;
+
+	if (qf_inds.transfer == -1)
+		qf_inds.transfer = qf_inds.gfx;
+
 	dbg_log("found queue families successfully");
 }
 
 static inline void create_dev(void)
 {
-	VkPhysicalDeviceFeatures		dev_feats;
-	VkDeviceQueueCreateInfo			queue_infos[2];
+	VkPhysicalDeviceFeatures		dev_feats, supported_feats;
+	VkDeviceQueueCreateInfo			queue_infos[3];
 	VkDeviceCreateInfo			dev_info;
+	uint32_t				queue_info_cnt;
 
 	memset(&dev_feats, '\0', sizeof(dev_feats));
 	memset(queue_infos, '\0', sizeof(queue_infos));
 
+	vkGetPhysicalDeviceFeatures(phys_dev, &supported_feats);
+
+	/* every indirect group after the first starts past instance 0 */
+	first_instance = supported_feats.drawIndirectFirstInstance;
+	dev_feats.drawIndirectFirstInstance = supported_feats.drawIndirectFirstInstance;
+
+	if (!first_instance)
+		dbg_warn("device has no drawIndirectFirstInstance, offsetting instance bindings per group");
+
+	if (gpu_stats) {
+		if (supported_feats.pipelineStatisticsQuery)
+			dev_feats.pipelineStatisticsQuery = VK_TRUE;
+		else
+			dbg_warn("device has no pipeline statistics queries, only timestamps will be profiled");
+
+		gpu_stats = supported_feats.pipelineStatisticsQuery;
+	}
+
 	queues.priority = 1.0f;
 
-	define_queue_infos(queue_infos, &queues.priority);
+	queue_info_cnt = define_queue_infos(queue_infos, &queues.priority);
 
 	memset(&dev_info, '\0', sizeof(dev_info));
 
 	dev_info.sType = VK_STRUCTURE_TYPE_DEVICE_CREATE_INFO;
 	dev_info.pQueueCreateInfos = queue_infos;
-	dev_info.queueCreateInfoCount = ARRAY_SIZE(queue_infos);
+	dev_info.queueCreateInfoCount = queue_info_cnt;
 	dev_info.pEnabledFeatures = &dev_feats;
-	dev_info.enabledExtensionCount = ARRAY_SIZE(req_exts);
+	dev_info.enabledExtensionCount = headless ? 0 : ARRAY_SIZE(req_exts);
 	dev_info.ppEnabledExtensionNames = req_exts;
 	dev_info.enabledLayerCount = 0;
 
@@ -325,11 +491,13 @@ static inline void create_dev(void)
 
 	vkGetDeviceQueue(dev, qf_inds.gfx, 0, &queues.gfx);
 	vkGetDeviceQueue(dev, qf_inds.present, 0, &queues.present);
+	vkGetDeviceQueue(dev, qf_inds.transfer, 0, &queues.transfer);
 
 	dbg_log("created device successfully");
 }
 
-static inline void create_swap_chain(void)
+/* passing the old swap chain lets the driver hand its resources over to the new one */
+static inline void create_swap_chain(VkSwapchainKHR old)
 {
 	VkSwapchainCreateInfoKHR		sc_info;
 	uint32_t				img_cnt, qf_ind_arr[2];
@@ -367,7 +535,7 @@ static inline void create_swap_chain(void)
 	sc_info.compositeAlpha = VK_COMPOSITE_ALPHA_OPAQUE_BIT_KHR;
 	sc_info.presentMode = sc_settings.present_mode;
 	sc_info.clipped = VK_TRUE;
-	sc_info.oldSwapchain = VK_NULL_HANDLE;
+	sc_info.oldSwapchain = old;
 
 	if (vkCreateSwapchainKHR(dev, &sc_info, NULL, &swap_chain) != VK_SUCCESS)
 		dbg_error("failed to create swap chain");
@@ -381,6 +549,86 @@ static inline void create_swap_chain(void)
 	dbg_log("created swap chain successfully");
 }
 
+/* headless mode renders into one offscreen image per frame in flight, which stand in for swap chain images */
+static inline void create_offscreen_targets(uint32_t width, uint32_t height, uint32_t img_cnt)
+{
+	VkImageCreateInfo			img_info;
+	VkBufferCreateInfo			buf_info;
+	VkCommandPoolCreateInfo			pool_info;
+
+	sc_settings.format.format = VK_FORMAT_R8G8B8A8_UNORM;
+	sc_settings.format.colorSpace = VK_COLOR_SPACE_SRGB_NONLINEAR_KHR;
+	sc_settings.extent = (VkExtent2D){
+		width,
+		height
+	};
+
+	sc_imgs.img_cnt = img_cnt;
+	sc_imgs.imgs = malloc(img_cnt * sizeof(VkImage));
+	offscreen.img_allocs = malloc(img_cnt * sizeof(ga_allocation));
+
+	for (uint32_t i = 0; i < img_cnt; i++) {
+		memset(&img_info, '\0', sizeof(img_info));
+
+		img_info.sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO;
+		img_info.imageType = VK_IMAGE_TYPE_2D;
+		img_info.format = sc_settings.format.format;
+		img_info.extent.width = width;
+		img_info.extent.height = height;
+		img_info.extent.depth = 1;
+		img_info.mipLevels = 1;
+		img_info.arrayLayers = 1;
+		img_info.samples = VK_SAMPLE_COUNT_1_BIT;
+		img_info.tiling = VK_IMAGE_TILING_OPTIMAL;
+		img_info.usage = VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | VK_IMAGE_USAGE_TRANSFER_SRC_BIT;
+		img_info.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+		img_info.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+
+		ga_create_image(&gpu_alloc, &img_info, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, 0,
+			&sc_imgs.imgs[i], &offscreen.img_allocs[i]);
+	}
+
+	memset(&buf_info, '\0', sizeof(buf_info));
+
+	buf_info.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
+	buf_info.size = (VkDeviceSize)width * height * 4;
+	buf_info.usage = VK_BUFFER_USAGE_TRANSFER_DST_BIT;
+	buf_info.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+
+	ga_create_buffer(&gpu_alloc, &buf_info, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+		VK_MEMORY_PROPERTY_HOST_CACHED_BIT, &offscreen.staging, &offscreen.staging_alloc);
+
+	offscreen.staging_map = offscreen.staging_alloc.map;
+
+	memset(&pool_info, '\0', sizeof(pool_info));
+
+	pool_info.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
+	pool_info.flags = VK_COMMAND_POOL_CREATE_TRANSIENT_BIT;
+	pool_info.queueFamilyIndex = qf_inds.gfx;
+
+	if (vkCreateCommandPool(dev, &pool_info, NULL, &offscreen.cmd_pool) != VK_SUCCESS)
+		dbg_error("failed to create readback command pool");
+
+	offscreen.last_img = 0;
+
+	dbg_log("created offscreen targets successfully");
+}
+
+static inline void destroy_offscreen_targets(void)
+{
+	vkDestroyCommandPool(dev, offscreen.cmd_pool, NULL);
+
+	vkDestroyBuffer(dev, offscreen.staging, NULL);
+	ga_free(&gpu_alloc, &offscreen.staging_alloc);
+
+	for (uint32_t i = 0; i < sc_imgs.img_cnt; i++) {
+		vkDestroyImage(dev, sc_imgs.imgs[i], NULL);
+		ga_free(&gpu_alloc, &offscreen.img_allocs[i]);
+	}
+
+	free(offscreen.img_allocs);
+}
+
 static inline void create_img_views(void)
 {
 	VkImageViewCreateInfo			img_view_info;
@@ -416,6 +664,8 @@ static inline void create_render_pass(void)
 	VkAttachmentDescription			color_att;
 	VkAttachmentReference			color_att_ref;
 	VkSubpassDescription			subpass;
+	VkSubpassDependency			dependencies[2];
+	VkRenderPassCreateInfo			rp_info;
 	
 	memset(&color_att, '\0', sizeof(color_att));
 
@@ -426,7 +676,7 @@ static inline void create_render_pass(void)
 	color_att.stencilLoadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
 	color_att.stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
 	color_att.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
-	color_att.finalLayout = VK_IMAGE_LAYOUT_PRESENT_SRC_KHR;
+	color_att.finalLayout = headless ? VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL : VK_IMAGE_LAYOUT_PRESENT_SRC_KHR;
 
 	memset(&color_att_ref, '\0', sizeof(color_att_ref));
 
@@ -438,230 +688,1691 @@ static inline void create_render_pass(void)
 	subpass.pipelineBindPoint = VK_PIPELINE_BIND_POINT_GRAPHICS;
 	subpass.colorAttachmentCount = 1;
 	subpass.pColorAttachments = &color_att_ref;
+
+	memset(dependencies, '\0', sizeof(dependencies));
+
+	dependencies[0].srcSubpass = VK_SUBPASS_EXTERNAL;
+	dependencies[0].dstSubpass = 0;
+	dependencies[0].srcStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT;
+	dependencies[0].srcAccessMask = 0;
+	dependencies[0].dstStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT;
+	dependencies[0].dstAccessMask = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT;
+
+	dependencies[1].srcSubpass = 0;
+	dependencies[1].dstSubpass = VK_SUBPASS_EXTERNAL;
+	dependencies[1].srcStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT;
+	dependencies[1].srcAccessMask = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT;
+	dependencies[1].dstStageMask = VK_PIPELINE_STAGE_TRANSFER_BIT;
+	dependencies[1].dstAccessMask = VK_ACCESS_TRANSFER_READ_BIT;
+
+	memset(&rp_info, '\0', sizeof(rp_info));
+
+	rp_info.sType = VK_STRUCTURE_TYPE_RENDER_PASS_CREATE_INFO;
+	rp_info.attachmentCount = 1;
+	rp_info.pAttachments = &color_att;
+	rp_info.subpassCount = 1;
+	rp_info.pSubpasses = &subpass;
+	rp_info.dependencyCount = headless ? 2 : 1;
+	rp_info.pDependencies = dependencies;
+
+	if (vkCreateRenderPass(dev, &rp_info, NULL, &render_pass) != VK_SUCCESS)
+		dbg_error("failed to create render pass");
+
+	dbg_log("created render pass successfully");
 }
 
 static inline void create_shader_mods(void)
 {
-	char					*vert_shader_buf, *frag_shader_buf;
-	size_t					vert_shader_len, frag_shader_len;
-	VkShaderModuleCreateInfo		vert_info, frag_info;
+	asset					vert_shader, frag_shader, cull_shader;
+	VkShaderModuleCreateInfo		vert_info, frag_info, cull_info;
 
-	vert_shader_len = get_file_len("build/shaders/vert.spv");
-	vert_shader_buf = malloc(vert_shader_len);
+	asset_load(&vert_shader, "shaders/vert.spv");
+
+	memset(&vert_info, '\0', sizeof(vert_info));
 
 	vert_info.sType = VK_STRUCTURE_TYPE_SHADER_MODULE_CREATE_INFO;
-	vert_info.codeSize = vert_shader_len;
-	vert_info.pCode = (uint32_t *)vert_shader_buf;
+	vert_info.codeSize = vert_shader.len;
+	vert_info.pCode = (const uint32_t *)vert_shader.data;
 
 	if (vkCreateShaderModule(dev, &vert_info, NULL, &shader_mods.vert) != VK_SUCCESS)
 		dbg_error("failed to create vertex shader module");
 
-	frag_shader_len = get_file_len("build/shaders/frag.spv");
-	frag_shader_buf = malloc(frag_shader_len);
+	asset_release(&vert_shader);
+
+	asset_load(&frag_shader, "shaders/frag.spv");
+
+	memset(&frag_info, '\0', sizeof(frag_info));
 
 	frag_info.sType = VK_STRUCTURE_TYPE_SHADER_MODULE_CREATE_INFO;
-	frag_info.codeSize = frag_shader_len;
-	frag_info.pCode = (uint32_t *)frag_shader_buf;
+	frag_info.codeSize = frag_shader.len;
+	frag_info.pCode = (const uint32_t *)frag_shader.data;
 
 	if (vkCreateShaderModule(dev, &frag_info, NULL, &shader_mods.frag) != VK_SUCCESS)
 		dbg_error("failed to create fragment shader module");
 
-	free(vert_shader_buf);
-	free(frag_shader_buf);
+	asset_release(&frag_shader);
+
+	shader_mods.cull = VK_NULL_HANDLE;
+
+	/* culling falls back to the cpu when the compute shader was not built */
+	if (asset_try_load(&cull_shader, "shaders/cull.spv")) {
+		memset(&cull_info, '\0', sizeof(cull_info));
+
+		cull_info.sType = VK_STRUCTURE_TYPE_SHADER_MODULE_CREATE_INFO;
+		cull_info.codeSize = cull_shader.len;
+		cull_info.pCode = (const uint32_t *)cull_shader.data;
+
+		if (vkCreateShaderModule(dev, &cull_info, NULL, &shader_mods.cull) != VK_SUCCESS)
+			dbg_error("failed to create cull shader module");
+
+		asset_release(&cull_shader);
+	}
 
 	dbg_log("created shader modules successfully");
 }
 
-static inline void create_pipeline(void)
+static inline void load_scene_obj(void)
 {
-	VkPipelineShaderStageCreateInfo		vert_stage_info, frag_stage_info, shader_stage_infos[2];
-	VkPipelineVertexInputStateCreateInfo	vert_input_info;
-	VkPipelineInputAssemblyStateCreateInfo	ia_info;
-	VkViewport				viewport;
-	VkRect2D				vp_scissor;
-	VkPipelineViewportStateCreateInfo	viewport_info;
-	VkPipelineRasterizationStateCreateInfo	rast_info;
-	VkPipelineMultisampleStateCreateInfo	ms_info;
-	VkPipelineColorBlendAttachmentState	cba_info;
-	VkPipelineColorBlendStateCreateInfo	blend_info;
-	VkPipelineDynamicStateCreateInfo	ds_info;
-	VkDynamicState				dynam_states[2];
-	VkPipelineLayoutCreateInfo		pl_info;
+	mesh_data				md;
 
-	create_shader_mods();
+	mesh_data_init(&md);
+	mesh_data_load_obj(&md, VK_SCENE_MESH);
+	mesh_data_optimize(&md);
+
+	mesh_create(&scene_mesh, &gpu_alloc, &gpu_upload, &md, VK_MESH_QUANT);
 
-	memset(&vert_stage_info, '\0', sizeof(vert_stage_info));
+	mesh_data_clean(&md);
 
-	vert_stage_info.sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
-	vert_stage_info.stage = VK_SHADER_STAGE_VERTEX_BIT;
-	vert_stage_info.module = shader_mods.vert;
-	vert_stage_info.pName = "main";
+	scene_ready = true;
+}
 
-	memset(&frag_stage_info, '\0', sizeof(frag_stage_info));
+/* stream_upload_fn for the baked scene; the header may come in pieces, the buffers are created once it is whole */
+static uint64_t stream_scene(void *user, const uint8_t *data, uint64_t offset, uint64_t len)
+{
+	uint64_t				n;
 
-	frag_stage_info.sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
-	frag_stage_info.stage = VK_SHADER_STAGE_FRAGMENT_BIT;
-	frag_stage_info.module = shader_mods.frag;
-	frag_stage_info.pName = "main";
+	(void)user;
 
-	shader_stage_infos[0] = vert_stage_info;
-	shader_stage_infos[1] = frag_stage_info;
+	if (scene_bad)
+		return len;
 
-	memset(&vert_input_info, '\0', sizeof(vert_input_info));
+	if (offset < sizeof(scene_hdr)) {
+		n = len < sizeof(scene_hdr) - offset ? len : sizeof(scene_hdr) - offset;
 
-	vert_input_info.sType = VK_STRUCTURE_TYPE_PIPELINE_VERTEX_INPUT_STATE_CREATE_INFO;
-	vert_input_info.vertexBindingDescriptionCount = 0;
-	vert_input_info.pVertexBindingDescriptions = NULL;
-	vert_input_info.vertexAttributeDescriptionCount = 0;
-	vert_input_info.pVertexAttributeDescriptions = NULL;
+		memcpy((uint8_t *)&scene_hdr + offset, data, n);
 
-	memset(&ia_info, '\0', sizeof(ia_info));
+		if (offset + n < sizeof(scene_hdr))
+			return n;
 
-	ia_info.sType = VK_STRUCTURE_TYPE_PIPELINE_INPUT_ASSEMBLY_STATE_CREATE_INFO;
-	ia_info.topology = VK_PRIMITIVE_TOPOLOGY_TRIANGLE_LIST;
-	ia_info.primitiveRestartEnable = VK_FALSE;
+		/* the pipelines were built for VK_MESH_QUANT, a blob baked otherwise cannot be drawn */
+		if (scene_hdr.quant != VK_MESH_QUANT || !mesh_create_empty(&scene_mesh, &gpu_alloc, &gpu_upload, &scene_hdr)) {
+			scene_bad = true;
 
-	memset(&viewport, '\0', sizeof(viewport));
+			return len;
+		}
 
-	viewport.x = 0.0f;
-	viewport.y = 0.0f;
-	viewport.width = (float)sc_settings.extent.width;
-	viewport.height = (float)sc_settings.extent.height;
-	viewport.minDepth = 0.0f;
-	viewport.maxDepth = 1.0f;
+		return n;
+	}
 
-	memset(&vp_scissor, '\0', sizeof(vp_scissor));
+	n = mesh_upload_span(&scene_mesh, &gpu_upload, data, offset - sizeof(scene_hdr), len);
+	scene_streamed += n;
 
-	vp_scissor.offset = (VkOffset2D){
-		0,
-		0
+	if (scene_streamed >= mesh_payload_size(&scene_mesh))
+		scene_ready = true;
+
+	return n;
+}
+
+/* the baked scene streams in over the first frames; without one, or without a streamer, the obj is parsed here */
+static inline void create_scene(void)
+{
+	stream_desc				desc;
+	asset_loc				loc;
+
+	mat4_identity(&view_proj);
+
+	/* the pipelines take the vertex layout before any of the scene has arrived */
+	mesh_layout_init(&scene_mesh.layout, VK_MESH_QUANT);
+
+	if (stream_sys == NULL || !asset_locate(&loc, VK_SCENE_BLOB)) {
+		load_scene_obj();
+
+		dbg_log("created scene successfully");
+
+		return;
+	}
+
+	desc = (stream_desc){
+		VK_SCENE_BLOB,
+		STREAM_PRIO_CRITICAL,
+		stream_scene,
+		NULL
 	};
 
-	vp_scissor.extent = sc_settings.extent;
-
-	memset(&viewport_info, '\0', sizeof(viewport_info));
-
-	viewport_info.sType = VK_STRUCTURE_TYPE_PIPELINE_VIEWPORT_STATE_CREATE_INFO;
-	viewport_info.viewportCount = 1;
-	viewport_info.pViewports = &viewport;
-	viewport_info.scissorCount = 1;
-	viewport_info.pScissors = &vp_scissor;
-
-	memset(&rast_info, '\0', sizeof(rast_info));
-
-	rast_info.sType = VK_STRUCTURE_TYPE_PIPELINE_RASTERIZATION_STATE_CREATE_INFO;
-	rast_info.depthClampEnable = VK_FALSE;
-	rast_info.rasterizerDiscardEnable = VK_FALSE;
-	rast_info.polygonMode = VK_POLYGON_MODE_FILL;
-	rast_info.lineWidth = 1.0f;
-	rast_info.cullMode = VK_CULL_MODE_BACK_BIT;
-	rast_info.frontFace = VK_FRONT_FACE_CLOCKWISE;
-	rast_info.depthBiasEnable = VK_FALSE;
-	rast_info.depthBiasConstantFactor = 0.0f;
-	rast_info.depthBiasClamp = 0.0f;
-	rast_info.depthBiasSlopeFactor = 0.0f;
-
-	memset(&ms_info, '\0', sizeof(ms_info));
-
-	ms_info.sType = VK_STRUCTURE_TYPE_PIPELINE_MULTISAMPLE_STATE_CREATE_INFO;
-	ms_info.sampleShadingEnable = VK_FALSE;
-	ms_info.rasterizationSamples = VK_SAMPLE_COUNT_1_BIT;
-	ms_info.minSampleShading = 1.0f;
-	ms_info.pSampleMask = NULL;
-	ms_info.alphaToCoverageEnable = VK_FALSE;
-	ms_info.alphaToOneEnable = VK_FALSE;
-
-	memset(&cba_info, '\0', sizeof(cba_info));
-
-	cba_info.colorWriteMask =
-		VK_COLOR_COMPONENT_R_BIT |
-		VK_COLOR_COMPONENT_G_BIT |
-		VK_COLOR_COMPONENT_B_BIT |
-		VK_COLOR_COMPONENT_A_BIT;
-
-	cba_info.blendEnable = VK_FALSE;
-	cba_info.srcColorBlendFactor = VK_BLEND_FACTOR_ONE;
-	cba_info.dstColorBlendFactor = VK_BLEND_FACTOR_ZERO;
-	cba_info.colorBlendOp = VK_BLEND_OP_ADD;
-	cba_info.srcAlphaBlendFactor = VK_BLEND_FACTOR_ONE;
-	cba_info.dstAlphaBlendFactor = VK_BLEND_FACTOR_ZERO;
-	cba_info.alphaBlendOp = VK_BLEND_OP_ADD;
-
-	memset(&blend_info, '\0', sizeof(blend_info));
-
-	blend_info.sType = VK_STRUCTURE_TYPE_PIPELINE_COLOR_BLEND_STATE_CREATE_INFO;
-	blend_info.logicOpEnable = VK_FALSE;
-	blend_info.logicOp = VK_LOGIC_OP_COPY;
-	blend_info.attachmentCount = 1;
-	blend_info.pAttachments = &cba_info;
-	blend_info.blendConstants[0] = 0.0f;
-	blend_info.blendConstants[1] = 0.0f;
-	blend_info.blendConstants[2] = 0.0f;
-	blend_info.blendConstants[3] = 0.0f;
-
-	dynam_states[0] = VK_DYNAMIC_STATE_VIEWPORT;
-	dynam_states[1] = VK_DYNAMIC_STATE_LINE_WIDTH;
-
-	memset(&ds_info, '\0', sizeof(ds_info));
-
-	ds_info.sType = VK_STRUCTURE_TYPE_PIPELINE_DYNAMIC_STATE_CREATE_INFO;
-	ds_info.dynamicStateCount = 2;
-	ds_info.pDynamicStates = dynam_states;
-
-	memset(&pl_info, '\0', sizeof(pipeline_layout));
+	scene_req = stream_request(stream_sys, &desc);
+	scene_pending = true;
+
+	dbg_log("requested scene stream successfully");
+}
+
+/* releases the scene request once it ends; one that ended without a whole mesh falls back to the obj */
+static inline void poll_scene(void)
+{
+	stream_state				state;
+
+	if (!scene_pending)
+		return;
+
+	state = stream_status(stream_sys, scene_req);
+
+	if (state != STREAM_DONE && state != STREAM_FAILED)
+		return;
+
+	stream_release(stream_sys, scene_req);
+	scene_pending = false;
+
+	if (scene_ready) {
+		dbg_log("streamed scene successfully");
+
+		return;
+	}
+
+	dbg_warn("%s did not stream in whole, loading %s instead", VK_SCENE_BLOB, VK_SCENE_MESH);
+
+	upload_flush(&gpu_upload, NULL);
+	upload_wait(&gpu_upload);
+	vkDeviceWaitIdle(dev);
+
+	mesh_destroy(&scene_mesh, &gpu_alloc);
+	load_scene_obj();
+}
+
+/* benchmarks draw the scene from their first frame, so it is pumped in whole before they start */
+static inline void wait_scene(void)
+{
+	while (scene_pending) {
+		stream_pump(stream_sys, STREAM_FRAME_UPLOAD_BUDGET);
+		upload_flush(&gpu_upload, NULL);
+		upload_wait(&gpu_upload);
+		poll_scene();
+
+		if (scene_pending)
+			sched_yield();
+	}
+}
+
+static inline void create_pipeline(void)
+{
+	VkPipelineLayoutCreateInfo		pl_info;
+	VkPushConstantRange			push_range;
+	bool					warm;
+
+	pipeline_cache = pcache_load(dev, &dev_props, VK_PIPELINE_CACHE_PATH, &warm);
+
+	psvc_init(&pipeline_svc, dev, pipeline_cache, tpool_core_cnt());
+
+	create_shader_mods();
+
+	memset(&push_range, '\0', sizeof(push_range));
+
+	push_range.stageFlags = VK_SHADER_STAGE_VERTEX_BIT;
+	push_range.offset = 0;
+	push_range.size = sizeof(mat4);
+
+	memset(&pl_info, '\0', sizeof(pl_info));
 	
 	pl_info.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
 	pl_info.setLayoutCount = 0;
 	pl_info.pSetLayouts = NULL;
-	pl_info.pushConstantRangeCount = 0;
-	pl_info.pPushConstantRanges = NULL;
+	pl_info.pushConstantRangeCount = 1;
+	pl_info.pPushConstantRanges = &push_range;
 
 	if (vkCreatePipelineLayout(dev, &pl_info, NULL, &pipeline_layout) != VK_SUCCESS)
-		dbg_error("failed to create pipeline");
+		dbg_error("failed to create pipeline layout");
+
+	memset(&pipeline_dsc, '\0', sizeof(pipeline_dsc));
+
+	pipeline_dsc.vert = shader_mods.vert;
+	pipeline_dsc.frag = shader_mods.frag;
+	pipeline_dsc.layout = pipeline_layout;
+	pipeline_dsc.render_pass = render_pass;
+	pipeline_dsc.bindings = vert_bindings;
+	pipeline_dsc.binding_cnt = ARRAY_SIZE(vert_bindings);
+	pipeline_dsc.attribs = vert_attribs;
+	pipeline_dsc.attrib_cnt = batch_vertex_input(&scene_mesh.layout, vert_bindings, vert_attribs);
+	pipeline_dsc.topology = VK_PRIMITIVE_TOPOLOGY_TRIANGLE_LIST;
+	pipeline_dsc.cull_mode = VK_CULL_MODE_BACK_BIT;
+	pipeline_dsc.front_face = VK_FRONT_FACE_CLOCKWISE;
+
+	psvc_submit(&pipeline_svc, &pipeline_dsc, 1, &pipeline_fut);
+
+	dbg_log("submitted %s pipeline build successfully", warm ? "warm" : "cold");
+}
+
+static inline void create_cull_pipeline(void)
+{
+	VkPipelineLayoutCreateInfo		pl_info;
+	VkPushConstantRange			push_range;
+
+	if (shader_mods.cull == VK_NULL_HANDLE) {
+		batcher.cull = BATCH_CULL_CPU;
+
+		dbg_warn("no cull shader, culling on the cpu");
+
+		return;
+	}
+
+	if (!first_instance) {
+		batcher.cull = BATCH_CULL_CPU;
+
+		dbg_warn("gpu culling needs drawIndirectFirstInstance, culling on the cpu");
+
+		return;
+	}
+
+	memset(&push_range, '\0', sizeof(push_range));
+
+	push_range.stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+	push_range.offset = 0;
+	push_range.size = sizeof(batch_cull_params);
+
+	memset(&pl_info, '\0', sizeof(pl_info));
+
+	pl_info.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
+	pl_info.setLayoutCount = 1;
+	pl_info.pSetLayouts = &batcher.cull_set_layout;
+	pl_info.pushConstantRangeCount = 1;
+	pl_info.pPushConstantRanges = &push_range;
+
+	if (vkCreatePipelineLayout(dev, &pl_info, NULL, &cull_pipeline_layout) != VK_SUCCESS)
+		dbg_error("failed to create cull pipeline layout");
+
+	if (pipeline_build_compute(dev, pipeline_cache, shader_mods.cull, cull_pipeline_layout, &cull_pipeline) != VK_SUCCESS)
+		dbg_error("failed to create cull pipeline");
+
+	batcher.cull = BATCH_CULL_GPU;
+
+	dbg_log("created cull pipeline successfully");
+}
+
+static inline void wait_pipelines(void)
+{
+	pipeline = pfut_wait(&pipeline_fut);
+
+	psvc_finish(&pipeline_svc);
+
+	dbg_info("pipeline creation took %.3f ms", pipeline_fut.build_ns / 1e6);
 
 	dbg_log("created pipeline successfully");
 }
 
-void vk_init(void)
+static inline void create_framebufs(void)
 {
-	init_glfw(800, 600);
-	create_inst();
-	create_surface(wnd);
-	pick_phys_dev();
-	find_queue_fams();
-	create_dev();
-	query_swap_chain_details();
-	select_swap_chain_settings();
-	create_swap_chain();
-	create_img_views();
-	create_pipeline();
+	VkFramebufferCreateInfo			fb_info;
 
-	dbg_log("initialized vulkan successfully");
+	sc_imgs.framebufs = malloc(sc_imgs.img_cnt * sizeof(VkFramebuffer));
+
+	for (uint32_t i = 0; i < sc_imgs.img_cnt; i++) {
+		memset(&fb_info, '\0', sizeof(fb_info));
+
+		fb_info.sType = VK_STRUCTURE_TYPE_FRAMEBUFFER_CREATE_INFO;
+		fb_info.renderPass = render_pass;
+		fb_info.attachmentCount = 1;
+		fb_info.pAttachments = &sc_imgs.img_views[i];
+		fb_info.width = sc_settings.extent.width;
+		fb_info.height = sc_settings.extent.height;
+		fb_info.layers = 1;
+
+		if (vkCreateFramebuffer(dev, &fb_info, NULL, &sc_imgs.framebufs[i]) != VK_SUCCESS)
+			dbg_error("failed to create framebuffers");
+	}
+
+	dbg_log("created framebuffers successfully");
 }
 
-void vk_clean(void)
+/* render_done is per image, not per frame, since presentation may still hold it when the frame slot comes around again */
+static inline void create_img_sync(void)
 {
-	vkDestroyPipelineLayout(dev, pipeline_layout, NULL);
+	VkSemaphoreCreateInfo			sem_info;
 
-	vkDestroyShaderModule(dev, shader_mods.vert, NULL);
-	vkDestroyShaderModule(dev, shader_mods.frag, NULL);
+	memset(&sem_info, '\0', sizeof(sem_info));
+
+	sem_info.sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO;
+
+	sc_imgs.render_done = malloc(sc_imgs.img_cnt * sizeof(VkSemaphore));
+	sc_imgs.fences = malloc(sc_imgs.img_cnt * sizeof(VkFence));
+
+	for (uint32_t i = 0; i < sc_imgs.img_cnt; i++) {
+		if (vkCreateSemaphore(dev, &sem_info, NULL, &sc_imgs.render_done[i]) != VK_SUCCESS)
+			dbg_error("failed to create image semaphores");
+
+		sc_imgs.fences[i] = VK_NULL_HANDLE;
+	}
+}
+
+static inline void create_frames(uint32_t frames_in_flight)
+{
+	VkCommandPoolCreateInfo			pool_info;
+	VkCommandBufferAllocateInfo		cb_info;
+	VkSemaphoreCreateInfo			sem_info;
+	VkFenceCreateInfo			fence_info;
+
+	frame_cnt = clamp_uint(frames_in_flight, 1, VK_MAX_FRAMES_IN_FLIGHT);
+	cur_frame = 0;
+	recorder_cnt = clamp_uint(job_pool->thread_cnt, 1, VK_MAX_RECORDERS);
+	recorders = recorder_cnt;
+
+	memset(&pool_info, '\0', sizeof(pool_info));
+
+	pool_info.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
+	pool_info.flags = VK_COMMAND_POOL_CREATE_TRANSIENT_BIT;
+	pool_info.queueFamilyIndex = qf_inds.gfx;
+
+	memset(&sem_info, '\0', sizeof(sem_info));
+
+	sem_info.sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO;
+
+	memset(&fence_info, '\0', sizeof(fence_info));
+
+	fence_info.sType = VK_STRUCTURE_TYPE_FENCE_CREATE_INFO;
+	fence_info.flags = VK_FENCE_CREATE_SIGNALED_BIT;
+
+	for (uint32_t i = 0; i < frame_cnt; i++) {
+		if (vkCreateCommandPool(dev, &pool_info, NULL, &frames[i].cmd_pool) != VK_SUCCESS)
+			dbg_error("failed to create frame command pool");
+
+		memset(&cb_info, '\0', sizeof(cb_info));
+
+		cb_info.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+		cb_info.commandPool = frames[i].cmd_pool;
+		cb_info.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+		cb_info.commandBufferCount = 1;
+
+		if (vkAllocateCommandBuffers(dev, &cb_info, &frames[i].cmd_buf) != VK_SUCCESS)
+			dbg_error("failed to allocate frame command buffer");
+
+		for (uint32_t j = 0; j < recorder_cnt; j++) {
+			if (vkCreateCommandPool(dev, &pool_info, NULL, &frames[i].rec_pools[j]) != VK_SUCCESS)
+				dbg_error("failed to create recorder command pool");
+
+			cb_info.commandPool = frames[i].rec_pools[j];
+			cb_info.level = VK_COMMAND_BUFFER_LEVEL_SECONDARY;
 
-	for (uint32_t i = 0; i < sc_imgs.img_cnt; i++)
+			if (vkAllocateCommandBuffers(dev, &cb_info, &frames[i].rec_bufs[j]) != VK_SUCCESS)
+				dbg_error("failed to allocate recorder command buffer");
+		}
+
+		if (vkCreateSemaphore(dev, &sem_info, NULL, &frames[i].img_avail) != VK_SUCCESS ||
+			vkCreateFence(dev, &fence_info, NULL, &frames[i].in_flight) != VK_SUCCESS)
+			dbg_error("failed to create frame sync objects");
+	}
+
+	dbg_log("created %u frames in flight with %u recorders successfully", frame_cnt, recorder_cnt);
+}
+
+/* everything that depends on the swap chain's images or size, the swap chain itself excluded */
+static inline void destroy_sized_objs(void)
+{
+	for (uint32_t i = 0; i < sc_imgs.img_cnt; i++) {
+		vkDestroyFramebuffer(dev, sc_imgs.framebufs[i], NULL);
 		vkDestroyImageView(dev, sc_imgs.img_views[i], NULL);
 
+		if (!headless)
+			vkDestroySemaphore(dev, sc_imgs.render_done[i], NULL);
+	}
+
+	free(sc_imgs.framebufs);
+	free(sc_imgs.render_done);
+	free(sc_imgs.fences);
 	free(sc_imgs.img_views);
+}
+
+static inline void destroy_swap_chain_objs(void)
+{
+	destroy_sized_objs();
+
+	if (headless)
+		destroy_offscreen_targets();
+	else
+		vkDestroySwapchainKHR(dev, swap_chain, NULL);
+
+	free(sc_imgs.imgs);
+}
+
+/*
+ * the render pass and pipelines only depend on the surface format, which never changes,
+ * so a resize rebuilds just the swap chain, its views and framebuffers and their semaphores
+ */
+static inline void recreate_swap_chain(void)
+{
+	VkSwapchainKHR				old;
+	int					width, height;
+	uint64_t				start_ns;
+
+	glfwGetFramebufferSize(wnd, &width, &height);
+
+	while (width == 0 || height == 0) {
+		glfwWaitEvents();
+		glfwGetFramebufferSize(wnd, &width, &height);
+	}
+
+	start_ns = time_now_ns();
+
+	if (resize_start_ns == 0)
+		resize_start_ns = start_ns;
+
+	vkDeviceWaitIdle(dev);
+
+	destroy_sized_objs();
 	free(sc_imgs.imgs);
 
-	free(sc_dets.formats);
-	free(sc_dets.present_modes);
+	vkGetPhysicalDeviceSurfaceCapabilitiesKHR(phys_dev, surface, &sc_dets.capabilities);
+
+	old = swap_chain;
 
-	vkDestroySwapchainKHR(dev, swap_chain, NULL);
-	vkDestroyDevice(dev, NULL);
-	vkDestroySurfaceKHR(inst, surface, NULL);
-	vkDestroyInstance(inst, NULL);
+	select_swap_chain_settings();
+	create_swap_chain(old);
+	vkDestroySwapchainKHR(dev, old, NULL);
+
+	create_img_views();
+	create_framebufs();
+	create_img_sync();
+
+	sc_resized = false;
+	resize_pending = true;
+
+	frame_stats.recreate_cnt++;
+	frame_stats.total_recreate_ns += time_now_ns() - start_ns;
+
+	dbg_log("recreated %ux%u swap chain in %.2f ms successfully", sc_settings.extent.width, sc_settings.extent.height,
+		(time_now_ns() - start_ns) / 1e6);
+}
+
+/* called once a frame has been presented, closes the resize that recreate_swap_chain opened */
+static inline void end_resize(void)
+{
+	uint64_t				ns;
+
+	ns = time_now_ns() - resize_start_ns;
+
+	frame_stats.resize_cnt++;
+	frame_stats.total_resize_ns += ns;
+
+	if (ns > frame_stats.max_resize_ns)
+		frame_stats.max_resize_ns = ns;
+
+	resize_start_ns = 0;
+	resize_pending = false;
+
+	dbg_log("first frame after resize presented %.2f ms after the resize", ns / 1e6);
+}
+
+/* secondaries inherit nothing but the render pass, so each one sets its own dynamic state */
+static inline void set_draw_state(VkCommandBuffer cmd_buf)
+{
+	VkViewport				viewport;
+	VkRect2D				scissor;
+
+	memset(&viewport, '\0', sizeof(viewport));
+
+	viewport.width = (float)sc_settings.extent.width;
+	viewport.height = (float)sc_settings.extent.height;
+	viewport.minDepth = 0.0f;
+	viewport.maxDepth = 1.0f;
+
+	memset(&scissor, '\0', sizeof(scissor));
+
+	scissor.extent = sc_settings.extent;
+
+	vkCmdSetViewport(cmd_buf, 0, 1, &viewport);
+	vkCmdSetScissor(cmd_buf, 0, 1, &scissor);
+	vkCmdSetLineWidth(cmd_buf, 1.0f);
+}
+
+/* slot i records the i-th of split equal slices of the draw list into its own pool's buffer */
+static void record_secondary(void *arg, uint32_t begin, uint32_t end, uint32_t worker)
+{
+	record_ctx				*ctx;
+	VkCommandBuffer				cmd_buf;
+	VkCommandBufferInheritanceInfo		inherit_info;
+	VkCommandBufferBeginInfo		begin_info;
+	uint32_t				zone;
+
+	PROF_ZONE("record_secondary");
+
+	(void)worker;
+
+	ctx = arg;
+
+	for (uint32_t i = begin; i < end; i++) {
+		cmd_buf = frames[ctx->frame].rec_bufs[i];
+
+		memset(&inherit_info, '\0', sizeof(inherit_info));
+
+		inherit_info.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_INHERITANCE_INFO;
+		inherit_info.renderPass = render_pass;
+		inherit_info.subpass = 0;
+		inherit_info.framebuffer = ctx->framebuf;
+
+		memset(&begin_info, '\0', sizeof(begin_info));
+
+		begin_info.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+		begin_info.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT |
+			VK_COMMAND_BUFFER_USAGE_RENDER_PASS_CONTINUE_BIT;
+		begin_info.pInheritanceInfo = &inherit_info;
+
+		if (vkBeginCommandBuffer(cmd_buf, &begin_info) != VK_SUCCESS)
+			dbg_error("failed to begin secondary command buffer");
+
+		set_draw_state(cmd_buf);
+
+		zone = gpu_prof_begin(&gpu_prof, cmd_buf, ctx->frame, "draw_slice", false);
+
+		batch_record_range(&batcher, cmd_buf, ctx->frame, &pipeline, pipeline_layout, &view_proj,
+			(uint64_t)ctx->draw_cnt * i / ctx->split, (uint64_t)ctx->draw_cnt * (i + 1) / ctx->split);
+
+		gpu_prof_end(&gpu_prof, cmd_buf, ctx->frame, zone);
+
+		if (vkEndCommandBuffer(cmd_buf) != VK_SUCCESS)
+			dbg_error("failed to record secondary command buffer");
+	}
+}
+
+static inline void record_frame(VkCommandBuffer cmd_buf, uint32_t img_ind, uint32_t frame)
+{
+	VkCommandBufferBeginInfo		begin_info;
+	VkRenderPassBeginInfo			rp_begin_info;
+	VkClearValue				clear_color;
+	record_ctx				ctx;
+	uint64_t				record_ns;
+	uint32_t				zone;
+
+	PROF_ZONE("record_frame");
+
+	memset(&begin_info, '\0', sizeof(begin_info));
+
+	begin_info.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+	begin_info.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+
+	if (vkBeginCommandBuffer(cmd_buf, &begin_info) != VK_SUCCESS)
+		dbg_error("failed to begin command buffer");
+
+	memset(&clear_color, '\0', sizeof(clear_color));
+
+	memset(&rp_begin_info, '\0', sizeof(rp_begin_info));
+
+	rp_begin_info.sType = VK_STRUCTURE_TYPE_RENDER_PASS_BEGIN_INFO;
+	rp_begin_info.renderPass = render_pass;
+	rp_begin_info.framebuffer = sc_imgs.framebufs[img_ind];
+	rp_begin_info.renderArea.offset = (VkOffset2D){
+		0,
+		0
+	};
+	rp_begin_info.renderArea.extent = sc_settings.extent;
+	rp_begin_info.clearValueCount = 1;
+	rp_begin_info.pClearValues = &clear_color;
+
+	gpu_prof_frame_begin(&gpu_prof, cmd_buf, frame);
+
+	batch_build(&batcher, frame, &view_proj);
+
+	zone = gpu_prof_begin(&gpu_prof, cmd_buf, frame, "cull_pass", true);
+	batch_record_cull(&batcher, cmd_buf, frame, cull_pipeline, cull_pipeline_layout);
+	gpu_prof_end(&gpu_prof, cmd_buf, frame, zone);
+
+	ctx.framebuf = sc_imgs.framebufs[img_ind];
+	ctx.frame = frame;
+	ctx.draw_cnt = batch_draw_cnt(&batcher);
+	ctx.split = recorders > 1 && ctx.draw_cnt >= VK_PARALLEL_RECORD_MIN_DRAWS ? recorders : 0;
+
+	record_ns = time_now_ns();
+
+	/* a statistics query left open across vkCmdExecuteCommands would need inheritedQueries */
+	zone = gpu_prof_begin(&gpu_prof, cmd_buf, frame, "main_pass", ctx.split == 0);
+
+	/* short draw lists stay inline, a secondary per slice only pays off once recording dominates */
+	if (ctx.split > 0) {
+		vkCmdBeginRenderPass(cmd_buf, &rp_begin_info, VK_SUBPASS_CONTENTS_SECONDARY_COMMAND_BUFFERS);
+
+		job_parallel_for(job_pool, 0, ctx.split, 1, record_secondary, &ctx);
+
+		vkCmdExecuteCommands(cmd_buf, ctx.split, frames[frame].rec_bufs);
+		batch_reset(&batcher);
+	} else {
+		vkCmdBeginRenderPass(cmd_buf, &rp_begin_info, VK_SUBPASS_CONTENTS_INLINE);
+
+		set_draw_state(cmd_buf);
+		batch_record(&batcher, cmd_buf, frame, &pipeline, pipeline_layout, &view_proj);
+	}
+
+	vkCmdEndRenderPass(cmd_buf);
+
+	gpu_prof_end(&gpu_prof, cmd_buf, frame, zone);
+
+	frame_stats.record_ns = time_now_ns() - record_ns;
+
+	if (vkEndCommandBuffer(cmd_buf) != VK_SUCCESS)
+		dbg_error("failed to record command buffer");
+}
+
+static inline void reset_frame_pools(frame_data *frame)
+{
+	vkResetCommandPool(dev, frame->cmd_pool, 0);
+
+	for (uint32_t i = 0; i < recorder_cnt; i++)
+		vkResetCommandPool(dev, frame->rec_pools[i], 0);
+}
+
+void vk_init(const vk_config *cfg)
+{
+	PROF_ZONE("vk_init");
+
+	arena_init(&vk_arena, VK_ARENA_BLOCK_SIZE);
+
+	headless = cfg->headless;
+	gpu_stats = cfg->gpu_stats;
+	present_pref = cfg->present_pref;
+	job_pool = cfg->jobs;
+	stream_sys = cfg->stream;
+
+	if (!headless)
+		init_glfw(cfg->width, cfg->height);
+
+	create_inst();
+
+	if (!headless)
+		create_surface(wnd);
+
+	pick_phys_dev();
+	find_queue_fams();
+	create_dev();
+
+	ga_init(&gpu_alloc, phys_dev, dev);
+	upload_init(&gpu_upload, &gpu_alloc, dev, queues.transfer, qf_inds.transfer, qf_inds.gfx);
+
+	if (headless) {
+		create_offscreen_targets(cfg->width, cfg->height, clamp_uint(cfg->frames_in_flight, 1, VK_MAX_FRAMES_IN_FLIGHT));
+	} else {
+		query_swap_chain_details();
+		select_swap_chain_settings();
+		create_swap_chain(VK_NULL_HANDLE);
+	}
+
+	create_img_views();
+	create_render_pass();
+	create_scene();
+	create_pipeline();
+	create_framebufs();
+
+	if (!headless)
+		create_img_sync();
+
+	create_frames(cfg->frames_in_flight);
+	gpu_prof_init(&gpu_prof, dev, &dev_props, gfx_ts_bits, queues.gfx, qf_inds.gfx, frame_cnt, gpu_stats);
+	batch_init(&batcher, &gpu_alloc, dev, frame_cnt, cfg->max_instances, first_instance);
+	create_cull_pipeline();
+	wait_pipelines();
+
+	dbg_log("initialized vulkan successfully");
+}
+
+static inline void end_frame_stats(uint64_t start_ns, uint64_t wait_ns)
+{
+	frame_stats.cpu_ns = time_now_ns() - start_ns;
+	frame_stats.fence_wait_ns = wait_ns;
+	frame_stats.total_cpu_ns += frame_stats.cpu_ns;
+	frame_stats.total_fence_wait_ns += wait_ns;
+	frame_stats.total_record_ns += frame_stats.record_ns;
+
+	/* heap calls since the caller's mem_frame_begin; the first frames still grow their lists and pools */
+	frame_stats.heap_calls = mem_frame_heap_calls();
+
+	if (frame_stats.frame_cnt >= VK_HEAP_WARMUP_FRAMES) {
+		if (frame_stats.heap_calls > frame_stats.max_heap_calls)
+			frame_stats.max_heap_calls = frame_stats.heap_calls;
+
+		frame_stats.total_heap_calls += frame_stats.heap_calls;
+		frame_stats.heap_frame_cnt++;
+	}
+
+	frame_stats.frame_cnt++;
+}
+
+static inline void draw_offscreen_frame(frame_data *frame, uint64_t start_ns, uint64_t wait_ns)
+{
+	VkSemaphore				upload_sem;
+	VkPipelineStageFlags			wait_stage;
+	VkSubmitInfo				submit_info;
+
+	vkResetFences(dev, 1, &frame->in_flight);
+	reset_frame_pools(frame);
+
+	record_frame(frame->cmd_buf, cur_frame, cur_frame);
+
+	wait_stage = UPLOAD_WAIT_STAGES;
+
+	memset(&submit_info, '\0', sizeof(submit_info));
+
+	submit_info.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+
+	if (upload_flush(&gpu_upload, &upload_sem)) {
+		submit_info.waitSemaphoreCount = 1;
+		submit_info.pWaitSemaphores = &upload_sem;
+		submit_info.pWaitDstStageMask = &wait_stage;
+	}
+
+	submit_info.commandBufferCount = 1;
+	submit_info.pCommandBuffers = &frame->cmd_buf;
+
+	if (vkQueueSubmit(queues.gfx, 1, &submit_info, frame->in_flight) != VK_SUCCESS)
+		dbg_error("failed to submit frame");
+
+	offscreen.last_img = cur_frame;
+	cur_frame = (cur_frame + 1) % frame_cnt;
+
+	end_frame_stats(start_ns, wait_ns);
+}
+
+void vk_draw_frame(void)
+{
+	frame_data				*frame;
+	uint64_t				start_ns, wait_ns, img_wait_ns;
+	uint32_t				img_ind;
+	VkResult				res;
+	VkSemaphore				wait_sems[2];
+	VkPipelineStageFlags			wait_stages[2];
+	uint32_t				wait_cnt;
+	VkSubmitInfo				submit_info;
+	VkPresentInfoKHR			present_info;
+
+	PROF_ZONE("vk_draw_frame");
+
+	poll_scene();
+
+	frame = &frames[cur_frame];
+	start_ns = time_now_ns();
+
+	vkWaitForFences(dev, 1, &frame->in_flight, VK_TRUE, UINT64_MAX);
+
+	wait_ns = time_now_ns() - start_ns;
+
+	if (headless) {
+		draw_offscreen_frame(frame, start_ns, wait_ns);
+
+		return;
+	}
+
+	res = vkAcquireNextImageKHR(dev, swap_chain, UINT64_MAX, frame->img_avail, VK_NULL_HANDLE, &img_ind);
+
+	if (res == VK_ERROR_OUT_OF_DATE_KHR) {
+		batch_reset(&batcher);
+		recreate_swap_chain();
+
+		return;
+	} else if (res != VK_SUCCESS && res != VK_SUBOPTIMAL_KHR) {
+		dbg_error("failed to acquire swap chain image");
+	}
+
+	if (sc_imgs.fences[img_ind] != VK_NULL_HANDLE && sc_imgs.fences[img_ind] != frame->in_flight) {
+		img_wait_ns = time_now_ns();
+
+		vkWaitForFences(dev, 1, &sc_imgs.fences[img_ind], VK_TRUE, UINT64_MAX);
+
+		wait_ns += time_now_ns() - img_wait_ns;
+	}
+
+	sc_imgs.fences[img_ind] = frame->in_flight;
+
+	vkResetFences(dev, 1, &frame->in_flight);
+	reset_frame_pools(frame);
+
+	record_frame(frame->cmd_buf, img_ind, cur_frame);
+
+	wait_sems[0] = frame->img_avail;
+	wait_stages[0] = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT;
+	wait_cnt = 1;
+
+	if (upload_flush(&gpu_upload, &wait_sems[wait_cnt]))
+		wait_stages[wait_cnt++] = UPLOAD_WAIT_STAGES;
+
+	memset(&submit_info, '\0', sizeof(submit_info));
+
+	submit_info.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+	submit_info.waitSemaphoreCount = wait_cnt;
+	submit_info.pWaitSemaphores = wait_sems;
+	submit_info.pWaitDstStageMask = wait_stages;
+	submit_info.commandBufferCount = 1;
+	submit_info.pCommandBuffers = &frame->cmd_buf;
+	submit_info.signalSemaphoreCount = 1;
+	submit_info.pSignalSemaphores = &sc_imgs.render_done[img_ind];
+
+	if (vkQueueSubmit(queues.gfx, 1, &submit_info, frame->in_flight) != VK_SUCCESS)
+		dbg_error("failed to submit frame");
+
+	memset(&present_info, '\0', sizeof(present_info));
+
+	present_info.sType = VK_STRUCTURE_TYPE_PRESENT_INFO_KHR;
+	present_info.waitSemaphoreCount = 1;
+	present_info.pWaitSemaphores = &sc_imgs.render_done[img_ind];
+	present_info.swapchainCount = 1;
+	present_info.pSwapchains = &swap_chain;
+	present_info.pImageIndices = &img_ind;
+
+	res = vkQueuePresentKHR(queues.present, &present_info);
+
+	if (res != VK_SUCCESS && res != VK_SUBOPTIMAL_KHR && res != VK_ERROR_OUT_OF_DATE_KHR)
+		dbg_error("failed to present swap chain image");
+
+	if (res == VK_SUCCESS && resize_pending)
+		end_resize();
+
+	if (res != VK_SUCCESS || sc_resized)
+		recreate_swap_chain();
+
+	cur_frame = (cur_frame + 1) % frame_cnt;
+
+	end_frame_stats(start_ns, wait_ns);
+}
+
+/*
+ * stream_upload_fn for vk_stream_dst targets, copies ride the next frame's transfer submit;
+ * when the staging ring is full the rest waits for a later pump rather than for the gpu
+ */
+uint64_t vk_stream_upload(void *user, const uint8_t *data, uint64_t offset, uint64_t len)
+{
+	vk_stream_dst				*dst;
+
+	dst = user;
+
+	return upload_try_buffer(&gpu_upload, dst->buf, dst->offset + offset, data, len);
+}
+
+void vk_read_frame(uint8_t *dest)
+{
+	VkCommandBufferAllocateInfo		cb_info;
+	VkCommandBufferBeginInfo		begin_info;
+	VkCommandBuffer				cmd_buf;
+	VkBufferImageCopy			region;
+	VkBufferMemoryBarrier			barrier;
+	VkSubmitInfo				submit_info;
+
+	if (!headless)
+		dbg_error("frame readback is only supported in headless mode");
+
+	if (frame_stats.frame_cnt == 0)
+		dbg_error("no frame has been rendered to read back");
+
+	vkDeviceWaitIdle(dev);
+
+	memset(&cb_info, '\0', sizeof(cb_info));
+
+	cb_info.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+	cb_info.commandPool = offscreen.cmd_pool;
+	cb_info.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+	cb_info.commandBufferCount = 1;
+
+	if (vkAllocateCommandBuffers(dev, &cb_info, &cmd_buf) != VK_SUCCESS)
+		dbg_error("failed to allocate readback command buffer");
+
+	memset(&begin_info, '\0', sizeof(begin_info));
+
+	begin_info.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+	begin_info.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+
+	vkBeginCommandBuffer(cmd_buf, &begin_info);
+
+	memset(&region, '\0', sizeof(region));
+
+	region.imageSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+	region.imageSubresource.layerCount = 1;
+	region.imageExtent.width = sc_settings.extent.width;
+	region.imageExtent.height = sc_settings.extent.height;
+	region.imageExtent.depth = 1;
+
+	vkCmdCopyImageToBuffer(cmd_buf, sc_imgs.imgs[offscreen.last_img], VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL,
+		offscreen.staging, 1, &region);
+
+	memset(&barrier, '\0', sizeof(barrier));
+
+	barrier.sType = VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER;
+	barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+	barrier.dstAccessMask = VK_ACCESS_HOST_READ_BIT;
+	barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+	barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+	barrier.buffer = offscreen.staging;
+	barrier.offset = 0;
+	barrier.size = VK_WHOLE_SIZE;
+
+	vkCmdPipelineBarrier(cmd_buf, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_HOST_BIT, 0,
+		0, NULL, 1, &barrier, 0, NULL);
+
+	vkEndCommandBuffer(cmd_buf);
+
+	memset(&submit_info, '\0', sizeof(submit_info));
+
+	submit_info.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+	submit_info.commandBufferCount = 1;
+	submit_info.pCommandBuffers = &cmd_buf;
+
+	if (vkQueueSubmit(queues.gfx, 1, &submit_info, VK_NULL_HANDLE) != VK_SUCCESS)
+		dbg_error("failed to submit readback");
+
+	vkQueueWaitIdle(queues.gfx);
+
+	memcpy(dest, offscreen.staging_map, (size_t)sc_settings.extent.width * sc_settings.extent.height * 4);
+
+	vkFreeCommandBuffers(dev, offscreen.cmd_pool, 1, &cmd_buf);
+}
+
+void vk_bench_upload(void)
+{
+	upload_bench(&gpu_upload);
+
+	dbg_info("%lu uploads in %lu batches, %lu stalls",
+		(unsigned long)gpu_upload.stats.upload_cnt,
+		(unsigned long)gpu_upload.stats.batch_cnt,
+		(unsigned long)gpu_upload.stats.stall_cnt);
+}
+
+static inline void use_mesh_layout(const mesh *m)
+{
+	vkDeviceWaitIdle(dev);
+	vkDestroyPipeline(dev, pipeline, NULL);
+
+	batch_vertex_input(&m->layout, vert_bindings, vert_attribs);
+
+	if (pipeline_build(dev, pipeline_cache, &pipeline_dsc, &pipeline) != VK_SUCCESS)
+		dbg_error("failed to rebuild pipeline for mesh layout");
+}
+
+/* draws a ~1m triangle grid in both vertex layouts; the pipeline is rebuilt around each */
+void vk_bench_mesh(uint32_t frames)
+{
+	mesh_data				md;
+	mesh					bench;
+	mat4					identity;
+	uint32_t				quants[2];
+	uint64_t				start_ns;
+	double					secs;
+
+	quants[0] = 0;
+	quants[1] = MESH_QUANT_ALL;
+
+	mat4_identity(&identity);
+
+	mesh_data_init(&md);
+	mesh_data_gen_grid(&md, VK_BENCH_GRID_CELLS);
+
+	for (uint32_t i = 0; i < ARRAY_SIZE(quants); i++) {
+		mesh_create(&bench, &gpu_alloc, &gpu_upload, &md, quants[i]);
+		use_mesh_layout(&bench);
+
+		start_ns = time_now_ns();
+
+		for (uint32_t frame = 0; frame < frames; frame++) {
+			batch_add(&batcher, &bench, 0, &identity);
+			vk_draw_frame();
+		}
+
+		vkDeviceWaitIdle(dev);
+
+		secs = (time_now_ns() - start_ns) / 1e9;
+
+		dbg_info("%s mesh: %u bytes/vertex, %.1f MB vertex data, %.3f ms/frame, %.1f Mtris/s",
+			quants[i] != 0 ? "quantized" : "float", bench.layout.stride,
+			(double)bench.vert_cnt * bench.layout.stride / (1024.0 * 1024.0), secs * 1e3 / frames,
+			(double)bench.idx_cnt / 3 * frames / secs / 1e6);
+
+		mesh_destroy(&bench, &gpu_alloc);
+	}
+
+	use_mesh_layout(&scene_mesh);
+
+	mesh_data_clean(&md);
+
+	memset(&frame_stats, '\0', sizeof(frame_stats));
+}
+
+/* the same instance set drawn with one vkCmdDrawIndexed per object, then as indirect batches */
+void vk_bench_instances(uint32_t instance_cnt, uint32_t frames)
+{
+	mat4					model;
+	bool					modes[2];
+	uint32_t				side;
+	uint64_t				start_ns, cpu_ns;
+	double					secs;
+
+	modes[0] = true;
+	modes[1] = false;
+	side = 1;
+
+	wait_scene();
+
+	while (side * side < instance_cnt)
+		side++;
+
+	for (uint32_t mode = 0; mode < ARRAY_SIZE(modes); mode++) {
+		batcher.direct = modes[mode];
+		batcher.stats.draw_calls = 0;
+
+		vkDeviceWaitIdle(dev);
+
+		cpu_ns = frame_stats.total_cpu_ns;
+		start_ns = time_now_ns();
+
+		for (uint32_t frame = 0; frame < frames; frame++) {
+			for (uint32_t i = 0; i < instance_cnt; i++) {
+				mat4_translate_scale(&model, (i % side + 0.5f) * 2.0f / side - 1.0f,
+					(i / side + 0.5f) * 2.0f / side - 1.0f, 0.0f, 1.0f / side);
+
+				vk_draw_instance(&model);
+			}
+
+			vk_draw_frame();
+		}
+
+		vkDeviceWaitIdle(dev);
+
+		secs = (time_now_ns() - start_ns) / 1e9;
+		cpu_ns = frame_stats.total_cpu_ns - cpu_ns;
+
+		dbg_info("%s: %u instances, %lu draw calls/frame, %.3f ms cpu/frame, %.3f ms/frame, %.1f M instances/s",
+			batcher.direct ? "per-object draws" : "indirect batches", instance_cnt,
+			(unsigned long)(batcher.stats.draw_calls / frames), cpu_ns / 1e6 / frames, secs * 1e3 / frames,
+			(double)instance_cnt * frames / secs / 1e6);
+	}
+
+	batcher.direct = false;
+
+	memset(&frame_stats, '\0', sizeof(frame_stats));
+}
+
+/*
+ * a grid of instances spanning twice the view in x and y, so about a quarter survive; run with
+ * the batcher's cpu cull, the gpu cull and the simd cull kernels at each size. cpu time covers
+ * the frame's cpu side plus, for the simd kernels, the cull and submission of the survivors
+ */
+void vk_bench_cull(uint32_t frames)
+{
+	mat4					model, saved_view_proj;
+	frustum					view;
+	cull_set				set;
+	uint32_t				counts[3], side, instance_cnt, visible;
+	batch_cull_mode				saved_cull;
+	uint64_t				start_ns, cpu_ns, cull_ns;
+	double					secs, step;
+	char					*names[3];
+
+	counts[0] = 10 * 1000;
+	counts[1] = 100 * 1000;
+	counts[2] = 1000 * 1000;
+
+	names[0] = "cpu";
+	names[1] = "gpu";
+	names[2] = "simd";
+
+	wait_scene();
+
+	saved_cull = batcher.cull;
+	saved_view_proj = view_proj;
+
+	mat4_identity(&view_proj);
+	frustum_from_mat4(&view, &view_proj);
+
+	cull_set_init(&set);
+
+	for (uint32_t i = 0; i < ARRAY_SIZE(counts); i++) {
+		instance_cnt = counts[i];
+
+		if (instance_cnt > batcher.max_instances) {
+			dbg_warn("skipping %u instance cull bench, batcher holds %u", instance_cnt, batcher.max_instances);
+
+			continue;
+		}
+
+		side = 1;
+
+		while (side * side < instance_cnt)
+			side++;
+
+		step = 2.0 * VK_BENCH_CULL_SPAN / side;
+
+		cull_set_clear(&set);
+
+		for (uint32_t j = 0; j < instance_cnt; j++) {
+			mat4_translate_scale(&model, (j % side + 0.5f) * step - VK_BENCH_CULL_SPAN,
+				(j / side + 0.5f) * step - VK_BENCH_CULL_SPAN, 0.5f, 0.5f * step);
+
+			cull_set_add(&set, &model, scene_mesh.aabb);
+		}
+
+		for (uint32_t mode = 0; mode < ARRAY_SIZE(names); mode++) {
+			if (mode == 1 && cull_pipeline == VK_NULL_HANDLE)
+				continue;
+
+			batcher.cull = mode == 0 ? BATCH_CULL_CPU : mode == 1 ? BATCH_CULL_GPU : BATCH_CULL_NONE;
+			batcher.stats.culled = 0;
+			visible = 0;
+			cull_ns = 0;
+
+			vkDeviceWaitIdle(dev);
+
+			cpu_ns = frame_stats.total_cpu_ns;
+			start_ns = time_now_ns();
+
+			for (uint32_t frame = 0; frame < frames; frame++) {
+				if (mode == 2) {
+					cull_ns -= time_now_ns();
+
+					visible = cull_run(&set, &view);
+					vk_draw_visible(&set);
+
+					cull_ns += time_now_ns();
+				} else {
+					for (uint32_t j = 0; j < instance_cnt; j++) {
+						cull_set_model(&set, j, &model);
+						vk_draw_instance(&model);
+					}
+				}
+
+				vk_draw_frame();
+			}
+
+			vkDeviceWaitIdle(dev);
+
+			secs = (time_now_ns() - start_ns) / 1e9;
+			cpu_ns = frame_stats.total_cpu_ns - cpu_ns + cull_ns;
+
+			if (mode == 0)
+				visible = instance_cnt - batcher.stats.culled / frames;
+
+			dbg_info("%s culling (%s): %u instances, %.3f ms cpu/frame, %.3f ms/frame",
+				names[mode], mode == 2 ? cull_isa_name(cull_get_isa()) : "batcher", instance_cnt,
+				cpu_ns / 1e6 / frames, secs * 1e3 / frames);
+
+			if (mode != 1)
+				dbg_info("kept %u of %u instances per frame", visible, instance_cnt);
+		}
+	}
+
+	cull_set_clean(&set);
+
+	batcher.cull = saved_cull;
+	view_proj = saved_view_proj;
+
+	memset(&frame_stats, '\0', sizeof(frame_stats));
+}
+
+/* the same per-object draw list recorded with 1 to N recorders, 1 being inline in the primary */
+void vk_bench_record(uint32_t frames)
+{
+	mat4					model;
+	uint32_t				side, saved_recorders;
+	uint64_t				record_ns, base_ns, cpu_ns;
+
+	if (VK_BENCH_RECORD_DRAWS > batcher.max_instances) {
+		dbg_warn("skipping recording bench, batcher holds %u instances", batcher.max_instances);
+
+		return;
+	}
+
+	wait_scene();
+
+	side = 1;
+
+	while (side * side < VK_BENCH_RECORD_DRAWS)
+		side++;
+
+	saved_recorders = recorders;
+	base_ns = 0;
+	batcher.direct = true;
+
+	for (uint32_t n = 1; n <= recorder_cnt; n = n < recorder_cnt && n * 2 > recorder_cnt ? recorder_cnt : n * 2) {
+		recorders = n;
+
+		vkDeviceWaitIdle(dev);
+
+		record_ns = frame_stats.total_record_ns;
+		cpu_ns = frame_stats.total_cpu_ns;
+
+		for (uint32_t frame = 0; frame < frames; frame++) {
+			for (uint32_t i = 0; i < VK_BENCH_RECORD_DRAWS; i++) {
+				mat4_translate_scale(&model, (i % side + 0.5f) * 2.0f / side - 1.0f,
+					(i / side + 0.5f) * 2.0f / side - 1.0f, 0.0f, 1.0f / side);
+
+				vk_draw_instance(&model);
+			}
+
+			vk_draw_frame();
+		}
+
+		record_ns = frame_stats.total_record_ns - record_ns;
+		cpu_ns = frame_stats.total_cpu_ns - cpu_ns;
+
+		if (n == 1)
+			base_ns = record_ns;
+
+		dbg_info("%u recorders: %u draws, %.3f ms recording/frame (%.2fx), %.3f ms cpu/frame", n,
+			VK_BENCH_RECORD_DRAWS, record_ns / 1e6 / frames, (double)base_ns / record_ns, cpu_ns / 1e6 / frames);
+
+		if (n == recorder_cnt)
+			break;
+	}
+
+	batcher.direct = false;
+	recorders = saved_recorders;
+
+	memset(&frame_stats, '\0', sizeof(frame_stats));
+}
+
+/* flips the window between two sizes, drawing until each new swap chain has presented a frame */
+void vk_bench_resize(uint32_t resizes)
+{
+	uint32_t				width, height, frames;
+	uint64_t				resize_cnt;
+
+	if (headless) {
+		dbg_warn("skipping resize bench, there is no window to resize");
+
+		return;
+	}
+
+	width = sc_settings.extent.width;
+	height = sc_settings.extent.height;
+
+	vkDeviceWaitIdle(dev);
+	memset(&frame_stats, '\0', sizeof(frame_stats));
+
+	for (uint32_t i = 0; i < resizes; i++) {
+		resize_cnt = frame_stats.resize_cnt;
+
+		/* timed from the request, so the window system's share of the latency is included */
+		resize_start_ns = time_now_ns();
+
+		glfwSetWindowSize(wnd, i % 2 ? width : width * 3 / 4, i % 2 ? height : height * 3 / 4);
+
+		for (frames = 0; frame_stats.resize_cnt == resize_cnt && frames < VK_BENCH_RESIZE_MAX_FRAMES; frames++) {
+			glfwPollEvents();
+			vk_draw_frame();
+		}
+
+		if (frames == VK_BENCH_RESIZE_MAX_FRAMES)
+			dbg_warn("window did not resize within %u frames", VK_BENCH_RESIZE_MAX_FRAMES);
+	}
+
+	if (frame_stats.resize_cnt > 0)
+		dbg_info("%lu resizes: avg resize to first frame %.2f ms, max %.2f ms, avg swap chain recreation %.2f ms",
+			(unsigned long)frame_stats.resize_cnt,
+			frame_stats.total_resize_ns / 1e6 / frame_stats.resize_cnt,
+			frame_stats.max_resize_ns / 1e6,
+			frame_stats.total_recreate_ns / 1e6 / frame_stats.recreate_cnt);
+
+	resize_start_ns = 0;
+
+	memset(&frame_stats, '\0', sizeof(frame_stats));
+}
+
+/* a counting pattern, so the bytes are not all alike; the loose file is reused by later runs */
+static inline void write_stream_bench_asset(void)
+{
+	uint32_t				*words;
+	FILE					*fp;
+
+	words = mem_alloc(VK_BENCH_STREAM_ASSET_SIZE);
+
+	if (words == NULL)
+		dbg_error("failed to allocate stream bench asset");
+
+	for (uint32_t i = 0; i < VK_BENCH_STREAM_ASSET_SIZE / sizeof(uint32_t); i++)
+		words[i] = i * 2654435761u;
+
+	fp = fopen(VK_BENCH_STREAM_PATH, "wb");
+
+	if (fp == NULL || fwrite(words, 1, VK_BENCH_STREAM_ASSET_SIZE, fp) != VK_BENCH_STREAM_ASSET_SIZE)
+		dbg_error("could not write %s", VK_BENCH_STREAM_PATH);
+
+	fclose(fp);
+	mem_free(words);
+}
+
+/*
+ * streams the bench asset into VK_BENCH_STREAM_TARGETS slots of a device local buffer, through
+ * the io threads, the decode pool and the staging ring, while frames render; the frames are
+ * compared against idle ones and uploads deferred for lack of staging room are counted
+ */
+void vk_bench_stream(void)
+{
+	VkBufferCreateInfo			buf_info;
+	VkBuffer				dst;
+	ga_allocation				dst_alloc;
+	vk_stream_dst				targets[VK_BENCH_STREAM_TARGETS];
+	stream_handle				handles[VK_BENCH_STREAM_TARGETS];
+	stream_desc				desc;
+	stream_stats				before, after;
+	asset_loc				loc;
+	uint32_t				fams[2], frames;
+	uint64_t				start_ns, frame_ns, pump_ns, max_pump_ns, defers;
+	uint64_t				idle_ns, max_idle_ns, busy_ns, max_busy_ns;
+	double					secs;
+
+	if (stream_sys == NULL) {
+		dbg_warn("skipping stream bench, there is no streamer");
+
+		return;
+	}
+
+	wait_scene();
+
+	if (!asset_locate(&loc, VK_BENCH_STREAM_ASSET) || loc.raw_len != VK_BENCH_STREAM_ASSET_SIZE)
+		write_stream_bench_asset();
+
+	memset(&buf_info, '\0', sizeof(buf_info));
+
+	buf_info.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
+	buf_info.size = VK_BENCH_STREAM_TARGETS * VK_BENCH_STREAM_ASSET_SIZE;
+	buf_info.usage = VK_BUFFER_USAGE_TRANSFER_DST_BIT;
+	buf_info.queueFamilyIndexCount = upload_queue_fams(&gpu_upload, fams);
+	buf_info.pQueueFamilyIndices = fams;
+	buf_info.sharingMode = buf_info.queueFamilyIndexCount > 1 ? VK_SHARING_MODE_CONCURRENT : VK_SHARING_MODE_EXCLUSIVE;
+
+	ga_create_buffer(&gpu_alloc, &buf_info, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, 0, &dst, &dst_alloc);
+
+	idle_ns = 0;
+	max_idle_ns = 0;
+
+	for (uint32_t i = 0; i < VK_BENCH_STREAM_IDLE_FRAMES; i++) {
+		frame_ns = time_now_ns();
+
+		vk_draw_frame();
+
+		frame_ns = time_now_ns() - frame_ns;
+		idle_ns += frame_ns;
+		max_idle_ns = frame_ns > max_idle_ns ? frame_ns : max_idle_ns;
+	}
+
+	stream_get_stats(stream_sys, &before);
+	defers = gpu_upload.stats.defer_cnt;
+	start_ns = time_now_ns();
+
+	for (uint32_t i = 0; i < VK_BENCH_STREAM_TARGETS; i++) {
+		targets[i].buf = dst;
+		targets[i].offset = (VkDeviceSize)i * VK_BENCH_STREAM_ASSET_SIZE;
+
+		desc = (stream_desc){
+			VK_BENCH_STREAM_ASSET,
+			STREAM_PRIO_NORMAL,
+			vk_stream_upload,
+			&targets[i]
+		};
+
+		handles[i] = stream_request(stream_sys, &desc);
+	}
+
+	busy_ns = 0;
+	max_busy_ns = 0;
+	max_pump_ns = 0;
+
+	for (frames = 0; stream_pending(stream_sys) > 0 && frames < VK_BENCH_STREAM_MAX_FRAMES; frames++) {
+		frame_ns = time_now_ns();
+
+		stream_pump(stream_sys, STREAM_FRAME_UPLOAD_BUDGET);
+
+		pump_ns = time_now_ns() - frame_ns;
+
+		vk_draw_frame();
+
+		frame_ns = time_now_ns() - frame_ns;
+		busy_ns += frame_ns;
+		max_busy_ns = frame_ns > max_busy_ns ? frame_ns : max_busy_ns;
+		max_pump_ns = pump_ns > max_pump_ns ? pump_ns : max_pump_ns;
+	}
+
+	vkDeviceWaitIdle(dev);
+
+	secs = (time_now_ns() - start_ns) / 1e9;
+
+	stream_get_stats(stream_sys, &after);
+
+	for (uint32_t i = 0; i < VK_BENCH_STREAM_TARGETS; i++)
+		stream_release(stream_sys, handles[i]);
+
+	if (frames == VK_BENCH_STREAM_MAX_FRAMES)
+		dbg_warn("stream bench did not finish within %u frames", VK_BENCH_STREAM_MAX_FRAMES);
+
+	dbg_info("streamed %.1f MB to the gpu in %u frames, %.1f MB/s, %lu failed, %lu uploads deferred for staging room",
+		(after.bytes_uploaded - before.bytes_uploaded) / 1e6, frames,
+		(after.bytes_uploaded - before.bytes_uploaded) / 1e6 / secs, (unsigned long)(after.failed - before.failed),
+		(unsigned long)(gpu_upload.stats.defer_cnt - defers));
+
+	if (frames > 0)
+		dbg_info("frame time idle avg %.3f ms, max %.3f ms; streaming avg %.3f ms, max %.3f ms, pump max %.3f ms",
+			idle_ns / 1e6 / VK_BENCH_STREAM_IDLE_FRAMES, max_idle_ns / 1e6, busy_ns / 1e6 / frames,
+			max_busy_ns / 1e6, max_pump_ns / 1e6);
+
+	vkDestroyBuffer(dev, dst, NULL);
+	ga_free(&gpu_alloc, &dst_alloc);
+
+	memset(&frame_stats, '\0', sizeof(frame_stats));
+}
+
+static inline VkPipelineCache create_empty_cache(void)
+{
+	VkPipelineCacheCreateInfo		cache_info;
+	VkPipelineCache				cache;
+
+	memset(&cache_info, '\0', sizeof(cache_info));
+
+	cache_info.sType = VK_STRUCTURE_TYPE_PIPELINE_CACHE_CREATE_INFO;
+
+	if (vkCreatePipelineCache(dev, &cache_info, NULL, &cache) != VK_SUCCESS)
+		dbg_error("failed to create bench pipeline cache");
+
+	return cache;
+}
+
+/* builds every desc on a fresh service, returns the wall time from submit to merged caches */
+static inline uint64_t compile_pipelines(const pipeline_desc *descs, uint32_t threads, VkPipelineCache cache,
+	uint64_t *build_ns)
+{
+	pipeline_service			svc;
+	pipeline_future				futs[VK_BENCH_PIPELINE_VARIANTS];
+	uint64_t				start_ns, wall_ns;
+
+	psvc_init(&svc, dev, cache, threads);
+
+	start_ns = time_now_ns();
+
+	psvc_submit(&svc, descs, VK_BENCH_PIPELINE_VARIANTS, futs);
+
+	for (uint32_t i = 0; i < VK_BENCH_PIPELINE_VARIANTS; i++)
+		pfut_wait(&futs[i]);
+
+	psvc_finish(&svc);
+
+	wall_ns = time_now_ns() - start_ns;
+	*build_ns = 0;
+
+	for (uint32_t i = 0; i < VK_BENCH_PIPELINE_VARIANTS; i++) {
+		*build_ns += futs[i].build_ns;
+
+		vkDestroyPipeline(dev, futs[i].pipeline, NULL);
+	}
+
+	psvc_clean(&svc);
+
+	return wall_ns;
+}
+
+/*
+ * 8 vertex layouts x 2 topologies x 2 cull modes x 2 windings, built with 1 and then N threads, each on an empty
+ * cache and again on the cache it filled; mesa keeps its own disk cache, MESA_SHADER_CACHE_DISABLE=true keeps
+ * the cold runs cold across processes
+ */
+void vk_bench_pipelines(void)
+{
+	pipeline_desc				descs[VK_BENCH_PIPELINE_VARIANTS];
+	mesh_layout				layouts[MESH_QUANT_ALL + 1];
+	VkVertexInputBindingDescription		bindings[MESH_QUANT_ALL + 1][2];
+	VkVertexInputAttributeDescription	attribs[MESH_QUANT_ALL + 1][MESH_ATTRIB_CNT + BATCH_ATTRIB_CNT];
+	VkPipelineCache				cache;
+	uint32_t				threads[2], attrib_cnt, q;
+	uint64_t				cold_ns, warm_ns, build_ns, base_ns;
+
+	for (q = 0; q <= MESH_QUANT_ALL; q++)
+		mesh_layout_init(&layouts[q], q);
+
+	for (uint32_t i = 0; i < VK_BENCH_PIPELINE_VARIANTS; i++) {
+		q = i % (MESH_QUANT_ALL + 1);
+		attrib_cnt = batch_vertex_input(&layouts[q], bindings[q], attribs[q]);
+
+		descs[i] = pipeline_dsc;
+		descs[i].bindings = bindings[q];
+		descs[i].binding_cnt = ARRAY_SIZE(bindings[q]);
+		descs[i].attribs = attribs[q];
+		descs[i].attrib_cnt = attrib_cnt;
+		descs[i].topology = (i >> 3) & 1 ? VK_PRIMITIVE_TOPOLOGY_TRIANGLE_STRIP :
+			VK_PRIMITIVE_TOPOLOGY_TRIANGLE_LIST;
+		descs[i].cull_mode = (i >> 4) & 1 ? VK_CULL_MODE_NONE : VK_CULL_MODE_BACK_BIT;
+		descs[i].front_face = (i >> 5) & 1 ? VK_FRONT_FACE_COUNTER_CLOCKWISE : VK_FRONT_FACE_CLOCKWISE;
+	}
+
+	threads[0] = 1;
+	threads[1] = tpool_core_cnt();
+	base_ns = 0;
+
+	for (uint32_t i = 0; i < ARRAY_SIZE(threads); i++) {
+		cache = create_empty_cache();
+
+		cold_ns = compile_pipelines(descs, threads[i], cache, &build_ns);
+
+		if (i == 0)
+			base_ns = cold_ns;
+
+		dbg_info("%u threads cold: %u pipelines in %.3f ms (%.2fx), %.3f ms per pipeline", threads[i],
+			VK_BENCH_PIPELINE_VARIANTS, cold_ns / 1e6, (double)base_ns / cold_ns,
+			build_ns / 1e6 / VK_BENCH_PIPELINE_VARIANTS);
+
+		warm_ns = compile_pipelines(descs, threads[i], cache, &build_ns);
+
+		dbg_info("%u threads warm: %u pipelines in %.3f ms (%.2fx), %.3f ms per pipeline", threads[i],
+			VK_BENCH_PIPELINE_VARIANTS, warm_ns / 1e6, (double)base_ns / warm_ns,
+			build_ns / 1e6 / VK_BENCH_PIPELINE_VARIANTS);
+
+		vkDestroyPipelineCache(dev, cache, NULL);
+	}
+}
+
+/* draws are dropped until the scene has streamed in */
+void vk_draw_instance(const mat4 *model)
+{
+	if (scene_ready)
+		batch_add(&batcher, &scene_mesh, 0, model);
+}
+
+/* submits the survivors of the last cull_run on the set */
+void vk_draw_visible(const cull_set *set)
+{
+	mat4					model;
+
+	if (!scene_ready)
+		return;
+
+	for (uint32_t i = 0; i < set->visible.size; i++) {
+		cull_set_model(set, set->visible.elems[i], &model);
+		batch_add(&batcher, &scene_mesh, 0, &model);
+	}
+}
+
+void vk_set_view_proj(const mat4 *vp)
+{
+	view_proj = *vp;
+}
+
+const vk_frame_stats *vk_get_frame_stats(void)
+{
+	return &frame_stats;
+}
+
+void vk_clean(void)
+{
+	ga_stats				mem_stats;
+
+	vkDeviceWaitIdle(dev);
+
+	if (frame_stats.frame_cnt > 0)
+		dbg_info("%lu frames, avg cpu frame time %.3f ms, avg fence wait %.3f ms, avg recording %.3f ms",
+			(unsigned long)frame_stats.frame_cnt,
+			frame_stats.total_cpu_ns / 1e6 / frame_stats.frame_cnt,
+			frame_stats.total_fence_wait_ns / 1e6 / frame_stats.frame_cnt,
+			frame_stats.total_record_ns / 1e6 / frame_stats.frame_cnt);
+
+	if (frame_stats.resize_cnt > 0)
+		dbg_info("%lu resizes, avg resize to first frame %.2f ms, max %.2f ms, avg swap chain recreation %.2f ms",
+			(unsigned long)frame_stats.resize_cnt,
+			frame_stats.total_resize_ns / 1e6 / frame_stats.resize_cnt,
+			frame_stats.max_resize_ns / 1e6,
+			frame_stats.total_recreate_ns / 1e6 / frame_stats.recreate_cnt);
+
+	if (frame_stats.heap_frame_cnt > 0)
+		dbg_info("steady state heap calls per frame: avg %.2f, max %lu over %lu frames",
+			(double)frame_stats.total_heap_calls / frame_stats.heap_frame_cnt,
+			(unsigned long)frame_stats.max_heap_calls, (unsigned long)frame_stats.heap_frame_cnt);
+
+	gpu_prof_clean(&gpu_prof);
+
+	for (uint32_t i = 0; i < frame_cnt; i++) {
+		vkDestroyCommandPool(dev, frames[i].cmd_pool, NULL);
+
+		for (uint32_t j = 0; j < recorder_cnt; j++)
+			vkDestroyCommandPool(dev, frames[i].rec_pools[j], NULL);
+
+		vkDestroySemaphore(dev, frames[i].img_avail, NULL);
+		vkDestroyFence(dev, frames[i].in_flight, NULL);
+	}
+
+	psvc_clean(&pipeline_svc);
+	pcache_save(dev, pipeline_cache, VK_PIPELINE_CACHE_PATH);
+
+	vkDestroyPipeline(dev, pipeline, NULL);
+	vkDestroyPipeline(dev, cull_pipeline, NULL);
+	vkDestroyPipelineCache(dev, pipeline_cache, NULL);
+	vkDestroyPipelineLayout(dev, pipeline_layout, NULL);
+	vkDestroyPipelineLayout(dev, cull_pipeline_layout, NULL);
+	vkDestroyRenderPass(dev, render_pass, NULL);
+
+	vkDestroyShaderModule(dev, shader_mods.vert, NULL);
+	vkDestroyShaderModule(dev, shader_mods.frag, NULL);
+	vkDestroyShaderModule(dev, shader_mods.cull, NULL);
+
+	destroy_swap_chain_objs();
+
+	batch_clean(&batcher);
+	mesh_destroy(&scene_mesh, &gpu_alloc);
+	upload_clean(&gpu_upload);
+
+	ga_get_stats(&gpu_alloc, &mem_stats);
+
+	if (mem_stats.total_alloc_calls > 0)
+		dbg_info("%lu gpu allocations, avg alloc time %.1f ns, %lu blocks left",
+			(unsigned long)mem_stats.total_alloc_calls,
+			(double)mem_stats.total_alloc_ns / mem_stats.total_alloc_calls,
+			(unsigned long)mem_stats.block_cnt);
+
+	ga_clean(&gpu_alloc);
+
+	vkDestroyDevice(dev, NULL);
+
+	if (!headless)
+		vkDestroySurfaceKHR(inst, surface, NULL);
+
+	vkDestroyInstance(inst, NULL);
+
+	if (!headless) {
+		glfwDestroyWindow(wnd);
+		glfwTerminate();
+	}
 
-	glfwDestroyWindow(wnd);
-	glfwTerminate();
+	arena_clean(&vk_arena);
 
 	dbg_log("cleaned vulkan successfully");
 }
\ No newline at end of file
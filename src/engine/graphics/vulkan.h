@@ -4,6 +4,18 @@
 #include "../../util/debug.h"
 #include "../../util/util.h"
 #include "../../util/dynarr.h"
+#include "../../util/arena.h"
+#include "../../util/job.h"
+#include "../assets.h"
+#include "../cull.h"
+#include "../stream.h"
+#include "pipeline_cache.h"
+#include "pipeline.h"
+#include "gpu_alloc.h"
+#include "upload.h"
+#include "mesh.h"
+#include "batch.h"
+#include "gpu_prof.h"
 
 #include <GL/gl.h>
 #include <GL/freeglut.h>
@@ -17,7 +29,98 @@
 #include <stdbool.h>
 #include <string.h>
 
-void vk_init(void);
+#define VK_DEFAULT_FRAMES_IN_FLIGHT		2
+#define VK_MAX_FRAMES_IN_FLIGHT			4
+#define VK_DEFAULT_MAX_INSTANCES		(128 * 1024)
+#define VK_BENCH_CULL_MAX_INSTANCES		(1000 * 1000)
+#define VK_MAX_RECORDERS			16
+#define VK_PARALLEL_RECORD_MIN_DRAWS		1024
+#define VK_BENCH_RECORD_DRAWS			(50 * 1000)
+#define VK_BENCH_RESIZE_MAX_FRAMES		120
+#define VK_HEAP_WARMUP_FRAMES			8
+#define VK_BENCH_STREAM_ASSET			"stream_bench.bin"
+#define VK_BENCH_STREAM_PATH			"build/" VK_BENCH_STREAM_ASSET
+#define VK_BENCH_STREAM_ASSET_SIZE		(4ull * 1024 * 1024)
+#define VK_BENCH_STREAM_TARGETS			32
+#define VK_BENCH_STREAM_IDLE_FRAMES		120
+#define VK_BENCH_STREAM_MAX_FRAMES		10000
+#define VK_BENCH_PIPELINE_VARIANTS		64
+
+/* mailbox is the old default; low latency also takes immediate, vsync always takes fifo */
+typedef enum {
+	VK_PRESENT_PREF_MAILBOX,
+	VK_PRESENT_PREF_LOW_LATENCY,
+	VK_PRESENT_PREF_VSYNC,
+} vk_present_pref;
+
+typedef struct {
+	uint32_t frames_in_flight;
+	uint32_t width;
+	uint32_t height;
+	uint32_t max_instances;
+	bool headless;
+	bool gpu_stats;
+	vk_present_pref present_pref;
+	job_system *jobs;
+	streamer *stream;
+} vk_config;
+
+typedef struct {
+	uint64_t cpu_ns;
+	uint64_t fence_wait_ns;
+	uint64_t record_ns;
+	uint64_t total_cpu_ns;
+	uint64_t total_fence_wait_ns;
+	uint64_t total_record_ns;
+	uint64_t frame_cnt;
+	uint64_t resize_cnt;
+	uint64_t total_resize_ns;
+	uint64_t max_resize_ns;
+	uint64_t recreate_cnt;
+	uint64_t total_recreate_ns;
+	uint64_t heap_calls;
+	uint64_t max_heap_calls;
+	uint64_t total_heap_calls;
+	uint64_t heap_frame_cnt;
+} vk_frame_stats;
+
+/* where a streamed asset lands; must outlive the stream request that points at it */
+typedef struct {
+	VkBuffer buf;
+	VkDeviceSize offset;
+} vk_stream_dst;
+
+void vk_init(const vk_config *cfg);
+
+void vk_draw_frame(void);
+
+void vk_bench_upload(void);
+
+void vk_bench_mesh(uint32_t frames);
+
+void vk_bench_instances(uint32_t instance_cnt, uint32_t frames);
+
+void vk_bench_cull(uint32_t frames);
+
+void vk_bench_record(uint32_t frames);
+
+void vk_bench_resize(uint32_t resizes);
+
+void vk_bench_stream(void);
+
+void vk_bench_pipelines(void);
+
+void vk_draw_instance(const mat4 *model);
+
+void vk_draw_visible(const cull_set *set);
+
+void vk_set_view_proj(const mat4 *vp);
+
+const vk_frame_stats *vk_get_frame_stats(void);
+
+void vk_read_frame(uint8_t *dest);
+
+uint64_t vk_stream_upload(void *user, const uint8_t *data, uint64_t offset, uint64_t len);
 
 void vk_clean(void);
 
@@ -0,0 +1,532 @@
+#include "mesh_opt.h"
+#include "../util/arena.h"
+
+#include <string.h>
+#include <math.h>
+
+#define MOPT_EMPTY				UINT32_MAX
+
+typedef struct {
+	uint32_t start;
+	uint32_t cnt;
+	float key;
+} mopt_cluster;
+
+DYNARR_DEFINE(mopt_cluster_list, mopt_cluster)
+
+/* triangles touching each vertex, in compressed rows */
+typedef struct {
+	uint32_t *offsets;
+	uint32_t *tris;
+} mopt_adjacency;
+
+static inline void *mopt_alloc(size_t size)
+{
+	void					*ptr;
+
+	ptr = mem_alloc(size > 0 ? size : 1);
+
+	if (ptr == NULL)
+		dbg_error("failed to allocate mesh optimizer scratch");
+
+	return ptr;
+}
+
+static inline const float *mopt_pos(const float *pos, size_t pos_stride, uint32_t v)
+{
+	return (const float *)((const uint8_t *)pos + (size_t)v * pos_stride);
+}
+
+static inline void build_adjacency(mopt_adjacency *adj, const uint32_t *inds, uint32_t idx_cnt, uint32_t vert_cnt)
+{
+	uint32_t				*fill;
+
+	adj->offsets = mopt_alloc((vert_cnt + 1) * sizeof(uint32_t));
+	adj->tris = mopt_alloc(idx_cnt * sizeof(uint32_t));
+	fill = mopt_alloc(vert_cnt * sizeof(uint32_t));
+
+	memset(adj->offsets, '\0', (vert_cnt + 1) * sizeof(uint32_t));
+
+	for (uint32_t i = 0; i < idx_cnt; i++)
+		adj->offsets[inds[i] + 1]++;
+
+	for (uint32_t v = 0; v < vert_cnt; v++)
+		adj->offsets[v + 1] += adj->offsets[v];
+
+	memcpy(fill, adj->offsets, vert_cnt * sizeof(uint32_t));
+
+	for (uint32_t i = 0; i < idx_cnt; i++)
+		adj->tris[fill[inds[i]]++] = i / 3;
+
+	mem_free(fill);
+}
+
+static inline void clean_adjacency(mopt_adjacency *adj)
+{
+	mem_free(adj->offsets);
+	mem_free(adj->tris);
+}
+
+uint32_t mopt_dedup(void *verts, size_t stride, uint32_t vert_cnt, uint32_t *inds, uint32_t idx_cnt)
+{
+	uint8_t					*bytes;
+	uint32_t				*table, *remap;
+	uint32_t				cap, slot, unique;
+
+	bytes = verts;
+
+	for (cap = 16; cap < vert_cnt * 2; cap *= 2)
+		;
+
+	table = mopt_alloc(cap * sizeof(uint32_t));
+	remap = mopt_alloc(vert_cnt * sizeof(uint32_t));
+
+	memset(table, 0xff, cap * sizeof(uint32_t));
+
+	unique = 0;
+
+	for (uint32_t v = 0; v < vert_cnt; v++) {
+		slot = (uint32_t)hash_fnv1a(bytes + v * stride, stride) & (cap - 1);
+
+		while (table[slot] != MOPT_EMPTY && memcmp(bytes + table[slot] * stride, bytes + v * stride, stride) != 0)
+			slot = (slot + 1) & (cap - 1);
+
+		if (table[slot] == MOPT_EMPTY) {
+			/* compacting in place is safe since unique never passes v */
+			if (unique != v)
+				memcpy(bytes + unique * stride, bytes + v * stride, stride);
+
+			table[slot] = unique++;
+		}
+
+		remap[v] = table[slot];
+	}
+
+	for (uint32_t i = 0; i < idx_cnt; i++)
+		inds[i] = remap[inds[i]];
+
+	mem_free(table);
+	mem_free(remap);
+
+	return unique;
+}
+
+static inline uint32_t skip_dead_end(const uint32_t *live, mopt_u32_list *dead_ends, uint32_t *cursor, uint32_t vert_cnt)
+{
+	uint32_t				v;
+
+	while (dead_ends->size > 0) {
+		v = mopt_u32_list_pop(dead_ends);
+
+		if (live[v] > 0)
+			return v;
+	}
+
+	while (*cursor < vert_cnt) {
+		v = (*cursor)++;
+
+		if (live[v] > 0)
+			return v;
+	}
+
+	return MOPT_EMPTY;
+}
+
+/* tipsify, sander et al. 2007: fan around the vertex that will stay in cache the longest */
+void mopt_tipsify(uint32_t *inds, uint32_t idx_cnt, uint32_t vert_cnt, uint32_t cache_size)
+{
+	mopt_adjacency				adj;
+	mopt_u32_list				dead_ends, candidates;
+	uint32_t				*live, *stamps, *out;
+	uint8_t					*emitted;
+	uint32_t				fan, cursor, time, out_cnt, tri, v, best;
+	int64_t					best_prio, prio;
+
+	if (idx_cnt == 0)
+		return;
+
+	build_adjacency(&adj, inds, idx_cnt, vert_cnt);
+
+	live = mopt_alloc(vert_cnt * sizeof(uint32_t));
+	stamps = mopt_alloc(vert_cnt * sizeof(uint32_t));
+	emitted = mopt_alloc(idx_cnt / 3);
+	out = mopt_alloc(idx_cnt * sizeof(uint32_t));
+
+	for (v = 0; v < vert_cnt; v++)
+		live[v] = adj.offsets[v + 1] - adj.offsets[v];
+
+	memset(stamps, '\0', vert_cnt * sizeof(uint32_t));
+	memset(emitted, '\0', idx_cnt / 3);
+
+	mopt_u32_list_init(&dead_ends);
+	mopt_u32_list_init(&candidates);
+
+	fan = 0;
+	cursor = 1;
+	time = cache_size + 1;
+	out_cnt = 0;
+
+	while (fan != MOPT_EMPTY) {
+		mopt_u32_list_clear(&candidates);
+
+		for (uint32_t i = adj.offsets[fan]; i < adj.offsets[fan + 1]; i++) {
+			tri = adj.tris[i];
+
+			if (emitted[tri])
+				continue;
+
+			for (uint32_t j = 0; j < 3; j++) {
+				v = inds[tri * 3 + j];
+				out[out_cnt++] = v;
+
+				mopt_u32_list_push(&dead_ends, v);
+				mopt_u32_list_push(&candidates, v);
+
+				live[v]--;
+
+				if (time - stamps[v] > cache_size)
+					stamps[v] = time++;
+			}
+
+			emitted[tri] = 1;
+		}
+
+		best = MOPT_EMPTY;
+		best_prio = -1;
+
+		/* prefer the oldest candidate whose remaining fan still fits before it is evicted */
+		for (uint32_t i = 0; i < candidates.size; i++) {
+			v = candidates.elems[i];
+
+			if (live[v] == 0)
+				continue;
+
+			prio = 0;
+
+			if ((int64_t)time - stamps[v] + 2 * (int64_t)live[v] <= (int64_t)cache_size)
+				prio = (int64_t)time - stamps[v];
+
+			if (prio > best_prio) {
+				best_prio = prio;
+				best = v;
+			}
+		}
+
+		fan = best != MOPT_EMPTY ? best : skip_dead_end(live, &dead_ends, &cursor, vert_cnt);
+	}
+
+	memcpy(inds, out, idx_cnt * sizeof(uint32_t));
+
+	mopt_u32_list_clean(&dead_ends);
+	mopt_u32_list_clean(&candidates);
+
+	mem_free(live);
+	mem_free(stamps);
+	mem_free(emitted);
+	mem_free(out);
+
+	clean_adjacency(&adj);
+}
+
+static inline void tri_geometry(const uint32_t *tri, const float *pos, size_t pos_stride, float *centroid, float *normal)
+{
+	const float				*a, *b, *c;
+	float					e0[3], e1[3];
+
+	a = mopt_pos(pos, pos_stride, tri[0]);
+	b = mopt_pos(pos, pos_stride, tri[1]);
+	c = mopt_pos(pos, pos_stride, tri[2]);
+
+	for (uint32_t j = 0; j < 3; j++) {
+		centroid[j] = (a[j] + b[j] + c[j]) / 3.0f;
+		e0[j] = b[j] - a[j];
+		e1[j] = c[j] - a[j];
+	}
+
+	/* unnormalized, so sums are area weighted */
+	normal[0] = e0[1] * e1[2] - e0[2] * e1[1];
+	normal[1] = e0[2] * e1[0] - e0[0] * e1[2];
+	normal[2] = e0[0] * e1[1] - e0[1] * e1[0];
+}
+
+static int cluster_cmp(const void *a, const void *b)
+{
+	const mopt_cluster			*ca, *cb;
+
+	ca = a;
+	cb = b;
+
+	return (ca->key < cb->key) - (ca->key > cb->key);
+}
+
+/*
+ * the linear-speed overdraw pass from the same paper: cut the cache-optimized order
+ * where the cache restarts anyway and draw outward-facing clusters first
+ */
+void mopt_overdraw(uint32_t *inds, uint32_t idx_cnt, const float *pos, size_t pos_stride, uint32_t cache_size)
+{
+	mopt_cluster_list			clusters;
+	mopt_cluster				cluster;
+	uint32_t				*stamps, *out;
+	uint32_t				vert_cnt, time, misses, out_cnt;
+	float					mesh_center[3], center[3], normal[3], tri_center[3], tri_normal[3];
+	float					area, total_area, cluster_area, len;
+
+	vert_cnt = 0;
+
+	for (uint32_t i = 0; i < idx_cnt; i++)
+		vert_cnt = inds[i] + 1 > vert_cnt ? inds[i] + 1 : vert_cnt;
+
+	stamps = mopt_alloc(vert_cnt * sizeof(uint32_t));
+	memset(stamps, '\0', vert_cnt * sizeof(uint32_t));
+
+	mopt_cluster_list_init(&clusters);
+
+	time = cache_size + 1;
+	cluster.start = 0;
+	cluster.key = 0.0f;
+
+	for (uint32_t i = 0; i < idx_cnt; i += 3) {
+		misses = 0;
+
+		for (uint32_t j = 0; j < 3; j++) {
+			if (time - stamps[inds[i + j]] > cache_size) {
+				stamps[inds[i + j]] = time++;
+				misses++;
+			}
+		}
+
+		if (misses == 3 && i > cluster.start) {
+			cluster.cnt = i - cluster.start;
+			mopt_cluster_list_push(&clusters, cluster);
+			cluster.start = i;
+		}
+	}
+
+	cluster.cnt = idx_cnt - cluster.start;
+	mopt_cluster_list_push(&clusters, cluster);
+
+	memset(mesh_center, '\0', sizeof(mesh_center));
+	total_area = 0.0f;
+
+	for (uint32_t i = 0; i < idx_cnt; i += 3) {
+		tri_geometry(inds + i, pos, pos_stride, tri_center, tri_normal);
+
+		area = sqrtf(tri_normal[0] * tri_normal[0] + tri_normal[1] * tri_normal[1] + tri_normal[2] * tri_normal[2]);
+		total_area += area;
+
+		for (uint32_t j = 0; j < 3; j++)
+			mesh_center[j] += tri_center[j] * area;
+	}
+
+	for (uint32_t j = 0; j < 3 && total_area > 0.0f; j++)
+		mesh_center[j] /= total_area;
+
+	for (uint32_t c = 0; c < clusters.size; c++) {
+		memset(center, '\0', sizeof(center));
+		memset(normal, '\0', sizeof(normal));
+		cluster_area = 0.0f;
+
+		for (uint32_t i = clusters.elems[c].start; i < clusters.elems[c].start + clusters.elems[c].cnt; i += 3) {
+			tri_geometry(inds + i, pos, pos_stride, tri_center, tri_normal);
+
+			area = sqrtf(tri_normal[0] * tri_normal[0] + tri_normal[1] * tri_normal[1] + tri_normal[2] * tri_normal[2]);
+			cluster_area += area;
+
+			for (uint32_t j = 0; j < 3; j++) {
+				center[j] += tri_center[j] * area;
+				normal[j] += tri_normal[j];
+			}
+		}
+
+		len = sqrtf(normal[0] * normal[0] + normal[1] * normal[1] + normal[2] * normal[2]);
+		clusters.elems[c].key = 0.0f;
+
+		if (cluster_area > 0.0f && len > 0.0f) {
+			for (uint32_t j = 0; j < 3; j++)
+				clusters.elems[c].key += (center[j] / cluster_area - mesh_center[j]) * normal[j] / len;
+		}
+	}
+
+	qsort(clusters.elems, clusters.size, sizeof(mopt_cluster), cluster_cmp);
+
+	out = mopt_alloc(idx_cnt * sizeof(uint32_t));
+	out_cnt = 0;
+
+	for (uint32_t c = 0; c < clusters.size; c++) {
+		memcpy(out + out_cnt, inds + clusters.elems[c].start, clusters.elems[c].cnt * sizeof(uint32_t));
+		out_cnt += clusters.elems[c].cnt;
+	}
+
+	memcpy(inds, out, idx_cnt * sizeof(uint32_t));
+
+	mopt_cluster_list_clean(&clusters);
+
+	mem_free(stamps);
+	mem_free(out);
+}
+
+uint32_t mopt_fetch(void *verts, size_t stride, uint32_t vert_cnt, uint32_t *inds, uint32_t idx_cnt)
+{
+	uint32_t				*remap, next;
+	uint8_t					*bytes, *sorted;
+
+	bytes = verts;
+	remap = mopt_alloc(vert_cnt * sizeof(uint32_t));
+
+	memset(remap, 0xff, vert_cnt * sizeof(uint32_t));
+
+	next = 0;
+
+	for (uint32_t i = 0; i < idx_cnt; i++) {
+		if (remap[inds[i]] == MOPT_EMPTY)
+			remap[inds[i]] = next++;
+
+		inds[i] = remap[inds[i]];
+	}
+
+	/* unreferenced vertices are dropped */
+	sorted = mopt_alloc(next * stride);
+
+	for (uint32_t v = 0; v < vert_cnt; v++) {
+		if (remap[v] != MOPT_EMPTY)
+			memcpy(sorted + remap[v] * stride, bytes + v * stride, stride);
+	}
+
+	memcpy(bytes, sorted, next * stride);
+
+	mem_free(sorted);
+	mem_free(remap);
+
+	return next;
+}
+
+void mopt_get_cache_stats(const uint32_t *inds, uint32_t idx_cnt, uint32_t vert_cnt, uint32_t cache_size,
+	mopt_cache_stats *stats)
+{
+	uint32_t				*stamps;
+	uint32_t				time, misses;
+
+	stamps = mopt_alloc(vert_cnt * sizeof(uint32_t));
+	memset(stamps, '\0', vert_cnt * sizeof(uint32_t));
+
+	time = cache_size + 1;
+	misses = 0;
+
+	for (uint32_t i = 0; i < idx_cnt; i++) {
+		if (time - stamps[inds[i]] > cache_size) {
+			stamps[inds[i]] = time++;
+			misses++;
+		}
+	}
+
+	stats->acmr = idx_cnt > 0 ? (float)misses / (idx_cnt / 3) : 0.0f;
+	stats->atvr = vert_cnt > 0 ? (float)misses / vert_cnt : 0.0f;
+
+	mem_free(stamps);
+}
+
+void mopt_meshlets_init(mopt_meshlets *ml)
+{
+	mopt_meshlet_list_init(&ml->meshlets);
+	mopt_u32_list_init(&ml->verts);
+	mopt_u8_list_init(&ml->tris);
+}
+
+void mopt_meshlets_clean(mopt_meshlets *ml)
+{
+	mopt_meshlet_list_clean(&ml->meshlets);
+	mopt_u32_list_clean(&ml->verts);
+	mopt_u8_list_clean(&ml->tris);
+}
+
+static inline void finish_meshlet(mopt_meshlets *ml, mopt_meshlet *m, uint32_t *local, const float *pos, size_t pos_stride)
+{
+	const float				*p;
+	float					lo[3], hi[3], d, dist;
+
+	for (uint32_t j = 0; j < 3; j++) {
+		lo[j] = INFINITY;
+		hi[j] = -INFINITY;
+	}
+
+	for (uint32_t i = m->vert_offset; i < m->vert_offset + m->vert_cnt; i++) {
+		p = mopt_pos(pos, pos_stride, ml->verts.elems[i]);
+
+		for (uint32_t j = 0; j < 3; j++) {
+			lo[j] = p[j] < lo[j] ? p[j] : lo[j];
+			hi[j] = p[j] > hi[j] ? p[j] : hi[j];
+		}
+
+		local[ml->verts.elems[i]] = MOPT_EMPTY;
+	}
+
+	for (uint32_t j = 0; j < 3; j++)
+		m->center[j] = (lo[j] + hi[j]) * 0.5f;
+
+	m->radius = 0.0f;
+
+	for (uint32_t i = m->vert_offset; i < m->vert_offset + m->vert_cnt; i++) {
+		p = mopt_pos(pos, pos_stride, ml->verts.elems[i]);
+		dist = 0.0f;
+
+		for (uint32_t j = 0; j < 3; j++) {
+			d = p[j] - m->center[j];
+			dist += d * d;
+		}
+
+		m->radius = dist > m->radius ? dist : m->radius;
+	}
+
+	m->radius = sqrtf(m->radius);
+
+	mopt_meshlet_list_push(&ml->meshlets, *m);
+}
+
+/* greedy in index order, so run it after tipsify to get compact meshlets */
+void mopt_build_meshlets(mopt_meshlets *ml, const uint32_t *inds, uint32_t idx_cnt, uint32_t vert_cnt, const float *pos,
+	size_t pos_stride)
+{
+	mopt_meshlet				m;
+	uint32_t				*local;
+	uint32_t				new_verts, v;
+
+	local = mopt_alloc(vert_cnt * sizeof(uint32_t));
+	memset(local, 0xff, vert_cnt * sizeof(uint32_t));
+
+	memset(&m, '\0', sizeof(m));
+
+	for (uint32_t i = 0; i + 2 < idx_cnt; i += 3) {
+		new_verts = 0;
+
+		for (uint32_t j = 0; j < 3; j++)
+			new_verts += local[inds[i + j]] == MOPT_EMPTY;
+
+		if (m.vert_cnt + new_verts > MOPT_MESHLET_MAX_VERTS || m.tri_cnt == MOPT_MESHLET_MAX_TRIS) {
+			finish_meshlet(ml, &m, local, pos, pos_stride);
+
+			m.vert_offset = ml->verts.size;
+			m.tri_offset = ml->tris.size;
+			m.vert_cnt = 0;
+			m.tri_cnt = 0;
+		}
+
+		for (uint32_t j = 0; j < 3; j++) {
+			v = inds[i + j];
+
+			if (local[v] == MOPT_EMPTY) {
+				local[v] = m.vert_cnt++;
+				mopt_u32_list_push(&ml->verts, v);
+			}
+
+			mopt_u8_list_push(&ml->tris, (uint8_t)local[v]);
+		}
+
+		m.tri_cnt++;
+	}
+
+	if (m.tri_cnt > 0)
+		finish_meshlet(ml, &m, local, pos, pos_stride);
+
+	mem_free(local);
+}
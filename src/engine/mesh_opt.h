@@ -0,0 +1,67 @@
+#ifndef MESH_OPT_H_INCLUDED
+#define MESH_OPT_H_INCLUDED
+
+#include "../util/debug.h"
+#include "../util/util.h"
+#include "../util/dynarr.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <stdbool.h>
+
+#define MOPT_CACHE_SIZE				16
+#define MOPT_MESHLET_MAX_VERTS			64
+#define MOPT_MESHLET_MAX_TRIS			124
+
+/* acmr is cache misses per triangle (0.5 is the ideal for regular grids), atvr misses per vertex (1.0 ideal) */
+typedef struct {
+	float acmr;
+	float atvr;
+} mopt_cache_stats;
+
+typedef struct {
+	uint32_t vert_offset;
+	uint32_t vert_cnt;
+	uint32_t tri_offset;
+	uint32_t tri_cnt;
+	float center[3];
+	float radius;
+} mopt_meshlet;
+
+DYNARR_DEFINE(mopt_meshlet_list, mopt_meshlet)
+
+DYNARR_DEFINE(mopt_u32_list, uint32_t)
+
+DYNARR_DEFINE(mopt_u8_list, uint8_t)
+
+/* verts holds mesh vertex indices, tris holds three meshlet-local indices per triangle */
+typedef struct {
+	mopt_meshlet_list meshlets;
+	mopt_u32_list verts;
+	mopt_u8_list tris;
+} mopt_meshlets;
+
+/*
+ * vertices are opaque blobs of stride bytes; the passes that need geometry take
+ * positions as three floats every pos_stride bytes, so they work on any layout
+ */
+uint32_t mopt_dedup(void *verts, size_t stride, uint32_t vert_cnt, uint32_t *inds, uint32_t idx_cnt);
+
+void mopt_tipsify(uint32_t *inds, uint32_t idx_cnt, uint32_t vert_cnt, uint32_t cache_size);
+
+void mopt_overdraw(uint32_t *inds, uint32_t idx_cnt, const float *pos, size_t pos_stride, uint32_t cache_size);
+
+uint32_t mopt_fetch(void *verts, size_t stride, uint32_t vert_cnt, uint32_t *inds, uint32_t idx_cnt);
+
+void mopt_get_cache_stats(const uint32_t *inds, uint32_t idx_cnt, uint32_t vert_cnt, uint32_t cache_size,
+	mopt_cache_stats *stats);
+
+void mopt_meshlets_init(mopt_meshlets *ml);
+
+void mopt_meshlets_clean(mopt_meshlets *ml);
+
+void mopt_build_meshlets(mopt_meshlets *ml, const uint32_t *inds, uint32_t idx_cnt, uint32_t vert_cnt, const float *pos,
+	size_t pos_stride);
+
+#endif
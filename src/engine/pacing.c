@@ -0,0 +1,314 @@
+#include "pacing.h"
+#include "../util/arena.h"
+
+#include <string.h>
+#include <math.h>
+#include <errno.h>
+#include <time.h>
+
+static const char *mode_names[PACE_MODE_CNT] = {
+	"low-latency",
+	"power-saving",
+	"target-fps",
+};
+
+static inline void cpu_relax(void)
+{
+#if defined(__x86_64__) || defined(__i386__)
+	__builtin_ia32_pause();
+#endif
+}
+
+static inline uint64_t thread_cpu_ns(void)
+{
+	struct timespec				ts;
+
+	clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts);
+
+	return (uint64_t)ts.tv_sec * 1000000000ull + ts.tv_nsec;
+}
+
+/* time_now_ns reads CLOCK_MONOTONIC, so an absolute sleep on the same clock lands on its deadlines */
+static inline void sleep_until(uint64_t ns)
+{
+	struct timespec				ts;
+
+	ts.tv_sec = ns / 1000000000ull;
+	ts.tv_nsec = ns % 1000000000ull;
+
+	while (clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &ts, NULL) == EINTR)
+		;
+}
+
+/* spin_ns follows the worst recent oversleep, growing at once and shrinking slowly */
+static inline void adapt_spin(frame_pacer *p, uint64_t oversleep)
+{
+	uint64_t				want;
+
+	want = oversleep + PACE_SPIN_MARGIN_NS;
+
+	if (want > p->spin_ns)
+		p->spin_ns = want;
+	else
+		p->spin_ns -= (p->spin_ns - want) / 16;
+
+	if (p->spin_ns < PACE_MIN_SPIN_NS)
+		p->spin_ns = PACE_MIN_SPIN_NS;
+
+	if (p->spin_ns > PACE_MAX_SPIN_NS)
+		p->spin_ns = PACE_MAX_SPIN_NS;
+}
+
+/* sleeps through most of the gap and spins the rest, the sleep alone overshoots by the scheduler's slack */
+static inline void wait_hybrid(frame_pacer *p)
+{
+	uint64_t				now, wake;
+
+	now = time_now_ns();
+
+	if (now + p->spin_ns < p->deadline_ns) {
+		wake = p->deadline_ns - p->spin_ns;
+
+		sleep_until(wake);
+
+		now = time_now_ns();
+
+		adapt_spin(p, now > wake ? now - wake : 0);
+	}
+
+	while (time_now_ns() < p->deadline_ns)
+		cpu_relax();
+}
+
+/* the event wait returns early on input, so it is retried until the deadline is reached */
+static inline void wait_events(frame_pacer *p)
+{
+	uint64_t				now;
+
+	while ((now = time_now_ns()) < p->deadline_ns) {
+		if (p->wait != NULL)
+			p->wait((double)(p->deadline_ns - now) / 1e9);
+		else
+			sleep_until(p->deadline_ns);
+	}
+}
+
+static inline void push_sample(uint64_t *ring, uint64_t *cnt, uint64_t ns)
+{
+	ring[*cnt % PACE_MAX_SAMPLES] = ns;
+	(*cnt)++;
+}
+
+static int cmp_u64(const void *a, const void *b)
+{
+	uint64_t				x, y;
+
+	x = *(const uint64_t *)a;
+	y = *(const uint64_t *)b;
+
+	return (x > y) - (x < y);
+}
+
+/* copies the ring into scratch and sorts it for the nearest rank percentiles */
+static inline uint64_t sorted_samples(const uint64_t *ring, uint64_t cnt, uint64_t *scratch)
+{
+	uint64_t				n;
+
+	n = cnt < PACE_MAX_SAMPLES ? cnt : PACE_MAX_SAMPLES;
+
+	memcpy(scratch, ring, n * sizeof(uint64_t));
+	qsort(scratch, n, sizeof(uint64_t), cmp_u64);
+
+	return n;
+}
+
+static inline uint64_t percentile(const uint64_t *sorted, uint64_t n, uint32_t pct)
+{
+	if (n == 0)
+		return 0;
+
+	return sorted[(n - 1) * pct / 100];
+}
+
+void pace_init(frame_pacer *p, pace_mode mode, uint32_t fps)
+{
+	memset(p, '\0', sizeof(*p));
+
+	p->mode = mode;
+	p->fps = fps;
+	p->period_ns = fps > 0 ? 1000000000ull / fps : 0;
+	p->spin_ns = PACE_MIN_SPIN_NS;
+
+	p->stats.frame_ns = mem_alloc(PACE_MAX_SAMPLES * sizeof(uint64_t));
+	p->stats.latency_ns = mem_alloc(PACE_MAX_SAMPLES * sizeof(uint64_t));
+
+	if (p->stats.frame_ns == NULL || p->stats.latency_ns == NULL)
+		dbg_error("failed to allocate pacing samples");
+
+	p->stats.cpu_start_ns = thread_cpu_ns();
+	p->stats.wall_start_ns = time_now_ns();
+
+	dbg_log("initialized %s frame pacing at %u fps successfully", mode_names[mode], fps);
+}
+
+void pace_clean(frame_pacer *p)
+{
+	mem_free(p->stats.frame_ns);
+	mem_free(p->stats.latency_ns);
+
+	memset(p, '\0', sizeof(*p));
+}
+
+/* poll matches glfwPollEvents and wait matches glfwWaitEventsTimeout, either may be NULL */
+void pace_set_events(frame_pacer *p, pace_poll_fn poll, pace_wait_fn wait)
+{
+	p->poll = poll;
+	p->wait = wait;
+}
+
+bool pace_parse_mode(const char *name, pace_mode *mode)
+{
+	for (uint32_t i = 0; i < PACE_MODE_CNT; i++) {
+		if (strcmp(name, mode_names[i]) == 0) {
+			*mode = (pace_mode)i;
+
+			return true;
+		}
+	}
+
+	return false;
+}
+
+const char *pace_mode_name(pace_mode mode)
+{
+	return mode < PACE_MODE_CNT ? mode_names[mode] : "unknown";
+}
+
+/* safe from any thread; only the oldest input since the last frame is kept, that is the one waiting longest */
+void pace_input(frame_pacer *p)
+{
+	uint64_t				expected;
+
+	expected = 0;
+
+	__atomic_compare_exchange_n(&p->input_ns, &expected, time_now_ns(), false, __ATOMIC_RELAXED,
+		__ATOMIC_RELAXED);
+}
+
+/*
+ * waits out the rest of the frame, then polls events, so input is sampled as late as possible;
+ * a frame that ends more than a period late resets the schedule instead of rushing to catch up
+ */
+void pace_frame_begin(frame_pacer *p)
+{
+	uint64_t				now;
+
+	if (p->period_ns > 0 && p->deadline_ns > 0) {
+		if (p->mode == PACE_POWER_SAVING)
+			wait_events(p);
+		else
+			wait_hybrid(p);
+	}
+
+	now = time_now_ns();
+
+	if (p->period_ns > 0) {
+		if (p->deadline_ns == 0 || now > p->deadline_ns + p->period_ns) {
+			if (p->deadline_ns > 0)
+				p->stats.missed++;
+
+			p->deadline_ns = now;
+		}
+
+		p->deadline_ns += p->period_ns;
+	}
+
+	if (p->poll != NULL)
+		p->poll();
+
+	p->latched_ns = __atomic_exchange_n(&p->input_ns, 0, __ATOMIC_RELAXED);
+
+	if (p->last_ns > 0)
+		push_sample(p->stats.frame_ns, &p->stats.frame_cnt, now - p->last_ns);
+
+	p->last_ns = now;
+}
+
+/* called once the frame is handed to present, the display timing itself is not visible without an extension */
+void pace_frame_end(frame_pacer *p)
+{
+	if (p->latched_ns == 0)
+		return;
+
+	push_sample(p->stats.latency_ns, &p->stats.latency_cnt, time_now_ns() - p->latched_ns);
+
+	p->latched_ns = 0;
+}
+
+/* the cpu share is of the calling thread, so summarize from the thread that called pace_init */
+void pace_summarize(const frame_pacer *p, pace_summary *sum)
+{
+	uint64_t				*scratch;
+	uint64_t				n, wall_ns;
+	double					mean, var, d;
+
+	memset(sum, '\0', sizeof(*sum));
+
+	scratch = mem_alloc(PACE_MAX_SAMPLES * sizeof(uint64_t));
+
+	if (scratch == NULL)
+		dbg_error("failed to allocate pacing scratch");
+
+	n = sorted_samples(p->stats.frame_ns, p->stats.frame_cnt, scratch);
+	mean = 0.0;
+	var = 0.0;
+
+	for (uint64_t i = 0; i < n; i++)
+		mean += (double)scratch[i];
+
+	mean = n > 0 ? mean / n : 0.0;
+
+	for (uint64_t i = 0; i < n; i++) {
+		d = (double)scratch[i] - mean;
+		var += d * d;
+	}
+
+	sum->frame_cnt = n;
+	sum->frame_p50_ns = percentile(scratch, n, 50);
+	sum->frame_p99_ns = percentile(scratch, n, 99);
+	sum->frame_max_ns = n > 0 ? scratch[n - 1] : 0;
+	sum->frame_mean_ns = mean;
+	sum->frame_stddev_ns = n > 0 ? sqrt(var / n) : 0.0;
+
+	n = sorted_samples(p->stats.latency_ns, p->stats.latency_cnt, scratch);
+
+	sum->latency_cnt = n;
+	sum->latency_p50_ns = percentile(scratch, n, 50);
+	sum->latency_p99_ns = percentile(scratch, n, 99);
+	sum->missed = p->stats.missed;
+
+	wall_ns = time_now_ns() - p->stats.wall_start_ns;
+	sum->cpu_pct = wall_ns > 0 ? 100.0 * (double)(thread_cpu_ns() - p->stats.cpu_start_ns) / wall_ns : 0.0;
+
+	mem_free(scratch);
+}
+
+void pace_report(const frame_pacer *p)
+{
+	pace_summary				sum;
+
+	pace_summarize(p, &sum);
+
+	dbg_info("%s pacing at %u fps, %llu frames, %llu missed deadlines, main thread cpu %.1f%%",
+		mode_names[p->mode], p->fps, (unsigned long long)sum.frame_cnt, (unsigned long long)sum.missed,
+		sum.cpu_pct);
+	dbg_info("frame time p50 %.3f ms, p99 %.3f ms, max %.3f ms, mean %.3f ms, stddev %.3f ms",
+		sum.frame_p50_ns / 1e6, sum.frame_p99_ns / 1e6, sum.frame_max_ns / 1e6, sum.frame_mean_ns / 1e6,
+		sum.frame_stddev_ns / 1e6);
+
+	if (sum.latency_cnt > 0)
+		dbg_info("input to present %llu samples, p50 %.3f ms, p99 %.3f ms",
+			(unsigned long long)sum.latency_cnt, sum.latency_p50_ns / 1e6, sum.latency_p99_ns / 1e6);
+	else
+		dbg_info("no input arrived, input to present latency was not measured");
+}
@@ -0,0 +1,94 @@
+#ifndef PACING_H_INCLUDED
+#define PACING_H_INCLUDED
+
+#include "../util/debug.h"
+#include "../util/util.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <stdbool.h>
+
+#define PACE_DEFAULT_FPS			60
+#define PACE_DEFAULT_CAP_FPS			240
+#define PACE_MAX_SAMPLES			(64 * 1024)
+#define PACE_MIN_SPIN_NS			(200 * 1000)
+#define PACE_MAX_SPIN_NS			(4 * 1000 * 1000)
+#define PACE_SPIN_MARGIN_NS			(100 * 1000)
+
+/*
+ * low latency presents with IMMEDIATE or MAILBOX and one frame in flight, capped on the cpu;
+ * power saving presents with FIFO and sleeps in the event wait; target fps hits a set rate
+ * by sleeping most of the frame and spinning the rest
+ */
+typedef enum {
+	PACE_LOW_LATENCY,
+	PACE_POWER_SAVING,
+	PACE_TARGET_FPS,
+	PACE_MODE_CNT,
+} pace_mode;
+
+typedef void (*pace_poll_fn)(void);
+
+typedef void (*pace_wait_fn)(double timeout);
+
+/* the most recent PACE_MAX_SAMPLES of each, kept in rings */
+typedef struct {
+	uint64_t *frame_ns;
+	uint64_t *latency_ns;
+	uint64_t frame_cnt;
+	uint64_t latency_cnt;
+	uint64_t missed;
+	uint64_t cpu_start_ns;
+	uint64_t wall_start_ns;
+} pace_stats;
+
+typedef struct {
+	pace_mode mode;
+	uint32_t fps;
+	uint64_t period_ns;
+	uint64_t spin_ns;
+	uint64_t deadline_ns;
+	uint64_t last_ns;
+	uint64_t input_ns;
+	uint64_t latched_ns;
+	pace_poll_fn poll;
+	pace_wait_fn wait;
+	pace_stats stats;
+} frame_pacer;
+
+typedef struct {
+	uint64_t frame_cnt;
+	uint64_t frame_p50_ns;
+	uint64_t frame_p99_ns;
+	uint64_t frame_max_ns;
+	double frame_mean_ns;
+	double frame_stddev_ns;
+	uint64_t latency_cnt;
+	uint64_t latency_p50_ns;
+	uint64_t latency_p99_ns;
+	uint64_t missed;
+	double cpu_pct;
+} pace_summary;
+
+void pace_init(frame_pacer *p, pace_mode mode, uint32_t fps);
+
+void pace_clean(frame_pacer *p);
+
+void pace_set_events(frame_pacer *p, pace_poll_fn poll, pace_wait_fn wait);
+
+bool pace_parse_mode(const char *name, pace_mode *mode);
+
+const char *pace_mode_name(pace_mode mode);
+
+void pace_input(frame_pacer *p);
+
+void pace_frame_begin(frame_pacer *p);
+
+void pace_frame_end(frame_pacer *p);
+
+void pace_summarize(const frame_pacer *p, pace_summary *sum);
+
+void pace_report(const frame_pacer *p);
+
+#endif
@@ -0,0 +1,703 @@
+#include "stream.h"
+#include "../util/lz4.h"
+
+#include <fcntl.h>
+#include <unistd.h>
+#include <errno.h>
+#include <string.h>
+#include <sys/resource.h>
+#include <sys/syscall.h>
+
+#define STREAM_MAP_EMPTY			UINT32_MAX
+
+static __thread bool				lowered;
+
+/* linux nice is per thread, so this only demotes the calling stage thread below the render thread */
+static inline void lower_priority(void)
+{
+	if (lowered)
+		return;
+
+	setpriority(PRIO_PROCESS, syscall(SYS_gettid), STREAM_NICE);
+	lowered = true;
+}
+
+static inline stream_handle make_handle(const stream_req *req)
+{
+	return (stream_handle)req->gen << 32 | req->ind;
+}
+
+static inline stream_req *lookup(streamer *s, stream_handle h)
+{
+	stream_req				*req;
+
+	if ((uint32_t)h >= s->reqs.size)
+		return NULL;
+
+	req = s->reqs.elems[(uint32_t)h];
+
+	return req->gen == (uint32_t)(h >> 32) && req->state != STREAM_INVALID ? req : NULL;
+}
+
+static inline void queue_push(stream_queue *q, uint32_t ind)
+{
+	stream_u32_list_push(&q->inds, ind);
+}
+
+static inline uint32_t queue_len(const stream_queue *q)
+{
+	return q->inds.size - q->head;
+}
+
+static inline void queue_pop(stream_queue *q)
+{
+	if (++q->head == q->inds.size) {
+		stream_u32_list_clear(&q->inds);
+		q->head = 0;
+	}
+}
+
+static inline uint64_t req_key(const char *name, stream_upload_fn upload, void *user)
+{
+	return hash_fnv1a(name, strlen(name)) ^ ((uint64_t)(uintptr_t)upload * 0x9e3779b97f4a7c15ull) ^
+		((uint64_t)(uintptr_t)user * 0xc2b2ae3d27d4eb4full);
+}
+
+static inline void map_insert_raw(uint32_t *map, uint32_t cap, uint64_t key, uint32_t ind)
+{
+	uint32_t				slot;
+
+	for (slot = key & (cap - 1); map[slot] != STREAM_MAP_EMPTY; slot = (slot + 1) & (cap - 1));
+
+	map[slot] = ind;
+}
+
+static inline void map_grow(streamer *s)
+{
+	uint32_t				*map;
+	uint32_t				cap;
+
+	cap = s->map_cap ? s->map_cap * 2 : STREAM_MIN_MAP_CAP;
+	map = mem_alloc(cap * sizeof(uint32_t));
+
+	if (map == NULL)
+		dbg_error("failed to grow stream request map");
+
+	memset(map, 0xff, cap * sizeof(uint32_t));
+
+	for (uint32_t i = 0; i < s->map_cap; i++) {
+		if (s->map[i] != STREAM_MAP_EMPTY)
+			map_insert_raw(map, cap, s->reqs.elems[s->map[i]]->key, s->map[i]);
+	}
+
+	mem_free(s->map);
+
+	s->map = map;
+	s->map_cap = cap;
+}
+
+/* same name going to the same upload target is the same request */
+static inline uint32_t map_find(streamer *s, const stream_desc *desc, uint64_t key)
+{
+	stream_req				*req;
+	uint32_t				slot;
+
+	if (s->map_cap == 0)
+		return STREAM_MAP_EMPTY;
+
+	for (slot = key & (s->map_cap - 1); s->map[slot] != STREAM_MAP_EMPTY; slot = (slot + 1) & (s->map_cap - 1)) {
+		req = s->reqs.elems[s->map[slot]];
+
+		if (req->key == key && req->upload == desc->upload && req->user == desc->user &&
+			strcmp(req->name, desc->name) == 0)
+			return s->map[slot];
+	}
+
+	return STREAM_MAP_EMPTY;
+}
+
+static inline void map_insert(streamer *s, uint32_t ind)
+{
+	if ((s->map_cnt + 1) * 2 > s->map_cap)
+		map_grow(s);
+
+	map_insert_raw(s->map, s->map_cap, s->reqs.elems[ind]->key, ind);
+	s->map_cnt++;
+}
+
+/* backward shift deletion, so probe chains never need tombstones */
+static inline void map_remove(streamer *s, uint32_t ind)
+{
+	uint32_t				mask, i, j, home;
+
+	if (s->map_cap == 0)
+		return;
+
+	mask = s->map_cap - 1;
+
+	for (i = s->reqs.elems[ind]->key & mask; s->map[i] != ind; i = (i + 1) & mask) {
+		if (s->map[i] == STREAM_MAP_EMPTY)
+			return;
+	}
+
+	for (j = i;;) {
+		j = (j + 1) & mask;
+
+		if (s->map[j] == STREAM_MAP_EMPTY)
+			break;
+
+		home = s->reqs.elems[s->map[j]]->key & mask;
+
+		if (i <= j ? (i < home && home <= j) : (i < home || home <= j))
+			continue;
+
+		s->map[i] = s->map[j];
+		i = j;
+	}
+
+	s->map[i] = STREAM_MAP_EMPTY;
+	s->map_cnt--;
+}
+
+static inline void release_mem(streamer *s, stream_req *req, uint64_t bytes)
+{
+	req->mem -= bytes;
+	s->mem_used -= bytes;
+
+	pthread_cond_broadcast(&s->io_cond);
+}
+
+static inline void free_buffers(streamer *s, stream_req *req)
+{
+	if (req->data != req->raw)
+		mem_free(req->data);
+
+	mem_free(req->raw);
+
+	req->raw = NULL;
+	req->data = NULL;
+
+	release_mem(s, req, req->mem);
+}
+
+static inline void free_req(streamer *s, stream_req *req)
+{
+	map_remove(s, req->ind);
+	free_buffers(s, req);
+	mem_free(req->name);
+
+	req->name = NULL;
+	req->state = STREAM_INVALID;
+	req->gen++;
+
+	stream_u32_list_push(&s->free_reqs, req->ind);
+}
+
+/* every request leaves the pipeline exactly once, through one of these three */
+static inline void finish(streamer *s, stream_req *req, stream_state state)
+{
+	free_buffers(s, req);
+
+	req->state = state;
+	s->in_flight--;
+
+	if (state == STREAM_DONE) {
+		s->stats.completed++;
+		s->stats.total_latency_ns += time_now_ns() - req->request_ns;
+	} else {
+		s->stats.failed++;
+
+		dbg_warn("failed to stream asset %s", req->name);
+	}
+
+	if (req->refs == 0)
+		free_req(s, req);
+}
+
+static inline void drop(streamer *s, stream_req *req)
+{
+	s->in_flight--;
+	s->stats.cancelled++;
+
+	free_req(s, req);
+}
+
+/* highest priority first, skipping entries left behind by cancels and priority bumps */
+static inline stream_req *next_queued(streamer *s, stream_queue *queues, stream_state state)
+{
+	stream_req				*req;
+	stream_queue				*q;
+
+	for (uint32_t prio = 0; prio < STREAM_PRIO_CNT; prio++) {
+		q = &queues[prio];
+
+		while (queue_len(q) > 0) {
+			req = s->reqs.elems[q->inds.elems[q->head]];
+
+			if (req->state == state && req->prio == prio)
+				return req;
+
+			queue_pop(q);
+		}
+	}
+
+	return NULL;
+}
+
+static inline bool read_stored(stream_req *req)
+{
+	uint64_t				done;
+	ssize_t					n;
+	int					fd;
+
+	PROF_ZONE("stream_read");
+
+	req->raw = mem_alloc(req->loc.stored_len ? req->loc.stored_len : 1);
+
+	if (req->raw == NULL)
+		dbg_error("failed to allocate stream read buffer");
+
+	fd = open(req->loc.path, O_RDONLY);
+
+	if (fd < 0)
+		return false;
+
+	posix_fadvise(fd, req->loc.offset, req->loc.stored_len, POSIX_FADV_SEQUENTIAL);
+
+	/* chunked so a cancel stops a large read early */
+	for (done = 0; done < req->loc.stored_len; done += n) {
+		if (__atomic_load_n(&req->cancelled, __ATOMIC_RELAXED))
+			break;
+
+		n = pread(fd, req->raw + done, req->loc.stored_len - done < STREAM_READ_CHUNK ?
+			req->loc.stored_len - done : STREAM_READ_CHUNK, req->loc.offset + done);
+
+		if (n < 0 && errno == EINTR) {
+			n = 0;
+
+			continue;
+		}
+
+		if (n <= 0) {
+			close(fd);
+
+			return false;
+		}
+	}
+
+	close(fd);
+
+	return true;
+}
+
+static void decode_task(void *arg, uint32_t worker)
+{
+	stream_req				*req;
+	streamer				*s;
+	bool					ok;
+
+	PROF_ZONE("stream_decode");
+
+	(void)worker;
+
+	lower_priority();
+
+	req = arg;
+	s = req->s;
+	ok = true;
+
+	if (!__atomic_load_n(&req->cancelled, __ATOMIC_RELAXED)) {
+		if (req->loc.lz4) {
+			req->data = mem_alloc(req->loc.raw_len ? req->loc.raw_len : 1);
+
+			if (req->data == NULL)
+				dbg_error("failed to allocate stream decode buffer");
+
+			ok = lz4_decompress(req->raw, req->loc.stored_len, req->data, req->loc.raw_len);
+
+			mem_free(req->raw);
+			req->raw = NULL;
+		} else {
+			req->data = req->raw;
+		}
+
+		if (ok && req->loc.verify && crc32(req->data, req->loc.raw_len) != req->loc.checksum)
+			ok = false;
+	}
+
+	pthread_mutex_lock(&s->lock);
+
+	if (req->loc.lz4 && req->raw == NULL)
+		release_mem(s, req, req->loc.stored_len);
+
+	if (req->refs == 0) {
+		drop(s, req);
+	} else if (!ok) {
+		finish(s, req, STREAM_FAILED);
+	} else {
+		req->len = req->loc.raw_len;
+		req->state = STREAM_READY;
+		s->stats.bytes_decoded += req->len;
+
+		queue_push(&s->ready[req->prio], req->ind);
+	}
+
+	pthread_mutex_unlock(&s->lock);
+}
+
+static void *io_main(void *arg)
+{
+	streamer				*s;
+	stream_req				*req;
+	uint64_t				need;
+	bool					ok;
+
+	s = arg;
+
+	lower_priority();
+	PROF_THREAD_NAME("stream io");
+
+	pthread_mutex_lock(&s->lock);
+
+	for (;;) {
+		while (!s->stopping && (req = next_queued(s, s->io_queue, STREAM_QUEUED)) == NULL)
+			pthread_cond_wait(&s->io_cond, &s->lock);
+
+		if (s->stopping)
+			break;
+
+		queue_pop(&s->io_queue[req->prio]);
+		req->state = STREAM_READING;
+
+		pthread_mutex_unlock(&s->lock);
+
+		ok = asset_locate(&req->loc, req->name);
+
+		pthread_mutex_lock(&s->lock);
+
+		if (!ok) {
+			finish(s, req, STREAM_FAILED);
+
+			continue;
+		}
+
+		/* a single asset larger than the whole budget still goes through once nothing else is resident */
+		need = req->loc.stored_len + (req->loc.lz4 ? req->loc.raw_len : 0);
+
+		if (s->mem_used > 0 && s->mem_used + need > s->budget)
+			s->stats.budget_waits++;
+
+		while (s->mem_used > 0 && s->mem_used + need > s->budget && req->refs > 0 && !s->stopping)
+			pthread_cond_wait(&s->io_cond, &s->lock);
+
+		if (req->refs == 0 || s->stopping) {
+			drop(s, req);
+
+			continue;
+		}
+
+		req->mem = need;
+		s->mem_used += need;
+
+		if (s->mem_used > s->stats.peak_mem)
+			s->stats.peak_mem = s->mem_used;
+
+		pthread_mutex_unlock(&s->lock);
+
+		ok = read_stored(req);
+
+		pthread_mutex_lock(&s->lock);
+
+		s->stats.bytes_read += req->loc.stored_len;
+
+		if (req->refs == 0) {
+			drop(s, req);
+		} else if (!ok) {
+			finish(s, req, STREAM_FAILED);
+		} else {
+			req->state = STREAM_DECODING;
+
+			tpool_submit(&s->decoders, decode_task, req);
+		}
+	}
+
+	pthread_mutex_unlock(&s->lock);
+
+	return NULL;
+}
+
+void stream_init(streamer *s, uint64_t budget, uint32_t io_cnt, uint32_t decode_cnt)
+{
+	memset(s, '\0', sizeof(streamer));
+
+	if (io_cnt == 0)
+		io_cnt = STREAM_DEFAULT_IO_THREADS;
+
+	s->io_cnt = clamp_uint(io_cnt, 1, STREAM_MAX_IO_THREADS);
+	s->budget = budget;
+
+	stream_req_list_init(&s->reqs);
+	stream_u32_list_init(&s->free_reqs);
+
+	for (uint32_t i = 0; i < STREAM_PRIO_CNT; i++) {
+		stream_u32_list_init(&s->io_queue[i].inds);
+		stream_u32_list_init(&s->ready[i].inds);
+	}
+
+	pthread_mutex_init(&s->lock, NULL);
+	pthread_cond_init(&s->io_cond, NULL);
+
+	tpool_init(&s->decoders, decode_cnt ? decode_cnt : tpool_core_cnt());
+
+	for (uint32_t i = 0; i < s->io_cnt; i++) {
+		if (pthread_create(&s->io_threads[i], NULL, io_main, s) != 0)
+			dbg_error("failed to create stream io thread");
+	}
+
+	dbg_log("started streamer with %u io and %u decode threads successfully", s->io_cnt, s->decoders.thread_cnt);
+}
+
+void stream_clean(streamer *s)
+{
+	stream_req				*req;
+
+	pthread_mutex_lock(&s->lock);
+
+	s->stopping = true;
+
+	pthread_cond_broadcast(&s->io_cond);
+	pthread_mutex_unlock(&s->lock);
+
+	for (uint32_t i = 0; i < s->io_cnt; i++)
+		pthread_join(s->io_threads[i], NULL);
+
+	/* io threads are gone, so nothing can be queued for decode past this point */
+	tpool_wait_idle(&s->decoders);
+	tpool_clean(&s->decoders);
+
+	for (uint32_t i = 0; i < s->reqs.size; i++) {
+		req = s->reqs.elems[i];
+
+		if (req->state != STREAM_INVALID) {
+			free_buffers(s, req);
+			mem_free(req->name);
+		}
+
+		mem_free(req);
+	}
+
+	for (uint32_t i = 0; i < STREAM_PRIO_CNT; i++) {
+		stream_u32_list_clean(&s->io_queue[i].inds);
+		stream_u32_list_clean(&s->ready[i].inds);
+	}
+
+	stream_req_list_clean(&s->reqs);
+	stream_u32_list_clean(&s->free_reqs);
+	mem_free(s->map);
+
+	pthread_mutex_destroy(&s->lock);
+	pthread_cond_destroy(&s->io_cond);
+
+	s->map = NULL;
+	s->map_cap = 0;
+}
+
+stream_handle stream_request(streamer *s, const stream_desc *desc)
+{
+	stream_req				*req;
+	uint64_t				key;
+	uint32_t				ind;
+
+	key = req_key(desc->name, desc->upload, desc->user);
+
+	pthread_mutex_lock(&s->lock);
+
+	s->stats.requested++;
+
+	ind = map_find(s, desc, key);
+
+	if (ind != STREAM_MAP_EMPTY) {
+		req = s->reqs.elems[ind];
+		req->refs++;
+		s->stats.dedup_hits++;
+
+		/* the stale lower priority entry is skipped once this one is popped */
+		if (req->state == STREAM_QUEUED && desc->prio < req->prio) {
+			req->prio = desc->prio;
+			queue_push(&s->io_queue[req->prio], ind);
+		}
+
+		pthread_mutex_unlock(&s->lock);
+
+		return make_handle(req);
+	}
+
+	if (s->free_reqs.size > 0) {
+		ind = stream_u32_list_pop(&s->free_reqs);
+		req = s->reqs.elems[ind];
+	} else {
+		ind = s->reqs.size;
+		req = mem_alloc(sizeof(stream_req));
+
+		if (req == NULL)
+			dbg_error("failed to allocate stream request");
+
+		memset(req, '\0', sizeof(stream_req));
+
+		req->gen = 1;
+
+		stream_req_list_push(&s->reqs, req);
+	}
+
+	req->s = s;
+	req->name = mem_alloc(strlen(desc->name) + 1);
+	req->key = key;
+	req->upload = desc->upload;
+	req->user = desc->user;
+	req->prio = desc->prio < STREAM_PRIO_CNT ? desc->prio : STREAM_PRIO_LOW;
+	req->state = STREAM_QUEUED;
+	req->ind = ind;
+	req->refs = 1;
+	req->cancelled = 0;
+	req->raw = NULL;
+	req->data = NULL;
+	req->len = 0;
+	req->mem = 0;
+	req->uploaded = 0;
+	req->request_ns = time_now_ns();
+
+	if (req->name == NULL)
+		dbg_error("failed to allocate stream request name");
+
+	strcpy(req->name, desc->name);
+
+	map_insert(s, ind);
+	queue_push(&s->io_queue[req->prio], ind);
+
+	s->in_flight++;
+
+	pthread_cond_signal(&s->io_cond);
+	pthread_mutex_unlock(&s->lock);
+
+	return make_handle(req);
+}
+
+/* dropping the last reference cancels the request wherever it is in the pipeline */
+void stream_release(streamer *s, stream_handle h)
+{
+	stream_req				*req;
+
+	pthread_mutex_lock(&s->lock);
+
+	req = lookup(s, h);
+
+	if (req == NULL || --req->refs > 0) {
+		pthread_mutex_unlock(&s->lock);
+
+		return;
+	}
+
+	switch (req->state) {
+	case STREAM_QUEUED:
+	case STREAM_READY:
+		drop(s, req);
+		break;
+	case STREAM_READING:
+	case STREAM_DECODING:
+		/* the owning stage frees it, new requests for the name must not join it meanwhile */
+		__atomic_store_n(&req->cancelled, 1, __ATOMIC_RELAXED);
+		map_remove(s, req->ind);
+		pthread_cond_broadcast(&s->io_cond);
+		break;
+	default:
+		free_req(s, req);
+		break;
+	}
+
+	pthread_mutex_unlock(&s->lock);
+}
+
+stream_state stream_status(streamer *s, stream_handle h)
+{
+	stream_req				*req;
+	stream_state				state;
+
+	pthread_mutex_lock(&s->lock);
+
+	req = lookup(s, h);
+	state = req != NULL ? req->state : STREAM_INVALID;
+
+	pthread_mutex_unlock(&s->lock);
+
+	return state;
+}
+
+uint32_t stream_pending(streamer *s)
+{
+	uint32_t				cnt;
+
+	pthread_mutex_lock(&s->lock);
+
+	cnt = s->in_flight;
+
+	pthread_mutex_unlock(&s->lock);
+
+	return cnt;
+}
+
+/*
+ * the upload stage, run once per frame on the render thread; it never waits on
+ * io, decode or the gpu, a request bigger than the budget is spread over several
+ * calls and an upload that runs out of staging room ends the pump until next frame
+ */
+void stream_pump(streamer *s, uint64_t upload_budget)
+{
+	stream_req				*req;
+	uint64_t				start_ns, left, want, n;
+
+	PROF_ZONE("stream_pump");
+
+	start_ns = time_now_ns();
+	left = upload_budget;
+
+	pthread_mutex_lock(&s->lock);
+
+	while (left > 0 && (req = next_queued(s, s->ready, STREAM_READY)) != NULL) {
+		want = req->len - req->uploaded < left ? req->len - req->uploaded : left;
+		n = want;
+
+		/* ready requests are only touched from this thread, so the copy runs unlocked */
+		pthread_mutex_unlock(&s->lock);
+
+		if (want > 0 && req->upload != NULL)
+			n = req->upload(req->user, req->data + req->uploaded, req->uploaded, want);
+
+		pthread_mutex_lock(&s->lock);
+
+		req->uploaded += n;
+		left -= n;
+		s->stats.bytes_uploaded += n;
+
+		if (req->uploaded == req->len) {
+			queue_pop(&s->ready[req->prio]);
+			finish(s, req, STREAM_DONE);
+		} else if (n < want) {
+			s->stats.upload_retries++;
+			break;
+		}
+	}
+
+	if (time_now_ns() - start_ns > s->stats.max_pump_ns)
+		s->stats.max_pump_ns = time_now_ns() - start_ns;
+
+	pthread_mutex_unlock(&s->lock);
+}
+
+void stream_get_stats(streamer *s, stream_stats *out)
+{
+	pthread_mutex_lock(&s->lock);
+
+	*out = s->stats;
+
+	pthread_mutex_unlock(&s->lock);
+}
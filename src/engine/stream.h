@@ -0,0 +1,151 @@
+#ifndef STREAM_H_INCLUDED
+#define STREAM_H_INCLUDED
+
+#include "../util/debug.h"
+#include "../util/util.h"
+#include "../util/dynarr.h"
+#include "../util/tpool.h"
+#include "../util/prof.h"
+#include "assets.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <pthread.h>
+
+#define STREAM_MAX_IO_THREADS			8
+#define STREAM_DEFAULT_IO_THREADS		2
+#define STREAM_DEFAULT_BUDGET			(256ull * 1024 * 1024)
+#define STREAM_FRAME_UPLOAD_BUDGET		(4ull * 1024 * 1024)
+#define STREAM_READ_CHUNK			(1024 * 1024)
+#define STREAM_MIN_MAP_CAP			64
+#define STREAM_NICE				10
+#define STREAM_NULL				((stream_handle)0)
+
+/* generation in the high 32 bits, request index in the low, like ecs entities */
+typedef uint64_t stream_handle;
+
+typedef enum {
+	STREAM_PRIO_CRITICAL,
+	STREAM_PRIO_HIGH,
+	STREAM_PRIO_NORMAL,
+	STREAM_PRIO_LOW,
+	STREAM_PRIO_CNT,
+} stream_prio;
+
+typedef enum {
+	STREAM_INVALID,
+	STREAM_QUEUED,
+	STREAM_READING,
+	STREAM_DECODING,
+	STREAM_READY,
+	STREAM_DONE,
+	STREAM_FAILED,
+} stream_state;
+
+/*
+ * called on the pumping thread, possibly several times per request when it spans frames;
+ * returns how many leading bytes it took, anything short is offered again on the next pump
+ */
+typedef uint64_t (*stream_upload_fn)(void *user, const uint8_t *data, uint64_t offset, uint64_t len);
+
+typedef struct {
+	char *name;
+	stream_prio prio;
+	stream_upload_fn upload;
+	void *user;
+} stream_desc;
+
+typedef struct streamer streamer;
+
+typedef struct {
+	streamer *s;
+	char *name;
+	uint64_t key;
+	stream_upload_fn upload;
+	void *user;
+	stream_prio prio;
+	stream_state state;
+	uint32_t ind;
+	uint32_t gen;
+	uint32_t refs;
+	uint32_t cancelled;
+	asset_loc loc;
+	uint8_t *raw;
+	uint8_t *data;
+	uint64_t len;
+	uint64_t mem;
+	uint64_t uploaded;
+	uint64_t request_ns;
+} stream_req;
+
+DYNARR_DEFINE(stream_req_list, stream_req *)
+
+DYNARR_DEFINE(stream_u32_list, uint32_t)
+
+/* fifo of request indices, popped from head until it drains and resets */
+typedef struct {
+	stream_u32_list inds;
+	uint32_t head;
+} stream_queue;
+
+typedef struct {
+	uint64_t requested;
+	uint64_t dedup_hits;
+	uint64_t cancelled;
+	uint64_t failed;
+	uint64_t completed;
+	uint64_t bytes_read;
+	uint64_t bytes_decoded;
+	uint64_t bytes_uploaded;
+	uint64_t peak_mem;
+	uint64_t budget_waits;
+	uint64_t upload_retries;
+	uint64_t max_pump_ns;
+	uint64_t total_latency_ns;
+} stream_stats;
+
+/*
+ * three stages: io threads pread the stored bytes, the decode pool inflates and
+ * verifies them, and stream_pump hands finished data to each request's upload
+ * callback under a per-call byte budget. requests, releases and pumps come from
+ * one thread; only the budget-limited bytes of in-flight requests are resident
+ */
+struct streamer {
+	pthread_mutex_t lock;
+	pthread_cond_t io_cond;
+	pthread_t io_threads[STREAM_MAX_IO_THREADS];
+	uint32_t io_cnt;
+	tpool decoders;
+	stream_req_list reqs;
+	stream_u32_list free_reqs;
+	uint32_t *map;
+	uint32_t map_cap;
+	uint32_t map_cnt;
+	stream_queue io_queue[STREAM_PRIO_CNT];
+	stream_queue ready[STREAM_PRIO_CNT];
+	uint32_t in_flight;
+	uint64_t budget;
+	uint64_t mem_used;
+	stream_stats stats;
+	bool stopping;
+};
+
+void stream_init(streamer *s, uint64_t budget, uint32_t io_cnt, uint32_t decode_cnt);
+
+void stream_clean(streamer *s);
+
+stream_handle stream_request(streamer *s, const stream_desc *desc);
+
+void stream_release(streamer *s, stream_handle h);
+
+stream_state stream_status(streamer *s, stream_handle h);
+
+uint32_t stream_pending(streamer *s);
+
+void stream_pump(streamer *s, uint64_t upload_budget);
+
+void stream_get_stats(streamer *s, stream_stats *out);
+
+#endif
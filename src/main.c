@@ -1,21 +1,312 @@
 #include "util/debug.h"
 #include "engine/game.h"
+#include "engine/assets.h"
+#include "engine/stream.h"
+#include "engine/pacing.h"
+#include "util/arena.h"
+#include "util/prof.h"
 
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
+
+#define FRAME_ARENA_BLOCK_SIZE			(1024 * 1024)
+#define HEADLESS_DEFAULT_FRAMES			1000
 
 extern GLFWwindow				*wnd;
 
-int main(void)
+arena						frame_arena;
+job_system					jobs;
+streamer					stream;
+frame_pacer					pacer;
+
+static inline void dump_frame(char *filepath, uint32_t width, uint32_t height)
+{
+	FILE					*fp;
+	uint8_t					*pixels;
+
+	pixels = malloc((size_t)width * height * 4);
+
+	vk_read_frame(pixels);
+
+	fp = fopen(filepath, "wb");
+
+	if (fp == NULL)
+		dbg_error("could not open frame dump file");
+
+	fprintf(fp, "P6\n%u %u\n255\n", width, height);
+
+	for (size_t i = 0; i < (size_t)width * height; i++)
+		fwrite(pixels + i * 4, 1, 3, fp);
+
+	fclose(fp);
+	free(pixels);
+
+	dbg_log("dumped frame successfully");
+}
+
+/* every input event stamps the pacer, so the latency covers the whole path to present */
+static void key_input(GLFWwindow *window, int key, int scancode, int action, int mods)
+{
+	(void)window;
+	(void)key;
+	(void)scancode;
+	(void)action;
+	(void)mods;
+
+	pace_input(&pacer);
+}
+
+static void cursor_input(GLFWwindow *window, double x, double y)
 {
-	vk_init();
+	(void)window;
+	(void)x;
+	(void)y;
+
+	pace_input(&pacer);
+}
+
+static void button_input(GLFWwindow *window, int button, int action, int mods)
+{
+	(void)window;
+	(void)button;
+	(void)action;
+	(void)mods;
+
+	pace_input(&pacer);
+}
+
+static inline bool running(bool headless, uint32_t frame, uint32_t frame_limit)
+{
+	if (headless)
+		return frame < frame_limit;
+
+	return !glfwWindowShouldClose(wnd);
+}
+
+int main(int argc, char **argv)
+{
+	vk_config				cfg;
+	uint32_t				frame_limit;
+	char					*dump_path;
+	char					*trace_path;
+	char					*log_path;
+	char					*level_name;
+	dbg_level				log_level;
+	char					*pace_name;
+	pace_mode				pace;
+	uint32_t				fps;
+	bool					fps_set, fif_set;
+	bool					bench_upload;
+	uint32_t				bench_mesh_frames;
+	uint32_t				bench_instances;
+	bool					bench_cull;
+	bool					bench_record;
+	uint32_t				bench_resizes;
+	bool					bench_stream;
+	bool					bench_pipelines;
+	uint32_t				entity_cnt;
+	uint32_t				thread_cnt;
+	uint64_t				last_ns, now_ns;
+	float					dt;
+
+	cfg.frames_in_flight = VK_DEFAULT_FRAMES_IN_FLIGHT;
+	cfg.width = 800;
+	cfg.height = 600;
+	cfg.max_instances = VK_DEFAULT_MAX_INSTANCES;
+	cfg.headless = false;
+	cfg.gpu_stats = false;
+	cfg.present_pref = VK_PRESENT_PREF_MAILBOX;
+	cfg.jobs = &jobs;
+	cfg.stream = &stream;
+
+	frame_limit = HEADLESS_DEFAULT_FRAMES;
+	dump_path = NULL;
+	trace_path = NULL;
+	log_path = NULL;
+	level_name = NULL;
+	log_level = DBG_LEVEL_LOG;
+	pace_name = NULL;
+	pace = PACE_POWER_SAVING;
+	fps = 0;
+	fps_set = false;
+	fif_set = false;
+	bench_upload = false;
+	bench_mesh_frames = 0;
+	bench_instances = 0;
+	bench_cull = false;
+	bench_record = false;
+	bench_resizes = 0;
+	bench_stream = false;
+	bench_pipelines = false;
+	entity_cnt = 0;
+	thread_cnt = 0;
+
+	for (int i = 1; i < argc; i++) {
+		if (strcmp(argv[i], "--headless") == 0)
+			cfg.headless = true;
+		else if (strcmp(argv[i], "--frames") == 0 && i + 1 < argc)
+			frame_limit = strtoul(argv[++i], NULL, 10);
+		else if (strcmp(argv[i], "--frames-in-flight") == 0 && i + 1 < argc) {
+			cfg.frames_in_flight = strtoul(argv[++i], NULL, 10);
+			fif_set = true;
+		} else if (strcmp(argv[i], "--dump") == 0 && i + 1 < argc)
+			dump_path = argv[++i];
+		else if (strcmp(argv[i], "--trace") == 0 && i + 1 < argc)
+			trace_path = argv[++i];
+		else if (strcmp(argv[i], "--gpu-stats") == 0)
+			cfg.gpu_stats = true;
+		else if (strcmp(argv[i], "--log") == 0 && i + 1 < argc)
+			log_path = argv[++i];
+		else if (strcmp(argv[i], "--log-level") == 0 && i + 1 < argc)
+			level_name = argv[++i];
+		else if (strcmp(argv[i], "--pacing") == 0 && i + 1 < argc)
+			pace_name = argv[++i];
+		else if (strcmp(argv[i], "--fps") == 0 && i + 1 < argc) {
+			fps = strtoul(argv[++i], NULL, 10);
+			fps_set = true;
+		} else if (strcmp(argv[i], "--bench-upload") == 0)
+			bench_upload = true;
+		else if (strcmp(argv[i], "--bench-mesh") == 0 && i + 1 < argc)
+			bench_mesh_frames = strtoul(argv[++i], NULL, 10);
+		else if (strcmp(argv[i], "--bench-instances") == 0 && i + 1 < argc)
+			bench_instances = strtoul(argv[++i], NULL, 10);
+		else if (strcmp(argv[i], "--bench-cull") == 0)
+			bench_cull = true;
+		else if (strcmp(argv[i], "--bench-record") == 0)
+			bench_record = true;
+		else if (strcmp(argv[i], "--bench-resize") == 0 && i + 1 < argc)
+			bench_resizes = strtoul(argv[++i], NULL, 10);
+		else if (strcmp(argv[i], "--bench-stream") == 0)
+			bench_stream = true;
+		else if (strcmp(argv[i], "--bench-pipelines") == 0)
+			bench_pipelines = true;
+		else if (strcmp(argv[i], "--entities") == 0 && i + 1 < argc)
+			entity_cnt = strtoul(argv[++i], NULL, 10);
+		else if (strcmp(argv[i], "--threads") == 0 && i + 1 < argc)
+			thread_cnt = strtoul(argv[++i], NULL, 10);
+		else
+			dbg_warn("ignoring unknown argument %s", argv[i]);
+	}
+
+	if (level_name != NULL && !dbg_parse_level(level_name, &log_level))
+		dbg_warn("unknown log level %s, expected log, info, warn or error", level_name);
+
+	if (pace_name != NULL && !pace_parse_mode(pace_name, &pace))
+		dbg_warn("unknown pacing %s, expected low-latency, power-saving or target-fps", pace_name);
 
-	while (!glfwWindowShouldClose(wnd))
-		glfwPollEvents();
+	/* headless runs are benchmarks, so they stay uncapped unless pacing is asked for */
+	if (cfg.headless && pace_name == NULL)
+		pace = PACE_LOW_LATENCY;
+	else if (!fps_set)
+		fps = pace == PACE_LOW_LATENCY ? PACE_DEFAULT_CAP_FPS : PACE_DEFAULT_FPS;
 
+	if (pace == PACE_LOW_LATENCY)
+		cfg.present_pref = VK_PRESENT_PREF_LOW_LATENCY;
+	else if (pace == PACE_POWER_SAVING)
+		cfg.present_pref = VK_PRESENT_PREF_VSYNC;
+
+	/* a second frame in flight is a frame of queued latency; headless runs keep theirs for the benchmarks */
+	if (pace == PACE_LOW_LATENCY && !fif_set && !cfg.headless)
+		cfg.frames_in_flight = 1;
+
+	if (bench_instances > cfg.max_instances)
+		cfg.max_instances = bench_instances;
+
+	if (bench_cull && cfg.max_instances < VK_BENCH_CULL_MAX_INSTANCES)
+		cfg.max_instances = VK_BENCH_CULL_MAX_INSTANCES;
+
+	if (entity_cnt >= cfg.max_instances)
+		cfg.max_instances = entity_cnt + 1;
+
+	dbg_init(log_level, log_path);
+	arena_init(&frame_arena, FRAME_ARENA_BLOCK_SIZE);
+	prof_init(trace_path);
+	job_init(&jobs, thread_cnt);
+
+	assets_init("build/assets.pak", "build");
+	cull_init();
+
+	/* the renderer streams its scene in, so the streamer comes up first */
+	stream_init(&stream, STREAM_DEFAULT_BUDGET, 0, 0);
+	vk_init(&cfg);
+
+	if (bench_upload)
+		vk_bench_upload();
+
+	if (bench_mesh_frames > 0)
+		vk_bench_mesh(bench_mesh_frames);
+
+	if (bench_instances > 0)
+		vk_bench_instances(bench_instances, frame_limit);
+
+	if (bench_cull)
+		vk_bench_cull(frame_limit);
+
+	if (bench_record)
+		vk_bench_record(frame_limit);
+
+	if (bench_resizes > 0)
+		vk_bench_resize(bench_resizes);
+
+	if (bench_stream)
+		vk_bench_stream();
+
+	if (bench_pipelines)
+		vk_bench_pipelines();
+
+	game_init(entity_cnt, &jobs);
+
+	pace_init(&pacer, pace, fps);
+
+	if (!cfg.headless) {
+		pace_set_events(&pacer, glfwPollEvents, glfwWaitEventsTimeout);
+
+		glfwSetKeyCallback(wnd, key_input);
+		glfwSetCursorPosCallback(wnd, cursor_input);
+		glfwSetMouseButtonCallback(wnd, button_input);
+	}
+
+	last_ns = time_now_ns();
+
+	for (uint32_t frame = 0; running(cfg.headless, frame, frame_limit); frame++) {
+		arena_reset(&frame_arena);
+		mem_frame_begin();
+
+		/* waits out the frame budget and polls events, in place of a bare poll that spun a whole core */
+		pace_frame_begin(&pacer);
+
+		/* headless runs step a fixed 60 hz so frame dumps are reproducible */
+		now_ns = time_now_ns();
+		dt = cfg.headless ? 1.0f / 60.0f : (float)(now_ns - last_ns) / 1e9f;
+		last_ns = now_ns;
+
+		game_update(dt);
+		stream_pump(&stream, STREAM_FRAME_UPLOAD_BUDGET);
+		vk_draw_frame();
+		pace_frame_end(&pacer);
+
+		prof_frame_end();
+		dbg_set_frame(frame + 1);
+	}
+
+	pace_report(&pacer);
+	pace_clean(&pacer);
+
+	if (dump_path != NULL)
+		dump_frame(dump_path, cfg.width, cfg.height);
+
+	game_clean();
+	stream_clean(&stream);
 	vk_clean();
+	assets_clean();
+
+	job_clean(&jobs);
+	prof_clean();
+	arena_clean(&frame_arena);
 
 	dbg_info("ran successfully");
+	dbg_clean();
 
 	return 0;
-}
\ No newline at end of file
+}
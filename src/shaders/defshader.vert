@@ -1,21 +1,18 @@
 #version 450
 
-layout(location = 0) out vec3 fragColor;
+layout(push_constant) uniform PushConstants {
+	mat4 viewProj;
+} pc;
 
-vec2 positions[3] = vec2[](
-	vec2(0.0, -0.5),
-	vec2(0.5, 0.5),
-	vec2(-0.5, 0.5)
-);
+layout(location = 0) in vec3 inPos;
+layout(location = 1) in vec2 inNormal;
+layout(location = 2) in vec4 inColor;
+layout(location = 3) in mat4 inModel;
 
-vec3 colors[3] = vec3[](
-	vec3(1.0, 0.0, 0.0),
-	vec3(0.0, 1.0, 0.0),
-	vec3(0.0, 0.0, 1.0)
-);
+layout(location = 0) out vec3 fragColor;
 
 void main()
 {
-	gl_Position = vec4(positions[gl_VertexIndex], 0.0, 1.0);
-	fragColor = colors[gl_VertexIndex];
+	gl_Position = pc.viewProj * inModel * vec4(inPos, 1.0);
+	fragColor = inColor.rgb;
 }
\ No newline at end of file
@@ -0,0 +1,183 @@
+#include "arena.h"
+
+static uint64_t					heap_call_cnt;
+static uint64_t					frame_start_cnt;
+
+static inline size_t align_up(size_t val, size_t align)
+{
+	return (val + align - 1) & ~(align - 1);
+}
+
+static inline arena_block *arena_new_block(size_t cap)
+{
+	arena_block				*block;
+
+	block = mem_alloc(align_up(sizeof(arena_block), ARENA_ALIGN) + cap);
+
+	if (block == NULL)
+		dbg_error("failed to allocate arena block");
+
+	block->next = NULL;
+	block->used = 0;
+	block->cap = cap;
+	block->data = (uint8_t *)block + align_up(sizeof(arena_block), ARENA_ALIGN);
+
+	return block;
+}
+
+void *mem_alloc(size_t size)
+{
+	__atomic_fetch_add(&heap_call_cnt, 1, __ATOMIC_RELAXED);
+
+	return malloc(size);
+}
+
+void *mem_realloc(void *ptr, size_t size)
+{
+	__atomic_fetch_add(&heap_call_cnt, 1, __ATOMIC_RELAXED);
+
+	return realloc(ptr, size);
+}
+
+void mem_free(void *ptr)
+{
+	if (ptr == NULL)
+		return;
+
+	__atomic_fetch_add(&heap_call_cnt, 1, __ATOMIC_RELAXED);
+
+	free(ptr);
+}
+
+uint64_t mem_heap_call_cnt(void)
+{
+	return __atomic_load_n(&heap_call_cnt, __ATOMIC_RELAXED);
+}
+
+void mem_frame_begin(void)
+{
+	frame_start_cnt = mem_heap_call_cnt();
+}
+
+uint64_t mem_frame_heap_calls(void)
+{
+	return mem_heap_call_cnt() - frame_start_cnt;
+}
+
+void arena_init(arena *a, size_t block_size)
+{
+	a->block_size = align_up(block_size, ARENA_ALIGN);
+	a->head = arena_new_block(a->block_size);
+	a->cur = a->head;
+}
+
+void arena_clean(arena *a)
+{
+	arena_block				*block, *next;
+
+	for (block = a->head; block != NULL; block = next) {
+		next = block->next;
+		mem_free(block);
+	}
+
+	a->head = NULL;
+	a->cur = NULL;
+}
+
+void *arena_alloc(arena *a, size_t size)
+{
+	arena_block				*block;
+	size_t					offset;
+
+	size = align_up(size, ARENA_ALIGN);
+	offset = a->cur->used;
+
+	if (offset + size > a->cur->cap) {
+		if (a->cur->next != NULL && a->cur->next->cap >= size) {
+			a->cur = a->cur->next;
+		} else {
+			block = arena_new_block(size > a->block_size ? size : a->block_size);
+			block->next = a->cur->next;
+			a->cur->next = block;
+			a->cur = block;
+		}
+
+		a->cur->used = 0;
+		offset = 0;
+	}
+
+	a->cur->used = offset + size;
+
+	return a->cur->data + offset;
+}
+
+arena_mark arena_get_mark(arena *a)
+{
+	return (arena_mark){
+		a->cur,
+		a->cur->used
+	};
+}
+
+void arena_reset_to(arena *a, arena_mark mark)
+{
+	a->cur = mark.block;
+	a->cur->used = mark.used;
+}
+
+void arena_reset(arena *a)
+{
+	a->cur = a->head;
+	a->cur->used = 0;
+}
+
+void pool_init(pool *p, uint32_t block_size, uint32_t block_cnt)
+{
+	if (block_size < sizeof(void *))
+		block_size = sizeof(void *);
+
+	p->block_size = align_up(block_size, sizeof(void *));
+	p->block_cnt = block_cnt;
+	p->used_cnt = 0;
+	p->mem = mem_alloc((size_t)p->block_size * block_cnt);
+
+	if (p->mem == NULL)
+		dbg_error("failed to allocate pool");
+
+	p->free_list = NULL;
+
+	for (uint32_t i = block_cnt; i > 0; i--) {
+		*(void **)(p->mem + (size_t)p->block_size * (i - 1)) = p->free_list;
+		p->free_list = p->mem + (size_t)p->block_size * (i - 1);
+	}
+}
+
+void pool_clean(pool *p)
+{
+	mem_free(p->mem);
+
+	p->mem = NULL;
+	p->free_list = NULL;
+	p->used_cnt = 0;
+}
+
+void *pool_alloc(pool *p)
+{
+	void					*block;
+
+	if (p->free_list == NULL)
+		dbg_error("pool is out of blocks");
+
+	block = p->free_list;
+	p->free_list = *(void **)block;
+	p->used_cnt++;
+
+	return block;
+}
+
+void pool_free(pool *p, void *block)
+{
+	*(void **)block = p->free_list;
+	p->free_list = block;
+	p->used_cnt--;
+}
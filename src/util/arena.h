@@ -0,0 +1,73 @@
+#ifndef ARENA_H_INCLUDED
+#define ARENA_H_INCLUDED
+
+#include "debug.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+
+#define ARENA_ALIGN				16
+
+#define ARENA_PUSH(a, type, n)			((type *)arena_alloc((a), sizeof(type) * (n)))
+
+typedef struct arena_block {
+	struct arena_block *next;
+	size_t used;
+	size_t cap;
+	uint8_t *data;
+} arena_block;
+
+typedef struct {
+	arena_block *head;
+	arena_block *cur;
+	size_t block_size;
+} arena;
+
+typedef struct {
+	arena_block *block;
+	size_t used;
+} arena_mark;
+
+typedef struct {
+	uint8_t *mem;
+	void *free_list;
+	uint32_t block_size;
+	uint32_t block_cnt;
+	uint32_t used_cnt;
+} pool;
+
+void *mem_alloc(size_t size);
+
+void *mem_realloc(void *ptr, size_t size);
+
+void mem_free(void *ptr);
+
+uint64_t mem_heap_call_cnt(void);
+
+void mem_frame_begin(void);
+
+uint64_t mem_frame_heap_calls(void);
+
+void arena_init(arena *a, size_t block_size);
+
+void arena_clean(arena *a);
+
+void *arena_alloc(arena *a, size_t size);
+
+arena_mark arena_get_mark(arena *a);
+
+void arena_reset_to(arena *a, arena_mark mark);
+
+void arena_reset(arena *a);
+
+void pool_init(pool *p, uint32_t block_size, uint32_t block_cnt);
+
+void pool_clean(pool *p);
+
+void *pool_alloc(pool *p);
+
+void pool_free(pool *p, void *block);
+
+#endif
@@ -1,22 +1,1022 @@
 #include "debug.h"
 
-void dbg_info(char *msg)
+#include <stddef.h>
+#include <string.h>
+#include <time.h>
+#include <signal.h>
+#include <unistd.h>
+#include <sched.h>
+
+static const char *level_names[] = {
+	"LOG",
+	"INFO",
+	"WARN",
+	"ERROR"
+};
+
+static const char *level_args[] = {
+	"log",
+	"info",
+	"warn",
+	"error"
+};
+
+static const int crash_sigs[] = {
+	SIGSEGV,
+	SIGBUS,
+	SIGFPE,
+	SIGILL,
+	SIGABRT
+};
+
+dbg_level					dbg_runtime_level = DBG_LEVEL_LOG;
+
+static __thread dbg_thread			*dbg_cur;
+static __thread uint32_t			dbg_cur_gen;
+static __thread bool				dbg_unlisted;
+static uint32_t					ring_gen;
+static dbg_thread				*threads[DBG_MAX_THREADS];
+static uint32_t					thread_cnt;
+static pthread_mutex_t				reg_lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_mutex_t				out_lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_mutex_t				wake_lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t				wake_cond = PTHREAD_COND_INITIALIZER;
+static pthread_t				writer;
+static bool					started, running, stopping;
+static FILE					*out_fp;
+static int					out_fd = STDOUT_FILENO;
+static bool					crashing;
+static char					batch[DBG_BATCH_SIZE];
+static uint32_t					batch_len;
+static uint64_t					base_ns;
+static uint64_t					cur_frame;
+
+/* one conversion of a format string; width and precision are -1 when absent */
+typedef struct {
+	const char				*flags;
+	uint32_t				flags_len;
+	int32_t					width, prec;
+	bool					star_width, star_prec;
+	char					len;
+	char					conv;
+} fmt_spec;
+
+/* util.h sits above this file, so the clock is read here directly */
+static inline uint64_t now_ns(void)
+{
+	struct timespec				ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+
+	return (uint64_t)ts.tv_sec * 1000000000ull + ts.tv_nsec;
+}
+
+static inline FILE *out(void)
+{
+	return out_fp != NULL ? out_fp : stdout;
+}
+
+static inline void out_flush(void)
+{
+	fwrite(batch, 1, batch_len, out());
+	fflush(out());
+
+	batch_len = 0;
+}
+
+/* stdio is off limits in a signal handler, so the crash path writes to the descriptor cached by dbg_init */
+static inline void out_write_raw(const char *buf, uint32_t len)
+{
+	ssize_t					n;
+
+	for (uint32_t done = 0; done < len; done += n) {
+		n = write(out_fd, buf + done, len - done);
+
+		if (n <= 0)
+			break;
+	}
+}
+
+/* decimal digits of v, at least min_digits of them, zero padded */
+static inline char *put_u64(char *p, uint64_t v, uint32_t min_digits)
+{
+	char					tmp[20];
+	uint32_t				n;
+
+	n = 0;
+
+	do {
+		tmp[n++] = '0' + v % 10;
+		v /= 10;
+	} while (v > 0 || n < min_digits);
+
+	while (n > 0)
+		*p++ = tmp[--n];
+
+	return p;
+}
+
+static inline char *put_str(char *p, const char *s, uint32_t len)
+{
+	memcpy(p, s, len);
+
+	return p + len;
+}
+
+/* parses the conversion after a '%'; hh and ll are kept as 'H' and 'q', NULL means the spec is not deferred */
+static inline const char *parse_spec(const char *p, fmt_spec *s)
+{
+	memset(s, '\0', sizeof(*s));
+
+	s->flags = p;
+
+	while (*p == '-' || *p == '+' || *p == ' ' || *p == '#' || *p == '0')
+		p++;
+
+	s->flags_len = p - s->flags;
+	s->width = -1;
+	s->prec = -1;
+
+	if (*p == '*') {
+		s->star_width = true;
+		p++;
+	}
+
+	for (; *p >= '0' && *p <= '9' && s->width < 10000; p++)
+		s->width = (s->width < 0 ? 0 : s->width * 10) + (*p - '0');
+
+	if (*p == '.') {
+		s->prec = 0;
+
+		if (*++p == '*') {
+			s->star_prec = true;
+			p++;
+		}
+
+		for (; *p >= '0' && *p <= '9' && s->prec < 10000; p++)
+			s->prec = s->prec * 10 + (*p - '0');
+	}
+
+	if ((p[0] == 'h' && p[1] == 'h') || (p[0] == 'l' && p[1] == 'l')) {
+		s->len = p[0] == 'h' ? 'H' : 'q';
+		p += 2;
+	} else if (*p == 'h' || *p == 'l' || *p == 'j' || *p == 'z' || *p == 't' || *p == 'L') {
+		s->len = *p++;
+	}
+
+	s->conv = *p;
+
+	/* wide characters, long doubles and %n stay on the eager path, as do digits too long to rebuild */
+	if (*p == '\0' || s->flags_len > 4 || s->width >= 10000 || s->prec >= 10000 ||
+		(s->len == 'l' && (*p == 'c' || *p == 's')) || s->len == 'L' || *p == 'n')
+		return NULL;
+
+	return p + 1;
+}
+
+static inline bool put_arg(dbg_record *rec, const void *v, uint32_t size)
+{
+	if (rec->len + size > DBG_MSG_MAX)
+		return false;
+
+	memcpy(rec->msg + rec->len, v, size);
+	rec->len += size;
+
+	return true;
+}
+
+static inline int64_t signed_arg(char len, va_list *ap)
+{
+	switch (len) {
+	case 'H':
+		return (signed char)va_arg(*ap, int);
+	case 'h':
+		return (short)va_arg(*ap, int);
+	case 'l':
+		return va_arg(*ap, long);
+	case 'q':
+		return va_arg(*ap, long long);
+	case 'j':
+		return va_arg(*ap, intmax_t);
+	case 'z':
+		return va_arg(*ap, ssize_t);
+	case 't':
+		return va_arg(*ap, ptrdiff_t);
+	default:
+		return va_arg(*ap, int);
+	}
+}
+
+static inline uint64_t unsigned_arg(char len, va_list *ap)
+{
+	switch (len) {
+	case 'H':
+		return (unsigned char)va_arg(*ap, unsigned int);
+	case 'h':
+		return (unsigned short)va_arg(*ap, unsigned int);
+	case 'l':
+		return va_arg(*ap, unsigned long);
+	case 'q':
+		return va_arg(*ap, unsigned long long);
+	case 'j':
+		return va_arg(*ap, uintmax_t);
+	case 'z':
+		return va_arg(*ap, size_t);
+	case 't':
+		return va_arg(*ap, ptrdiff_t);
+	default:
+		return va_arg(*ap, unsigned int);
+	}
+}
+
+/*
+ * copies the arguments fmt consumes into rec->msg, in order: star values as int, integers widened to 64 bits,
+ * floats as double, pointers as is and strings inline up to their precision; false sends the caller to vsnprintf
+ */
+static inline bool capture_args(dbg_record *rec, const char *fmt, va_list *ap)
+{
+	fmt_spec				s;
+	const char				*str;
+	int64_t					i;
+	uint64_t				u;
+	double					d;
+	void					*ptr;
+	int					star;
+	size_t					n;
+
+	rec->len = 0;
+
+	while ((fmt = strchr(fmt, '%')) != NULL) {
+		if (fmt[1] == '%') {
+			fmt += 2;
+
+			continue;
+		}
+
+		fmt = parse_spec(fmt + 1, &s);
+
+		if (fmt == NULL)
+			return false;
+
+		if (s.star_width) {
+			star = va_arg(*ap, int);
+
+			if (!put_arg(rec, &star, sizeof(star)))
+				return false;
+		}
+
+		if (s.star_prec) {
+			star = va_arg(*ap, int);
+			s.prec = star;
+
+			if (!put_arg(rec, &star, sizeof(star)))
+				return false;
+		}
+
+		switch (s.conv) {
+		case 'd':
+		case 'i':
+		case 'c':
+			i = signed_arg(s.len, ap);
+
+			if (!put_arg(rec, &i, sizeof(i)))
+				return false;
+
+			break;
+		case 'u':
+		case 'o':
+		case 'x':
+		case 'X':
+			u = unsigned_arg(s.len, ap);
+
+			if (!put_arg(rec, &u, sizeof(u)))
+				return false;
+
+			break;
+		case 'e':
+		case 'E':
+		case 'f':
+		case 'F':
+		case 'g':
+		case 'G':
+		case 'a':
+		case 'A':
+			d = va_arg(*ap, double);
+
+			if (!put_arg(rec, &d, sizeof(d)))
+				return false;
+
+			break;
+		case 'p':
+			ptr = va_arg(*ap, void *);
+
+			if (!put_arg(rec, &ptr, sizeof(ptr)))
+				return false;
+
+			break;
+		case 's':
+			str = va_arg(*ap, const char *);
+
+			if (str == NULL)
+				str = "(null)";
+
+			n = s.prec >= 0 ? strnlen(str, s.prec) : strlen(str);
+
+			if (n >= DBG_MSG_MAX || !put_arg(rec, str, n) || !put_arg(rec, "", 1))
+				return false;
+
+			break;
+		default:
+			return false;
+		}
+	}
+
+	return true;
+}
+
+static inline char *put_int(char *p, int32_t v)
+{
+	if (v < 0) {
+		*p++ = '-';
+		v = -v;
+	}
+
+	return put_u64(p, v, 1);
+}
+
+/* replays a deferred record on the writer thread, one snprintf per conversion with the captured argument */
+static inline uint32_t render_args(const dbg_record *rec, char *dst)
+{
+	fmt_spec				s;
+	char					spec[DBG_MAX_SPEC];
+	const char				*fmt, *lit, *arg;
+	char					*p;
+	int64_t					i;
+	uint64_t				u;
+	double					d;
+	void					*ptr;
+	int					star, n;
+	uint32_t				len, room;
+
+	fmt = rec->fmt;
+	arg = rec->msg;
+	len = 0;
+
+	while (*fmt != '\0' && len < DBG_MSG_MAX - 1) {
+		lit = fmt;
+
+		while (*fmt != '\0' && *fmt != '%')
+			fmt++;
+
+		n = fmt - lit < DBG_MSG_MAX - 1 - len ? fmt - lit : DBG_MSG_MAX - 1 - len;
+		memcpy(dst + len, lit, n);
+		len += n;
+
+		if (*fmt == '\0' || len == DBG_MSG_MAX - 1)
+			break;
+
+		if (fmt[1] == '%') {
+			dst[len++] = '%';
+			fmt += 2;
+
+			continue;
+		}
+
+		fmt = parse_spec(fmt + 1, &s);
+
+		if (s.star_width) {
+			memcpy(&star, arg, sizeof(star));
+			arg += sizeof(star);
+			s.width = star;
+		}
+
+		if (s.star_prec) {
+			memcpy(&star, arg, sizeof(star));
+			arg += sizeof(star);
+			s.prec = star;
+		}
+
+		room = DBG_MSG_MAX - len;
+
+		/* plain %d and %u are most of what gets logged, they skip snprintf */
+		if ((s.conv == 'd' || s.conv == 'i' || s.conv == 'u') && s.flags_len == 0 && !s.star_width &&
+			s.width < 0 && s.prec < 0 && room > 21) {
+			memcpy(&u, arg, sizeof(u));
+			arg += sizeof(u);
+			p = dst + len;
+
+			if (s.conv != 'u' && (int64_t)u < 0) {
+				*p++ = '-';
+				u = -u;
+			}
+
+			len = put_u64(p, u, 1) - dst;
+
+			continue;
+		}
+
+		/* a star value lands in the spec text as digits, a negative width reads back as the '-' flag */
+		p = spec;
+		*p++ = '%';
+		p = put_str(p, s.flags, s.flags_len);
+
+		if (s.star_width || s.width >= 0)
+			p = put_int(p, s.width);
+
+		if (s.prec >= 0) {
+			*p++ = '.';
+			p = put_int(p, s.prec);
+		}
+
+		switch (s.conv) {
+		case 'd':
+		case 'i':
+		case 'c':
+			memcpy(&i, arg, sizeof(i));
+			arg += sizeof(i);
+
+			if (s.conv != 'c')
+				p = put_str(p, "ll", 2);
+
+			*p++ = s.conv;
+			*p = '\0';
+
+			if (s.conv == 'c')
+				n = snprintf(dst + len, room, spec, (int)i);
+			else
+				n = snprintf(dst + len, room, spec, (long long)i);
+
+			break;
+		case 'u':
+		case 'o':
+		case 'x':
+		case 'X':
+			memcpy(&u, arg, sizeof(u));
+			arg += sizeof(u);
+
+			p = put_str(p, "ll", 2);
+			*p++ = s.conv;
+			*p = '\0';
+
+			n = snprintf(dst + len, room, spec, (unsigned long long)u);
+
+			break;
+		case 'p':
+			memcpy(&ptr, arg, sizeof(ptr));
+			arg += sizeof(ptr);
+
+			*p++ = s.conv;
+			*p = '\0';
+
+			n = snprintf(dst + len, room, spec, ptr);
+
+			break;
+		case 's':
+			*p++ = s.conv;
+			*p = '\0';
+
+			n = snprintf(dst + len, room, spec, arg);
+			arg += strlen(arg) + 1;
+
+			break;
+		default:
+			memcpy(&d, arg, sizeof(d));
+			arg += sizeof(d);
+
+			*p++ = s.conv;
+			*p = '\0';
+
+			n = snprintf(dst + len, room, spec, d);
+
+			break;
+		}
+
+		if (n > 0)
+			len += (uint32_t)n < room ? (uint32_t)n : room - 1;
+	}
+
+	return len;
+}
+
+/* everything up to the message: [LEVEL] t=s.us thread=n frame=n " */
+static inline char *put_prefix(char *p, const dbg_record *rec, uint32_t tid)
+{
+	uint64_t				us;
+
+	us = (rec->ns - base_ns) / 1000;
+
+	*p++ = '[';
+	p = put_str(p, level_names[rec->level], strlen(level_names[rec->level]));
+	p = put_str(p, "] t=", 4);
+	p = put_u64(p, us / 1000000, 1);
+	*p++ = '.';
+	p = put_u64(p, us % 1000000, 6);
+	p = put_str(p, " thread=", 8);
+
+	/* threads log without a ring before dbg_init, after dbg_clean and past the cap */
+	if (tid < DBG_MAX_THREADS)
+		p = put_u64(p, tid, 1);
+	else
+		*p++ = '-';
+
+	p = put_str(p, " frame=", 7);
+	p = put_u64(p, rec->frame, 1);
+
+	return put_str(p, " \"", 2);
+}
+
+/* the writer formats every line, so this avoids printf; the output is "[LEVEL] t=s.us thread=n frame=n "msg"" */
+static inline void append_line(const dbg_record *rec, uint32_t tid)
+{
+	char					text[DBG_MSG_MAX];
+	const char				*msg;
+	char					*p;
+	uint32_t				len;
+
+	if (batch_len + DBG_RECORD_SIZE + 128 > DBG_BATCH_SIZE)
+		out_flush();
+
+	if (rec->fmt != NULL) {
+		len = render_args(rec, text);
+		msg = text;
+	} else {
+		len = rec->len;
+		msg = rec->msg;
+	}
+
+	p = put_prefix(batch + batch_len, rec, tid);
+	p = put_str(p, msg, len);
+	p = put_str(p, "\"\n", 2);
+
+	batch_len = p - batch;
+}
+
+/*
+ * the signal safe variant: a deferred record would need snprintf, so its format string is
+ * written as is with a marker, and a finished record is written as the text it already holds
+ */
+static inline void crash_line(const dbg_record *rec, uint32_t tid)
+{
+	static const char			marker[] = "\" [unformatted]\n";
+	char					line[DBG_RECORD_SIZE + 128];
+	char					*p;
+
+	p = put_prefix(line, rec, tid);
+
+	if (rec->fmt != NULL) {
+		p = put_str(p, rec->fmt, strnlen(rec->fmt, DBG_MSG_MAX - 1));
+		p = put_str(p, marker, sizeof(marker) - 1);
+	} else {
+		p = put_str(p, rec->msg, rec->len);
+		p = put_str(p, "\"\n", 2);
+	}
+
+	out_write_raw(line, p - line);
+}
+
+/* merges every ring by timestamp up to the heads seen on entry; callers hold out_lock */
+static inline void drain_all(void)
+{
+	uint64_t				heads[DBG_MAX_THREADS];
+	dbg_thread				*t, *best;
+	dbg_record				*rec, *best_rec;
+	uint32_t				cnt;
+
+	cnt = __atomic_load_n(&thread_cnt, __ATOMIC_ACQUIRE);
+
+	for (uint32_t i = 0; i < cnt; i++)
+		heads[i] = __atomic_load_n(&threads[i]->head, __ATOMIC_ACQUIRE);
+
+	for (;;) {
+		best = NULL;
+		best_rec = NULL;
+
+		for (uint32_t i = 0; i < cnt; i++) {
+			t = threads[i];
+
+			if (t->tail == heads[i])
+				continue;
+
+			rec = &t->ring[t->tail & (DBG_RING_CAP - 1)];
+
+			if (best == NULL || rec->ns < best_rec->ns) {
+				best = t;
+				best_rec = rec;
+			}
+		}
+
+		if (best == NULL)
+			break;
+
+		append_line(best_rec, best->tid);
+
+		__atomic_store_n(&best->tail, best->tail + 1, __ATOMIC_RELEASE);
+	}
+
+	if (batch_len > 0)
+		out_flush();
+}
+
+/*
+ * the same merge for the crash handler, which takes no locks and leaves the tails alone: it walks
+ * private copies, so a writer interrupted mid-drain can at worst have its last lines written twice
+ */
+static inline void crash_drain(void)
+{
+	uint64_t				heads[DBG_MAX_THREADS], tails[DBG_MAX_THREADS];
+	dbg_record				*rec, *best_rec;
+	uint32_t				cnt, best;
+
+	cnt = __atomic_load_n(&thread_cnt, __ATOMIC_ACQUIRE);
+
+	for (uint32_t i = 0; i < cnt; i++) {
+		heads[i] = __atomic_load_n(&threads[i]->head, __ATOMIC_ACQUIRE);
+		tails[i] = __atomic_load_n(&threads[i]->tail, __ATOMIC_ACQUIRE);
+	}
+
+	for (;;) {
+		best = cnt;
+		best_rec = NULL;
+
+		for (uint32_t i = 0; i < cnt; i++) {
+			if (tails[i] == heads[i])
+				continue;
+
+			rec = &threads[i]->ring[tails[i] & (DBG_RING_CAP - 1)];
+
+			if (best_rec == NULL || rec->ns < best_rec->ns) {
+				best = i;
+				best_rec = rec;
+			}
+		}
+
+		if (best_rec == NULL)
+			break;
+
+		crash_line(best_rec, threads[best]->tid);
+
+		tails[best]++;
+	}
+}
+
+static inline dbg_thread *register_thread(void)
+{
+	dbg_thread				*t;
+
+	t = aligned_alloc(DBG_CACHE_LINE, sizeof(dbg_thread));
+
+	if (t == NULL)
+		return NULL;
+
+	memset(t, '\0', sizeof(dbg_thread));
+
+	t->ring = malloc(DBG_RING_CAP * sizeof(dbg_record));
+
+	pthread_mutex_lock(&reg_lock);
+
+	if (t->ring == NULL || thread_cnt == DBG_MAX_THREADS) {
+		pthread_mutex_unlock(&reg_lock);
+
+		free(t->ring);
+		free(t);
+
+		/* past the cap a thread just logs synchronously */
+		dbg_unlisted = true;
+
+		return NULL;
+	}
+
+	t->tid = thread_cnt;
+	threads[thread_cnt] = t;
+	dbg_cur_gen = ring_gen;
+
+	__atomic_store_n(&thread_cnt, thread_cnt + 1, __ATOMIC_RELEASE);
+
+	pthread_mutex_unlock(&reg_lock);
+
+	dbg_cur = t;
+
+	return t;
+}
+
+/*
+ * dbg_clean retires every ring by bumping the generation, so a thread still holding one from before
+ * drops it without touching the freed memory and falls back to direct writes until it registers again
+ */
+static inline dbg_thread *cur_thread(void)
 {
-	printf("[INFO] \"%s\"\n", msg);
+	uint32_t				gen;
+
+	gen = __atomic_load_n(&ring_gen, __ATOMIC_ACQUIRE);
+
+	if (dbg_cur_gen != gen) {
+		dbg_cur = NULL;
+		dbg_cur_gen = gen;
+		dbg_unlisted = false;
+	}
+
+	return dbg_cur;
+}
+
+static inline void wake_writer(void)
+{
+	pthread_mutex_lock(&wake_lock);
+	pthread_cond_signal(&wake_cond);
+	pthread_mutex_unlock(&wake_lock);
+}
+
+/* the cached tail lags the writer, so it is reloaded before deciding the ring is really filling up */
+static inline bool ring_filling(dbg_thread *t, uint64_t h)
+{
+	t->tail_cache = __atomic_load_n(&t->tail, __ATOMIC_ACQUIRE);
+
+	return h - t->tail_cache >= DBG_RING_CAP * 3 / 4;
 }
 
-void dbg_log(char *msg)
+/* a full ring stalls the caller until the writer catches up, lines are never dropped */
+static inline bool wait_for_space(dbg_thread *t, uint64_t h)
 {
-	printf("[LOG] \"%s\"\n", msg);
+	for (;;) {
+		t->tail_cache = __atomic_load_n(&t->tail, __ATOMIC_ACQUIRE);
+
+		if (h - t->tail_cache < DBG_RING_CAP)
+			return true;
+
+		if (!__atomic_load_n(&running, __ATOMIC_ACQUIRE))
+			return false;
+
+		wake_writer();
+		sched_yield();
+	}
 }
 
-void dbg_warn(char *msg)
+/* a literal format outlives the record, so only its arguments are copied and the writer does the formatting */
+static inline void fill_record(dbg_record *rec, dbg_level level, bool lit, const char *fmt, va_list args)
 {
-	printf("[WARN] \"%s\"\n", msg);
+	va_list					ap;
+	int					n;
+
+	rec->fmt = NULL;
+
+	if (lit) {
+		va_copy(ap, args);
+
+		if (capture_args(rec, fmt, &ap))
+			rec->fmt = fmt;
+
+		va_end(ap);
+	}
+
+	if (rec->fmt == NULL) {
+		n = vsnprintf(rec->msg, DBG_MSG_MAX, fmt, args);
+		rec->len = n < 0 ? 0 : n < DBG_MSG_MAX ? (uint32_t)n : DBG_MSG_MAX - 1;
+	}
+
+	rec->ns = now_ns();
+	rec->frame = __atomic_load_n(&cur_frame, __ATOMIC_RELAXED);
+	rec->level = level;
+}
+
+static inline void write_sync(dbg_thread *t, dbg_level level, const char *fmt, va_list args)
+{
+	dbg_record				rec;
+
+	fill_record(&rec, level, false, fmt, args);
+
+	pthread_mutex_lock(&out_lock);
+
+	append_line(&rec, t != NULL ? t->tid : DBG_MAX_THREADS);
+	out_flush();
+
+	pthread_mutex_unlock(&out_lock);
+}
+
+/* records straight into the caller's ring; only a filling ring or a warning takes a lock, to wake the writer */
+void dbg_write(dbg_level level, bool lit, const char *fmt, ...)
+{
+	dbg_thread				*t;
+	va_list					args;
+	uint64_t				h;
+
+	t = cur_thread();
+
+	if (t == NULL && !dbg_unlisted && __atomic_load_n(&running, __ATOMIC_ACQUIRE))
+		t = register_thread();
+
+	va_start(args, fmt);
+
+	h = t != NULL ? t->head : 0;
+
+	if (t == NULL || !__atomic_load_n(&running, __ATOMIC_ACQUIRE) ||
+		(h - t->tail_cache >= DBG_RING_CAP && !wait_for_space(t, h))) {
+		write_sync(t, level, fmt, args);
+		va_end(args);
+
+		return;
+	}
+
+	fill_record(&t->ring[h & (DBG_RING_CAP - 1)], level, lit, fmt, args);
+
+	va_end(args);
+
+	__atomic_store_n(&t->head, h + 1, __ATOMIC_RELEASE);
+
+	if (level >= DBG_LEVEL_WARN || (h + 1 - t->tail_cache == DBG_RING_CAP * 3 / 4 && ring_filling(t, h + 1)))
+		wake_writer();
 }
 
-void dbg_error(char *msg)
+/* everything queued before the error is written first, then the error itself, then the process exits */
+void dbg_error(const char *fmt, ...)
 {
-	printf("[ERROR] \"%s\"\n", msg);
+	dbg_record				rec;
+	dbg_thread				*t;
+	va_list					args;
+
+	t = cur_thread();
+
+	va_start(args, fmt);
+	fill_record(&rec, DBG_LEVEL_ERROR, false, fmt, args);
+	va_end(args);
+
+	__atomic_store_n(&running, false, __ATOMIC_RELEASE);
+
+	pthread_mutex_lock(&out_lock);
+
+	drain_all();
+	append_line(&rec, t != NULL ? t->tid : DBG_MAX_THREADS);
+	out_flush();
+
+	pthread_mutex_unlock(&out_lock);
+
 	exit(-1);
-}
\ No newline at end of file
+}
+
+/*
+ * only async signal safe calls from here on: no locks, no stdio, no formatting; deferred lines come out
+ * unformatted, and a batch the writer had not flushed when the fault hit is lost
+ */
+static void crash_handler(int sig)
+{
+	static const char			msg[] = "[ERROR] fatal signal, pending log lines flushed\n";
+
+	/* a second thread faulting at the same time must not write the rings out again */
+	if (!__atomic_exchange_n(&crashing, true, __ATOMIC_ACQ_REL)) {
+		crash_drain();
+		out_write_raw(msg, sizeof(msg) - 1);
+	}
+
+	raise(sig);
+}
+
+static inline void install_crash_handler(void)
+{
+	struct sigaction			sa;
+
+	memset(&sa, '\0', sizeof(sa));
+
+	sa.sa_handler = crash_handler;
+	sa.sa_flags = SA_RESETHAND | SA_NODEFER;
+	sigemptyset(&sa.sa_mask);
+
+	for (uint32_t i = 0; i < sizeof(crash_sigs) / sizeof(crash_sigs[0]); i++)
+		sigaction(crash_sigs[i], &sa, NULL);
+}
+
+static void *writer_main(void *arg)
+{
+	struct timespec				ts;
+	uint64_t				deadline;
+
+	(void)arg;
+
+	pthread_mutex_lock(&wake_lock);
+
+	while (!stopping) {
+		clock_gettime(CLOCK_REALTIME, &ts);
+
+		deadline = (uint64_t)ts.tv_sec * 1000000000ull + ts.tv_nsec + DBG_FLUSH_NS;
+		ts.tv_sec = deadline / 1000000000ull;
+		ts.tv_nsec = deadline % 1000000000ull;
+
+		pthread_cond_timedwait(&wake_cond, &wake_lock, &ts);
+		pthread_mutex_unlock(&wake_lock);
+
+		dbg_flush();
+
+		pthread_mutex_lock(&wake_lock);
+	}
+
+	pthread_mutex_unlock(&wake_lock);
+
+	return NULL;
+}
+
+/* lines logged before this are written synchronously, as they are again after dbg_clean */
+void dbg_init(dbg_level level, char *path)
+{
+	base_ns = now_ns();
+
+	dbg_set_level(level);
+
+	if (path != NULL) {
+		out_fp = fopen(path, "w");
+
+		if (out_fp == NULL)
+			dbg_warn("could not open log file %s, logging to stdout", path);
+	}
+
+	out_fd = fileno(out());
+
+	install_crash_handler();
+
+	__atomic_store_n(&running, true, __ATOMIC_RELEASE);
+
+	if (pthread_create(&writer, NULL, writer_main, NULL) != 0) {
+		__atomic_store_n(&running, false, __ATOMIC_RELEASE);
+
+		dbg_warn("could not start log writer, logging synchronously");
+
+		return;
+	}
+
+	started = true;
+
+	dbg_log("initialized logging successfully");
+}
+
+/*
+ * rings are freed here, so no other thread may be inside a dbg_* call; threads that log afterwards
+ * see their ring retired and write synchronously, or register a new one after the next dbg_init
+ */
+void dbg_clean(void)
+{
+	if (!started)
+		return;
+
+	__atomic_store_n(&running, false, __ATOMIC_RELEASE);
+
+	pthread_mutex_lock(&wake_lock);
+
+	stopping = true;
+
+	pthread_cond_signal(&wake_cond);
+	pthread_mutex_unlock(&wake_lock);
+
+	pthread_join(writer, NULL);
+
+	dbg_flush();
+
+	pthread_mutex_lock(&reg_lock);
+
+	__atomic_add_fetch(&ring_gen, 1, __ATOMIC_RELEASE);
+
+	for (uint32_t i = 0; i < thread_cnt; i++) {
+		free(threads[i]->ring);
+		free(threads[i]);
+	}
+
+	thread_cnt = 0;
+
+	pthread_mutex_unlock(&reg_lock);
+
+	if (out_fp != NULL)
+		fclose(out_fp);
+
+	out_fp = NULL;
+	out_fd = STDOUT_FILENO;
+	started = false;
+	stopping = false;
+}
+
+void dbg_set_level(dbg_level level)
+{
+	__atomic_store_n(&dbg_runtime_level, level, __ATOMIC_RELAXED);
+}
+
+bool dbg_parse_level(const char *name, dbg_level *level)
+{
+	for (uint32_t i = 0; i < sizeof(level_args) / sizeof(level_args[0]); i++) {
+		if (strcmp(name, level_args[i]) == 0) {
+			*level = (dbg_level)i;
+
+			return true;
+		}
+	}
+
+	return false;
+}
+
+void dbg_set_frame(uint64_t frame)
+{
+	__atomic_store_n(&cur_frame, frame, __ATOMIC_RELAXED);
+}
+
+/* writes out everything queued so far; the writer thread calls this on its own every few ms */
+void dbg_flush(void)
+{
+	pthread_mutex_lock(&out_lock);
+
+	drain_all();
+
+	pthread_mutex_unlock(&out_lock);
+}
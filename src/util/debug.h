@@ -3,13 +3,83 @@
 
 #include <stdio.h>
 #include <stdlib.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdarg.h>
+#include <pthread.h>
 
-void dbg_info(char *msg);
+#define DBG_MAX_THREADS				64
+#define DBG_RING_CAP				256
+#define DBG_RECORD_SIZE				512
+#define DBG_MSG_MAX				(DBG_RECORD_SIZE - 32)
+#define DBG_MAX_SPEC				32
+#define DBG_BATCH_SIZE				(64 * 1024)
+#define DBG_FLUSH_NS				(5 * 1000 * 1000)
+#define DBG_CACHE_LINE				64
 
-void dbg_log(char *msg);
+typedef enum {
+	DBG_LEVEL_LOG,
+	DBG_LEVEL_INFO,
+	DBG_LEVEL_WARN,
+	DBG_LEVEL_ERROR,
+} dbg_level;
 
-void dbg_warn(char *msg);
+/* anything below this is compiled out, arguments and all; build with -DDBG_MIN_LEVEL=DBG_LEVEL_WARN to drop chatter */
+#ifndef DBG_MIN_LEVEL
+#define DBG_MIN_LEVEL				DBG_LEVEL_LOG
+#endif
 
-void dbg_error(char *msg);
+/*
+ * with fmt set, msg holds the raw arguments in call order and the writer thread formats them;
+ * otherwise it holds the finished text
+ */
+typedef struct {
+	uint64_t ns;
+	uint64_t frame;
+	const char *fmt;
+	uint32_t level;
+	uint32_t len;
+	char msg[DBG_MSG_MAX];
+} dbg_record;
 
-#endif
\ No newline at end of file
+/* single producer ring per logging thread, drained by the writer thread */
+typedef struct {
+	uint64_t head __attribute__((aligned(DBG_CACHE_LINE)));
+	uint64_t tail_cache;
+	uint64_t tail __attribute__((aligned(DBG_CACHE_LINE)));
+	dbg_record *ring;
+	uint32_t tid;
+} dbg_thread;
+
+extern dbg_level dbg_runtime_level;
+
+/* lit says fmt is a string literal, which outlives the record, so formatting can wait for the writer */
+void dbg_write(dbg_level level, bool lit, const char *fmt, ...) __attribute__((format(printf, 3, 4)));
+
+void dbg_error(const char *fmt, ...) __attribute__((format(printf, 1, 2), noreturn));
+
+/* the level test comes first, so a filtered call never evaluates or formats its arguments */
+#define DBG_EMIT(level, fmt, ...)						\
+	do {									\
+		if ((level) >= DBG_MIN_LEVEL &&					\
+			(level) >= __atomic_load_n(&dbg_runtime_level, __ATOMIC_RELAXED))	\
+			dbg_write(level, __builtin_constant_p(fmt), fmt, ##__VA_ARGS__);	\
+	} while (0)
+
+#define dbg_log(...)				DBG_EMIT(DBG_LEVEL_LOG, __VA_ARGS__)
+#define dbg_info(...)				DBG_EMIT(DBG_LEVEL_INFO, __VA_ARGS__)
+#define dbg_warn(...)				DBG_EMIT(DBG_LEVEL_WARN, __VA_ARGS__)
+
+void dbg_init(dbg_level level, char *path);
+
+void dbg_clean(void);
+
+void dbg_set_level(dbg_level level);
+
+bool dbg_parse_level(const char *name, dbg_level *level);
+
+void dbg_set_frame(uint64_t frame);
+
+void dbg_flush(void);
+
+#endif
@@ -11,10 +11,46 @@ static inline void *da_last_elem(dynarr *da)
 	return da->elems + da->elem_stride * (da->size - 1);
 }
 
+static inline void da_realloc(dynarr *da, uint32_t cap)
+{
+	void					*elems;
+
+	elems = mem_realloc(da->elems, (size_t)cap * da->elem_stride);
+
+	if (elems == NULL)
+		dbg_error("failed to reallocate dynarr storage");
+
+	da->elems = elems;
+	da->cap = cap;
+}
+
+/* doubles the capacity until min_cap fits, so n appends cost O(n) copies in total */
+static inline uint32_t da_grown_cap(uint32_t cur_cap, uint32_t min_cap)
+{
+	uint64_t				cap;
+
+	cap = cur_cap < DA_MIN_CAP ? DA_MIN_CAP : cur_cap;
+
+	while (cap < min_cap)
+		cap *= 2;
+
+	if (cap > UINT32_MAX)
+		cap = UINT32_MAX;
+
+	return (uint32_t)cap;
+}
+
+static inline void da_grow(dynarr *da, uint32_t min_cap)
+{
+	if (min_cap > da->cap)
+		da_realloc(da, da_grown_cap(da->cap, min_cap));
+}
+
 void da_init(dynarr *da, uint32_t elem_stride)
 {
-	da->elems = malloc(1);
+	da->elems = NULL;
 	da->size = 0;
+	da->cap = 0;
 	da->elem_stride = elem_stride;
 
 	da_safety(da);
@@ -22,21 +58,101 @@ void da_init(dynarr *da, uint32_t elem_stride)
 
 void da_clean(dynarr *da)
 {
-	free(da->elems);
+	mem_free(da->elems);
 
+	da->elems = NULL;
 	da->size = 0;
+	da->cap = 0;
 	da->elem_stride = 0;
 }
 
+void da_reserve(dynarr *da, uint32_t cap)
+{
+	if (cap > da->cap)
+		da_realloc(da, cap);
+}
+
 void da_add_elem(dynarr *da, void *elem)
 {
+	if (da->size == da->cap) {
+		if (da->size == UINT32_MAX)
+			dbg_error("dynarr size would overflow");
+
+		da_grow(da, da->size + 1);
+	}
+
 	da->size++;
 
-	da->elems = realloc(da->elems, da->size * da->elem_stride);
 	memcpy((uint8_t *)da_last_elem(da), (uint8_t *)elem, da->elem_stride);
 }
 
+void da_append_n(dynarr *da, void *elems, uint32_t n)
+{
+	if (n == 0)
+		return;
+
+	if ((uint64_t)da->size + n > UINT32_MAX)
+		dbg_error("dynarr size would overflow");
+
+	da_grow(da, da->size + n);
+
+	memcpy((uint8_t *)da->elems + (size_t)da->elem_stride * da->size, (uint8_t *)elems, (size_t)da->elem_stride * n);
+
+	da->size += n;
+}
+
+void da_pop(dynarr *da, void *dest)
+{
+	if (da->size == 0)
+		dbg_error("cannot pop from an empty dynarr");
+
+	if (dest != NULL)
+		memcpy((uint8_t *)dest, (uint8_t *)da_last_elem(da), da->elem_stride);
+
+	da->size--;
+}
+
+void da_clear(dynarr *da)
+{
+	da->size = 0;
+}
+
+void da_shrink_to_fit(dynarr *da)
+{
+	if (da->size == da->cap)
+		return;
+
+	if (da->size == 0) {
+		mem_free(da->elems);
+
+		da->elems = NULL;
+		da->cap = 0;
+
+		return;
+	}
+
+	da_realloc(da, da->size);
+}
+
 void *da_get(dynarr *da, uint32_t ind)
 {
-	return da->elems + da->elem_stride * ind;
-}
\ No newline at end of file
+	return da->elems + (size_t)da->elem_stride * ind;
+}
+
+void da_raw_grow(void **elems, uint32_t *cap, uint32_t min_cap, size_t elem_stride)
+{
+	void					*new_elems;
+	uint32_t				new_cap;
+
+	if (min_cap <= *cap)
+		return;
+
+	new_cap = da_grown_cap(*cap, min_cap);
+	new_elems = mem_realloc(*elems, (size_t)new_cap * elem_stride);
+
+	if (new_elems == NULL)
+		dbg_error("failed to reallocate dynarr storage");
+
+	*elems = new_elems;
+	*cap = new_cap;
+}
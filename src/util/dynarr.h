@@ -2,6 +2,7 @@
 #define DYNARR_H_INCLUDED
 
 #include "debug.h"
+#include "arena.h"
 
 #include <stdio.h>
 #include <stdlib.h>
@@ -10,9 +11,12 @@
 
 #define ARRAY_SIZE(a)				(sizeof(a) / sizeof(a[0]))
 
+#define DA_MIN_CAP				8
+
 typedef struct {
 	void *elems;
 	uint32_t size;
+	uint32_t cap;
 	uint32_t elem_stride;
 } dynarr;
 
@@ -20,8 +24,108 @@ void da_init(dynarr *da, uint32_t elem_stride);
 
 void da_clean(dynarr *da);
 
+void da_reserve(dynarr *da, uint32_t cap);
+
 void da_add_elem(dynarr *da, void *elem);
 
+void da_append_n(dynarr *da, void *elems, uint32_t n);
+
+void da_pop(dynarr *da, void *dest);
+
+void da_clear(dynarr *da);
+
+void da_shrink_to_fit(dynarr *da);
+
 void *da_get(dynarr *da, uint32_t ind);
 
-#endif
\ No newline at end of file
+void da_raw_grow(void **elems, uint32_t *cap, uint32_t min_cap, size_t elem_stride);
+
+/* works on both containers; both sides are cast so an untyped dynarr steps by sizeof(type), which must match its stride */
+#define DA_FOREACH(type, it, da)						\
+	for (type *it = (type *)(da)->elems; it < (type *)(da)->elems + (da)->size; it++)
+
+/*
+ * typed dynarr generator; DYNARR_DEFINE(vec3_da, float3) emits a vec3_da
+ * struct and static inline vec3_da_* functions whose stride is sizeof(float3),
+ * so element access compiles down to plain pointer indexing
+ */
+#define DYNARR_DEFINE(name, type)						\
+	typedef struct {							\
+		type *elems;							\
+		uint32_t size;							\
+		uint32_t cap;							\
+	} name;									\
+										\
+	static inline void name##_init(name *da)				\
+	{									\
+		da->elems = NULL;						\
+		da->size = 0;							\
+		da->cap = 0;							\
+	}									\
+										\
+	static inline void name##_clean(name *da)				\
+	{									\
+		mem_free(da->elems);						\
+		name##_init(da);						\
+	}									\
+										\
+	static inline void name##_reserve(name *da, uint32_t cap)		\
+	{									\
+		if (cap > da->cap)						\
+			da_raw_grow((void **)&da->elems, &da->cap, cap, sizeof(type)); \
+	}									\
+										\
+	static inline type *name##_push(name *da, type elem)			\
+	{									\
+		if (da->size == da->cap) {					\
+			if (da->size == UINT32_MAX)				\
+				dbg_error("dynarr size would overflow");	\
+										\
+			da_raw_grow((void **)&da->elems, &da->cap, da->size + 1, sizeof(type)); \
+		}								\
+										\
+		da->elems[da->size] = elem;					\
+										\
+		return &da->elems[da->size++];					\
+	}									\
+										\
+	static inline type *name##_push_n(name *da, const type *elems, uint32_t n) \
+	{									\
+		type *dest;							\
+										\
+		if (n > da->cap - da->size) {					\
+			if (n > UINT32_MAX - da->size)				\
+				dbg_error("dynarr size would overflow");	\
+										\
+			da_raw_grow((void **)&da->elems, &da->cap, da->size + n, sizeof(type)); \
+		}								\
+										\
+		dest = da->elems + da->size;					\
+										\
+		if (elems != NULL)						\
+			memcpy(dest, elems, (size_t)n * sizeof(type));		\
+										\
+		da->size += n;							\
+										\
+		return dest;							\
+	}									\
+										\
+	static inline type name##_pop(name *da)					\
+	{									\
+		if (da->size == 0)						\
+			dbg_error("cannot pop from an empty dynarr");		\
+										\
+		return da->elems[--da->size];					\
+	}									\
+										\
+	static inline type *name##_get(name *da, uint32_t ind)			\
+	{									\
+		return &da->elems[ind];						\
+	}									\
+										\
+	static inline void name##_clear(name *da)				\
+	{									\
+		da->size = 0;							\
+	}
+
+#endif
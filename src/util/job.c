@@ -0,0 +1,539 @@
+#include "job.h"
+#include "tpool.h"
+#include "arena.h"
+
+#include <sched.h>
+
+typedef struct {
+	job_range_fn fn;
+	void *arg;
+	uint32_t grain;
+} job_range;
+
+static __thread job_worker			*cur_worker;
+
+static inline void cpu_relax(void)
+{
+#if defined(__x86_64__) || defined(__i386__)
+	__builtin_ia32_pause();
+#endif
+}
+
+static inline void spin_lock(uint32_t *lock)
+{
+	uint32_t				spins;
+
+	spins = 0;
+
+	while (__atomic_exchange_n(lock, 1, __ATOMIC_ACQUIRE)) {
+		while (__atomic_load_n(lock, __ATOMIC_RELAXED)) {
+			if (++spins % JOB_SPIN_ROUNDS == 0)
+				sched_yield();
+			else
+				cpu_relax();
+		}
+	}
+}
+
+static inline void spin_unlock(uint32_t *lock)
+{
+	__atomic_store_n(lock, 0, __ATOMIC_RELEASE);
+}
+
+/* slots are read by thieves while the owner may be reusing them, a failed cas throws the torn copy away */
+static inline void slot_store(job *slot, const job *j)
+{
+	__atomic_store_n(&slot->fn, j->fn, __ATOMIC_RELAXED);
+	__atomic_store_n(&slot->arg, j->arg, __ATOMIC_RELAXED);
+	__atomic_store_n(&slot->counter, j->counter, __ATOMIC_RELAXED);
+	__atomic_store_n(&slot->begin, j->begin, __ATOMIC_RELAXED);
+	__atomic_store_n(&slot->end, j->end, __ATOMIC_RELAXED);
+}
+
+static inline void slot_load(job *j, job *slot)
+{
+	j->fn = __atomic_load_n(&slot->fn, __ATOMIC_RELAXED);
+	j->arg = __atomic_load_n(&slot->arg, __ATOMIC_RELAXED);
+	j->counter = __atomic_load_n(&slot->counter, __ATOMIC_RELAXED);
+	j->begin = __atomic_load_n(&slot->begin, __ATOMIC_RELAXED);
+	j->end = __atomic_load_n(&slot->end, __ATOMIC_RELAXED);
+}
+
+static inline bool deque_push(job_deque *dq, const job *j)
+{
+	int64_t					b, t;
+
+	b = __atomic_load_n(&dq->bottom, __ATOMIC_RELAXED);
+	t = __atomic_load_n(&dq->top, __ATOMIC_ACQUIRE);
+
+	if (b - t >= JOB_DEQUE_CAP)
+		return false;
+
+	slot_store(&dq->ring[b & (JOB_DEQUE_CAP - 1)], j);
+
+	__atomic_store_n(&dq->bottom, b + 1, __ATOMIC_RELEASE);
+
+	return true;
+}
+
+static inline bool deque_take(job_deque *dq, job *j)
+{
+	int64_t					b, t;
+	bool					ok;
+
+	b = __atomic_load_n(&dq->bottom, __ATOMIC_RELAXED) - 1;
+
+	__atomic_store_n(&dq->bottom, b, __ATOMIC_RELAXED);
+	__atomic_thread_fence(__ATOMIC_SEQ_CST);
+
+	t = __atomic_load_n(&dq->top, __ATOMIC_RELAXED);
+
+	if (t > b) {
+		__atomic_store_n(&dq->bottom, b + 1, __ATOMIC_RELAXED);
+		return false;
+	}
+
+	slot_load(j, &dq->ring[b & (JOB_DEQUE_CAP - 1)]);
+
+	if (t < b)
+		return true;
+
+	/* last job left, race the thieves for it */
+	ok = __atomic_compare_exchange_n(&dq->top, &t, t + 1, false, __ATOMIC_SEQ_CST, __ATOMIC_RELAXED);
+
+	__atomic_store_n(&dq->bottom, b + 1, __ATOMIC_RELAXED);
+
+	return ok;
+}
+
+static inline bool deque_steal(job_deque *dq, job *j)
+{
+	int64_t					b, t;
+
+	t = __atomic_load_n(&dq->top, __ATOMIC_ACQUIRE);
+
+	__atomic_thread_fence(__ATOMIC_SEQ_CST);
+
+	b = __atomic_load_n(&dq->bottom, __ATOMIC_ACQUIRE);
+
+	if (t >= b)
+		return false;
+
+	slot_load(j, &dq->ring[t & (JOB_DEQUE_CAP - 1)]);
+
+	return __atomic_compare_exchange_n(&dq->top, &t, t + 1, false, __ATOMIC_SEQ_CST, __ATOMIC_RELAXED);
+}
+
+static inline bool deque_empty(job_deque *dq)
+{
+	return __atomic_load_n(&dq->top, __ATOMIC_ACQUIRE) >= __atomic_load_n(&dq->bottom, __ATOMIC_ACQUIRE);
+}
+
+static inline job_worker *this_worker(job_system *js)
+{
+	if (cur_worker != NULL && cur_worker->js == js)
+		return cur_worker;
+
+	return NULL;
+}
+
+static inline void wake_one(job_system *js)
+{
+	__atomic_thread_fence(__ATOMIC_SEQ_CST);
+
+	if (__atomic_load_n(&js->sleeping, __ATOMIC_RELAXED) == 0)
+		return;
+
+	pthread_mutex_lock(&js->lock);
+	pthread_cond_signal(&js->wake_cond);
+	pthread_mutex_unlock(&js->lock);
+}
+
+/* threads outside the system and full deques fall back to the shared locked queue */
+static inline void enqueue(job_system *js, const job *j)
+{
+	job_worker				*w;
+
+	w = this_worker(js);
+
+	if (w == NULL || !deque_push(&w->deque, j)) {
+		pthread_mutex_lock(&js->lock);
+
+		job_list_push(&js->injected, *j);
+		__atomic_fetch_add(&js->injected_cnt, 1, __ATOMIC_RELEASE);
+
+		pthread_mutex_unlock(&js->lock);
+	}
+
+	wake_one(js);
+}
+
+static inline bool take_injected(job_system *js, job *j)
+{
+	bool					ok;
+
+	if (__atomic_load_n(&js->injected_cnt, __ATOMIC_ACQUIRE) == 0)
+		return false;
+
+	pthread_mutex_lock(&js->lock);
+
+	ok = js->injected.size > 0;
+
+	if (ok) {
+		*j = job_list_pop(&js->injected);
+		__atomic_fetch_sub(&js->injected_cnt, 1, __ATOMIC_RELEASE);
+	}
+
+	pthread_mutex_unlock(&js->lock);
+
+	return ok;
+}
+
+/* own deque first, then the shared queue, then one pass over the others from a random victim */
+static inline bool find_job(job_system *js, job_worker *w, job *j)
+{
+	job_worker				*victim;
+	uint32_t				start;
+
+	if (w != NULL && deque_take(&w->deque, j))
+		return true;
+
+	if (take_injected(js, j))
+		return true;
+
+	if (w != NULL) {
+		w->rng ^= w->rng << 13;
+		w->rng ^= w->rng >> 17;
+		w->rng ^= w->rng << 5;
+		start = w->rng;
+	} else {
+		start = 0;
+	}
+
+	for (uint32_t i = 0; i < js->thread_cnt; i++) {
+		victim = &js->workers[(start + i) % js->thread_cnt];
+
+		if (victim == w)
+			continue;
+
+		if (deque_steal(&victim->deque, j)) {
+			if (w != NULL)
+				w->stolen++;
+
+			return true;
+		}
+	}
+
+	return false;
+}
+
+static inline bool any_work(job_system *js)
+{
+	if (__atomic_load_n(&js->injected_cnt, __ATOMIC_ACQUIRE) > 0)
+		return true;
+
+	for (uint32_t i = 0; i < js->thread_cnt; i++) {
+		if (!deque_empty(&js->workers[i].deque))
+			return true;
+	}
+
+	return false;
+}
+
+/* the decrement happens under the counter lock so job_wait can tell when the waiters are out */
+static inline void finish(job_system *js, job_counter *c)
+{
+	spin_lock(&c->lock);
+
+	if (__atomic_sub_fetch(&c->value, 1, __ATOMIC_ACQ_REL) == 0) {
+		for (uint32_t i = 0; i < c->waiters.size; i++)
+			enqueue(js, &c->waiters.elems[i]);
+
+		job_list_clear(&c->waiters);
+	}
+
+	spin_unlock(&c->lock);
+}
+
+static inline void run_range(job_system *js, job *j, uint32_t worker)
+{
+	job_range				*range;
+	job					half;
+	uint32_t				begin, end, mid;
+
+	range = j->arg;
+	begin = j->begin;
+	end = j->end;
+
+	/* keep halving, leaving the upper half for thieves, until one grain is left */
+	while (end - begin > range->grain) {
+		mid = begin + (end - begin) / 2;
+
+		half = *j;
+		half.begin = mid;
+		half.end = end;
+
+		__atomic_fetch_add(&j->counter->value, 1, __ATOMIC_RELAXED);
+		enqueue(js, &half);
+
+		end = mid;
+	}
+
+	range->fn(range->arg, begin, end, worker);
+}
+
+static inline void run(job_system *js, job_worker *w, job *j)
+{
+	uint32_t				worker;
+
+	PROF_ZONE("job");
+
+	worker = w != NULL ? w->ind : js->thread_cnt;
+
+	if (j->fn != NULL)
+		j->fn(j->arg, worker);
+	else
+		run_range(js, j, worker);
+
+	if (w != NULL)
+		w->executed++;
+
+	if (j->counter != NULL)
+		finish(js, j->counter);
+}
+
+static void *job_worker_main(void *arg)
+{
+	job_worker				*w;
+	job_system				*js;
+	job					j;
+	uint32_t				idle;
+
+	w = arg;
+	js = w->js;
+	cur_worker = w;
+	idle = 0;
+
+	PROF_THREAD_NAME("job worker");
+
+	while (!__atomic_load_n(&js->stopping, __ATOMIC_ACQUIRE)) {
+		if (find_job(js, w, &j)) {
+			run(js, w, &j);
+			idle = 0;
+			continue;
+		}
+
+		if (++idle < JOB_SPIN_ROUNDS) {
+			cpu_relax();
+			continue;
+		}
+
+		/* sleeping is raised before the last look, pairing with the fence in wake_one */
+		pthread_mutex_lock(&js->lock);
+
+		__atomic_fetch_add(&js->sleeping, 1, __ATOMIC_RELAXED);
+		__atomic_thread_fence(__ATOMIC_SEQ_CST);
+
+		if (!any_work(js) && !__atomic_load_n(&js->stopping, __ATOMIC_ACQUIRE))
+			pthread_cond_wait(&js->wake_cond, &js->lock);
+
+		__atomic_fetch_sub(&js->sleeping, 1, __ATOMIC_RELAXED);
+
+		pthread_mutex_unlock(&js->lock);
+
+		idle = 0;
+	}
+
+	return NULL;
+}
+
+void job_init(job_system *js, uint32_t thread_cnt)
+{
+	if (thread_cnt == 0)
+		thread_cnt = tpool_core_cnt();
+
+	if (thread_cnt > JOB_MAX_THREADS)
+		thread_cnt = JOB_MAX_THREADS;
+
+	memset(js, '\0', sizeof(*js));
+
+	pthread_mutex_init(&js->lock, NULL);
+	pthread_cond_init(&js->wake_cond, NULL);
+
+	job_list_init(&js->injected);
+
+	js->thread_cnt = thread_cnt;
+
+	for (uint32_t i = 0; i < thread_cnt; i++) {
+		js->workers[i].js = js;
+		js->workers[i].ind = i;
+		js->workers[i].rng = 0x9e3779b9u * (i + 1);
+		js->workers[i].deque.ring = mem_alloc(JOB_DEQUE_CAP * sizeof(job));
+
+		if (js->workers[i].deque.ring == NULL)
+			dbg_error("failed to allocate job deque");
+	}
+
+	cur_worker = &js->workers[0];
+
+	for (uint32_t i = 1; i < thread_cnt; i++) {
+		if (pthread_create(&js->workers[i].thread, NULL, job_worker_main, &js->workers[i]) != 0)
+			dbg_error("failed to create job worker thread");
+	}
+
+	dbg_log("started job system with %u workers successfully", thread_cnt);
+}
+
+/* every counter must have been waited on, queued jobs are dropped */
+void job_clean(job_system *js)
+{
+	pthread_mutex_lock(&js->lock);
+
+	__atomic_store_n(&js->stopping, true, __ATOMIC_RELEASE);
+
+	pthread_cond_broadcast(&js->wake_cond);
+	pthread_mutex_unlock(&js->lock);
+
+	for (uint32_t i = 1; i < js->thread_cnt; i++)
+		pthread_join(js->workers[i].thread, NULL);
+
+	for (uint32_t i = 0; i < js->thread_cnt; i++)
+		mem_free(js->workers[i].deque.ring);
+
+	if (cur_worker != NULL && cur_worker->js == js)
+		cur_worker = NULL;
+
+	job_list_clean(&js->injected);
+
+	pthread_mutex_destroy(&js->lock);
+	pthread_cond_destroy(&js->wake_cond);
+
+	js->thread_cnt = 0;
+}
+
+/* thread_cnt for threads that are not part of the system, so per-worker scratch needs thread_cnt + 1 slots */
+uint32_t job_current_worker(job_system *js)
+{
+	job_worker				*w;
+
+	w = this_worker(js);
+
+	return w != NULL ? w->ind : js->thread_cnt;
+}
+
+void job_counter_init(job_counter *c)
+{
+	c->value = 0;
+	c->lock = 0;
+
+	job_list_init(&c->waiters);
+}
+
+void job_counter_clean(job_counter *c)
+{
+	job_list_clean(&c->waiters);
+}
+
+void job_submit(job_system *js, job_fn fn, void *arg, job_counter *counter)
+{
+	job					j;
+
+	j = (job){
+		fn,
+		arg,
+		counter,
+		0,
+		0
+	};
+
+	if (counter != NULL)
+		__atomic_fetch_add(&counter->value, 1, __ATOMIC_RELAXED);
+
+	enqueue(js, &j);
+}
+
+void job_submit_after(job_system *js, job_fn fn, void *arg, job_counter *after, job_counter *counter)
+{
+	job					j;
+
+	j = (job){
+		fn,
+		arg,
+		counter,
+		0,
+		0
+	};
+
+	if (counter != NULL)
+		__atomic_fetch_add(&counter->value, 1, __ATOMIC_RELAXED);
+
+	spin_lock(&after->lock);
+
+	if (__atomic_load_n(&after->value, __ATOMIC_ACQUIRE) > 0) {
+		job_list_push(&after->waiters, j);
+		spin_unlock(&after->lock);
+		return;
+	}
+
+	spin_unlock(&after->lock);
+
+	enqueue(js, &j);
+}
+
+/* the caller runs other jobs until the counter drains instead of blocking its thread */
+void job_wait(job_system *js, job_counter *c)
+{
+	job_worker				*w;
+	job					j;
+
+	w = this_worker(js);
+
+	while (__atomic_load_n(&c->value, __ATOMIC_ACQUIRE) > 0) {
+		if (find_job(js, w, &j))
+			run(js, w, &j);
+		else
+			sched_yield();
+	}
+
+	spin_lock(&c->lock);
+	spin_unlock(&c->lock);
+}
+
+void job_parallel_for(job_system *js, uint32_t begin, uint32_t end, uint32_t grain, job_range_fn fn, void *arg)
+{
+	job_range				range;
+	job_counter				counter;
+	job					j;
+
+	if (begin >= end)
+		return;
+
+	if (grain == 0)
+		grain = (end - begin) / (js->thread_cnt * JOB_GRAIN_SPLIT);
+
+	range.fn = fn;
+	range.arg = arg;
+	range.grain = grain > 0 ? grain : 1;
+
+	if (end - begin <= range.grain) {
+		fn(arg, begin, end, job_current_worker(js));
+		return;
+	}
+
+	job_counter_init(&counter);
+
+	j = (job){
+		NULL,
+		&range,
+		&counter,
+		begin,
+		end
+	};
+
+	counter.value = 1;
+
+	run(js, this_worker(js), &j);
+	job_wait(js, &counter);
+
+	job_counter_clean(&counter);
+}
@@ -0,0 +1,93 @@
+#ifndef JOB_H_INCLUDED
+#define JOB_H_INCLUDED
+
+#include "debug.h"
+#include "dynarr.h"
+#include "prof.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <pthread.h>
+
+#define JOB_MAX_THREADS				64
+#define JOB_DEQUE_CAP				4096
+#define JOB_CACHE_LINE				64
+#define JOB_SPIN_ROUNDS				64
+#define JOB_GRAIN_SPLIT				8
+
+typedef void (*job_fn)(void *arg, uint32_t worker);
+
+typedef void (*job_range_fn)(void *arg, uint32_t begin, uint32_t end, uint32_t worker);
+
+typedef struct job_counter job_counter;
+
+/* range jobs have no fn, arg then points at the parallel_for they split */
+typedef struct {
+	job_fn fn;
+	void *arg;
+	job_counter *counter;
+	uint32_t begin;
+	uint32_t end;
+} job;
+
+DYNARR_DEFINE(job_list, job)
+
+/* counts unfinished jobs; jobs submitted after it are held here until it drops to zero */
+struct job_counter {
+	uint32_t value;
+	uint32_t lock;
+	job_list waiters;
+};
+
+typedef struct job_system job_system;
+
+/* chase-lev: the owner pushes and takes at the bottom, thieves steal from the top */
+typedef struct {
+	int64_t top __attribute__((aligned(JOB_CACHE_LINE)));
+	int64_t bottom __attribute__((aligned(JOB_CACHE_LINE)));
+	job *ring;
+} job_deque;
+
+typedef struct {
+	job_deque deque;
+	job_system *js;
+	uint32_t ind;
+	uint32_t rng;
+	pthread_t thread;
+	uint64_t executed;
+	uint64_t stolen;
+} job_worker;
+
+/* worker 0 is the thread that called job_init and only runs jobs while it waits */
+struct job_system {
+	job_worker workers[JOB_MAX_THREADS];
+	uint32_t thread_cnt;
+	pthread_mutex_t lock;
+	pthread_cond_t wake_cond;
+	job_list injected;
+	uint32_t injected_cnt;
+	uint32_t sleeping;
+	bool stopping;
+};
+
+void job_init(job_system *js, uint32_t thread_cnt);
+
+void job_clean(job_system *js);
+
+uint32_t job_current_worker(job_system *js);
+
+void job_counter_init(job_counter *c);
+
+void job_counter_clean(job_counter *c);
+
+void job_submit(job_system *js, job_fn fn, void *arg, job_counter *counter);
+
+void job_submit_after(job_system *js, job_fn fn, void *arg, job_counter *after, job_counter *counter);
+
+void job_wait(job_system *js, job_counter *c);
+
+void job_parallel_for(job_system *js, uint32_t begin, uint32_t end, uint32_t grain, job_range_fn fn, void *arg);
+
+#endif
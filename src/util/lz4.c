@@ -0,0 +1,198 @@
+#include "lz4.h"
+
+/* lz4 block format; the last match must start 12 bytes and end 5 bytes before the input ends */
+#define LZ4_HASH_LOG				14
+#define LZ4_MIN_MATCH				4
+#define LZ4_MF_LIMIT				12
+#define LZ4_LAST_LITERALS			5
+#define LZ4_MAX_OFFSET				65535
+
+static inline uint32_t lz4_read32(const uint8_t *p)
+{
+	uint32_t				val;
+
+	memcpy(&val, p, sizeof(val));
+
+	return val;
+}
+
+static inline uint32_t lz4_hash(uint32_t seq)
+{
+	return (seq * 2654435761u) >> (32 - LZ4_HASH_LOG);
+}
+
+static inline bool lz4_put_len(uint8_t **op, uint8_t *oend, size_t len)
+{
+	for (; len >= 255; len -= 255) {
+		if (*op >= oend)
+			return false;
+
+		*(*op)++ = 255;
+	}
+
+	if (*op >= oend)
+		return false;
+
+	*(*op)++ = (uint8_t)len;
+
+	return true;
+}
+
+static inline bool lz4_emit(uint8_t **op, uint8_t *oend, const uint8_t *lits, size_t lit_len, size_t offset, size_t match_len)
+{
+	uint8_t					*token;
+
+	if (*op >= oend)
+		return false;
+
+	token = (*op)++;
+	*token = (lit_len < 15 ? lit_len : 15) << 4;
+
+	if (lit_len >= 15 && !lz4_put_len(op, oend, lit_len - 15))
+		return false;
+
+	if ((size_t)(oend - *op) < lit_len)
+		return false;
+
+	memcpy(*op, lits, lit_len);
+	*op += lit_len;
+
+	if (match_len == 0)
+		return true;
+
+	if (oend - *op < 2)
+		return false;
+
+	*(*op)++ = offset & 0xff;
+	*(*op)++ = offset >> 8;
+
+	match_len -= LZ4_MIN_MATCH;
+	*token |= match_len < 15 ? match_len : 15;
+
+	if (match_len >= 15 && !lz4_put_len(op, oend, match_len - 15))
+		return false;
+
+	return true;
+}
+
+size_t lz4_compress(const uint8_t *src, size_t src_len, uint8_t *dest, size_t dest_cap)
+{
+	uint32_t				*table;
+	uint8_t					*op, *oend;
+	size_t					ip, anchor, ref, match_len;
+	uint32_t				seq, h;
+
+	op = dest;
+	oend = dest + dest_cap;
+	ip = 0;
+	anchor = 0;
+
+	if (src_len > LZ4_MF_LIMIT) {
+		table = calloc(1 << LZ4_HASH_LOG, sizeof(uint32_t));
+
+		if (table == NULL)
+			dbg_error("failed to allocate lz4 hash table");
+
+		while (ip < src_len - LZ4_MF_LIMIT) {
+			seq = lz4_read32(src + ip);
+			h = lz4_hash(seq);
+			ref = table[h];
+			table[h] = ip + 1;
+
+			if (ref == 0 || ip + 1 - ref > LZ4_MAX_OFFSET || lz4_read32(src + ref - 1) != seq) {
+				ip++;
+				continue;
+			}
+
+			ref--;
+			match_len = LZ4_MIN_MATCH;
+
+			while (ip + match_len < src_len - LZ4_LAST_LITERALS && src[ref + match_len] == src[ip + match_len])
+				match_len++;
+
+			if (!lz4_emit(&op, oend, src + anchor, ip - anchor, ip - ref, match_len)) {
+				free(table);
+
+				return 0;
+			}
+
+			ip += match_len;
+			anchor = ip;
+		}
+
+		free(table);
+	}
+
+	if (!lz4_emit(&op, oend, src + anchor, src_len - anchor, 0, 0))
+		return 0;
+
+	return op - dest;
+}
+
+bool lz4_decompress(const uint8_t *src, size_t src_len, uint8_t *dest, size_t dest_len)
+{
+	size_t					ip, op, lit_len, match_len, offset;
+	uint8_t					token, b;
+
+	ip = 0;
+	op = 0;
+
+	while (ip < src_len) {
+		token = src[ip++];
+		lit_len = token >> 4;
+
+		if (lit_len == 15) {
+			do {
+				if (ip >= src_len)
+					return false;
+
+				b = src[ip++];
+				lit_len += b;
+			} while (b == 255);
+		}
+
+		if (lit_len > src_len - ip || lit_len > dest_len - op)
+			return false;
+
+		memcpy(dest + op, src + ip, lit_len);
+		ip += lit_len;
+		op += lit_len;
+
+		if (ip == src_len)
+			break;
+
+		if (src_len - ip < 2)
+			return false;
+
+		offset = src[ip] | (src[ip + 1] << 8);
+		ip += 2;
+
+		if (offset == 0 || offset > op)
+			return false;
+
+		match_len = (token & 15) + LZ4_MIN_MATCH;
+
+		if ((token & 15) == 15) {
+			do {
+				if (ip >= src_len)
+					return false;
+
+				b = src[ip++];
+				match_len += b;
+			} while (b == 255);
+		}
+
+		if (match_len > dest_len - op)
+			return false;
+
+		if (offset >= match_len) {
+			memcpy(dest + op, dest + op - offset, match_len);
+			op += match_len;
+		} else {
+			for (size_t i = 0; i < match_len; i++, op++)
+				dest[op] = dest[op - offset];
+		}
+	}
+
+	return op == dest_len;
+}
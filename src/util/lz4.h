@@ -0,0 +1,18 @@
+#ifndef LZ4_H_INCLUDED
+#define LZ4_H_INCLUDED
+
+#include "debug.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+
+#define LZ4_COMPRESS_BOUND(n)			((n) + (n) / 255 + 16)
+
+size_t lz4_compress(const uint8_t *src, size_t src_len, uint8_t *dest, size_t dest_cap);
+
+bool lz4_decompress(const uint8_t *src, size_t src_len, uint8_t *dest, size_t dest_len);
+
+#endif
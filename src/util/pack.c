@@ -0,0 +1,306 @@
+#include "pack.h"
+#include "arena.h"
+#include "lz4.h"
+
+#include <unistd.h>
+
+static inline uint64_t pak_hash(const char *name, size_t len)
+{
+	uint64_t				hash;
+
+	hash = hash_fnv1a(name, len);
+
+	return hash == 0 ? 1 : hash;
+}
+
+static inline uint64_t pak_align(uint64_t val)
+{
+	return (val + PAK_DATA_ALIGN - 1) & ~(uint64_t)(PAK_DATA_ALIGN - 1);
+}
+
+static inline uint32_t pak_slot_cnt(uint32_t entry_cnt)
+{
+	uint32_t				slot_cnt;
+
+	slot_cnt = 8;
+
+	while (slot_cnt < entry_cnt * 2)
+		slot_cnt *= 2;
+
+	return slot_cnt;
+}
+
+static inline void pak_write_at(FILE *fp, uint64_t offset, const void *data, size_t len)
+{
+	if (fseek(fp, offset, SEEK_SET) != 0 || fwrite(data, 1, len, fp) != len)
+		dbg_error("failed to write pack file");
+}
+
+/*
+ * lz4 cannot expand a block by more than 255 to 1, so a larger raw_len is corrupt;
+ * stored entries are views into the mapping and must be exactly as long as they claim
+ */
+static inline bool pak_entry_valid(const pak *pk, const pak_entry *entry, uint64_t names_len)
+{
+	if (entry->name_offset > names_len || entry->name_len > names_len - entry->name_offset)
+		return false;
+
+	if (entry->stored_len > pk->fv.len || entry->offset > pk->fv.len - entry->stored_len)
+		return false;
+
+	if (entry->raw_len > PAK_MAX_RAW_LEN)
+		return false;
+
+	if (entry->flags & PAK_ENTRY_LZ4)
+		return entry->raw_len <= entry->stored_len * PAK_MAX_LZ4_RATIO;
+
+	return entry->raw_len == entry->stored_len;
+}
+
+/* every toc entry is checked once here, so lookups and reads can trust the ranges and lengths in it */
+static inline bool pak_valid(const pak *pk)
+{
+	const pak_header			*hdr;
+	const pak_entry				*entry;
+	uint64_t				names_len;
+
+	hdr = pk->hdr;
+
+	if (pk->fv.len < sizeof(pak_header) ||
+		memcmp(hdr->magic, PAK_MAGIC, sizeof(hdr->magic)) != 0 ||
+		hdr->version != PAK_VERSION ||
+		hdr->file_len != pk->fv.len ||
+		hdr->slot_cnt == 0 ||
+		(hdr->slot_cnt & (hdr->slot_cnt - 1)) != 0 ||
+		hdr->toc_offset > pk->fv.len ||
+		(uint64_t)hdr->slot_cnt * sizeof(pak_entry) > pk->fv.len - hdr->toc_offset ||
+		hdr->names_offset > pk->fv.len)
+		return false;
+
+	names_len = pk->fv.len - hdr->names_offset;
+
+	for (uint32_t i = 0; i < hdr->slot_cnt; i++) {
+		entry = (const pak_entry *)(pk->fv.data + hdr->toc_offset) + i;
+
+		if (entry->name_hash != 0 && !pak_entry_valid(pk, entry, names_len))
+			return false;
+	}
+
+	return true;
+}
+
+bool pak_open(pak *pk, char *filepath, uint32_t flags)
+{
+	if (!fv_try_open(&pk->fv, filepath, FV_HINT_WILLNEED))
+		return false;
+
+	pk->hdr = (const pak_header *)pk->fv.data;
+	pk->flags = flags;
+
+	if (!pak_valid(pk)) {
+		dbg_warn("ignoring malformed pack file");
+		fv_close(&pk->fv);
+
+		return false;
+	}
+
+	pk->toc = (const pak_entry *)(pk->fv.data + pk->hdr->toc_offset);
+	pk->names = (const char *)(pk->fv.data + pk->hdr->names_offset);
+
+	return true;
+}
+
+void pak_close(pak *pk)
+{
+	fv_close(&pk->fv);
+
+	pk->hdr = NULL;
+	pk->toc = NULL;
+	pk->names = NULL;
+}
+
+const pak_entry *pak_find(pak *pk, const char *name)
+{
+	size_t					len;
+	uint64_t				hash;
+	uint32_t				mask, slot;
+	const pak_entry				*entry;
+
+	len = strlen(name);
+	hash = pak_hash(name, len);
+	mask = pk->hdr->slot_cnt - 1;
+	slot = hash & mask;
+
+	/* a crafted table may have no empty slot, so the probe stops after one lap */
+	for (uint32_t i = 0; i < pk->hdr->slot_cnt; i++, slot = (slot + 1) & mask) {
+		entry = &pk->toc[slot];
+
+		if (entry->name_hash == 0)
+			return NULL;
+
+		if (entry->name_hash == hash && entry->name_len == len &&
+			memcmp(pk->names + entry->name_offset, name, len) == 0)
+			return entry;
+	}
+
+	return NULL;
+}
+
+bool pak_read(pak *pk, const pak_entry *entry, pak_blob *blob)
+{
+	const uint8_t				*stored;
+
+	/* the range and raw_len were checked against the mapping by pak_valid */
+	stored = pk->fv.data + entry->offset;
+
+	if (entry->flags & PAK_ENTRY_LZ4) {
+		blob->owned = mem_alloc(entry->raw_len ? entry->raw_len : 1);
+
+		if (blob->owned == NULL)
+			dbg_error("failed to allocate pack entry buffer");
+
+		if (!lz4_decompress(stored, entry->stored_len, blob->owned, entry->raw_len)) {
+			mem_free(blob->owned);
+			blob->owned = NULL;
+
+			return false;
+		}
+
+		blob->data = blob->owned;
+	} else {
+		blob->owned = NULL;
+		blob->data = stored;
+	}
+
+	blob->len = entry->raw_len;
+
+	if ((pk->flags & PAK_FLAG_VERIFY) && crc32(blob->data, blob->len) != entry->checksum) {
+		pak_blob_release(blob);
+
+		return false;
+	}
+
+	return true;
+}
+
+void pak_blob_release(pak_blob *blob)
+{
+	mem_free(blob->owned);
+
+	blob->data = NULL;
+	blob->owned = NULL;
+	blob->len = 0;
+}
+
+void pak_build(char *filepath, pak_src *srcs, uint32_t src_cnt, uint32_t flags)
+{
+	FILE					*fp;
+	pak_header				hdr;
+	pak_entry				*toc, *entry;
+	uint32_t				*slot_srcs;
+	file_view				src;
+	uint8_t					*packed;
+	size_t					packed_len, name_len;
+	uint64_t				offset, names_len;
+	uint32_t				mask, slot;
+	char					tmp_path[4096];
+
+	snprintf(tmp_path, sizeof(tmp_path), "%s.tmp", filepath);
+
+	fp = fopen(tmp_path, "wb");
+
+	if (fp == NULL)
+		dbg_error("could not create pack file");
+
+	memset(&hdr, '\0', sizeof(hdr));
+
+	memcpy(hdr.magic, PAK_MAGIC, sizeof(hdr.magic));
+	hdr.version = PAK_VERSION;
+	hdr.entry_cnt = src_cnt;
+	hdr.slot_cnt = pak_slot_cnt(src_cnt);
+	hdr.toc_offset = pak_align(sizeof(pak_header));
+	hdr.names_offset = hdr.toc_offset + (uint64_t)hdr.slot_cnt * sizeof(pak_entry);
+
+	toc = calloc(hdr.slot_cnt, sizeof(pak_entry));
+	slot_srcs = calloc(hdr.slot_cnt, sizeof(uint32_t));
+
+	if (toc == NULL || slot_srcs == NULL)
+		dbg_error("failed to allocate pack toc");
+
+	mask = hdr.slot_cnt - 1;
+	names_len = 0;
+
+	for (uint32_t i = 0; i < src_cnt; i++)
+		names_len += strlen(srcs[i].name);
+
+	offset = pak_align(hdr.names_offset + names_len);
+	names_len = 0;
+
+	for (uint32_t i = 0; i < src_cnt; i++) {
+		name_len = strlen(srcs[i].name);
+
+		for (slot = pak_hash(srcs[i].name, name_len) & mask; toc[slot].name_hash != 0; slot = (slot + 1) & mask) {
+			if (toc[slot].name_len == name_len &&
+				memcmp(srcs[slot_srcs[slot]].name, srcs[i].name, name_len) == 0)
+				dbg_error("duplicate name in pack sources");
+		}
+
+		entry = &toc[slot];
+		slot_srcs[slot] = i;
+
+		fv_open(&src, srcs[i].filepath, FV_HINT_SEQUENTIAL);
+
+		entry->name_hash = pak_hash(srcs[i].name, name_len);
+		entry->name_offset = names_len;
+		entry->name_len = name_len;
+		entry->raw_len = src.len;
+		entry->checksum = crc32(src.data, src.len);
+		entry->offset = offset;
+
+		packed = NULL;
+		packed_len = 0;
+
+		if ((flags & PAK_FLAG_COMPRESS) && src.len > 0) {
+			packed = malloc(LZ4_COMPRESS_BOUND(src.len));
+
+			if (packed == NULL)
+				dbg_error("failed to allocate compression buffer");
+
+			packed_len = lz4_compress(src.data, src.len, packed, LZ4_COMPRESS_BOUND(src.len));
+		}
+
+		if (packed_len != 0 && packed_len < src.len) {
+			entry->flags = PAK_ENTRY_LZ4;
+			entry->stored_len = packed_len;
+
+			pak_write_at(fp, offset, packed, packed_len);
+		} else {
+			entry->flags = 0;
+			entry->stored_len = src.len;
+
+			pak_write_at(fp, offset, src.data, src.len);
+		}
+
+		free(packed);
+		fv_close(&src);
+
+		pak_write_at(fp, hdr.names_offset + names_len, srcs[i].name, name_len);
+
+		names_len += name_len;
+		offset = pak_align(offset + entry->stored_len);
+	}
+
+	hdr.file_len = offset;
+
+	pak_write_at(fp, hdr.toc_offset, toc, (size_t)hdr.slot_cnt * sizeof(pak_entry));
+	pak_write_at(fp, 0, &hdr, sizeof(hdr));
+
+	if (ftruncate(fileno(fp), offset) != 0)
+		dbg_error("failed to size pack file");
+
+	if (fclose(fp) != 0 || rename(tmp_path, filepath) != 0)
+		dbg_error("failed to finalize pack file");
+
+	free(toc);
+	free(slot_srcs);
+}
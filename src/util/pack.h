@@ -0,0 +1,78 @@
+#ifndef PACK_H_INCLUDED
+#define PACK_H_INCLUDED
+
+#include "debug.h"
+#include "util.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+
+#define PAK_MAGIC				"UBQPAK01"
+#define PAK_VERSION				1
+#define PAK_DATA_ALIGN				64
+#define PAK_MAX_LZ4_RATIO			255
+#define PAK_MAX_RAW_LEN				(1024ull * 1024 * 1024)
+
+#define PAK_FLAG_COMPRESS			(1 << 0)
+#define PAK_FLAG_VERIFY				(1 << 1)
+
+#define PAK_ENTRY_LZ4				(1 << 0)
+
+typedef struct {
+	char magic[8];
+	uint32_t version;
+	uint32_t entry_cnt;
+	uint32_t slot_cnt;
+	uint32_t reserved;
+	uint64_t toc_offset;
+	uint64_t names_offset;
+	uint64_t file_len;
+} pak_header;
+
+/* toc slots form an open addressing hash table keyed by name_hash, 0 marks an empty slot */
+typedef struct {
+	uint64_t name_hash;
+	uint64_t offset;
+	uint64_t stored_len;
+	uint64_t raw_len;
+	uint32_t name_offset;
+	uint32_t name_len;
+	uint32_t checksum;
+	uint32_t flags;
+} pak_entry;
+
+typedef struct {
+	file_view fv;
+	const pak_header *hdr;
+	const pak_entry *toc;
+	const char *names;
+	uint32_t flags;
+} pak;
+
+typedef struct {
+	char *name;
+	char *filepath;
+} pak_src;
+
+typedef struct {
+	const uint8_t *data;
+	size_t len;
+	uint8_t *owned;
+} pak_blob;
+
+bool pak_open(pak *pk, char *filepath, uint32_t flags);
+
+void pak_close(pak *pk);
+
+const pak_entry *pak_find(pak *pk, const char *name);
+
+bool pak_read(pak *pk, const pak_entry *entry, pak_blob *blob);
+
+void pak_blob_release(pak_blob *blob);
+
+void pak_build(char *filepath, pak_src *srcs, uint32_t src_cnt, uint32_t flags);
+
+#endif
@@ -0,0 +1,380 @@
+#include "prof.h"
+#include "arena.h"
+
+#include <string.h>
+
+typedef struct {
+	const prof_site *site;
+	uint64_t calls;
+	uint64_t ticks;
+	uint64_t max_ticks;
+} prof_zone_stats;
+
+DYNARR_DEFINE(prof_thread_list, prof_thread *)
+
+DYNARR_DEFINE(prof_zone_list, prof_zone_stats)
+
+DYNARR_DEFINE(prof_site_list, prof_site *)
+
+__thread prof_thread				*prof_cur;
+
+static pthread_mutex_t				prof_lock = PTHREAD_MUTEX_INITIALIZER;
+static prof_thread_list				threads;
+static prof_zone_list				zones;
+static prof_site_list				sites;
+static FILE					*trace_fp;
+static bool					trace_first;
+static uint64_t					base_ticks;
+static uint64_t					base_ns;
+static double					ticks_per_ns;
+static uint32_t					summary_frames;
+
+/* rdtsc runs at a constant rate on anything this targets, so one short spin against the clock is enough to start */
+static inline void calibrate(void)
+{
+	uint64_t				t0, n0, n1;
+
+	t0 = prof_ticks();
+	n0 = time_now_ns();
+
+	do {
+		n1 = time_now_ns();
+	} while (n1 - n0 < PROF_CALIBRATE_NS);
+
+	base_ticks = t0;
+	base_ns = n0;
+	ticks_per_ns = (double)(prof_ticks() - t0) / (n1 - n0);
+}
+
+/* every flush widens the calibration window, so the rate only gets more accurate over a run */
+static inline void recalibrate(void)
+{
+	uint64_t				ticks, ns;
+
+	ticks = prof_ticks();
+	ns = time_now_ns();
+
+	if (ns - base_ns > PROF_CALIBRATE_NS)
+		ticks_per_ns = (double)(ticks - base_ticks) / (ns - base_ns);
+}
+
+static inline double ticks_to_us(uint64_t ticks)
+{
+	return ticks / ticks_per_ns / 1e3;
+}
+
+static inline prof_zone_stats *zone_of(const prof_site *site)
+{
+	prof_site				*mut;
+
+	/* only the flusher writes slot, recording threads never read it */
+	mut = (prof_site *)site;
+
+	if (mut->slot == 0) {
+		prof_zone_list_push(&zones, (prof_zone_stats){
+			site,
+			0,
+			0,
+			0
+		});
+
+		mut->slot = zones.size;
+	}
+
+	return &zones.elems[mut->slot - 1];
+}
+
+static inline void write_event(const prof_thread *t, const prof_event *ev)
+{
+	fprintf(trace_fp, "%s\n{\"name\":\"%s\",\"cat\":\"%s:%u\",\"ph\":\"X\",\"pid\":1,\"tid\":%u,\"ts\":%.3f,\"dur\":%.3f}",
+		trace_first ? "" : ",", ev->site->name, ev->site->file, ev->site->line, t->tid,
+		ticks_to_us(ev->begin - base_ticks), ticks_to_us(ev->end - ev->begin));
+
+	trace_first = false;
+}
+
+static inline void drain(prof_thread *t)
+{
+	prof_zone_stats				*z;
+	prof_event				*ev;
+	uint64_t				head, tail, dur;
+
+	head = __atomic_load_n(&t->head, __ATOMIC_ACQUIRE);
+	tail = t->tail;
+
+	for (; tail != head; tail++) {
+		ev = &t->ring[tail & (PROF_RING_CAP - 1)];
+		dur = ev->end - ev->begin;
+
+		z = zone_of(ev->site);
+		z->calls++;
+		z->ticks += dur;
+
+		if (dur > z->max_ticks)
+			z->max_ticks = dur;
+
+		if (trace_fp != NULL)
+			write_event(t, ev);
+	}
+
+	__atomic_store_n(&t->tail, tail, __ATOMIC_RELEASE);
+}
+
+static inline prof_thread *alloc_thread(void)
+{
+	prof_thread				*t;
+
+	t = aligned_alloc(PROF_CACHE_LINE, sizeof(prof_thread));
+
+	if (t == NULL)
+		dbg_error("failed to allocate profiler thread");
+
+	memset(t, '\0', sizeof(prof_thread));
+
+	t->ring = mem_alloc(PROF_RING_CAP * sizeof(prof_event));
+
+	if (t->ring == NULL)
+		dbg_error("failed to allocate profiler ring");
+
+	pthread_mutex_lock(&prof_lock);
+
+	t->tid = threads.size;
+	snprintf(t->name, sizeof(t->name), "thread %u", t->tid);
+
+	prof_thread_list_push(&threads, t);
+
+	pthread_mutex_unlock(&prof_lock);
+
+	return t;
+}
+
+prof_thread *prof_register_thread(void)
+{
+	prof_cur = alloc_thread();
+
+	return prof_cur;
+}
+
+/* a ring with no thread behind it, for events timed elsewhere such as on the gpu */
+prof_thread *prof_add_timeline(const char *name)
+{
+	prof_thread				*t;
+
+	t = alloc_thread();
+
+	pthread_mutex_lock(&prof_lock);
+
+	snprintf(t->name, sizeof(t->name), "%s", name);
+
+	pthread_mutex_unlock(&prof_lock);
+
+	return t;
+}
+
+/* a site for names only known at run time; it lives until prof_clean */
+const prof_site *prof_intern_site(const char *name, const char *file, uint32_t line)
+{
+	prof_site				*site;
+
+	site = mem_alloc(sizeof(prof_site));
+
+	if (site == NULL)
+		dbg_error("failed to allocate profiler site");
+
+	*site = (prof_site){
+		name,
+		file,
+		line,
+		0
+	};
+
+	pthread_mutex_lock(&prof_lock);
+
+	prof_site_list_push(&sites, site);
+
+	pthread_mutex_unlock(&prof_lock);
+
+	return site;
+}
+
+bool prof_init(char *trace_path)
+{
+	calibrate();
+
+	/* the calling thread becomes tid 0 */
+	PROF_THREAD_NAME("main");
+
+	if (trace_path == NULL)
+		return true;
+
+	trace_fp = fopen(trace_path, "w");
+
+	if (trace_fp == NULL) {
+		dbg_warn("could not open trace file %s", trace_path);
+
+		return false;
+	}
+
+	trace_first = true;
+
+	fprintf(trace_fp, "{\"traceEvents\":[");
+
+#ifndef PROF_ENABLE
+	dbg_warn("built without PROF_ENABLE, the trace will hold no cpu zones");
+#endif
+
+	return true;
+}
+
+void prof_thread_name(const char *name)
+{
+	prof_thread				*t;
+
+	t = prof_cur != NULL ? prof_cur : prof_register_thread();
+
+	pthread_mutex_lock(&prof_lock);
+
+	snprintf(t->name, sizeof(t->name), "%s", name);
+
+	pthread_mutex_unlock(&prof_lock);
+}
+
+/* drains every thread's ring; only one thread may flush, usually the one calling prof_frame_end */
+void prof_flush(void)
+{
+	pthread_mutex_lock(&prof_lock);
+
+	recalibrate();
+
+	for (uint32_t i = 0; i < threads.size; i++)
+		drain(threads.elems[i]);
+
+	pthread_mutex_unlock(&prof_lock);
+}
+
+void prof_frame_end(void)
+{
+	prof_flush();
+
+	if (++summary_frames == PROF_SUMMARY_FRAMES)
+		prof_print_summary();
+}
+
+static int cmp_zone(const void *a, const void *b)
+{
+	const prof_zone_stats			*x, *y;
+
+	x = a;
+	y = b;
+
+	return (x->ticks < y->ticks) - (x->ticks > y->ticks);
+}
+
+/* inclusive time per frame for the heaviest zones since the last summary, then starts a new window */
+void prof_print_summary(void)
+{
+	prof_zone_stats				*sorted;
+	prof_zone_stats				*z;
+	uint64_t				dropped;
+	uint32_t				frames, cnt;
+
+	pthread_mutex_lock(&prof_lock);
+
+	frames = summary_frames ? summary_frames : 1;
+	cnt = 0;
+	dropped = 0;
+	sorted = mem_alloc((zones.size ? zones.size : 1) * sizeof(prof_zone_stats));
+
+	for (uint32_t i = 0; i < zones.size; i++) {
+		if (zones.elems[i].calls > 0)
+			sorted[cnt++] = zones.elems[i];
+	}
+
+	for (uint32_t i = 0; i < threads.size; i++)
+		dropped += __atomic_load_n(&threads.elems[i]->dropped, __ATOMIC_RELAXED);
+
+	qsort(sorted, cnt, sizeof(prof_zone_stats), cmp_zone);
+
+	if (cnt > 0)
+		dbg_info("profile over %u frames, %lu zones dropped", frames, (unsigned long)dropped);
+
+	for (uint32_t i = 0; i < cnt && i < PROF_SUMMARY_TOP; i++) {
+		z = &sorted[i];
+
+		dbg_info("  %-24s %8.3f ms/frame %8.1f calls/frame  max %.3f ms", z->site->name,
+			ticks_to_us(z->ticks) / 1e3 / frames, (double)z->calls / frames, ticks_to_us(z->max_ticks) / 1e3);
+	}
+
+	for (uint32_t i = 0; i < zones.size; i++) {
+		zones.elems[i].calls = 0;
+		zones.elems[i].ticks = 0;
+		zones.elems[i].max_ticks = 0;
+	}
+
+	summary_frames = 0;
+
+	mem_free(sorted);
+
+	pthread_mutex_unlock(&prof_lock);
+}
+
+double prof_ticks_per_ns(void)
+{
+	return ticks_per_ns;
+}
+
+/* maps a time_now_ns reading, or anything already put on that clock, onto the tick timeline */
+uint64_t prof_ns_to_ticks(uint64_t ns)
+{
+	return base_ticks + (int64_t)((double)(int64_t)(ns - base_ns) * ticks_per_ns);
+}
+
+/* call after every other profiled thread has stopped, their rings are freed here */
+void prof_clean(void)
+{
+	prof_thread				*t;
+
+	prof_flush();
+
+	if (summary_frames > 0)
+		prof_print_summary();
+
+	pthread_mutex_lock(&prof_lock);
+
+	if (trace_fp != NULL) {
+		for (uint32_t i = 0; i < threads.size; i++) {
+			t = threads.elems[i];
+
+			fprintf(trace_fp, "%s\n{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":%u,\"args\":{\"name\":\"%s\"}}",
+				trace_first ? "" : ",", t->tid, t->name);
+
+			trace_first = false;
+		}
+
+		fprintf(trace_fp, "\n]}\n");
+		fclose(trace_fp);
+
+		trace_fp = NULL;
+
+		dbg_log("wrote chrome trace successfully");
+	}
+
+	for (uint32_t i = 0; i < threads.size; i++) {
+		mem_free(threads.elems[i]->ring);
+		free(threads.elems[i]);
+	}
+
+	for (uint32_t i = 0; i < zones.size; i++)
+		((prof_site *)zones.elems[i].site)->slot = 0;
+
+	for (uint32_t i = 0; i < sites.size; i++)
+		mem_free(sites.elems[i]);
+
+	prof_thread_list_clean(&threads);
+	prof_zone_list_clean(&zones);
+	prof_site_list_clean(&sites);
+
+	pthread_mutex_unlock(&prof_lock);
+
+	prof_cur = NULL;
+}
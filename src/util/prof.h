@@ -0,0 +1,162 @@
+#ifndef PROF_H_INCLUDED
+#define PROF_H_INCLUDED
+
+#include "debug.h"
+#include "util.h"
+#include "dynarr.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <pthread.h>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#endif
+
+#define PROF_RING_CAP				(16 * 1024)
+#define PROF_CACHE_LINE				64
+#define PROF_THREAD_NAME_MAX			32
+#define PROF_SUMMARY_FRAMES			300
+#define PROF_SUMMARY_TOP			12
+#define PROF_CALIBRATE_NS			(5 * 1000 * 1000)
+
+/* one per PROF_ZONE call site; slot is assigned by the flusher the first time it sees the site */
+typedef struct {
+	const char *name;
+	const char *file;
+	uint32_t line;
+	uint32_t slot;
+} prof_site;
+
+/* a zone is written once, when it closes; nesting is recovered from the timestamps */
+typedef struct {
+	const prof_site *site;
+	uint64_t begin;
+	uint64_t end;
+} prof_event;
+
+/* single producer ring, the owning thread pushes at head and the flusher drains from tail */
+typedef struct {
+	uint64_t head __attribute__((aligned(PROF_CACHE_LINE)));
+	uint64_t tail_cache;
+	uint64_t dropped;
+	uint64_t tail __attribute__((aligned(PROF_CACHE_LINE)));
+	prof_event *ring;
+	uint32_t tid;
+	char name[PROF_THREAD_NAME_MAX];
+} prof_thread;
+
+typedef struct {
+	const prof_site *site;
+	uint64_t start;
+} prof_scope;
+
+extern __thread prof_thread *prof_cur;
+
+prof_thread *prof_register_thread(void);
+
+static inline uint64_t prof_ticks(void)
+{
+#if defined(__x86_64__) || defined(__i386__)
+	return __rdtsc();
+#else
+	return time_now_ns();
+#endif
+}
+
+prof_thread *prof_add_timeline(const char *name);
+
+/* t must only ever be pushed to from one thread, for thread rings that is their owner */
+static inline void prof_record_on(prof_thread *t, const prof_site *site, uint64_t begin, uint64_t end)
+{
+	uint64_t				h;
+
+	h = t->head;
+
+	/* a full ring drops the zone rather than ever blocking the thread being measured */
+	if (__builtin_expect(h - t->tail_cache >= PROF_RING_CAP, 0)) {
+		t->tail_cache = __atomic_load_n(&t->tail, __ATOMIC_ACQUIRE);
+
+		if (h - t->tail_cache >= PROF_RING_CAP) {
+			__atomic_store_n(&t->dropped, t->dropped + 1, __ATOMIC_RELAXED);
+
+			return;
+		}
+	}
+
+	t->ring[h & (PROF_RING_CAP - 1)] = (prof_event){
+		site,
+		begin,
+		end
+	};
+
+	__atomic_store_n(&t->head, h + 1, __ATOMIC_RELEASE);
+}
+
+static inline void prof_record(const prof_site *site, uint64_t begin, uint64_t end)
+{
+	prof_thread				*t;
+
+	t = prof_cur;
+
+	if (__builtin_expect(t == NULL, 0))
+		t = prof_register_thread();
+
+	prof_record_on(t, site, begin, end);
+}
+
+static inline prof_scope prof_scope_begin(const prof_site *site)
+{
+	return (prof_scope){
+		site,
+		prof_ticks()
+	};
+}
+
+static inline void prof_scope_end(prof_scope *scope)
+{
+	prof_record(scope->site, scope->start, prof_ticks());
+}
+
+#define PROF_CONCAT_(a, b)			a##b
+#define PROF_CONCAT(a, b)			PROF_CONCAT_(a, b)
+
+/* PROF_ZONE("name") times the rest of the enclosing block; without PROF_ENABLE it is nothing */
+#ifdef PROF_ENABLE
+#define PROF_ZONE(name)								\
+	static prof_site PROF_CONCAT(prof_site_, __LINE__) = {			\
+		name,								\
+		__FILE__,							\
+		__LINE__,							\
+		0								\
+	};									\
+	prof_scope PROF_CONCAT(prof_scope_, __LINE__)				\
+		__attribute__((cleanup(prof_scope_end))) =			\
+		prof_scope_begin(&PROF_CONCAT(prof_site_, __LINE__))
+#define PROF_THREAD_NAME(name)			prof_thread_name(name)
+#else
+#define PROF_ZONE(name)				((void)0)
+#define PROF_THREAD_NAME(name)			((void)0)
+#endif
+
+bool prof_init(char *trace_path);
+
+void prof_clean(void);
+
+void prof_thread_name(const char *name);
+
+void prof_flush(void);
+
+void prof_frame_end(void);
+
+void prof_print_summary(void);
+
+double prof_ticks_per_ns(void);
+
+uint64_t prof_ns_to_ticks(uint64_t ns);
+
+const prof_site *prof_intern_site(const char *name, const char *file, uint32_t line);
+
+#endif
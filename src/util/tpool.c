@@ -0,0 +1,187 @@
+#include "tpool.h"
+#include "arena.h"
+
+#include <unistd.h>
+
+#define TPOOL_MIN_TASK_CAP			64
+
+static void *tpool_worker_main(void *arg)
+{
+	tpool_worker				*worker;
+	tpool					*tp;
+	tpool_task				task;
+
+	worker = arg;
+	tp = worker->tp;
+
+	PROF_THREAD_NAME("pool worker");
+
+	pthread_mutex_lock(&tp->lock);
+
+	for (;;) {
+		while (tp->task_cnt == 0 && !tp->stopping)
+			pthread_cond_wait(&tp->task_cond, &tp->lock);
+
+		if (tp->task_cnt == 0)
+			break;
+
+		task = tp->tasks[tp->task_head];
+		tp->task_head = (tp->task_head + 1) % tp->task_cap;
+		tp->task_cnt--;
+		tp->busy_cnt++;
+
+		pthread_mutex_unlock(&tp->lock);
+
+		task.fn(task.arg, worker->ind);
+
+		pthread_mutex_lock(&tp->lock);
+
+		tp->busy_cnt--;
+
+		pthread_cond_broadcast(&tp->done_cond);
+	}
+
+	pthread_mutex_unlock(&tp->lock);
+
+	return NULL;
+}
+
+/* the queue is a ring, so growing it has to unroll the wrapped part to the front */
+static inline void tpool_grow(tpool *tp)
+{
+	tpool_task				*tasks;
+	uint32_t				cap;
+
+	cap = tp->task_cap * 2;
+	tasks = mem_alloc(cap * sizeof(tpool_task));
+
+	if (tasks == NULL)
+		dbg_error("failed to grow thread pool queue");
+
+	for (uint32_t i = 0; i < tp->task_cnt; i++)
+		tasks[i] = tp->tasks[(tp->task_head + i) % tp->task_cap];
+
+	mem_free(tp->tasks);
+
+	tp->tasks = tasks;
+	tp->task_cap = cap;
+	tp->task_head = 0;
+}
+
+uint32_t tpool_core_cnt(void)
+{
+	long					cnt;
+
+	cnt = sysconf(_SC_NPROCESSORS_ONLN);
+
+	if (cnt < 1)
+		return 1;
+
+	return cnt > TPOOL_MAX_THREADS ? TPOOL_MAX_THREADS : (uint32_t)cnt;
+}
+
+void tpool_init(tpool *tp, uint32_t thread_cnt)
+{
+	if (thread_cnt < 1)
+		thread_cnt = 1;
+
+	if (thread_cnt > TPOOL_MAX_THREADS)
+		thread_cnt = TPOOL_MAX_THREADS;
+
+	pthread_mutex_init(&tp->lock, NULL);
+	pthread_cond_init(&tp->task_cond, NULL);
+	pthread_cond_init(&tp->done_cond, NULL);
+
+	tp->task_cap = TPOOL_MIN_TASK_CAP;
+	tp->tasks = mem_alloc(tp->task_cap * sizeof(tpool_task));
+	tp->task_head = 0;
+	tp->task_cnt = 0;
+	tp->busy_cnt = 0;
+	tp->stopping = false;
+	tp->thread_cnt = thread_cnt;
+
+	if (tp->tasks == NULL)
+		dbg_error("failed to allocate thread pool queue");
+
+	for (uint32_t i = 0; i < thread_cnt; i++) {
+		tp->workers[i].tp = tp;
+		tp->workers[i].ind = i;
+
+		if (pthread_create(&tp->workers[i].thread, NULL, tpool_worker_main, &tp->workers[i]) != 0)
+			dbg_error("failed to create worker thread");
+	}
+}
+
+void tpool_clean(tpool *tp)
+{
+	pthread_mutex_lock(&tp->lock);
+
+	tp->stopping = true;
+
+	pthread_cond_broadcast(&tp->task_cond);
+	pthread_mutex_unlock(&tp->lock);
+
+	for (uint32_t i = 0; i < tp->thread_cnt; i++)
+		pthread_join(tp->workers[i].thread, NULL);
+
+	mem_free(tp->tasks);
+
+	pthread_mutex_destroy(&tp->lock);
+	pthread_cond_destroy(&tp->task_cond);
+	pthread_cond_destroy(&tp->done_cond);
+
+	tp->tasks = NULL;
+	tp->thread_cnt = 0;
+}
+
+void tpool_submit(tpool *tp, tpool_fn fn, void *arg)
+{
+	pthread_mutex_lock(&tp->lock);
+
+	if (tp->task_cnt == tp->task_cap)
+		tpool_grow(tp);
+
+	tp->tasks[(tp->task_head + tp->task_cnt) % tp->task_cap] = (tpool_task){
+		fn,
+		arg
+	};
+
+	tp->task_cnt++;
+
+	pthread_cond_signal(&tp->task_cond);
+	pthread_mutex_unlock(&tp->lock);
+}
+
+/* flags are set under the pool lock so a waiter can never miss the wakeup */
+void tpool_signal(tpool *tp, uint32_t *flag)
+{
+	pthread_mutex_lock(&tp->lock);
+
+	__atomic_store_n(flag, 1, __ATOMIC_RELEASE);
+
+	pthread_cond_broadcast(&tp->done_cond);
+	pthread_mutex_unlock(&tp->lock);
+}
+
+void tpool_wait_flag(tpool *tp, uint32_t *flag)
+{
+	if (__atomic_load_n(flag, __ATOMIC_ACQUIRE))
+		return;
+
+	pthread_mutex_lock(&tp->lock);
+
+	while (!__atomic_load_n(flag, __ATOMIC_ACQUIRE))
+		pthread_cond_wait(&tp->done_cond, &tp->lock);
+
+	pthread_mutex_unlock(&tp->lock);
+}
+
+void tpool_wait_idle(tpool *tp)
+{
+	pthread_mutex_lock(&tp->lock);
+
+	while (tp->task_cnt != 0 || tp->busy_cnt != 0)
+		pthread_cond_wait(&tp->done_cond, &tp->lock);
+
+	pthread_mutex_unlock(&tp->lock);
+}
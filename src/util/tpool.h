@@ -0,0 +1,58 @@
+#ifndef TPOOL_H_INCLUDED
+#define TPOOL_H_INCLUDED
+
+#include "debug.h"
+#include "prof.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <pthread.h>
+
+#define TPOOL_MAX_THREADS			64
+
+typedef void (*tpool_fn)(void *arg, uint32_t worker);
+
+typedef struct {
+	tpool_fn fn;
+	void *arg;
+} tpool_task;
+
+typedef struct tpool tpool;
+
+typedef struct {
+	tpool *tp;
+	uint32_t ind;
+	pthread_t thread;
+} tpool_worker;
+
+struct tpool {
+	tpool_worker workers[TPOOL_MAX_THREADS];
+	uint32_t thread_cnt;
+	pthread_mutex_t lock;
+	pthread_cond_t task_cond;
+	pthread_cond_t done_cond;
+	tpool_task *tasks;
+	uint32_t task_cap;
+	uint32_t task_head;
+	uint32_t task_cnt;
+	uint32_t busy_cnt;
+	bool stopping;
+};
+
+uint32_t tpool_core_cnt(void);
+
+void tpool_init(tpool *tp, uint32_t thread_cnt);
+
+void tpool_clean(tpool *tp);
+
+void tpool_submit(tpool *tp, tpool_fn fn, void *arg);
+
+void tpool_signal(tpool *tp, uint32_t *flag);
+
+void tpool_wait_flag(tpool *tp, uint32_t *flag);
+
+void tpool_wait_idle(tpool *tp);
+
+#endif
@@ -1,38 +1,185 @@
 #include "util.h"
+#include "arena.h"
 
-size_t get_file_len(char *filepath)
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <time.h>
+
+#define FV_READ_CHUNK				(64 * 1024)
+
+static const uint8_t				fv_empty[1];
+static uint32_t					crc_table[256];
+static pthread_once_t				crc_once = PTHREAD_ONCE_INIT;
+
+static inline void fv_advise(file_view *fv, file_view_hint hint)
 {
-	FILE					*fp;
-	size_t					file_len;
-	
-	fp = fopen(filepath, "rb");
-	
-	if (fp == NULL)
-		dbg_error("could not open file");
-		
-	fseek(fp, 0, SEEK_END);
-	
-	file_len = ftell(fp);
+	if (!fv->mapped || hint == FV_HINT_NONE)
+		return;
+
+	madvise((void *)fv->data, fv->len, hint == FV_HINT_SEQUENTIAL ? MADV_SEQUENTIAL : MADV_WILLNEED);
+}
+
+/* pipes, fifos and anything else mmap refuses get read into a heap buffer */
+static inline void fv_read_fallback(file_view *fv, int fd)
+{
+	uint8_t					*buf, *grown;
+	size_t					len, cap;
+	ssize_t					read_len;
 
-	fseek(fp, 0, SEEK_SET);
-	
-	fclose(fp);
+	cap = FV_READ_CHUNK;
+	len = 0;
+	buf = mem_alloc(cap);
 
-	return file_len;
+	if (buf == NULL)
+		dbg_error("failed to allocate file buffer");
+
+	while ((read_len = read(fd, buf + len, cap - len)) != 0) {
+		if (read_len < 0)
+			dbg_error("failed to read file");
+
+		len += read_len;
+
+		if (len == cap) {
+			cap *= 2;
+			grown = mem_realloc(buf, cap);
+
+			if (grown == NULL)
+				dbg_error("failed to grow file buffer");
+
+			buf = grown;
+		}
+	}
+
+	fv->data = buf;
+	fv->len = len;
+	fv->mapped = false;
 }
 
-void read_file(char *dest, char *filepath)
-{	
-	FILE					*fp;
+bool fv_try_open(file_view *fv, char *filepath, file_view_hint hint)
+{
+	int					fd;
+	struct stat				st;
+	void					*data;
+
+	fd = open(filepath, O_RDONLY);
+
+	if (fd < 0)
+		return false;
+
+	if (fstat(fd, &st) != 0)
+		dbg_error("could not stat file");
+
+	if (!S_ISREG(st.st_mode)) {
+		fv_read_fallback(fv, fd);
+		close(fd);
+
+		return true;
+	}
+
+	if (st.st_size == 0) {
+		fv->data = fv_empty;
+		fv->len = 0;
+		fv->mapped = false;
+
+		close(fd);
+
+		return true;
+	}
+
+	data = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+
+	if (data == MAP_FAILED) {
+		fv_read_fallback(fv, fd);
+		close(fd);
+
+		return true;
+	}
+
+	close(fd);
+
+	fv->data = data;
+	fv->len = st.st_size;
+	fv->mapped = true;
+
+	fv_advise(fv, hint);
+
+	return true;
+}
 
-	fp = fopen(filepath, "rb");
-	
-	if (fp == NULL)
+void fv_open(file_view *fv, char *filepath, file_view_hint hint)
+{
+	if (!fv_try_open(fv, filepath, hint))
 		dbg_error("could not open file");
-		
-	fread(dest, 1, get_file_len(filepath), fp);
+}
+
+void fv_close(file_view *fv)
+{
+	if (fv->mapped)
+		munmap((void *)fv->data, fv->len);
+	else if (fv->data != fv_empty)
+		mem_free((void *)fv->data);
+
+	fv->data = NULL;
+	fv->len = 0;
+	fv->mapped = false;
+}
+
+uint64_t hash_fnv1a(const void *data, size_t len)
+{
+	const uint8_t				*bytes;
+	uint64_t				hash;
+
+	bytes = data;
+	hash = 0xcbf29ce484222325ull;
+
+	for (size_t i = 0; i < len; i++) {
+		hash ^= bytes[i];
+		hash *= 0x100000001b3ull;
+	}
+
+	return hash;
+}
+
+static void crc_init_table(void)
+{
+	uint32_t				crc;
 
-	fclose(fp);
+	for (uint32_t i = 0; i < 256; i++) {
+		crc = i;
+
+		for (uint32_t j = 0; j < 8; j++)
+			crc = (crc >> 1) ^ (0xedb88320u & -(crc & 1));
+
+		crc_table[i] = crc;
+	}
+}
+
+/* the decode workers checksum chunks concurrently, so the table is built exactly once before anyone reads it */
+uint32_t crc32(const void *data, size_t len)
+{
+	const uint8_t				*bytes;
+	uint32_t				crc;
+
+	pthread_once(&crc_once, crc_init_table);
+
+	bytes = data;
+	crc = 0xffffffffu;
+
+	for (size_t i = 0; i < len; i++)
+		crc = (crc >> 8) ^ crc_table[(crc ^ bytes[i]) & 0xff];
+
+	return ~crc;
+}
+
+uint64_t time_now_ns(void)
+{
+	struct timespec				ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+
+	return (uint64_t)ts.tv_sec * 1000000000ull + ts.tv_nsec;
 }
 
 uint32_t clamp_uint(uint32_t val, uint32_t min, uint32_t max)
@@ -43,4 +190,4 @@ uint32_t clamp_uint(uint32_t val, uint32_t min, uint32_t max)
 		return max;
 
 	return val;
-}
\ No newline at end of file
+}
@@ -6,11 +6,32 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <stdint.h>
+#include <stdbool.h>
 
-size_t get_file_len(char *filepath);
+typedef enum {
+	FV_HINT_NONE,
+	FV_HINT_SEQUENTIAL,
+	FV_HINT_WILLNEED,
+} file_view_hint;
 
-void read_file(char *dest, char *filepath);
+typedef struct {
+	const uint8_t *data;
+	size_t len;
+	bool mapped;
+} file_view;
+
+bool fv_try_open(file_view *fv, char *filepath, file_view_hint hint);
+
+void fv_open(file_view *fv, char *filepath, file_view_hint hint);
+
+void fv_close(file_view *fv);
+
+uint64_t hash_fnv1a(const void *data, size_t len);
+
+uint32_t crc32(const void *data, size_t len);
+
+uint64_t time_now_ns(void);
 
 uint32_t clamp_uint(uint32_t val, uint32_t min, uint32_t max);
 
-#endif
\ No newline at end of file
+#endif
@@ -0,0 +1,118 @@
+#ifndef VMATH_H_INCLUDED
+#define VMATH_H_INCLUDED
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+#include <math.h>
+
+typedef struct {
+	float x, y, z;
+} vec3;
+
+/* column-major, matching glsl, so matrices go to the gpu as-is */
+typedef struct {
+	float m[16];
+} mat4;
+
+/* left, right, bottom, top, near, far; xyz is the inward normal, inside when dot(xyz, p) + w >= 0 */
+typedef struct {
+	float planes[6][4];
+} frustum;
+
+static inline void mat4_identity(mat4 *out)
+{
+	memset(out, '\0', sizeof(*out));
+
+	out->m[0] = 1.0f;
+	out->m[5] = 1.0f;
+	out->m[10] = 1.0f;
+	out->m[15] = 1.0f;
+}
+
+static inline void mat4_mul(mat4 *out, const mat4 *a, const mat4 *b)
+{
+	mat4					res;
+
+	for (uint32_t col = 0; col < 4; col++) {
+		for (uint32_t row = 0; row < 4; row++) {
+			res.m[col * 4 + row] = a->m[row] * b->m[col * 4] + a->m[4 + row] * b->m[col * 4 + 1] +
+				a->m[8 + row] * b->m[col * 4 + 2] + a->m[12 + row] * b->m[col * 4 + 3];
+		}
+	}
+
+	*out = res;
+}
+
+static inline void mat4_translate_scale(mat4 *out, float x, float y, float z, float scale)
+{
+	mat4_identity(out);
+
+	out->m[0] = scale;
+	out->m[5] = scale;
+	out->m[10] = scale;
+	out->m[12] = x;
+	out->m[13] = y;
+	out->m[14] = z;
+}
+
+/* gribb-hartmann extraction for vulkan clip space, where depth runs 0..w */
+static inline void frustum_from_mat4(frustum *out, const mat4 *vp)
+{
+	const float				*m;
+	float					len;
+
+	m = vp->m;
+
+	for (uint32_t i = 0; i < 4; i++) {
+		out->planes[0][i] = m[i * 4 + 3] + m[i * 4];
+		out->planes[1][i] = m[i * 4 + 3] - m[i * 4];
+		out->planes[2][i] = m[i * 4 + 3] + m[i * 4 + 1];
+		out->planes[3][i] = m[i * 4 + 3] - m[i * 4 + 1];
+		out->planes[4][i] = m[i * 4 + 2];
+		out->planes[5][i] = m[i * 4 + 3] - m[i * 4 + 2];
+	}
+
+	for (uint32_t i = 0; i < 6; i++) {
+		len = sqrtf(out->planes[i][0] * out->planes[i][0] + out->planes[i][1] * out->planes[i][1] +
+			out->planes[i][2] * out->planes[i][2]);
+
+		if (len > 0.0f) {
+			for (uint32_t j = 0; j < 4; j++)
+				out->planes[i][j] /= len;
+		}
+	}
+}
+
+/* a local bounding sphere (xyz center, w radius) moved into world space, scaled by the largest axis */
+static inline void sphere_transform(float *out, const mat4 *model, const float *sphere)
+{
+	const float				*m;
+	float					sx, sy, sz;
+
+	m = model->m;
+
+	for (uint32_t i = 0; i < 3; i++)
+		out[i] = m[i] * sphere[0] + m[4 + i] * sphere[1] + m[8 + i] * sphere[2] + m[12 + i];
+
+	sx = m[0] * m[0] + m[1] * m[1] + m[2] * m[2];
+	sy = m[4] * m[4] + m[5] * m[5] + m[6] * m[6];
+	sz = m[8] * m[8] + m[9] * m[9] + m[10] * m[10];
+
+	out[3] = sphere[3] * sqrtf(fmaxf(sx, fmaxf(sy, sz)));
+}
+
+static inline bool frustum_test_sphere(const frustum *f, const float *sphere)
+{
+	for (uint32_t i = 0; i < 6; i++) {
+		if (f->planes[i][0] * sphere[0] + f->planes[i][1] * sphere[1] + f->planes[i][2] * sphere[2] +
+			f->planes[i][3] < -sphere[3])
+			return false;
+	}
+
+	return true;
+}
+
+#endif
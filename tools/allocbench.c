@@ -0,0 +1,220 @@
+#include "../src/util/debug.h"
+#include "../src/util/util.h"
+#include "../src/util/arena.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define ALLOCBENCH_FRAMES			600
+#define ALLOCBENCH_PER_FRAME			4096
+#define ALLOCBENCH_MIN_SIZE			16
+#define ALLOCBENCH_MAX_SIZE			512
+#define ALLOCBENCH_POOL_SIZE			64
+#define ALLOCBENCH_ARENA_BLOCK			(256 * 1024)
+#define ALLOCBENCH_REPS				5
+
+static inline uint32_t rand_next(uint32_t *state)
+{
+	*state ^= *state << 13;
+	*state ^= *state >> 17;
+	*state ^= *state << 5;
+
+	return *state;
+}
+
+static inline uint32_t rand_size(uint32_t *seed)
+{
+	return ALLOCBENCH_MIN_SIZE + rand_next(seed) % (ALLOCBENCH_MAX_SIZE - ALLOCBENCH_MIN_SIZE);
+}
+
+/* the touch keeps the compiler from dropping allocations nobody reads */
+static inline void touch(void *mem, uint32_t size, uint32_t *sink)
+{
+	memset(mem, (int)size, size);
+
+	*sink += ((uint8_t *)mem)[size - 1];
+}
+
+/* what the init code did before: a malloc and a free around every scratch buffer */
+static uint64_t heap_frame(void **ptrs, uint32_t *seed, uint32_t *sink)
+{
+	uint64_t				start_ns;
+	uint32_t				size;
+
+	start_ns = time_now_ns();
+
+	for (uint32_t i = 0; i < ALLOCBENCH_PER_FRAME; i++) {
+		size = rand_size(seed);
+		ptrs[i] = mem_alloc(size);
+
+		if (ptrs[i] == NULL)
+			dbg_error("failed to allocate scratch");
+
+		touch(ptrs[i], size, sink);
+	}
+
+	for (uint32_t i = 0; i < ALLOCBENCH_PER_FRAME; i++)
+		mem_free(ptrs[i]);
+
+	return time_now_ns() - start_ns;
+}
+
+static uint64_t arena_frame(arena *a, uint32_t *seed, uint32_t *sink)
+{
+	uint64_t				start_ns;
+	uint32_t				size;
+	void					*mem;
+
+	start_ns = time_now_ns();
+
+	arena_reset(a);
+
+	for (uint32_t i = 0; i < ALLOCBENCH_PER_FRAME; i++) {
+		size = rand_size(seed);
+		mem = arena_alloc(a, size);
+
+		touch(mem, size, sink);
+	}
+
+	return time_now_ns() - start_ns;
+}
+
+/* same-sized objects churned in place, half of them freed and reallocated each frame */
+static uint64_t pool_frame(pool *p, void **ptrs, uint32_t *seed, uint32_t *sink)
+{
+	uint64_t				start_ns;
+	uint32_t				ind;
+
+	start_ns = time_now_ns();
+
+	for (uint32_t i = 0; i < ALLOCBENCH_PER_FRAME / 2; i++) {
+		ind = rand_next(seed) % ALLOCBENCH_PER_FRAME;
+
+		pool_free(p, ptrs[ind]);
+		ptrs[ind] = pool_alloc(p);
+
+		touch(ptrs[ind], ALLOCBENCH_POOL_SIZE, sink);
+	}
+
+	return time_now_ns() - start_ns;
+}
+
+static uint64_t heap_churn(void **ptrs, uint32_t *seed, uint32_t *sink)
+{
+	uint64_t				start_ns;
+	uint32_t				ind;
+
+	start_ns = time_now_ns();
+
+	for (uint32_t i = 0; i < ALLOCBENCH_PER_FRAME / 2; i++) {
+		ind = rand_next(seed) % ALLOCBENCH_PER_FRAME;
+
+		mem_free(ptrs[ind]);
+		ptrs[ind] = mem_alloc(ALLOCBENCH_POOL_SIZE);
+
+		if (ptrs[ind] == NULL)
+			dbg_error("failed to allocate churn object");
+
+		touch(ptrs[ind], ALLOCBENCH_POOL_SIZE, sink);
+	}
+
+	return time_now_ns() - start_ns;
+}
+
+static inline void report(const char *name, uint64_t best_ns, uint32_t cnt, uint64_t warm_calls, uint32_t warm_frames)
+{
+	printf("%-24s %8.3f ms/frame %7.2f ns/alloc %8lu heap calls in %u frames after the first\n", name,
+		best_ns / 1e6, (double)best_ns / cnt, (unsigned long)warm_calls, warm_frames);
+}
+
+/* each case runs ALLOCBENCH_FRAMES frames; heap calls of every frame but the first are summed to show the steady state */
+int main(void)
+{
+	arena					a;
+	pool					p;
+	void					**ptrs;
+	uint32_t				seed, sink;
+	uint64_t				ns, best_ns, warm_calls;
+
+	ptrs = mem_alloc(ALLOCBENCH_PER_FRAME * sizeof(void *));
+
+	if (ptrs == NULL)
+		dbg_error("failed to allocate pointer table");
+
+	seed = 0x9e3779b9u;
+	sink = 0;
+
+	printf("%u allocations of %u to %u bytes per frame, %u frames\n", ALLOCBENCH_PER_FRAME, ALLOCBENCH_MIN_SIZE,
+		ALLOCBENCH_MAX_SIZE, ALLOCBENCH_FRAMES);
+
+	best_ns = UINT64_MAX;
+	warm_calls = 0;
+
+	for (uint32_t f = 0; f < ALLOCBENCH_FRAMES; f++) {
+		mem_frame_begin();
+		ns = heap_frame(ptrs, &seed, &sink);
+		warm_calls += f > 0 ? mem_frame_heap_calls() : 0;
+		best_ns = ns < best_ns ? ns : best_ns;
+	}
+
+	report("malloc/free", best_ns, ALLOCBENCH_PER_FRAME, warm_calls, ALLOCBENCH_FRAMES - 1);
+
+	arena_init(&a, ALLOCBENCH_ARENA_BLOCK);
+
+	best_ns = UINT64_MAX;
+	warm_calls = 0;
+
+	for (uint32_t f = 0; f < ALLOCBENCH_FRAMES; f++) {
+		mem_frame_begin();
+		ns = arena_frame(&a, &seed, &sink);
+		warm_calls += f > 0 ? mem_frame_heap_calls() : 0;
+		best_ns = ns < best_ns ? ns : best_ns;
+	}
+
+	report("frame arena", best_ns, ALLOCBENCH_PER_FRAME, warm_calls, ALLOCBENCH_FRAMES - 1);
+
+	arena_clean(&a);
+
+	for (uint32_t i = 0; i < ALLOCBENCH_PER_FRAME; i++)
+		ptrs[i] = mem_alloc(ALLOCBENCH_POOL_SIZE);
+
+	best_ns = UINT64_MAX;
+	warm_calls = 0;
+
+	for (uint32_t f = 0; f < ALLOCBENCH_FRAMES; f++) {
+		mem_frame_begin();
+		ns = heap_churn(ptrs, &seed, &sink);
+		warm_calls += f > 0 ? mem_frame_heap_calls() : 0;
+		best_ns = ns < best_ns ? ns : best_ns;
+	}
+
+	report("malloc/free churn", best_ns, ALLOCBENCH_PER_FRAME / 2, warm_calls, ALLOCBENCH_FRAMES - 1);
+
+	for (uint32_t i = 0; i < ALLOCBENCH_PER_FRAME; i++)
+		mem_free(ptrs[i]);
+
+	pool_init(&p, ALLOCBENCH_POOL_SIZE, ALLOCBENCH_PER_FRAME);
+
+	for (uint32_t i = 0; i < ALLOCBENCH_PER_FRAME; i++)
+		ptrs[i] = pool_alloc(&p);
+
+	best_ns = UINT64_MAX;
+	warm_calls = 0;
+
+	for (uint32_t f = 0; f < ALLOCBENCH_FRAMES; f++) {
+		mem_frame_begin();
+		ns = pool_frame(&p, ptrs, &seed, &sink);
+		warm_calls += f > 0 ? mem_frame_heap_calls() : 0;
+		best_ns = ns < best_ns ? ns : best_ns;
+	}
+
+	report("pool churn", best_ns, ALLOCBENCH_PER_FRAME / 2, warm_calls, ALLOCBENCH_FRAMES - 1);
+
+	pool_clean(&p);
+	mem_free(ptrs);
+
+	printf("checksum %u\n", sink);
+
+	return 0;
+}
@@ -0,0 +1,161 @@
+#include "../src/util/debug.h"
+#include "../src/util/util.h"
+#include "../src/engine/cull.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+#define CULLBENCH_SMALL				4096
+#define CULLBENCH_LARGE				(1024 * 1024)
+#define CULLBENCH_WORK				(32u * 1024 * 1024)
+#define CULLBENCH_SEED				0x9e3779b9u
+
+static uint32_t					rng_state;
+
+static inline float rand_float(float lo, float hi)
+{
+	rng_state ^= rng_state << 13;
+	rng_state ^= rng_state >> 17;
+	rng_state ^= rng_state << 5;
+
+	return lo + (hi - lo) * (rng_state >> 8) / (float)(1 << 24);
+}
+
+static inline void rotation_z(mat4 *out, float angle)
+{
+	mat4_identity(out);
+
+	out->m[0] = cosf(angle);
+	out->m[1] = sinf(angle);
+	out->m[4] = -sinf(angle);
+	out->m[5] = cosf(angle);
+}
+
+/* scattered well past the view volume, so only about one object in seven survives */
+static inline void gen_set(cull_set *set, uint32_t cnt)
+{
+	mat4					model, rot;
+	float					aabb[6];
+
+	rng_state = CULLBENCH_SEED;
+
+	cull_set_clear(set);
+
+	for (uint32_t i = 0; i < cnt; i++) {
+		rotation_z(&rot, rand_float(0.0f, 6.28f));
+		mat4_translate_scale(&model, rand_float(-2.0f, 2.0f), rand_float(-2.0f, 2.0f), rand_float(-0.5f, 1.5f),
+			rand_float(0.01f, 0.05f));
+		mat4_mul(&model, &model, &rot);
+
+		aabb[0] = rand_float(-0.5f, 0.5f);
+		aabb[1] = rand_float(-0.5f, 0.5f);
+		aabb[2] = rand_float(-0.5f, 0.5f);
+		aabb[3] = rand_float(0.1f, 1.0f);
+		aabb[4] = rand_float(0.1f, 1.0f);
+		aabb[5] = rand_float(0.1f, 1.0f);
+
+		cull_set_add(set, &model, aabb);
+	}
+}
+
+static inline bool same_results(const cull_set *a, const cull_set *b)
+{
+	for (uint32_t i = 0; i < CULL_WORLD_STREAMS; i++) {
+		if (memcmp(a->world[i].elems, b->world[i].elems, a->cnt * sizeof(float)) != 0)
+			return false;
+	}
+
+	for (uint32_t i = 0; i < CULL_MODEL_STREAMS; i++) {
+		if (memcmp(a->model[i].elems, b->model[i].elems, a->cnt * sizeof(float)) != 0)
+			return false;
+	}
+
+	return a->visible.size == b->visible.size &&
+		memcmp(a->visible.elems, b->visible.elems, a->visible.size * sizeof(uint32_t)) == 0;
+}
+
+/* every isa runs the same set and must reproduce the scalar streams exactly before it is timed */
+static inline void report(uint32_t cnt, const frustum *f)
+{
+	cull_set				ref, set;
+	mat4					rot;
+	uint32_t				reps;
+	uint64_t				mul_ns, aabb_ns, sphere_ns;
+	bool					match;
+
+	reps = CULLBENCH_WORK / cnt;
+
+	rotation_z(&rot, 0.001f);
+
+	cull_set_init(&ref);
+	cull_set_init(&set);
+
+	cull_select_isa(CULL_ISA_SCALAR);
+	gen_set(&ref, cnt);
+	cull_mul(&ref, &rot);
+	cull_run(&ref, f);
+
+	for (int isa = 0; isa < CULL_ISA_CNT; isa++) {
+		if (!cull_select_isa(isa)) {
+			printf("%-6s %8u objs  not supported\n", cull_isa_name(isa), cnt);
+			continue;
+		}
+
+		gen_set(&set, cnt);
+		cull_mul(&set, &rot);
+		cull_run(&set, f);
+
+		match = same_results(&ref, &set);
+
+		mul_ns = time_now_ns();
+
+		for (uint32_t r = 0; r < reps; r++)
+			cull_mul(&set, &rot);
+
+		mul_ns = time_now_ns() - mul_ns;
+		aabb_ns = time_now_ns();
+
+		for (uint32_t r = 0; r < reps; r++)
+			cull_transform_aabbs(&set);
+
+		aabb_ns = time_now_ns() - aabb_ns;
+		sphere_ns = time_now_ns();
+
+		for (uint32_t r = 0; r < reps; r++)
+			cull_test_spheres(&set, f);
+
+		sphere_ns = time_now_ns() - sphere_ns;
+
+		printf("%-6s %8u objs  mat4 mul %.3f  aabb %.3f  sphere %.3f objs/ns  %u visible  %s\n",
+			cull_isa_name(isa), cnt, (double)cnt * reps / mul_ns, (double)cnt * reps / aabb_ns,
+			(double)cnt * reps / sphere_ns, ref.visible.size, match ? "matches scalar" : "MISMATCH");
+	}
+
+	cull_set_clean(&ref);
+	cull_set_clean(&set);
+}
+
+int main(int argc, char **argv)
+{
+	mat4					view_proj;
+	frustum					f;
+	uint32_t				cnt;
+
+	cnt = argc > 1 ? strtoul(argv[1], NULL, 10) : 0;
+
+	mat4_identity(&view_proj);
+	frustum_from_mat4(&f, &view_proj);
+
+	printf("best isa %s\n", cull_isa_name(cull_init()));
+
+	if (cnt > 0) {
+		report(cnt, &f);
+	} else {
+		report(CULLBENCH_SMALL, &f);
+		report(CULLBENCH_LARGE, &f);
+	}
+
+	return 0;
+}
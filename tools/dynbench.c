@@ -0,0 +1,287 @@
+#include "../src/util/debug.h"
+#include "../src/util/util.h"
+#include "../src/util/arena.h"
+#include "../src/util/dynarr.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define DYNBENCH_MAX_CNT			(10u * 1000 * 1000)
+#define DYNBENCH_NAIVE_MAX_CNT			(100u * 1000)
+#define DYNBENCH_CHUNK				256
+#define DYNBENCH_REPS				3
+#define DYNBENCH_SUM_CNT			(1000u * 1000)
+#define DYNBENCH_SUM_REPS			50
+
+typedef struct {
+	float x, y, z;
+} float3;
+
+DYNARR_DEFINE(u32_list, uint32_t)
+DYNARR_DEFINE(vec3_da, float3)
+
+typedef float (*sum_fn)(void *arr);
+
+typedef uint64_t (*bench_fn)(uint32_t cnt, uint64_t *heap_calls);
+
+/* the old da_add_elem: one realloc per insert */
+static uint64_t naive_append(uint32_t cnt, uint64_t *heap_calls)
+{
+	uint32_t				*elems, *grown;
+	uint64_t				start_ns, calls;
+
+	elems = NULL;
+	calls = mem_heap_call_cnt();
+	start_ns = time_now_ns();
+
+	for (uint32_t i = 0; i < cnt; i++) {
+		grown = mem_realloc(elems, (size_t)(i + 1) * sizeof(uint32_t));
+
+		if (grown == NULL)
+			dbg_error("failed to grow naive array");
+
+		elems = grown;
+		elems[i] = i;
+	}
+
+	start_ns = time_now_ns() - start_ns;
+	*heap_calls = mem_heap_call_cnt() - calls;
+
+	mem_free(elems);
+
+	return start_ns;
+}
+
+static uint64_t da_append(uint32_t cnt, uint64_t *heap_calls)
+{
+	dynarr					da;
+	uint64_t				start_ns, calls;
+
+	da_init(&da, sizeof(uint32_t));
+
+	calls = mem_heap_call_cnt();
+	start_ns = time_now_ns();
+
+	for (uint32_t i = 0; i < cnt; i++)
+		da_add_elem(&da, &i);
+
+	start_ns = time_now_ns() - start_ns;
+	*heap_calls = mem_heap_call_cnt() - calls;
+
+	da_clean(&da);
+
+	return start_ns;
+}
+
+static uint64_t da_bulk_append(uint32_t cnt, uint64_t *heap_calls)
+{
+	dynarr					da;
+	uint32_t				chunk[DYNBENCH_CHUNK];
+	uint64_t				start_ns, calls;
+	uint32_t				n;
+
+	for (uint32_t i = 0; i < DYNBENCH_CHUNK; i++)
+		chunk[i] = i;
+
+	da_init(&da, sizeof(uint32_t));
+
+	calls = mem_heap_call_cnt();
+	start_ns = time_now_ns();
+
+	for (uint32_t i = 0; i < cnt; i += n) {
+		n = cnt - i < DYNBENCH_CHUNK ? cnt - i : DYNBENCH_CHUNK;
+
+		da_append_n(&da, chunk, n);
+	}
+
+	start_ns = time_now_ns() - start_ns;
+	*heap_calls = mem_heap_call_cnt() - calls;
+
+	da_clean(&da);
+
+	return start_ns;
+}
+
+static uint64_t typed_push(uint32_t cnt, uint64_t *heap_calls)
+{
+	u32_list				list;
+	uint64_t				start_ns, calls;
+
+	u32_list_init(&list);
+
+	calls = mem_heap_call_cnt();
+	start_ns = time_now_ns();
+
+	for (uint32_t i = 0; i < cnt; i++)
+		u32_list_push(&list, i);
+
+	start_ns = time_now_ns() - start_ns;
+	*heap_calls = mem_heap_call_cnt() - calls;
+
+	u32_list_clean(&list);
+
+	return start_ns;
+}
+
+/* reserved up front, so this is the floor the growing paths are measured against */
+static uint64_t reserved_push(uint32_t cnt, uint64_t *heap_calls)
+{
+	u32_list				list;
+	uint64_t				start_ns, calls;
+
+	u32_list_init(&list);
+
+	calls = mem_heap_call_cnt();
+	start_ns = time_now_ns();
+
+	u32_list_reserve(&list, cnt);
+
+	for (uint32_t i = 0; i < cnt; i++)
+		u32_list_push(&list, i);
+
+	start_ns = time_now_ns() - start_ns;
+	*heap_calls = mem_heap_call_cnt() - calls;
+
+	u32_list_clean(&list);
+
+	return start_ns;
+}
+
+/* the fastest of a few runs at each size; a flat ns/append column is the amortized O(1) */
+static inline void run(const char *name, bench_fn fn, uint32_t max_cnt)
+{
+	uint64_t				best_ns, ns, heap_calls;
+
+	for (uint32_t cnt = 1000; cnt <= max_cnt; cnt *= 10) {
+		best_ns = UINT64_MAX;
+
+		for (uint32_t r = 0; r < DYNBENCH_REPS; r++) {
+			ns = fn(cnt, &heap_calls);
+
+			if (ns < best_ns)
+				best_ns = ns;
+		}
+
+		printf("%-20s %9u appends %10.3f ms %7.2f ns/append %9lu heap calls\n", name, cnt, best_ns / 1e6,
+			(double)best_ns / cnt, (unsigned long)heap_calls);
+	}
+}
+
+/* the generic path: an out-of-line call and a multiply by elem_stride per element */
+static float sum_da_get(void *arr)
+{
+	dynarr					*da;
+	float3					*v;
+	float					sum;
+
+	da = arr;
+	sum = 0.0f;
+
+	for (uint32_t i = 0; i < da->size; i++) {
+		v = da_get(da, i);
+		sum += v->x + v->y + v->z;
+	}
+
+	return sum;
+}
+
+static float sum_typed_get(void *arr)
+{
+	vec3_da					*da;
+	float3					*v;
+	float					sum;
+
+	da = arr;
+	sum = 0.0f;
+
+	for (uint32_t i = 0; i < da->size; i++) {
+		v = vec3_da_get(da, i);
+		sum += v->x + v->y + v->z;
+	}
+
+	return sum;
+}
+
+static float sum_typed_foreach(void *arr)
+{
+	vec3_da					*da;
+	float					sum;
+
+	da = arr;
+	sum = 0.0f;
+
+	DA_FOREACH(float3, v, da)
+		sum += v->x + v->y + v->z;
+
+	return sum;
+}
+
+static inline void run_sum(const char *name, sum_fn fn, void *arr)
+{
+	uint64_t				best_ns, ns;
+	float					sum;
+
+	best_ns = UINT64_MAX;
+	sum = 0.0f;
+
+	for (uint32_t r = 0; r < DYNBENCH_SUM_REPS; r++) {
+		ns = time_now_ns();
+		sum = fn(arr);
+		ns = time_now_ns() - ns;
+
+		if (ns < best_ns)
+			best_ns = ns;
+	}
+
+	printf("%-20s %9u float3 %10.3f ms %7.2f ns/elem   (sum %.0f)\n", name, DYNBENCH_SUM_CNT, best_ns / 1e6,
+		(double)best_ns / DYNBENCH_SUM_CNT, sum);
+}
+
+/* both containers hold the same values, so the sums must match */
+static inline void sum_bench(void)
+{
+	dynarr					generic;
+	vec3_da					typed;
+	float3					v;
+
+	da_init(&generic, sizeof(float3));
+	vec3_da_init(&typed);
+
+	for (uint32_t i = 0; i < DYNBENCH_SUM_CNT; i++) {
+		v.x = (float)(i & 15);
+		v.y = (float)(i & 7);
+		v.z = 1.0f;
+
+		da_add_elem(&generic, &v);
+		vec3_da_push(&typed, v);
+	}
+
+	printf("\nsum of x + y + z, best of %u runs\n", DYNBENCH_SUM_REPS);
+
+	run_sum("da_get", sum_da_get, &generic);
+	run_sum("typed get", sum_typed_get, &typed);
+	run_sum("typed DA_FOREACH", sum_typed_foreach, &typed);
+
+	da_clean(&generic);
+	vec3_da_clean(&typed);
+}
+
+int main(int argc, char **argv)
+{
+	uint32_t				max_cnt;
+
+	max_cnt = argc > 1 ? strtoul(argv[1], NULL, 10) : DYNBENCH_MAX_CNT;
+
+	printf("4 byte elements, best of %u runs\n", DYNBENCH_REPS);
+
+	run("realloc per insert", naive_append, max_cnt < DYNBENCH_NAIVE_MAX_CNT ? max_cnt : DYNBENCH_NAIVE_MAX_CNT);
+	run("da_add_elem", da_append, max_cnt);
+	run("da_append_n", da_bulk_append, max_cnt);
+	run("typed push", typed_push, max_cnt);
+	run("reserved push", reserved_push, max_cnt);
+
+	sum_bench();
+
+	return 0;
+}
@@ -0,0 +1,212 @@
+#include "../src/util/debug.h"
+#include "../src/util/util.h"
+#include "../src/engine/ecs.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define ECSBENCH_ENTITIES			(1024 * 1024)
+#define ECSBENCH_REPS				20
+#define ECSBENCH_DT				(1.0f / 60.0f)
+
+/* read position and velocity, write position */
+#define ECSBENCH_BYTES_PER_ENTITY		(3 * 3 * sizeof(float))
+
+typedef struct {
+	float x, y, z;
+} vec3;
+
+typedef struct {
+	float hp;
+	uint32_t flags;
+} health;
+
+typedef struct {
+	float xform[16];
+} render_state;
+
+/* the array-of-structs baseline: a typical fat game object, most of it cold for the movement update */
+typedef struct {
+	vec3 pos;
+	vec3 vel;
+	health hp;
+	render_state render;
+} game_object;
+
+static inline void init_vel(vec3 *vel, uint32_t i)
+{
+	vel->x = (float)(i % 7) - 3.0f;
+	vel->y = (float)(i % 5) - 2.0f;
+	vel->z = (float)(i % 3) - 1.0f;
+}
+
+/* ns is the fastest single pass, the rest are noise from whatever else shares the machine */
+static inline double report(char *name, uint64_t ns, uint32_t cnt)
+{
+	double					per_ent, gbs;
+
+	per_ent = (double)ns / cnt;
+	gbs = (double)ECSBENCH_BYTES_PER_ENTITY * cnt / ns;
+
+	printf("%-28s %.3f ns/entity  %.2f GB/s\n", name, per_ent, gbs);
+
+	return gbs;
+}
+
+int main(int argc, char **argv)
+{
+	uint32_t				cnt, comp_pos, comp_vel, comp_hp, comp_render, removed;
+	game_object				*objs;
+	vec3					*pos, *vel, *cpos, *cvel;
+	ecs_world				w;
+	ecs_query				move;
+	ecs_iter				it;
+	ecs_cmd_buf				cb;
+	ecs_entity				*ents, *chunk_ents;
+	ecs_mask				mask;
+	uint64_t				ns, best;
+	double					raw_gbs, ecs_gbs, checksum_aos, checksum_ecs;
+
+	cnt = argc > 1 ? strtoul(argv[1], NULL, 10) : ECSBENCH_ENTITIES;
+
+	/* plain position and velocity arrays are the bandwidth bound for this access pattern */
+	pos = mem_alloc(cnt * sizeof(vec3));
+	vel = mem_alloc(cnt * sizeof(vec3));
+	objs = mem_alloc(cnt * sizeof(game_object));
+	ents = mem_alloc(cnt * sizeof(ecs_entity));
+
+	memset(objs, '\0', cnt * sizeof(game_object));
+
+	for (uint32_t i = 0; i < cnt; i++) {
+		memset(&pos[i], '\0', sizeof(vec3));
+		init_vel(&vel[i], i);
+		init_vel(&objs[i].vel, i);
+	}
+
+	best = UINT64_MAX;
+
+	for (uint32_t r = 0; r < ECSBENCH_REPS; r++) {
+		ns = time_now_ns();
+
+		for (uint32_t i = 0; i < cnt; i++) {
+			pos[i].x += vel[i].x * ECSBENCH_DT;
+			pos[i].y += vel[i].y * ECSBENCH_DT;
+			pos[i].z += vel[i].z * ECSBENCH_DT;
+		}
+
+		ns = time_now_ns() - ns;
+		best = ns < best ? ns : best;
+	}
+
+	raw_gbs = report("raw arrays", best, cnt);
+
+	best = UINT64_MAX;
+
+	for (uint32_t r = 0; r < ECSBENCH_REPS; r++) {
+		ns = time_now_ns();
+
+		for (uint32_t i = 0; i < cnt; i++) {
+			objs[i].pos.x += objs[i].vel.x * ECSBENCH_DT;
+			objs[i].pos.y += objs[i].vel.y * ECSBENCH_DT;
+			objs[i].pos.z += objs[i].vel.z * ECSBENCH_DT;
+		}
+
+		ns = time_now_ns() - ns;
+		best = ns < best ? ns : best;
+	}
+
+	report("array of structs", best, cnt);
+
+	ecs_init(&w);
+
+	comp_pos = ecs_register(&w, sizeof(vec3));
+	comp_vel = ecs_register(&w, sizeof(vec3));
+	comp_hp = ecs_register(&w, sizeof(health));
+	comp_render = ecs_register(&w, sizeof(render_state));
+
+	mask = ECS_BIT(comp_pos) | ECS_BIT(comp_vel) | ECS_BIT(comp_hp) | ECS_BIT(comp_render);
+
+	ns = time_now_ns();
+
+	for (uint32_t i = 0; i < cnt; i++) {
+		ents[i] = ecs_create(&w, mask);
+		init_vel(ecs_get(&w, ents[i], comp_vel), i);
+	}
+
+	printf("%-28s %.3f ns/entity\n", "ecs create", (double)(time_now_ns() - ns) / cnt);
+
+	ecs_query_init(&move, ECS_BIT(comp_pos) | ECS_BIT(comp_vel), 0);
+
+	best = UINT64_MAX;
+
+	for (uint32_t r = 0; r < ECSBENCH_REPS; r++) {
+		ns = time_now_ns();
+
+		ecs_iter_init(&it, &w, &move);
+
+		while (ecs_iter_next(&it)) {
+			cpos = ecs_iter_column(&it, comp_pos);
+			cvel = ecs_iter_column(&it, comp_vel);
+
+			for (uint32_t i = 0; i < it.cnt; i++) {
+				cpos[i].x += cvel[i].x * ECSBENCH_DT;
+				cpos[i].y += cvel[i].y * ECSBENCH_DT;
+				cpos[i].z += cvel[i].z * ECSBENCH_DT;
+			}
+		}
+
+		ns = time_now_ns() - ns;
+		best = ns < best ? ns : best;
+	}
+
+	ecs_gbs = report("ecs chunks (4 components)", best, cnt);
+
+	printf("ecs reaches %.0f%% of raw array bandwidth, %u rows per %u kb chunk\n", ecs_gbs / raw_gbs * 100.0,
+		w.archs.elems[0]->chunk_cap, ECS_CHUNK_SIZE / 1024);
+
+	checksum_aos = 0.0;
+	checksum_ecs = 0.0;
+
+	for (uint32_t i = 0; i < cnt; i++) {
+		checksum_aos += objs[i].pos.x + objs[i].pos.y + objs[i].pos.z;
+		cpos = ecs_get(&w, ents[i], comp_pos);
+		checksum_ecs += cpos->x + cpos->y + cpos->z;
+	}
+
+	printf("checksums %s (%.3f)\n", checksum_aos == checksum_ecs ? "match" : "DIFFER", checksum_ecs);
+
+	/* every other entity is destroyed from inside the query, then everything is applied at once */
+	ecs_cmd_init(&cb);
+
+	ns = time_now_ns();
+
+	ecs_iter_init(&it, &w, &move);
+
+	while (ecs_iter_next(&it)) {
+		chunk_ents = ecs_iter_entities(&it);
+
+		for (uint32_t i = 0; i < it.cnt; i++) {
+			if ((uint32_t)chunk_ents[i] % 2 == 0)
+				ecs_cmd_destroy(&cb, chunk_ents[i]);
+		}
+	}
+
+	removed = cb.cmds.size;
+
+	ecs_cmd_flush(&cb, &w);
+
+	printf("%-28s %.3f ns/entity, %u destroyed, %u alive\n", "deferred destroy",
+		(double)(time_now_ns() - ns) / removed, removed, w.alive);
+
+	ecs_cmd_clean(&cb);
+	ecs_query_clean(&move);
+	ecs_clean(&w);
+
+	mem_free(pos);
+	mem_free(vel);
+	mem_free(objs);
+	mem_free(ents);
+
+	return 0;
+}
@@ -0,0 +1,459 @@
+#include "../src/util/debug.h"
+#include "../src/util/util.h"
+#include "../src/util/arena.h"
+#include "../src/engine/graphics/gpu_alloc.h"
+
+#include <vulkan/vulkan.h>
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stddef.h>
+#include <string.h>
+
+#define GABENCH_RESOURCES			(100u * 1000)
+#define GABENCH_LIVE				2048
+#define GABENCH_MIN_LOG2			8
+#define GABENCH_MAX_LOG2			20
+#define GABENCH_BIG_SIZE			(40ull * 1024 * 1024)
+#define GABENCH_BIG_ONE_IN			1000
+#define GABENCH_IMAGE_ONE_IN			4
+#define GABENCH_MIN_IMAGE_LOG2			4
+#define GABENCH_MAX_IMAGE_LOG2			10
+#define GABENCH_RAW_MAX				4096
+
+/* side is zero for buffers; both are kept so a moved resource can be recreated */
+typedef struct {
+	VkBuffer buf;
+	VkImage img;
+	VkDeviceSize size;
+	uint32_t side;
+	ga_allocation alloc;
+	bool live;
+} bench_resource;
+
+typedef struct {
+	VkInstance inst;
+	VkPhysicalDevice phys_dev;
+	VkDevice dev;
+	VkPhysicalDeviceProperties props;
+} bench_device;
+
+static bench_device				bd;
+static bench_resource				slots[GABENCH_LIVE];
+
+static inline uint32_t rand_next(uint32_t *state)
+{
+	*state ^= *state << 13;
+	*state ^= *state >> 17;
+	*state ^= *state << 5;
+
+	return *state;
+}
+
+/* log-uniform, so small buffers dominate the count and large ones the bytes, like a real scene */
+static inline VkDeviceSize rand_size(uint32_t *seed)
+{
+	uint32_t				shift;
+
+	if (rand_next(seed) % GABENCH_BIG_ONE_IN == 0)
+		return GABENCH_BIG_SIZE;
+
+	shift = GABENCH_MIN_LOG2 + rand_next(seed) % (GABENCH_MAX_LOG2 - GABENCH_MIN_LOG2);
+
+	return ((VkDeviceSize)1 << shift) + rand_next(seed) % ((VkDeviceSize)1 << shift);
+}
+
+static int cmp_u32(const void *a, const void *b)
+{
+	uint32_t				x, y;
+
+	x = *(const uint32_t *)a;
+	y = *(const uint32_t *)b;
+
+	return (x > y) - (x < y);
+}
+
+static int cmp_alloc(const void *a, const void *b)
+{
+	const ga_allocation			*x, *y;
+
+	x = *(const ga_allocation * const *)a;
+	y = *(const ga_allocation * const *)b;
+
+	if (x->mem != y->mem)
+		return (uintptr_t)x->mem < (uintptr_t)y->mem ? -1 : 1;
+
+	return (x->offset > y->offset) - (x->offset < y->offset);
+}
+
+static inline void report_latency(const char *name, uint32_t *ns, uint32_t cnt)
+{
+	uint64_t				total;
+
+	if (cnt == 0)
+		return;
+
+	total = 0;
+
+	for (uint32_t i = 0; i < cnt; i++)
+		total += ns[i];
+
+	qsort(ns, cnt, sizeof(uint32_t), cmp_u32);
+
+	printf("%-22s %7u calls  avg %8.0f ns  p50 %8u ns  p99 %8u ns  max %9u ns\n", name, cnt, (double)total / cnt,
+		ns[cnt / 2], ns[(cnt - 1) * 99 / 100], ns[cnt - 1]);
+}
+
+static inline void report_stats(gpu_allocator *ga, const char *when)
+{
+	ga_stats				stats;
+
+	ga_get_stats(ga, &stats);
+
+	printf("%-22s %lu blocks (%lu dedicated), %.1f of %.1f MB used, %lu allocations, fragmentation %.3f\n", when,
+		(unsigned long)stats.block_cnt, (unsigned long)stats.dedicated_cnt, stats.used_bytes / 1e6,
+		stats.block_bytes / 1e6, (unsigned long)stats.alloc_cnt, stats.fragmentation);
+}
+
+/* no surface, one queue; pick the device with VK_ICD_FILENAMES, lavapipe being the one this was written for */
+static inline void create_device(void)
+{
+	VkApplicationInfo			app_info;
+	VkInstanceCreateInfo			inst_info;
+	VkDeviceQueueCreateInfo			queue_info;
+	VkDeviceCreateInfo			dev_info;
+	uint32_t				dev_cnt;
+	float					prio;
+
+	memset(&app_info, '\0', sizeof(app_info));
+
+	app_info.sType = VK_STRUCTURE_TYPE_APPLICATION_INFO;
+	app_info.pApplicationName = "gpuallocbench";
+	app_info.apiVersion = VK_API_VERSION_1_0;
+
+	memset(&inst_info, '\0', sizeof(inst_info));
+
+	inst_info.sType = VK_STRUCTURE_TYPE_INSTANCE_CREATE_INFO;
+	inst_info.pApplicationInfo = &app_info;
+
+	if (vkCreateInstance(&inst_info, NULL, &bd.inst) != VK_SUCCESS)
+		dbg_error("failed to create instance");
+
+	dev_cnt = 1;
+
+	if (vkEnumeratePhysicalDevices(bd.inst, &dev_cnt, &bd.phys_dev) < 0 || dev_cnt == 0)
+		dbg_error("failed to find a vulkan device");
+
+	vkGetPhysicalDeviceProperties(bd.phys_dev, &bd.props);
+
+	prio = 1.0f;
+
+	memset(&queue_info, '\0', sizeof(queue_info));
+
+	queue_info.sType = VK_STRUCTURE_TYPE_DEVICE_QUEUE_CREATE_INFO;
+	queue_info.queueFamilyIndex = 0;
+	queue_info.queueCount = 1;
+	queue_info.pQueuePriorities = &prio;
+
+	memset(&dev_info, '\0', sizeof(dev_info));
+
+	dev_info.sType = VK_STRUCTURE_TYPE_DEVICE_CREATE_INFO;
+	dev_info.queueCreateInfoCount = 1;
+	dev_info.pQueueCreateInfos = &queue_info;
+
+	if (vkCreateDevice(bd.phys_dev, &dev_info, NULL, &bd.dev) != VK_SUCCESS)
+		dbg_error("failed to create device");
+}
+
+/* a buffer or optimal image for res, returning what it needs from the allocator */
+static inline ga_kind create_handle(bench_resource *res, VkMemoryRequirements *reqs)
+{
+	VkBufferCreateInfo			buf_info;
+	VkImageCreateInfo			img_info;
+
+	if (res->side > 0) {
+		memset(&img_info, '\0', sizeof(img_info));
+
+		img_info.sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO;
+		img_info.imageType = VK_IMAGE_TYPE_2D;
+		img_info.format = VK_FORMAT_R8G8B8A8_UNORM;
+		img_info.extent.width = res->side;
+		img_info.extent.height = res->side;
+		img_info.extent.depth = 1;
+		img_info.mipLevels = 1;
+		img_info.arrayLayers = 1;
+		img_info.samples = VK_SAMPLE_COUNT_1_BIT;
+		img_info.tiling = VK_IMAGE_TILING_OPTIMAL;
+		img_info.usage = VK_IMAGE_USAGE_SAMPLED_BIT | VK_IMAGE_USAGE_TRANSFER_DST_BIT;
+		img_info.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+		img_info.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+
+		if (vkCreateImage(bd.dev, &img_info, NULL, &res->img) != VK_SUCCESS)
+			dbg_error("failed to create image");
+
+		vkGetImageMemoryRequirements(bd.dev, res->img, reqs);
+
+		return GA_KIND_OPTIMAL;
+	}
+
+	memset(&buf_info, '\0', sizeof(buf_info));
+
+	buf_info.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
+	buf_info.size = res->size;
+	buf_info.usage = VK_BUFFER_USAGE_VERTEX_BUFFER_BIT | VK_BUFFER_USAGE_INDEX_BUFFER_BIT |
+		VK_BUFFER_USAGE_TRANSFER_DST_BIT;
+	buf_info.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+
+	if (vkCreateBuffer(bd.dev, &buf_info, NULL, &res->buf) != VK_SUCCESS)
+		dbg_error("failed to create buffer");
+
+	vkGetBufferMemoryRequirements(bd.dev, res->buf, reqs);
+
+	return GA_KIND_LINEAR;
+}
+
+static inline void bind_handle(bench_resource *res, const ga_allocation *alloc)
+{
+	VkResult				result;
+
+	if (res->side > 0)
+		result = vkBindImageMemory(bd.dev, res->img, alloc->mem, alloc->offset);
+	else
+		result = vkBindBufferMemory(bd.dev, res->buf, alloc->mem, alloc->offset);
+
+	if (result != VK_SUCCESS)
+		dbg_error("failed to bind resource memory");
+}
+
+static inline void destroy_handle(bench_resource *res)
+{
+	vkDestroyBuffer(bd.dev, res->buf, NULL);
+	vkDestroyImage(bd.dev, res->img, NULL);
+
+	res->buf = VK_NULL_HANDLE;
+	res->img = VK_NULL_HANDLE;
+}
+
+static inline void create_resource(gpu_allocator *ga, bench_resource *res, uint32_t *seed, uint32_t *alloc_ns)
+{
+	VkMemoryRequirements			reqs;
+	ga_kind					kind;
+	uint64_t				start_ns;
+
+	res->side = 0;
+	res->size = 0;
+
+	if (rand_next(seed) % GABENCH_IMAGE_ONE_IN == 0)
+		res->side = 1u << (GABENCH_MIN_IMAGE_LOG2 + rand_next(seed) % (GABENCH_MAX_IMAGE_LOG2 - GABENCH_MIN_IMAGE_LOG2));
+	else
+		res->size = rand_size(seed);
+
+	kind = create_handle(res, &reqs);
+
+	start_ns = time_now_ns();
+
+	ga_alloc(ga, &reqs, ga_find_mem_type(ga, reqs.memoryTypeBits, 0, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT), kind,
+		&res->alloc);
+
+	*alloc_ns = (uint32_t)(time_now_ns() - start_ns);
+
+	bind_handle(res, &res->alloc);
+
+	res->live = true;
+}
+
+static inline void destroy_resource(gpu_allocator *ga, bench_resource *res, uint32_t *free_ns)
+{
+	uint64_t				start_ns;
+
+	destroy_handle(res);
+
+	start_ns = time_now_ns();
+
+	ga_free(ga, &res->alloc);
+
+	*free_ns = (uint32_t)(time_now_ns() - start_ns);
+
+	res->live = false;
+}
+
+/* memory can only be bound once, so a moved resource is recreated on its new range; contents are not kept */
+static void move_resource(ga_allocation *old_alloc, const ga_allocation *new_alloc, void *user)
+{
+	bench_resource				*res;
+	VkMemoryRequirements			reqs;
+
+	(void)user;
+
+	res = (bench_resource *)((uint8_t *)old_alloc - offsetof(bench_resource, alloc));
+
+	destroy_handle(res);
+	create_handle(res, &reqs);
+	bind_handle(res, new_alloc);
+}
+
+/* every live range sorted by memory and offset, any neighbours that overlap are a double allocation */
+static inline uint32_t count_overlaps(void)
+{
+	ga_allocation				*live[GABENCH_LIVE];
+	uint32_t				cnt, overlaps;
+
+	cnt = 0;
+	overlaps = 0;
+
+	for (uint32_t i = 0; i < GABENCH_LIVE; i++) {
+		if (slots[i].live)
+			live[cnt++] = &slots[i].alloc;
+	}
+
+	qsort(live, cnt, sizeof(live[0]), cmp_alloc);
+
+	for (uint32_t i = 1; i < cnt; i++) {
+		if (live[i]->mem == live[i - 1]->mem && live[i - 1]->offset + live[i - 1]->size > live[i]->offset)
+			overlaps++;
+	}
+
+	return overlaps;
+}
+
+/* what every resource would pay without the suballocator, limited by maxMemoryAllocationCount */
+static inline void bench_raw(uint32_t *ns, uint32_t seed)
+{
+	VkMemoryAllocateInfo			alloc_info;
+	VkDeviceMemory				*mems;
+	uint32_t				cnt, type;
+	uint64_t				start_ns;
+	gpu_allocator				ga;
+
+	ga_init(&ga, bd.phys_dev, bd.dev);
+
+	type = ga_find_mem_type(&ga, UINT32_MAX, 0, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+	cnt = bd.props.limits.maxMemoryAllocationCount < GABENCH_RAW_MAX ? bd.props.limits.maxMemoryAllocationCount :
+		GABENCH_RAW_MAX;
+	mems = mem_alloc(cnt * sizeof(VkDeviceMemory));
+
+	if (mems == NULL)
+		dbg_error("failed to allocate raw memory handles");
+
+	memset(&alloc_info, '\0', sizeof(alloc_info));
+
+	alloc_info.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
+	alloc_info.memoryTypeIndex = type;
+
+	for (uint32_t i = 0; i < cnt; i++) {
+		alloc_info.allocationSize = rand_size(&seed);
+
+		start_ns = time_now_ns();
+
+		if (vkAllocateMemory(bd.dev, &alloc_info, NULL, &mems[i]) != VK_SUCCESS)
+			dbg_error("failed to allocate raw memory");
+
+		ns[i] = (uint32_t)(time_now_ns() - start_ns);
+
+		/* keeps the live footprint near the suballocated run's */
+		if (i >= GABENCH_LIVE)
+			vkFreeMemory(bd.dev, mems[i - GABENCH_LIVE], NULL);
+	}
+
+	for (uint32_t i = cnt > GABENCH_LIVE ? cnt - GABENCH_LIVE : 0; i < cnt; i++)
+		vkFreeMemory(bd.dev, mems[i], NULL);
+
+	report_latency("vkAllocateMemory", ns, cnt);
+
+	mem_free(mems);
+	ga_clean(&ga);
+}
+
+/*
+ * allocates n resources into GABENCH_LIVE slots, each landing on a random slot and freeing whatever
+ * lived there, then frees half, defragments and tears down; the ranges are checked for overlaps
+ */
+int main(int argc, char **argv)
+{
+	gpu_allocator				ga;
+	uint32_t				*alloc_ns, *free_ns;
+	uint32_t				n, seed, slot, free_cnt, moved, alloc_cnt;
+	ga_allocation				*live[GABENCH_LIVE];
+	ga_stats				stats;
+
+	n = argc > 1 ? strtoul(argv[1], NULL, 10) : GABENCH_RESOURCES;
+
+	dbg_init(DBG_LEVEL_WARN, NULL);
+
+	create_device();
+
+	printf("%s, %u resources through %u slots, maxMemoryAllocationCount %u\n", bd.props.deviceName, n,
+		GABENCH_LIVE, bd.props.limits.maxMemoryAllocationCount);
+
+	alloc_ns = mem_alloc((size_t)(n > GABENCH_RAW_MAX ? n : GABENCH_RAW_MAX) * sizeof(uint32_t));
+	free_ns = mem_alloc((size_t)(n + GABENCH_LIVE) * sizeof(uint32_t));
+
+	if (alloc_ns == NULL || free_ns == NULL)
+		dbg_error("failed to allocate latency samples");
+
+	ga_init(&ga, bd.phys_dev, bd.dev);
+
+	seed = 0x9e3779b9u;
+	free_cnt = 0;
+
+	for (uint32_t i = 0; i < n; i++) {
+		slot = rand_next(&seed) % GABENCH_LIVE;
+
+		if (slots[slot].live)
+			destroy_resource(&ga, &slots[slot], &free_ns[free_cnt++]);
+
+		create_resource(&ga, &slots[slot], &seed, &alloc_ns[i]);
+	}
+
+	report_stats(&ga, "after churn");
+
+	printf("overlapping ranges: %u\n", count_overlaps());
+
+	for (uint32_t i = 0; i < GABENCH_LIVE; i++) {
+		if (slots[i].live && rand_next(&seed) % 2 == 0)
+			destroy_resource(&ga, &slots[i], &free_ns[free_cnt++]);
+	}
+
+	report_stats(&ga, "after freeing half");
+
+	alloc_cnt = 0;
+
+	for (uint32_t i = 0; i < GABENCH_LIVE; i++) {
+		if (slots[i].live)
+			live[alloc_cnt++] = &slots[i].alloc;
+	}
+
+	moved = ga_defrag(&ga, live, alloc_cnt, move_resource, NULL);
+
+	printf("defrag moved %u of %u allocations\n", moved, alloc_cnt);
+	report_stats(&ga, "after defrag");
+
+	printf("overlapping ranges: %u\n", count_overlaps());
+
+	for (uint32_t i = 0; i < GABENCH_LIVE; i++) {
+		if (slots[i].live)
+			destroy_resource(&ga, &slots[i], &free_ns[free_cnt++]);
+	}
+
+	ga_trim(&ga);
+	ga_get_stats(&ga, &stats);
+
+	printf("blocks left after freeing everything and trimming: %lu\n", (unsigned long)stats.block_cnt);
+
+	report_latency("ga_alloc", alloc_ns, n);
+	report_latency("ga_free", free_ns, free_cnt);
+
+	ga_clean(&ga);
+
+	bench_raw(alloc_ns, 0x9e3779b9u);
+
+	mem_free(alloc_ns);
+	mem_free(free_ns);
+
+	vkDestroyDevice(bd.dev, NULL);
+	vkDestroyInstance(bd.inst, NULL);
+
+	dbg_clean();
+
+	return 0;
+}
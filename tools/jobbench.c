@@ -0,0 +1,227 @@
+#include "../src/util/debug.h"
+#include "../src/util/util.h"
+#include "../src/util/tpool.h"
+#include "../src/util/job.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+#define JOBBENCH_FINE_CNT			(16u * 1024 * 1024)
+#define JOBBENCH_FINE_GRAIN			512
+#define JOBBENCH_COARSE_JOBS			64
+#define JOBBENCH_COARSE_ITERS			(256u * 1024)
+#define JOBBENCH_EMPTY_JOBS			(256u * 1024)
+#define JOBBENCH_STAGE_JOBS			256
+#define JOBBENCH_REPS				5
+
+typedef struct {
+	float *data;
+	uint32_t iters;
+	float out[JOBBENCH_COARSE_JOBS];
+} bench_state;
+
+static inline float coarse_work(uint32_t seed, uint32_t iters)
+{
+	float					x;
+
+	x = (float)seed;
+
+	for (uint32_t i = 0; i < iters; i++)
+		x = sqrtf(x * 1.0001f + 1.0f);
+
+	return x;
+}
+
+/* a few flops per element, so the job system overhead per 512 elements is what gets measured */
+static void fine_range(void *arg, uint32_t begin, uint32_t end, uint32_t worker)
+{
+	float					*data;
+
+	(void)worker;
+
+	/* hoisted, bench_state holds floats so stores through st->data could otherwise alias it */
+	data = ((bench_state *)arg)->data;
+
+	for (uint32_t i = begin; i < end; i++)
+		data[i] = data[i] * 0.999f + 0.5f;
+}
+
+static void coarse_job(void *arg, uint32_t worker)
+{
+	float					*out;
+
+	(void)worker;
+
+	out = arg;
+	*out = coarse_work((uint32_t)(uintptr_t)out, JOBBENCH_COARSE_ITERS);
+}
+
+static void empty_job(void *arg, uint32_t worker)
+{
+	(void)arg;
+	(void)worker;
+}
+
+static void stage_job(void *arg, uint32_t worker)
+{
+	float					*out;
+
+	(void)worker;
+
+	out = arg;
+	*out = coarse_work(1, JOBBENCH_COARSE_ITERS / 64);
+}
+
+static inline uint64_t best_of(uint64_t *ns, uint32_t cnt)
+{
+	uint64_t				best;
+
+	best = ns[0];
+
+	for (uint32_t i = 1; i < cnt; i++) {
+		if (ns[i] < best)
+			best = ns[i];
+	}
+
+	return best;
+}
+
+typedef struct {
+	uint64_t fine;
+	uint64_t coarse;
+	uint64_t empty;
+	uint64_t stages;
+} bench_times;
+
+static inline void run(uint32_t thread_cnt, bench_state *st, bench_times *out)
+{
+	job_system				js;
+	job_counter				c[3];
+	uint64_t				ns[4][JOBBENCH_REPS];
+	uint64_t				t;
+	float					scratch[3][JOBBENCH_STAGE_JOBS];
+
+	job_init(&js, thread_cnt);
+
+	for (uint32_t i = 0; i < 3; i++)
+		job_counter_init(&c[i]);
+
+	for (uint32_t r = 0; r < JOBBENCH_REPS; r++) {
+		t = time_now_ns();
+		job_parallel_for(&js, 0, JOBBENCH_FINE_CNT, JOBBENCH_FINE_GRAIN, fine_range, st);
+		ns[0][r] = time_now_ns() - t;
+
+		t = time_now_ns();
+
+		for (uint32_t i = 0; i < JOBBENCH_COARSE_JOBS; i++)
+			job_submit(&js, coarse_job, &st->out[i], &c[0]);
+
+		job_wait(&js, &c[0]);
+		ns[1][r] = time_now_ns() - t;
+
+		t = time_now_ns();
+
+		for (uint32_t i = 0; i < JOBBENCH_EMPTY_JOBS; i++)
+			job_submit(&js, empty_job, NULL, &c[0]);
+
+		job_wait(&js, &c[0]);
+		ns[2][r] = time_now_ns() - t;
+
+		/* three dependent waves, each released by the previous counter draining */
+		t = time_now_ns();
+
+		for (uint32_t i = 0; i < JOBBENCH_STAGE_JOBS; i++)
+			job_submit(&js, stage_job, &scratch[0][i], &c[0]);
+
+		for (uint32_t i = 0; i < JOBBENCH_STAGE_JOBS; i++)
+			job_submit_after(&js, stage_job, &scratch[1][i], &c[0], &c[1]);
+
+		for (uint32_t i = 0; i < JOBBENCH_STAGE_JOBS; i++)
+			job_submit_after(&js, stage_job, &scratch[2][i], &c[1], &c[2]);
+
+		job_wait(&js, &c[2]);
+		job_wait(&js, &c[1]);
+		job_wait(&js, &c[0]);
+		ns[3][r] = time_now_ns() - t;
+	}
+
+	for (uint32_t i = 0; i < 3; i++)
+		job_counter_clean(&c[i]);
+
+	job_clean(&js);
+
+	out->fine = best_of(ns[0], JOBBENCH_REPS);
+	out->coarse = best_of(ns[1], JOBBENCH_REPS);
+	out->empty = best_of(ns[2], JOBBENCH_REPS);
+	out->stages = best_of(ns[3], JOBBENCH_REPS);
+}
+
+int main(int argc, char **argv)
+{
+	bench_state				st;
+	bench_times				base, cur;
+	job_range_fn volatile			serial_fn;
+	uint32_t				max_threads;
+	uint64_t				serial_fine, serial_coarse, t;
+
+	max_threads = argc > 1 ? strtoul(argv[1], NULL, 10) : tpool_core_cnt();
+
+	if (max_threads < 1)
+		max_threads = 1;
+
+	st.data = mem_alloc(JOBBENCH_FINE_CNT * sizeof(float));
+
+	for (uint32_t i = 0; i < JOBBENCH_FINE_CNT; i++)
+		st.data[i] = (float)(i & 1023);
+
+	/* through a pointer so the serial run gets the same out-of-line loop the workers call, after a warm pass */
+	serial_fn = fine_range;
+	serial_fn(&st, 0, JOBBENCH_FINE_CNT, 0);
+
+	serial_fine = UINT64_MAX;
+	serial_coarse = UINT64_MAX;
+
+	for (uint32_t r = 0; r < JOBBENCH_REPS; r++) {
+		t = time_now_ns();
+		serial_fn(&st, 0, JOBBENCH_FINE_CNT, 0);
+		t = time_now_ns() - t;
+
+		if (t < serial_fine)
+			serial_fine = t;
+	}
+
+	for (uint32_t r = 0; r < 2; r++) {
+		t = time_now_ns();
+
+		for (uint32_t i = 0; i < JOBBENCH_COARSE_JOBS; i++)
+			coarse_job(&st.out[i], 0);
+
+		t = time_now_ns() - t;
+
+		if (t < serial_coarse)
+			serial_coarse = t;
+	}
+
+	printf("%u cores online\n", tpool_core_cnt());
+	printf("serial       fine %.2f ms  coarse %.2f ms\n", serial_fine / 1e6, serial_coarse / 1e6);
+
+	for (uint32_t n = 1; n <= max_threads; n = n < max_threads && n * 2 > max_threads ? max_threads : n * 2) {
+		run(n, &st, &cur);
+
+		if (n == 1)
+			base = cur;
+
+		printf("%2u threads   fine %.2f ms (%.2fx)  coarse %.2f ms (%.2fx)  3 waves %.2f ms (%.2fx)  %.0f ns/empty job\n",
+			n, cur.fine / 1e6, (double)base.fine / cur.fine, cur.coarse / 1e6, (double)base.coarse / cur.coarse,
+			cur.stages / 1e6, (double)base.stages / cur.stages, (double)cur.empty / JOBBENCH_EMPTY_JOBS);
+
+		if (n == max_threads)
+			break;
+	}
+
+	mem_free(st.data);
+
+	return 0;
+}
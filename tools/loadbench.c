@@ -0,0 +1,199 @@
+#include "../src/util/debug.h"
+#include "../src/util/util.h"
+#include "../src/util/arena.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+#define LOADBENCH_PATH				"build/loadbench.bin"
+#define LOADBENCH_MB				256
+#define LOADBENCH_PAGE				4096
+#define LOADBENCH_REPS				3
+
+typedef uint64_t (*load_fn)(char *path, uint64_t *sum);
+
+/* the loader before file views: an open to measure the file, a second to read it into a heap copy */
+static inline size_t old_file_len(char *path)
+{
+	FILE					*fp;
+	size_t					len;
+
+	fp = fopen(path, "rb");
+
+	if (fp == NULL)
+		dbg_error("could not open %s", path);
+
+	fseek(fp, 0, SEEK_END);
+
+	len = ftell(fp);
+
+	fclose(fp);
+
+	return len;
+}
+
+/* one byte per page, so every page is faulted in or copied before the clock stops */
+static inline uint64_t touch_pages(const uint8_t *data, size_t len)
+{
+	uint64_t				sum;
+
+	sum = 0;
+
+	for (size_t i = 0; i < len; i += LOADBENCH_PAGE)
+		sum += data[i];
+
+	return sum;
+}
+
+static uint64_t load_read_file(char *path, uint64_t *sum)
+{
+	FILE					*fp;
+	uint8_t					*data;
+	uint64_t				start_ns;
+	size_t					len;
+
+	start_ns = time_now_ns();
+
+	len = old_file_len(path);
+	data = mem_alloc(len);
+	fp = fopen(path, "rb");
+
+	if (data == NULL || fp == NULL || fread(data, 1, len, fp) != len)
+		dbg_error("could not read %s", path);
+
+	fclose(fp);
+
+	*sum = touch_pages(data, len);
+	start_ns = time_now_ns() - start_ns;
+
+	mem_free(data);
+
+	return start_ns;
+}
+
+static inline uint64_t load_view(char *path, file_view_hint hint, uint64_t *sum)
+{
+	file_view				fv;
+	uint64_t				start_ns;
+
+	start_ns = time_now_ns();
+
+	fv_open(&fv, path, hint);
+
+	*sum = touch_pages(fv.data, fv.len);
+	start_ns = time_now_ns() - start_ns;
+
+	fv_close(&fv);
+
+	return start_ns;
+}
+
+static uint64_t load_view_seq(char *path, uint64_t *sum)
+{
+	return load_view(path, FV_HINT_SEQUENTIAL, sum);
+}
+
+static uint64_t load_view_willneed(char *path, uint64_t *sum)
+{
+	return load_view(path, FV_HINT_WILLNEED, sum);
+}
+
+/* the file is written once and synced, dirty pages would survive the eviction below */
+static inline void write_bench_file(char *path, size_t len)
+{
+	uint8_t					*chunk;
+	FILE					*fp;
+
+	chunk = mem_alloc(1024 * 1024);
+	fp = fopen(path, "wb");
+
+	if (chunk == NULL || fp == NULL)
+		dbg_error("could not create %s", path);
+
+	for (size_t i = 0; i < 1024 * 1024; i++)
+		chunk[i] = (uint8_t)(i / LOADBENCH_PAGE + 1);
+
+	for (size_t done = 0; done < len; done += 1024 * 1024) {
+		if (fwrite(chunk, 1, 1024 * 1024, fp) != 1024 * 1024)
+			dbg_error("could not write %s", path);
+	}
+
+	fflush(fp);
+	fsync(fileno(fp));
+	fclose(fp);
+
+	mem_free(chunk);
+}
+
+/* drops the file from the page cache without root, unlike drop_caches */
+static inline void evict(char *path)
+{
+	int					fd;
+
+	fd = open(path, O_RDONLY);
+
+	if (fd < 0)
+		dbg_error("could not open %s", path);
+
+	fdatasync(fd);
+	posix_fadvise(fd, 0, 0, POSIX_FADV_DONTNEED);
+	close(fd);
+}
+
+static inline void run(const char *name, load_fn fn, char *path, size_t len)
+{
+	uint64_t				cold_ns, warm_ns, ns, sum;
+
+	cold_ns = UINT64_MAX;
+	warm_ns = UINT64_MAX;
+
+	for (uint32_t r = 0; r < LOADBENCH_REPS; r++) {
+		evict(path);
+
+		ns = fn(path, &sum);
+		cold_ns = ns < cold_ns ? ns : cold_ns;
+
+		ns = fn(path, &sum);
+		warm_ns = ns < warm_ns ? ns : warm_ns;
+	}
+
+	printf("%-22s cold %9.2f ms %7.2f GB/s   warm %9.2f ms %7.2f GB/s   (sum %lu)\n", name, cold_ns / 1e6,
+		(double)len / cold_ns, warm_ns / 1e6, (double)len / warm_ns, (unsigned long)sum);
+}
+
+int main(int argc, char **argv)
+{
+	char					*path;
+	size_t					len, have;
+	file_view				fv;
+
+	path = argc > 1 ? argv[1] : LOADBENCH_PATH;
+	len = (size_t)(argc > 2 ? strtoul(argv[2], NULL, 10) : LOADBENCH_MB) * 1024 * 1024;
+
+	dbg_init(DBG_LEVEL_WARN, NULL);
+
+	have = 0;
+
+	if (fv_try_open(&fv, path, FV_HINT_NONE)) {
+		have = fv.len;
+
+		fv_close(&fv);
+	}
+
+	if (have != len)
+		write_bench_file(path, len);
+
+	printf("%s, %lu MB, best of %u, cold runs evicted with POSIX_FADV_DONTNEED\n", path,
+		(unsigned long)(len / (1024 * 1024)), LOADBENCH_REPS);
+
+	run("read_file", load_read_file, path, len);
+	run("fv_open sequential", load_view_seq, path, len);
+	run("fv_open willneed", load_view_willneed, path, len);
+
+	dbg_clean();
+
+	return 0;
+}
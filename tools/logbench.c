@@ -0,0 +1,180 @@
+#include "../src/util/debug.h"
+#include "../src/util/util.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdarg.h>
+#include <pthread.h>
+
+#define LOGBENCH_SUPPRESSED_CALLS		(64u * 1024 * 1024)
+#define LOGBENCH_EMITTED_CALLS			(1024u * 1024)
+#define LOGBENCH_BURST				(DBG_RING_CAP / 2)
+#define LOGBENCH_THREADS			4
+#define LOGBENCH_THREAD_CALLS			(256u * 1024)
+#define LOGBENCH_REPS				5
+
+typedef struct {
+	bool async;
+	uint32_t id;
+} bench_worker;
+
+static FILE					*null_fp;
+static FILE					*old_fp;
+
+/* what dbg_log used to do, a locked printf per part on the calling thread; on a terminal every line is a write */
+static void old_log(char *fmt, ...)
+{
+	va_list					args;
+
+	va_start(args, fmt);
+	fprintf(old_fp, "[%s] \"", "LOG");
+	vfprintf(old_fp, fmt, args);
+	fprintf(old_fp, "\"\n");
+	va_end(args);
+}
+
+static inline uint64_t best_suppressed(void)
+{
+	uint64_t				best, t;
+
+	best = UINT64_MAX;
+
+	for (uint32_t r = 0; r < LOGBENCH_REPS; r++) {
+		t = time_now_ns();
+
+		for (uint32_t i = 0; i < LOGBENCH_SUPPRESSED_CALLS; i++)
+			dbg_log("culled %u of %u instances in %.3f ms", i, i * 2, i * 1e-6);
+
+		t = time_now_ns() - t;
+
+		if (t < best)
+			best = t;
+	}
+
+	return best;
+}
+
+/* caller-side cost only: bursts fit in the ring and are flushed outside the timed region */
+static inline uint64_t best_emitted(bool async)
+{
+	uint64_t				best, t, ft;
+
+	best = UINT64_MAX;
+
+	for (uint32_t r = 0; r < LOGBENCH_REPS; r++) {
+		t = 0;
+
+		for (uint32_t b = 0; b < LOGBENCH_EMITTED_CALLS; b += LOGBENCH_BURST) {
+			ft = time_now_ns();
+
+			for (uint32_t i = b; i < b + LOGBENCH_BURST; i++) {
+				if (async)
+					dbg_log("culled %u of %u instances in %.3f ms", i, i * 2, i * 1e-6);
+				else
+					old_log("culled %u of %u instances in %.3f ms", i, i * 2, i * 1e-6);
+			}
+
+			t += time_now_ns() - ft;
+
+			if (async)
+				dbg_flush();
+		}
+
+		if (t < best)
+			best = t;
+	}
+
+	return best;
+}
+
+static void *worker_main(void *arg)
+{
+	bench_worker				*w;
+
+	w = arg;
+
+	for (uint32_t i = 0; i < LOGBENCH_THREAD_CALLS; i++) {
+		if (w->async)
+			dbg_info("worker %u finished job %u", w->id, i);
+		else
+			old_log("worker %u finished job %u", w->id, i);
+	}
+
+	return NULL;
+}
+
+/* wall time for every thread's lines to reach the file, writer included */
+static inline uint64_t threaded(bool async)
+{
+	pthread_t				threads[LOGBENCH_THREADS];
+	bench_worker				workers[LOGBENCH_THREADS];
+	uint64_t				t;
+
+	t = time_now_ns();
+
+	for (uint32_t i = 0; i < LOGBENCH_THREADS; i++) {
+		workers[i] = (bench_worker){
+			async,
+			i
+		};
+
+		pthread_create(&threads[i], NULL, worker_main, &workers[i]);
+	}
+
+	for (uint32_t i = 0; i < LOGBENCH_THREADS; i++)
+		pthread_join(threads[i], NULL);
+
+	if (async)
+		dbg_flush();
+	else
+		fflush(null_fp);
+
+	return time_now_ns() - t;
+}
+
+int main(int argc, char **argv)
+{
+	uint64_t				supp_ns, old_ns, old_tty_ns, async_ns, old_mt_ns, async_mt_ns;
+	FILE					*tty_fp;
+	char					*path;
+
+	path = argc > 1 ? argv[1] : "/dev/null";
+	null_fp = fopen(path, "w");
+	tty_fp = fopen(path, "w");
+
+	if (null_fp == NULL || tty_fp == NULL)
+		dbg_error("could not open %s", path);
+
+	setvbuf(tty_fp, NULL, _IOLBF, BUFSIZ);
+
+	dbg_init(DBG_LEVEL_WARN, path);
+
+	supp_ns = best_suppressed();
+
+	dbg_set_level(DBG_LEVEL_LOG);
+
+	old_fp = tty_fp;
+	old_tty_ns = best_emitted(false);
+
+	old_fp = null_fp;
+	old_ns = best_emitted(false);
+	async_ns = best_emitted(true);
+	old_mt_ns = threaded(false);
+	async_mt_ns = threaded(true);
+
+	dbg_clean();
+	fclose(null_fp);
+	fclose(tty_fp);
+
+	printf("suppressed by level     %8.2f ns/call\n", (double)supp_ns / LOGBENCH_SUPPRESSED_CALLS);
+	printf("printf, line buffered   %8.2f ns/call\n", (double)old_tty_ns / LOGBENCH_EMITTED_CALLS);
+	printf("printf, fully buffered  %8.2f ns/call\n", (double)old_ns / LOGBENCH_EMITTED_CALLS);
+	printf("queued for the writer   %8.2f ns/call\n", (double)async_ns / LOGBENCH_EMITTED_CALLS);
+	printf("%u threads, printf      %8.2f ms for %u lines\n", LOGBENCH_THREADS, old_mt_ns / 1e6,
+		LOGBENCH_THREADS * LOGBENCH_THREAD_CALLS);
+	printf("%u threads, queued      %8.2f ms for %u lines\n", LOGBENCH_THREADS, async_mt_ns / 1e6,
+		LOGBENCH_THREADS * LOGBENCH_THREAD_CALLS);
+
+	return 0;
+}
@@ -0,0 +1,55 @@
+#include "../src/util/debug.h"
+#include "../src/util/util.h"
+#include "../src/util/arena.h"
+#include "../src/engine/assets.h"
+#include "../src/engine/graphics/mesh.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define MESHBAKE_PATH_MAX			1024
+
+/* parses and optimizes an obj once at build time, so the game can stream the result straight into its buffers */
+int main(int argc, char **argv)
+{
+	mesh_data				md;
+	char					pak_path[MESHBAKE_PATH_MAX];
+	uint8_t					*blob;
+	uint64_t				len;
+	FILE					*fp;
+
+	if (argc < 4) {
+		printf("usage: meshbake <root dir> <obj name> <out.mesh>\n");
+
+		return 1;
+	}
+
+	/* only loose files are read, the pack in the root may be older than the obj */
+	snprintf(pak_path, sizeof(pak_path), "%s/.no-pack", argv[1]);
+
+	dbg_set_level(DBG_LEVEL_ERROR);
+	assets_init(pak_path, argv[1]);
+
+	mesh_data_init(&md);
+	mesh_data_load_obj(&md, argv[2]);
+	mesh_data_optimize(&md);
+
+	blob = mesh_bake(&md, MESH_QUANT_ALL, &len);
+
+	fp = fopen(argv[3], "wb");
+
+	if (fp == NULL || fwrite(blob, 1, len, fp) != len)
+		dbg_error("could not write %s", argv[3]);
+
+	fclose(fp);
+
+	printf("baked %s: %u vertices, %u indices, %lu bytes\n", argv[2], md.verts.size, md.inds.size,
+		(unsigned long)len);
+
+	mem_free(blob);
+	mesh_data_clean(&md);
+	assets_clean();
+
+	return 0;
+}
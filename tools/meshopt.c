@@ -0,0 +1,195 @@
+#include "../src/util/debug.h"
+#include "../src/util/util.h"
+#include "../src/engine/mesh_opt.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+#define MESHOPT_GRID_CELLS			256
+#define MESHOPT_SPHERE_RINGS			128
+#define MESHOPT_SPHERE_SEGS			256
+#define MESHOPT_PI				3.14159265358979f
+
+typedef struct {
+	float pos[3];
+	float normal[3];
+} corpus_vertex;
+
+typedef struct {
+	char *name;
+	corpus_vertex *verts;
+	uint32_t vert_cnt;
+	uint32_t *inds;
+	uint32_t idx_cnt;
+} corpus_mesh;
+
+static inline void alloc_mesh(corpus_mesh *m, char *name, uint32_t vert_cnt, uint32_t idx_cnt)
+{
+	m->name = name;
+	m->vert_cnt = vert_cnt;
+	m->idx_cnt = idx_cnt;
+	m->verts = malloc(vert_cnt * sizeof(corpus_vertex));
+	m->inds = malloc(idx_cnt * sizeof(uint32_t));
+}
+
+static inline void gen_grid(corpus_mesh *m, uint32_t cells)
+{
+	uint32_t				row, ind, a;
+
+	alloc_mesh(m, "grid", (cells + 1) * (cells + 1), cells * cells * 6);
+
+	for (uint32_t y = 0; y <= cells; y++) {
+		for (uint32_t x = 0; x <= cells; x++) {
+			m->verts[y * (cells + 1) + x] = (corpus_vertex){
+				{ (float)x, (float)y, 0.0f },
+				{ 0.0f, 0.0f, 1.0f }
+			};
+		}
+	}
+
+	row = cells + 1;
+	ind = 0;
+
+	for (uint32_t y = 0; y < cells; y++) {
+		for (uint32_t x = 0; x < cells; x++) {
+			a = y * row + x;
+
+			m->inds[ind++] = a;
+			m->inds[ind++] = a + 1;
+			m->inds[ind++] = a + row + 1;
+			m->inds[ind++] = a;
+			m->inds[ind++] = a + row + 1;
+			m->inds[ind++] = a + row;
+		}
+	}
+}
+
+/* exported per face like many dcc tools do, so dedup has real work to do */
+static inline void gen_sphere(corpus_mesh *m, uint32_t rings, uint32_t segs)
+{
+	float					theta, phi;
+	uint32_t				ind;
+	corpus_vertex				corners[4];
+
+	alloc_mesh(m, "sphere (per-face verts)", rings * segs * 6, rings * segs * 6);
+
+	ind = 0;
+
+	for (uint32_t r = 0; r < rings; r++) {
+		for (uint32_t s = 0; s < segs; s++) {
+			for (uint32_t c = 0; c < 4; c++) {
+				theta = (float)(r + (c >> 1)) / rings * MESHOPT_PI;
+				phi = (float)(s + ((c ^ (c >> 1)) & 1)) / segs * 2.0f * MESHOPT_PI;
+
+				corners[c].normal[0] = sinf(theta) * cosf(phi);
+				corners[c].normal[1] = cosf(theta);
+				corners[c].normal[2] = sinf(theta) * sinf(phi);
+
+				memcpy(corners[c].pos, corners[c].normal, sizeof(corners[c].pos));
+			}
+
+			m->verts[ind + 0] = corners[0];
+			m->verts[ind + 1] = corners[1];
+			m->verts[ind + 2] = corners[2];
+			m->verts[ind + 3] = corners[0];
+			m->verts[ind + 4] = corners[2];
+			m->verts[ind + 5] = corners[3];
+
+			for (uint32_t i = 0; i < 6; i++)
+				m->inds[ind + i] = ind + i;
+
+			ind += 6;
+		}
+	}
+}
+
+static inline void shuffle_tris(corpus_mesh *m, char *name)
+{
+	uint32_t				tri_cnt, j, tmp[3];
+
+	m->name = name;
+	tri_cnt = m->idx_cnt / 3;
+	srand(1);
+
+	for (uint32_t i = tri_cnt - 1; i > 0; i--) {
+		j = (uint32_t)rand() % (i + 1);
+
+		memcpy(tmp, m->inds + i * 3, sizeof(tmp));
+		memcpy(m->inds + i * 3, m->inds + j * 3, sizeof(tmp));
+		memcpy(m->inds + j * 3, tmp, sizeof(tmp));
+	}
+}
+
+static inline void report(corpus_mesh *m)
+{
+	mopt_cache_stats			before, after;
+	mopt_meshlets				ml;
+	uint64_t				start_ns, tipsify_ns, total_ns;
+	uint32_t				tri_cnt, orig_verts;
+
+	tri_cnt = m->idx_cnt / 3;
+	orig_verts = m->vert_cnt;
+
+	mopt_get_cache_stats(m->inds, m->idx_cnt, m->vert_cnt, MOPT_CACHE_SIZE, &before);
+
+	start_ns = time_now_ns();
+
+	m->vert_cnt = mopt_dedup(m->verts, sizeof(corpus_vertex), m->vert_cnt, m->inds, m->idx_cnt);
+
+	tipsify_ns = time_now_ns();
+
+	mopt_tipsify(m->inds, m->idx_cnt, m->vert_cnt, MOPT_CACHE_SIZE);
+
+	tipsify_ns = time_now_ns() - tipsify_ns;
+
+	mopt_overdraw(m->inds, m->idx_cnt, m->verts[0].pos, sizeof(corpus_vertex), MOPT_CACHE_SIZE);
+	m->vert_cnt = mopt_fetch(m->verts, sizeof(corpus_vertex), m->vert_cnt, m->inds, m->idx_cnt);
+
+	total_ns = time_now_ns() - start_ns;
+
+	mopt_get_cache_stats(m->inds, m->idx_cnt, m->vert_cnt, MOPT_CACHE_SIZE, &after);
+
+	/* both atvrs are over the deduplicated vertex count so they compare */
+	before.atvr = before.atvr * orig_verts / m->vert_cnt;
+
+	mopt_meshlets_init(&ml);
+	mopt_build_meshlets(&ml, m->inds, m->idx_cnt, m->vert_cnt, m->verts[0].pos, sizeof(corpus_vertex));
+
+	printf("%-28s %7u tris %7u -> %7u verts  acmr %.3f -> %.3f  atvr %.3f -> %.3f  "
+		"tipsify %.1f Mtris/s  all %.1f Mtris/s  %u meshlets\n",
+		m->name, tri_cnt, orig_verts, m->vert_cnt, before.acmr, after.acmr, before.atvr, after.atvr,
+		tri_cnt / (tipsify_ns / 1e9) / 1e6, tri_cnt / (total_ns / 1e9) / 1e6, ml.meshlets.size);
+
+	mopt_meshlets_clean(&ml);
+
+	free(m->verts);
+	free(m->inds);
+}
+
+int main(int argc, char **argv)
+{
+	corpus_mesh				m;
+	uint32_t				cells;
+
+	cells = argc > 1 ? strtoul(argv[1], NULL, 10) : MESHOPT_GRID_CELLS;
+
+	printf("cache size %u\n", MOPT_CACHE_SIZE);
+
+	gen_grid(&m, cells);
+	report(&m);
+
+	gen_grid(&m, cells);
+	shuffle_tris(&m, "grid (shuffled)");
+	report(&m);
+
+	gen_sphere(&m, MESHOPT_SPHERE_RINGS, MESHOPT_SPHERE_SEGS);
+	report(&m);
+
+	gen_sphere(&m, MESHOPT_SPHERE_RINGS, MESHOPT_SPHERE_SEGS);
+	shuffle_tris(&m, "sphere (per-face, shuffled)");
+	report(&m);
+
+	return 0;
+}
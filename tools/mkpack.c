@@ -0,0 +1,50 @@
+#include "../src/util/debug.h"
+#include "../src/util/pack.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define MKPACK_PATH_MAX				1024
+
+int main(int argc, char **argv)
+{
+	uint32_t				flags, src_cnt;
+	int					arg;
+	pak_src					*srcs;
+
+	flags = 0;
+	arg = 1;
+
+	if (arg < argc && strcmp(argv[arg], "-c") == 0) {
+		flags |= PAK_FLAG_COMPRESS;
+		arg++;
+	}
+
+	if (argc - arg < 3) {
+		printf("usage: mkpack [-c] <out.pak> <root dir> <asset name>...\n");
+
+		return 1;
+	}
+
+	src_cnt = argc - arg - 2;
+	srcs = malloc(src_cnt * sizeof(pak_src));
+
+	for (uint32_t i = 0; i < src_cnt; i++) {
+		srcs[i].name = argv[arg + 2 + i];
+		srcs[i].filepath = malloc(MKPACK_PATH_MAX);
+
+		snprintf(srcs[i].filepath, MKPACK_PATH_MAX, "%s/%s", argv[arg + 1], srcs[i].name);
+	}
+
+	pak_build(argv[arg], srcs, src_cnt, flags);
+
+	for (uint32_t i = 0; i < src_cnt; i++)
+		free(srcs[i].filepath);
+
+	free(srcs);
+
+	dbg_info("built asset pack");
+
+	return 0;
+}
@@ -0,0 +1,203 @@
+#include "../src/engine/pacing.h"
+#include "../src/util/util.h"
+#include "../src/util/dynarr.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <pthread.h>
+
+#define PACEBENCH_FRAMES			300
+#define PACEBENCH_CPU_WORK_NS			(1000 * 1000)
+#define PACEBENCH_MIN_BLOCK_NS			(1000 * 1000)
+#define PACEBENCH_MAX_BLOCK_NS			(5 * 1000 * 1000)
+#define PACEBENCH_MIN_INPUT_NS			(500 * 1000)
+#define PACEBENCH_MAX_INPUT_NS			(4 * 1000 * 1000)
+
+typedef struct {
+	const char *name;
+	pace_mode mode;
+	uint32_t fps;
+	bool event_wait;
+} bench_case;
+
+static frame_pacer				pacer;
+static pthread_mutex_t				event_lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t				event_cond;
+static uint32_t					event_pending;
+static bool					stop;
+
+static inline uint32_t rand_next(uint32_t *state)
+{
+	*state ^= *state << 13;
+	*state ^= *state >> 17;
+	*state ^= *state << 5;
+
+	return *state;
+}
+
+static inline void sleep_ns(uint64_t ns)
+{
+	struct timespec				ts;
+
+	ts.tv_sec = ns / 1000000000ull;
+	ts.tv_nsec = ns % 1000000000ull;
+
+	nanosleep(&ts, NULL);
+}
+
+/* stands in for glfwPollEvents */
+static void poll_events(void)
+{
+	pthread_mutex_lock(&event_lock);
+	event_pending = 0;
+	pthread_mutex_unlock(&event_lock);
+}
+
+/* stands in for glfwWaitEventsTimeout, returns as soon as an event is queued */
+static void wait_events(double timeout)
+{
+	struct timespec				ts;
+	uint64_t				until;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+
+	until = (uint64_t)ts.tv_sec * 1000000000ull + ts.tv_nsec + (uint64_t)(timeout * 1e9);
+	ts.tv_sec = until / 1000000000ull;
+	ts.tv_nsec = until % 1000000000ull;
+
+	pthread_mutex_lock(&event_lock);
+
+	while (event_pending == 0 && pthread_cond_timedwait(&event_cond, &event_lock, &ts) == 0)
+		;
+
+	event_pending = 0;
+
+	pthread_mutex_unlock(&event_lock);
+}
+
+/* mouse motion at a jittery 250 to 2000 hz, the way a window system would deliver it */
+static void *input_main(void *arg)
+{
+	uint32_t				seed;
+
+	(void)arg;
+	seed = 0x9e3779b9u;
+
+	while (!__atomic_load_n(&stop, __ATOMIC_RELAXED)) {
+		sleep_ns(PACEBENCH_MIN_INPUT_NS + rand_next(&seed) % (PACEBENCH_MAX_INPUT_NS - PACEBENCH_MIN_INPUT_NS));
+
+		pace_input(&pacer);
+
+		pthread_mutex_lock(&event_lock);
+		event_pending++;
+		pthread_cond_signal(&event_cond);
+		pthread_mutex_unlock(&event_lock);
+	}
+
+	return NULL;
+}
+
+/* a frame is a millisecond of cpu work, then a varying block on the gpu or present */
+static inline void fake_frame(uint32_t *seed)
+{
+	uint64_t				end;
+
+	end = time_now_ns() + PACEBENCH_CPU_WORK_NS;
+
+	while (time_now_ns() < end)
+		;
+
+	sleep_ns(PACEBENCH_MIN_BLOCK_NS + rand_next(seed) % (PACEBENCH_MAX_BLOCK_NS - PACEBENCH_MIN_BLOCK_NS));
+}
+
+static inline void run_case(const bench_case *bc)
+{
+	pace_summary				sum;
+	pthread_t				input;
+	uint32_t				seed;
+
+	seed = 12345;
+
+	pace_init(&pacer, bc->mode, bc->fps);
+	pace_set_events(&pacer, poll_events, bc->event_wait ? wait_events : NULL);
+
+	__atomic_store_n(&stop, false, __ATOMIC_RELAXED);
+	pthread_create(&input, NULL, input_main, NULL);
+
+	for (uint32_t i = 0; i < PACEBENCH_FRAMES; i++) {
+		pace_frame_begin(&pacer);
+		fake_frame(&seed);
+		pace_frame_end(&pacer);
+	}
+
+	pace_summarize(&pacer, &sum);
+
+	__atomic_store_n(&stop, true, __ATOMIC_RELAXED);
+	pthread_join(input, NULL);
+	pace_clean(&pacer);
+
+	printf("%-28s %8.3f %8.3f %8.3f %8.3f %8.3f %7llu %6.1f%%\n", bc->name, sum.frame_p50_ns / 1e6,
+		sum.frame_p99_ns / 1e6, sum.frame_stddev_ns / 1e6, sum.latency_p50_ns / 1e6,
+		sum.latency_p99_ns / 1e6, (unsigned long long)sum.missed, sum.cpu_pct);
+}
+
+int main(int argc, char **argv)
+{
+	pthread_condattr_t			attr;
+	uint32_t				fps;
+	bench_case				cases[5];
+
+	fps = argc > 1 ? strtoul(argv[1], NULL, 10) : PACE_DEFAULT_FPS;
+
+	pthread_condattr_init(&attr);
+	pthread_condattr_setclock(&attr, CLOCK_MONOTONIC);
+	pthread_cond_init(&event_cond, &attr);
+	pthread_condattr_destroy(&attr);
+
+	dbg_init(DBG_LEVEL_WARN, NULL);
+
+	cases[0] = (bench_case){
+		"uncapped busy loop",
+		PACE_LOW_LATENCY,
+		0,
+		false
+	};
+	cases[1] = (bench_case){
+		"low-latency cap",
+		PACE_LOW_LATENCY,
+		PACE_DEFAULT_CAP_FPS,
+		false
+	};
+	cases[2] = (bench_case){
+		"sleep only",
+		PACE_POWER_SAVING,
+		fps,
+		false
+	};
+	cases[3] = (bench_case){
+		"power-saving event wait",
+		PACE_POWER_SAVING,
+		fps,
+		true
+	};
+	cases[4] = (bench_case){
+		"target-fps sleep and spin",
+		PACE_TARGET_FPS,
+		fps,
+		false
+	};
+
+	printf("%u frames each, target %u fps, frame times and latencies in ms\n", PACEBENCH_FRAMES, fps);
+	printf("%-28s %8s %8s %8s %8s %8s %7s %7s\n", "", "p50", "p99", "stddev", "lat p50", "lat p99", "missed",
+		"cpu");
+
+	for (uint32_t i = 0; i < ARRAY_SIZE(cases); i++)
+		run_case(&cases[i]);
+
+	pthread_cond_destroy(&event_cond);
+	dbg_clean();
+
+	return 0;
+}
@@ -0,0 +1,322 @@
+#include "../src/util/debug.h"
+#include "../src/util/util.h"
+#include "../src/util/arena.h"
+#include "../src/util/pack.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/stat.h>
+
+#define PACKBENCH_ASSETS			1000
+#define PACKBENCH_MIN_SIZE			(4u * 1024)
+#define PACKBENCH_MAX_SIZE			(256u * 1024)
+#define PACKBENCH_PATH_MAX			256
+#define PACKBENCH_PAGE				4096
+#define PACKBENCH_REPS				3
+
+typedef struct {
+	char names[PACKBENCH_ASSETS][32];
+	char paths[PACKBENCH_ASSETS][PACKBENCH_PATH_MAX];
+	pak_src srcs[PACKBENCH_ASSETS];
+	char raw_pak[PACKBENCH_PATH_MAX];
+	char lz4_pak[PACKBENCH_PATH_MAX];
+	uint64_t total_len;
+} bench_set;
+
+typedef uint64_t (*load_fn)(bench_set *set, uint64_t *sum);
+
+static inline uint32_t rand_next(uint32_t *state)
+{
+	*state ^= *state << 13;
+	*state ^= *state >> 17;
+	*state ^= *state << 5;
+
+	return *state;
+}
+
+/* runs of repeated words between noisy ones, so lz4 gets roughly 2:1 like real meshes */
+static inline void gen_asset(uint8_t *buf, uint32_t len, uint32_t seed)
+{
+	uint32_t				x, w;
+
+	x = seed * 2654435761u + 1;
+	w = 0;
+
+	for (uint32_t i = 0; i + 4 <= len; i += 4) {
+		x = x * 1664525u + 1013904223u;
+
+		if ((x >> 28) < 7)
+			w = x;
+
+		memcpy(buf + i, &w, 4);
+	}
+}
+
+/* one byte per page and the last one, so every page is faulted in, copied or inflated before the clock stops */
+static inline uint64_t touch_pages(const uint8_t *data, size_t len)
+{
+	uint64_t				sum;
+
+	sum = data[len - 1];
+
+	for (size_t i = 0; i < len; i += PACKBENCH_PAGE)
+		sum += data[i];
+
+	return sum;
+}
+
+/* the loader before file views: an open to measure the file, a second to read it into a heap copy */
+static uint64_t load_read_file(bench_set *set, uint64_t *sum)
+{
+	FILE					*fp;
+	uint8_t					*data;
+	uint64_t				start_ns;
+	size_t					len;
+
+	*sum = 0;
+	start_ns = time_now_ns();
+
+	for (uint32_t i = 0; i < PACKBENCH_ASSETS; i++) {
+		fp = fopen(set->paths[i], "rb");
+
+		if (fp == NULL)
+			dbg_error("could not open %s", set->paths[i]);
+
+		fseek(fp, 0, SEEK_END);
+
+		len = ftell(fp);
+
+		fclose(fp);
+
+		data = mem_alloc(len);
+		fp = fopen(set->paths[i], "rb");
+
+		if (data == NULL || fp == NULL || fread(data, 1, len, fp) != len)
+			dbg_error("could not read %s", set->paths[i]);
+
+		fclose(fp);
+
+		*sum += touch_pages(data, len);
+
+		mem_free(data);
+	}
+
+	return time_now_ns() - start_ns;
+}
+
+static uint64_t load_view(bench_set *set, uint64_t *sum)
+{
+	file_view				fv;
+	uint64_t				start_ns;
+
+	*sum = 0;
+	start_ns = time_now_ns();
+
+	for (uint32_t i = 0; i < PACKBENCH_ASSETS; i++) {
+		fv_open(&fv, set->paths[i], FV_HINT_SEQUENTIAL);
+
+		*sum += touch_pages(fv.data, fv.len);
+
+		fv_close(&fv);
+	}
+
+	return time_now_ns() - start_ns;
+}
+
+/* the pack is opened inside the timed region, a level load pays for that once too */
+static inline uint64_t load_pack(char *pak_path, uint32_t flags, bench_set *set, uint64_t *sum)
+{
+	pak					pk;
+	const pak_entry				*entry;
+	pak_blob				blob;
+	uint64_t				start_ns;
+
+	*sum = 0;
+	start_ns = time_now_ns();
+
+	if (!pak_open(&pk, pak_path, flags))
+		dbg_error("could not open %s", pak_path);
+
+	for (uint32_t i = 0; i < PACKBENCH_ASSETS; i++) {
+		entry = pak_find(&pk, set->names[i]);
+
+		if (entry == NULL || !pak_read(&pk, entry, &blob))
+			dbg_error("could not read %s from %s", set->names[i], pak_path);
+
+		*sum += touch_pages(blob.data, blob.len);
+
+		pak_blob_release(&blob);
+	}
+
+	pak_close(&pk);
+
+	return time_now_ns() - start_ns;
+}
+
+static uint64_t load_raw_pak(bench_set *set, uint64_t *sum)
+{
+	return load_pack(set->raw_pak, 0, set, sum);
+}
+
+static uint64_t load_raw_pak_verify(bench_set *set, uint64_t *sum)
+{
+	return load_pack(set->raw_pak, PAK_FLAG_VERIFY, set, sum);
+}
+
+static uint64_t load_lz4_pak(bench_set *set, uint64_t *sum)
+{
+	return load_pack(set->lz4_pak, 0, set, sum);
+}
+
+static uint64_t load_lz4_pak_verify(bench_set *set, uint64_t *sum)
+{
+	return load_pack(set->lz4_pak, PAK_FLAG_VERIFY, set, sum);
+}
+
+/* sizes come from a fixed seed, so reruns reuse the files and packs already on disk */
+static inline void build_set(bench_set *set, char *dir)
+{
+	uint8_t					*buf;
+	uint32_t				seed, len;
+	struct stat				st;
+	FILE					*fp;
+	bool					have_paks;
+
+	buf = mem_alloc(PACKBENCH_MAX_SIZE);
+
+	if (buf == NULL)
+		dbg_error("failed to allocate asset buffer");
+
+	snprintf(set->raw_pak, sizeof(set->raw_pak), "%s/raw.pak", dir);
+	snprintf(set->lz4_pak, sizeof(set->lz4_pak), "%s/lz4.pak", dir);
+
+	have_paks = stat(set->raw_pak, &st) == 0 && stat(set->lz4_pak, &st) == 0;
+	seed = 0x9e3779b9u;
+	set->total_len = 0;
+
+	mkdir(dir, 0755);
+
+	for (uint32_t i = 0; i < PACKBENCH_ASSETS; i++) {
+		len = PACKBENCH_MIN_SIZE + rand_next(&seed) % (PACKBENCH_MAX_SIZE - PACKBENCH_MIN_SIZE);
+		set->total_len += len;
+
+		snprintf(set->names[i], sizeof(set->names[i]), "asset_%04u.bin", i);
+		snprintf(set->paths[i], sizeof(set->paths[i]), "%s/%s", dir, set->names[i]);
+
+		set->srcs[i] = (pak_src){
+			set->names[i],
+			set->paths[i]
+		};
+
+		if (have_paks && stat(set->paths[i], &st) == 0 && (uint32_t)st.st_size == len)
+			continue;
+
+		gen_asset(buf, len, i);
+
+		fp = fopen(set->paths[i], "wb");
+
+		if (fp == NULL || fwrite(buf, 1, len, fp) != len)
+			dbg_error("could not write %s", set->paths[i]);
+
+		fclose(fp);
+
+		have_paks = false;
+	}
+
+	if (!have_paks) {
+		pak_build(set->raw_pak, set->srcs, PACKBENCH_ASSETS, 0);
+		pak_build(set->lz4_pak, set->srcs, PACKBENCH_ASSETS, PAK_FLAG_COMPRESS);
+	}
+
+	mem_free(buf);
+}
+
+/* drops a file from the page cache without root, unlike drop_caches */
+static inline void evict(char *path)
+{
+	int					fd;
+
+	fd = open(path, O_RDONLY);
+
+	if (fd < 0)
+		dbg_error("could not open %s", path);
+
+	fdatasync(fd);
+	posix_fadvise(fd, 0, 0, POSIX_FADV_DONTNEED);
+	close(fd);
+}
+
+static inline void evict_set(bench_set *set)
+{
+	for (uint32_t i = 0; i < PACKBENCH_ASSETS; i++)
+		evict(set->paths[i]);
+
+	evict(set->raw_pak);
+	evict(set->lz4_pak);
+}
+
+static inline void run(const char *name, load_fn fn, bench_set *set)
+{
+	uint64_t				cold_ns, warm_ns, ns, sum;
+
+	cold_ns = UINT64_MAX;
+	warm_ns = UINT64_MAX;
+
+	for (uint32_t r = 0; r < PACKBENCH_REPS; r++) {
+		evict_set(set);
+
+		ns = fn(set, &sum);
+		cold_ns = ns < cold_ns ? ns : cold_ns;
+
+		ns = fn(set, &sum);
+		warm_ns = ns < warm_ns ? ns : warm_ns;
+	}
+
+	printf("%-22s cold %9.2f ms %7.2f us/asset   warm %9.2f ms %7.2f us/asset   (sum %lu)\n", name,
+		cold_ns / 1e6, cold_ns / 1e3 / PACKBENCH_ASSETS, warm_ns / 1e6, warm_ns / 1e3 / PACKBENCH_ASSETS,
+		(unsigned long)sum);
+}
+
+int main(int argc, char **argv)
+{
+	bench_set				*set;
+	char					*dir;
+	file_view				fv;
+
+	dir = argc > 1 ? argv[1] : "build/packbench_data";
+
+	dbg_init(DBG_LEVEL_WARN, NULL);
+
+	set = mem_alloc(sizeof(bench_set));
+
+	if (set == NULL)
+		dbg_error("failed to allocate bench set");
+
+	build_set(set, dir);
+
+	printf("%u assets, %.1f MB loose, best of %u, cold runs evicted with POSIX_FADV_DONTNEED\n", PACKBENCH_ASSETS,
+		set->total_len / (1024.0 * 1024.0), PACKBENCH_REPS);
+
+	fv_open(&fv, set->raw_pak, FV_HINT_NONE);
+	printf("%s %.1f MB", set->raw_pak, fv.len / (1024.0 * 1024.0));
+	fv_close(&fv);
+
+	fv_open(&fv, set->lz4_pak, FV_HINT_NONE);
+	printf(", %s %.1f MB\n", set->lz4_pak, fv.len / (1024.0 * 1024.0));
+	fv_close(&fv);
+
+	run("loose read_file", load_read_file, set);
+	run("loose fv_open", load_view, set);
+	run("pak", load_raw_pak, set);
+	run("pak verify", load_raw_pak_verify, set);
+	run("pak lz4", load_lz4_pak, set);
+	run("pak lz4 verify", load_lz4_pak_verify, set);
+
+	mem_free(set);
+	dbg_clean();
+
+	return 0;
+}
@@ -0,0 +1,129 @@
+#include "../src/util/debug.h"
+#include "../src/util/util.h"
+#include "../src/util/prof.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+/* without it the zones compile away and the overhead subtraction underflows */
+#ifndef PROF_ENABLE
+#error "profbench measures zone overhead, build it with -DPROF_ENABLE"
+#endif
+
+#define PROFBENCH_CALLS				(8u * 1024 * 1024)
+#define PROFBENCH_FLUSH_EVERY			(PROF_RING_CAP / 2)
+#define PROFBENCH_REPS				5
+
+static volatile uint64_t			sink;
+
+__attribute__((noinline)) static void plain(uint64_t i)
+{
+	sink += i;
+}
+
+__attribute__((noinline)) static void zoned(uint64_t i)
+{
+	PROF_ZONE("zoned");
+
+	sink += i;
+}
+
+__attribute__((noinline)) static void nested(uint64_t i)
+{
+	PROF_ZONE("outer");
+
+	{
+		PROF_ZONE("middle");
+
+		{
+			PROF_ZONE("inner");
+
+			sink += i;
+		}
+	}
+}
+
+__attribute__((noinline)) static void ticks_only(uint64_t i)
+{
+	sink += prof_ticks() + i;
+}
+
+/* best of a few runs of calls through fn, flushing between batches like a frame boundary would */
+static inline uint64_t time_calls(void (*fn)(uint64_t), uint64_t *flush_ns)
+{
+	uint64_t				best, t, f, ft;
+
+	best = UINT64_MAX;
+	*flush_ns = UINT64_MAX;
+
+	for (uint32_t r = 0; r < PROFBENCH_REPS; r++) {
+		t = 0;
+		f = 0;
+
+		for (uint32_t b = 0; b < PROFBENCH_CALLS; b += PROFBENCH_FLUSH_EVERY) {
+			ft = time_now_ns();
+
+			for (uint32_t i = b; i < b + PROFBENCH_FLUSH_EVERY; i++)
+				fn(i);
+
+			t += time_now_ns() - ft;
+			ft = time_now_ns();
+
+			prof_flush();
+
+			f += time_now_ns() - ft;
+		}
+
+		if (t < best)
+			best = t;
+
+		if (f < *flush_ns)
+			*flush_ns = f;
+	}
+
+	return best;
+}
+
+int main(int argc, char **argv)
+{
+	uint64_t				base, tick, zone, deep, flush, flush_deep, trace_flush;
+	double					per_zone, per_tick;
+
+	(void)argc;
+	(void)argv;
+
+	prof_init(NULL);
+
+	base = time_calls(plain, &flush);
+	tick = time_calls(ticks_only, &flush);
+	zone = time_calls(zoned, &flush);
+	deep = time_calls(nested, &flush_deep);
+
+	printf("%.2f ticks/ns\n", prof_ticks_per_ns());
+	printf("%-28s %.2f ns/call\n", "plain call", (double)base / PROFBENCH_CALLS);
+	printf("%-28s %.2f ns/call\n", "call with one zone", (double)zone / PROFBENCH_CALLS);
+	printf("%-28s %.2f ns/call\n", "call with three nested", (double)deep / PROFBENCH_CALLS);
+
+	per_zone = (double)(zone - base) / PROFBENCH_CALLS;
+	per_tick = (double)(tick - base) / PROFBENCH_CALLS;
+
+	/* a zone is two timer reads plus a ring store, the reads are whatever the cpu or hypervisor charges */
+	printf("%-28s %.2f ns (%.2f ns nested)\n", "zone overhead", per_zone,
+		(double)(deep - base) / PROFBENCH_CALLS / 3.0);
+	printf("%-28s %.2f ns, so %.2f ns of bookkeeping per zone\n", "timer read", per_tick, per_zone - 2.0 * per_tick);
+	printf("%-28s %.2f ns/zone\n", "flush to summary", (double)flush / PROFBENCH_CALLS);
+
+	prof_clean();
+
+	/* the trace writer is the expensive consumer, measured separately into /dev/null */
+	prof_init("/dev/null");
+
+	time_calls(zoned, &trace_flush);
+
+	printf("%-28s %.2f ns/zone\n", "flush to chrome trace", (double)trace_flush / PROFBENCH_CALLS);
+
+	prof_clean();
+
+	return 0;
+}
@@ -0,0 +1,314 @@
+#include "../src/util/debug.h"
+#include "../src/util/util.h"
+#include "../src/util/pack.h"
+#include "../src/engine/assets.h"
+#include "../src/engine/stream.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <math.h>
+#include <sys/stat.h>
+
+#define STREAMBENCH_ASSETS			64
+#define STREAMBENCH_ASSET_SIZE			(8u * 1024 * 1024)
+#define STREAMBENCH_TARGETS			4
+#define STREAMBENCH_REQS			(STREAMBENCH_ASSETS * STREAMBENCH_TARGETS)
+#define STREAMBENCH_CANCEL_EVERY		16
+#define STREAMBENCH_GPU_RING			(64u * 1024 * 1024)
+#define STREAMBENCH_FRAME_NS			(1000000000ull / 60)
+#define STREAMBENCH_WORK_NS			(4ull * 1000 * 1000)
+#define STREAMBENCH_PUMP_BUDGET			(16ull * 1024 * 1024)
+#define STREAMBENCH_BASE_FRAMES			120
+#define STREAMBENCH_MAX_FRAMES			100000
+
+/* where one asset lands, its sampled hash is compared against the generated source */
+typedef struct {
+	uint64_t hash;
+	uint64_t bytes;
+	uint64_t expect;
+} bench_target;
+
+static uint8_t					*gpu_ring;
+static uint64_t					gpu_cursor;
+
+/* one word per cache line, keyed by offset so chunks can be hashed in any order */
+static inline uint64_t sample_hash(const uint8_t *data, uint64_t offset, uint64_t len)
+{
+	uint64_t				h, w;
+
+	h = 0;
+
+	for (uint64_t p = (offset + 63) & ~63ull; p + 8 <= offset + len; p += 64) {
+		memcpy(&w, data + (p - offset), 8);
+		h += (w ^ p) * 0x9e3779b97f4a7c15ull;
+	}
+
+	return h;
+}
+
+/* runs of repeated words between noisy ones, so lz4 gets roughly 2:1 like real meshes */
+static inline void gen_asset(uint8_t *buf, uint64_t len, uint32_t seed)
+{
+	uint32_t				x, w;
+
+	x = seed * 2654435761u + 1;
+	w = 0;
+
+	for (uint64_t i = 0; i + 4 <= len; i += 4) {
+		x = x * 1664525u + 1013904223u;
+
+		if ((x >> 28) < 7)
+			w = x;
+
+		memcpy(buf + i, &w, 4);
+	}
+}
+
+/* stands in for upload_buffer: copy into a ring the size of a staging buffer */
+static uint64_t fake_upload(void *user, const uint8_t *data, uint64_t offset, uint64_t len)
+{
+	bench_target				*t;
+	uint64_t				n;
+
+	t = user;
+
+	for (uint64_t done = 0; done < len; done += n) {
+		if (gpu_cursor == STREAMBENCH_GPU_RING)
+			gpu_cursor = 0;
+
+		n = len - done < STREAMBENCH_GPU_RING - gpu_cursor ? len - done : STREAMBENCH_GPU_RING - gpu_cursor;
+
+		memcpy(gpu_ring + gpu_cursor, data + done, n);
+		gpu_cursor += n;
+	}
+
+	t->hash += sample_hash(data, offset, len);
+	t->bytes += len;
+
+	return len;
+}
+
+static inline void build_pack(char *dir, char *pak_path, uint64_t *expect)
+{
+	pak_src					srcs[STREAMBENCH_ASSETS];
+	char					names[STREAMBENCH_ASSETS][64], paths[STREAMBENCH_ASSETS][ASSET_PATH_MAX];
+	uint8_t					*buf;
+	struct stat				st;
+	FILE					*fp;
+	bool					have_pak;
+
+	buf = mem_alloc(STREAMBENCH_ASSET_SIZE);
+	have_pak = stat(pak_path, &st) == 0;
+
+	mkdir(dir, 0755);
+
+	for (uint32_t i = 0; i < STREAMBENCH_ASSETS; i++) {
+		gen_asset(buf, STREAMBENCH_ASSET_SIZE, i);
+		expect[i] = sample_hash(buf, 0, STREAMBENCH_ASSET_SIZE);
+
+		snprintf(names[i], sizeof(names[i]), "asset_%03u.bin", i);
+		snprintf(paths[i], sizeof(paths[i]), "%s/%s", dir, names[i]);
+
+		srcs[i] = (pak_src){
+			names[i],
+			paths[i]
+		};
+
+		if (have_pak)
+			continue;
+
+		fp = fopen(paths[i], "wb");
+
+		if (fp == NULL || fwrite(buf, 1, STREAMBENCH_ASSET_SIZE, fp) != STREAMBENCH_ASSET_SIZE)
+			dbg_error("could not write synthetic asset");
+
+		fclose(fp);
+	}
+
+	if (!have_pak) {
+		pak_build(pak_path, srcs, STREAMBENCH_ASSETS, PAK_FLAG_COMPRESS);
+
+		/* only the pack is streamed, the loose copies would just shadow nothing */
+		for (uint32_t i = 0; i < STREAMBENCH_ASSETS; i++)
+			remove(paths[i]);
+	}
+
+	mem_free(buf);
+}
+
+/* a stand-in for game update and draw recording, a fixed slice of cpu per frame */
+static inline void frame_work(void)
+{
+	volatile float				x;
+	uint64_t				end;
+
+	x = 1.0f;
+	end = time_now_ns() + STREAMBENCH_WORK_NS;
+
+	while (time_now_ns() < end) {
+		for (uint32_t i = 0; i < 256; i++)
+			x = sqrtf(x + 1.0f);
+	}
+}
+
+static inline void wait_vsync(uint64_t frame_start)
+{
+	struct timespec				ts;
+	uint64_t				deadline;
+
+	deadline = frame_start + STREAMBENCH_FRAME_NS;
+	ts.tv_sec = deadline / 1000000000ull;
+	ts.tv_nsec = deadline % 1000000000ull;
+
+	clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &ts, NULL);
+}
+
+static int cmp_u64(const void *a, const void *b)
+{
+	uint64_t				x, y;
+
+	x = *(const uint64_t *)a;
+	y = *(const uint64_t *)b;
+
+	return (x > y) - (x < y);
+}
+
+static inline void report(char *name, uint64_t *ns, uint32_t cnt)
+{
+	qsort(ns, cnt, sizeof(uint64_t), cmp_u64);
+
+	printf("%-18s %5u frames  p50 %.2f ms  p99 %.2f ms  max %.2f ms\n", name, cnt, ns[cnt / 2] / 1e6,
+		ns[(uint64_t)cnt * 99 / 100] / 1e6, ns[cnt - 1] / 1e6);
+}
+
+int main(int argc, char **argv)
+{
+	streamer				s;
+	stream_stats				stats;
+	stream_desc				desc;
+	stream_handle				handles[STREAMBENCH_REQS];
+	bench_target				*targets;
+	uint64_t				expect[STREAMBENCH_ASSETS];
+	uint64_t				*base_ns, *stream_ns;
+	uint64_t				start_ns, frame_start, t;
+	uint32_t				frames, bad, a;
+	char					*dir, pak_path[ASSET_PATH_MAX], name[64];
+
+	dir = argc > 1 ? argv[1] : "build/streambench";
+
+	snprintf(pak_path, sizeof(pak_path), "%s/stream.pak", dir);
+
+	build_pack(dir, pak_path, expect);
+
+	gpu_ring = mem_alloc(STREAMBENCH_GPU_RING);
+	targets = mem_alloc(STREAMBENCH_REQS * sizeof(bench_target));
+	base_ns = mem_alloc(STREAMBENCH_BASE_FRAMES * sizeof(uint64_t));
+	stream_ns = mem_alloc(STREAMBENCH_MAX_FRAMES * sizeof(uint64_t));
+
+	memset(gpu_ring, '\0', STREAMBENCH_GPU_RING);
+
+	for (uint32_t i = 0; i < STREAMBENCH_REQS; i++) {
+		targets[i] = (bench_target){
+			0,
+			0,
+			expect[i % STREAMBENCH_ASSETS]
+		};
+	}
+
+	assets_init(pak_path, dir);
+	stream_init(&s, STREAM_DEFAULT_BUDGET, 0, 0);
+
+	for (uint32_t f = 0; f < STREAMBENCH_BASE_FRAMES; f++) {
+		frame_start = time_now_ns();
+
+		frame_work();
+		stream_pump(&s, STREAMBENCH_PUMP_BUDGET);
+
+		base_ns[f] = time_now_ns() - frame_start;
+
+		wait_vsync(frame_start);
+	}
+
+	/* every asset to four targets is 2 gb, each requested twice to exercise dedup */
+	start_ns = time_now_ns();
+
+	for (uint32_t i = 0; i < STREAMBENCH_REQS; i++) {
+		a = i % STREAMBENCH_ASSETS;
+
+		snprintf(name, sizeof(name), "asset_%03u.bin", a);
+
+		desc = (stream_desc){
+			name,
+			(stream_prio)(i % STREAM_PRIO_CNT),
+			fake_upload,
+			&targets[i]
+		};
+
+		handles[i] = stream_request(&s, &desc);
+
+		if (stream_request(&s, &desc) != handles[i])
+			dbg_error("duplicate request was not merged");
+
+		stream_release(&s, handles[i]);
+	}
+
+	for (frames = 0; stream_pending(&s) > 0 && frames < STREAMBENCH_MAX_FRAMES; frames++) {
+		frame_start = time_now_ns();
+
+		/* a few requests are dropped mid-flight, whatever stage they reached */
+		if (frames == 2) {
+			for (uint32_t i = 0; i < STREAMBENCH_REQS; i += STREAMBENCH_CANCEL_EVERY) {
+				stream_release(&s, handles[i]);
+				handles[i] = STREAM_NULL;
+			}
+		}
+
+		frame_work();
+		stream_pump(&s, STREAMBENCH_PUMP_BUDGET);
+
+		stream_ns[frames] = time_now_ns() - frame_start;
+
+		wait_vsync(frame_start);
+	}
+
+	t = time_now_ns() - start_ns;
+
+	stream_get_stats(&s, &stats);
+
+	bad = 0;
+
+	for (uint32_t i = 0; i < STREAMBENCH_REQS; i++) {
+		if (handles[i] == STREAM_NULL)
+			continue;
+
+		if (stream_status(&s, handles[i]) != STREAM_DONE || targets[i].hash != targets[i].expect ||
+			targets[i].bytes != STREAMBENCH_ASSET_SIZE)
+			bad++;
+
+		stream_release(&s, handles[i]);
+	}
+
+	printf("streamed %.2f gb (%.2f gb read from the pack) in %.2f s, %.2f gb/s\n", stats.bytes_uploaded / 1e9,
+		stats.bytes_read / 1e9, t / 1e9, stats.bytes_uploaded / (double)t);
+	printf("%lu requests, %lu merged, %lu cancelled, %lu failed, %lu completed, %u corrupt\n",
+		(unsigned long)stats.requested, (unsigned long)stats.dedup_hits, (unsigned long)stats.cancelled,
+		(unsigned long)stats.failed, (unsigned long)stats.completed, bad);
+	printf("peak resident %.1f mb of %.1f mb budget, %lu budget waits, avg latency %.1f ms, max pump %.2f ms\n",
+		stats.peak_mem / 1e6, STREAM_DEFAULT_BUDGET / 1e6, (unsigned long)stats.budget_waits,
+		stats.completed ? stats.total_latency_ns / 1e6 / stats.completed : 0.0, stats.max_pump_ns / 1e6);
+
+	report("idle frames", base_ns, STREAMBENCH_BASE_FRAMES);
+	report("streaming frames", stream_ns, frames);
+
+	stream_clean(&s);
+	assets_clean();
+
+	mem_free(gpu_ring);
+	mem_free(targets);
+	mem_free(base_ns);
+	mem_free(stream_ns);
+
+	return bad != 0;
+}